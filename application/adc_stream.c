@@ -0,0 +1,377 @@
+/**
+ * @file    adc_stream.c
+ * @brief   Circular DMA ADC acquisition and USB streaming code.
+ * @details ADC1 runs a continuous circular conversion into a two halves
+ *          DMA buffer. Each half is decimated in the DMA callback straight
+ *          into an output block taken from a pool, full blocks are queued
+ *          and handed to the bulk IN endpoint without further copies. The
+ *          IN completion returns the block to the pool and starts the next
+ *          one, if the host falls behind the pool runs dry and new blocks
+ *          are dropped and counted.
+ *
+ * @{
+ */
+
+#include "ch.h"
+#include "hal.h"
+
+#include "ccm.h"
+#include "adc_stream.h"
+
+#if HAL_USE_ADC || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+/* Clears the bits shifted from the upper lane into the lower one.*/
+#define LANE_MASK                                                           \
+  ((0xFFFFU >> ADC_STREAM_DECIMATION_SHIFT) |                               \
+   ((0xFFFFU >> ADC_STREAM_DECIMATION_SHIFT) << 16))
+
+/* Delay before restarting the conversion after an ADC error.*/
+#define ADC_STREAM_RESTART_DELAY    MS2ST(1)
+
+/*===========================================================================*/
+/* Driver local variables.                                                   */
+/*===========================================================================*/
+
+/* Circular DMA buffer, two halves of ADC_STREAM_HALF_FRAMES frames.*/
+static DMA_RAM adcsample_t adc_ring[2 * ADC_STREAM_HALF_FRAMES *
+                                    ADC_STREAM_NUM_CHANNELS]
+                                    __attribute__((aligned(4)));
+
+/* Blocks are filled by the CPU and read by the OTG FS core through its
+   FIFO, no DMA involved.*/
+static CCM_RAM adc_stream_block_t blocks[ADC_STREAM_NUM_BLOCKS];
+static MemoryPool block_pool;
+
+/* Blocks waiting for the endpoint, in production order.*/
+static adc_stream_block_t *txq[ADC_STREAM_NUM_BLOCKS];
+static unsigned txq_head, txq_count;
+
+/* Most recent block, retained for inspection until the next one.*/
+static adc_stream_block_t *latest;
+
+static adc_stream_stats_t stats;
+static uint32_t seq;
+static bool_t running;
+static VirtualTimer restart_vt;
+
+#if ADC_STREAM_USE_USB
+static USBDriver *stream_usbp;
+static adc_stream_block_t *inflight;
+static bool_t zlp_pending;
+#endif
+
+static void adc_stream_cb(ADCDriver *adcp, adcsample_t *buffer, size_t n);
+static void adc_stream_err_cb(ADCDriver *adcp, adcerror_t err);
+
+/*
+ * ADC conversion group.
+ * Mode:        Continuous, circular, 4 channels, SW triggered.
+ * Channels:    IN8 (PB0), IN9 (PB1), IN11 (PC1), IN12 (PC2).
+ */
+static const ADCConversionGroup adcgrpcfg = {
+  TRUE,
+  ADC_STREAM_NUM_CHANNELS,
+  adc_stream_cb,
+  adc_stream_err_cb,
+  0,                        /* CR1 */
+  ADC_CR2_SWSTART,          /* CR2 */
+  ADC_SMPR1_SMP_AN11(ADC_SAMPLE_480) | ADC_SMPR1_SMP_AN12(ADC_SAMPLE_480),
+  ADC_SMPR2_SMP_AN8(ADC_SAMPLE_480) | ADC_SMPR2_SMP_AN9(ADC_SAMPLE_480),
+  ADC_SQR1_NUM_CH(ADC_STREAM_NUM_CHANNELS),
+  0,                        /* SQR2 */
+  ADC_SQR3_SQ4_N(ADC_CHANNEL_IN12) | ADC_SQR3_SQ3_N(ADC_CHANNEL_IN11) |
+  ADC_SQR3_SQ2_N(ADC_CHANNEL_IN9)  | ADC_SQR3_SQ1_N(ADC_CHANNEL_IN8)
+};
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+/*
+ * Boxcar decimation of interleaved frames. Channel pairs are loaded as
+ * one word and accumulated with a dual 16 bits add, 12 bits samples
+ * cannot overflow a lane for decimation factors up to 8.
+ */
+static void decimate(const adcsample_t *in, adcsample_t *out, size_t frames) {
+  const uint32_t *ip = (const uint32_t *)in;
+  uint32_t *op = (uint32_t *)out;
+  unsigned d, w;
+
+  while (frames-- > 0) {
+    uint32_t acc[ADC_STREAM_NUM_CHANNELS / 2] = {0};
+
+    for (d = 0; d < ADC_STREAM_DECIMATION; d++) {
+      for (w = 0; w < ADC_STREAM_NUM_CHANNELS / 2; w++) {
+#if defined(__CORTEX_M) && (__CORTEX_M == 0x04)
+        acc[w] = __SADD16(acc[w], *ip++);
+#else
+        acc[w] += *ip++;
+#endif
+      }
+    }
+    for (w = 0; w < ADC_STREAM_NUM_CHANNELS / 2; w++)
+      *op++ = (acc[w] >> ADC_STREAM_DECIMATION_SHIFT) & LANE_MASK;
+  }
+}
+
+#if ADC_STREAM_USE_USB
+/*
+ * Starts the next queued block if the endpoint is idle.
+ */
+static void stream_kick_i(void) {
+  USBDriver *usbp = stream_usbp;
+
+  if ((usbp == NULL) || (inflight != NULL) || (txq_count == 0) ||
+      (usbGetDriverStateI(usbp) != USB_ACTIVE))
+    return;
+
+  inflight = txq[txq_head];
+  txq_head = (txq_head + 1) % ADC_STREAM_NUM_BLOCKS;
+  txq_count--;
+
+  usbPrepareTransmit(usbp, ADC_STREAM_USB_EP,
+                     (const uint8_t *)inflight, sizeof (adc_stream_block_t));
+  usbStartTransmitI(usbp, ADC_STREAM_USB_EP);
+}
+#endif /* ADC_STREAM_USE_USB */
+
+/*
+ * Returns all the blocks waiting for the endpoint to the pool, except the
+ * latest one which is released when superseded.
+ */
+static void stream_flush_i(void) {
+
+  while (txq_count > 0) {
+    if (txq[txq_head] != latest)
+      chPoolFreeI(&block_pool, txq[txq_head]);
+    txq_head = (txq_head + 1) % ADC_STREAM_NUM_BLOCKS;
+    txq_count--;
+  }
+}
+
+/*
+ * Publishes a completed block, it becomes the latest one and, when the
+ * USB sink is active, is queued for transmission.
+ */
+static void stream_publish_i(adc_stream_block_t *bp) {
+
+  if (latest != NULL) {
+    bool_t queued = FALSE;
+    unsigned i;
+
+    /* The previous latest block is released unless it is still owned by
+       the transmit side.*/
+    for (i = 0; i < txq_count; i++)
+      if (txq[(txq_head + i) % ADC_STREAM_NUM_BLOCKS] == latest)
+        queued = TRUE;
+#if ADC_STREAM_USE_USB
+    if (latest == inflight)
+      queued = TRUE;
+#endif
+    if (!queued)
+      chPoolFreeI(&block_pool, latest);
+  }
+  latest = bp;
+  stats.produced++;
+
+#if ADC_STREAM_USE_USB
+  if ((stream_usbp != NULL) &&
+      (usbGetDriverStateI(stream_usbp) == USB_ACTIVE)) {
+    txq[(txq_head + txq_count) % ADC_STREAM_NUM_BLOCKS] = bp;
+    txq_count++;
+    stream_kick_i();
+  }
+#endif
+}
+
+/*
+ * ADC half and full buffer callback, runs in the DMA ISR.
+ */
+static void adc_stream_cb(ADCDriver *adcp, adcsample_t *buffer, size_t n) {
+  adc_stream_block_t *bp;
+
+  (void)adcp;
+
+  chSysLockFromIsr();
+  bp = chPoolAllocI(&block_pool);
+  if (bp == NULL) {
+    seq++;
+    stats.dropped++;
+    chSysUnlockFromIsr();
+    return;
+  }
+  chSysUnlockFromIsr();
+
+  /* Decimation runs outside the critical zone, the block is private until
+     published.*/
+  bp->hdr.seq        = seq++;
+  bp->hdr.dropped    = stats.dropped;
+  bp->hdr.frames     = n / ADC_STREAM_DECIMATION;
+  bp->hdr.channels   = ADC_STREAM_NUM_CHANNELS;
+  bp->hdr.decimation = ADC_STREAM_DECIMATION;
+  decimate(buffer, bp->samples, n / ADC_STREAM_DECIMATION);
+
+  chSysLockFromIsr();
+  stream_publish_i(bp);
+  chSysUnlockFromIsr();
+}
+
+/*
+ * Restarts the conversion after an error, the driver is back in the ready
+ * state once the error callback returns.
+ */
+static void restart_cb(void *p) {
+
+  (void)p;
+
+  chSysLockFromIsr();
+  if (running && (ADCD1.state == ADC_READY))
+    adcStartConversionI(&ADCD1, &adcgrpcfg, adc_ring,
+                        2 * ADC_STREAM_HALF_FRAMES);
+  chSysUnlockFromIsr();
+}
+
+/*
+ * ADC overflow or DMA failure, the driver has stopped the conversion.
+ */
+static void adc_stream_err_cb(ADCDriver *adcp, adcerror_t err) {
+
+  (void)adcp;
+  (void)err;
+
+  chSysLockFromIsr();
+  stats.errors++;
+  if (running && !chVTIsArmedI(&restart_vt))
+    chVTSetI(&restart_vt, ADC_STREAM_RESTART_DELAY, restart_cb, NULL);
+  chSysUnlockFromIsr();
+}
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Starts the acquisition pipeline.
+ * @note    The analog pins must already be configured.
+ *
+ * @api
+ */
+void adcStreamStart(void) {
+
+  chPoolInit(&block_pool, sizeof (adc_stream_block_t), NULL);
+  chPoolLoadArray(&block_pool, blocks, ADC_STREAM_NUM_BLOCKS);
+  txq_head = txq_count = 0;
+  latest = NULL;
+  seq = 0;
+  stats.produced = stats.sent = stats.dropped = stats.errors = 0;
+  running = TRUE;
+
+  adcStart(&ADCD1, NULL);
+  adcStartConversion(&ADCD1, &adcgrpcfg, adc_ring,
+                     2 * ADC_STREAM_HALF_FRAMES);
+}
+
+/**
+ * @brief   Stops the acquisition pipeline.
+ * @note    A block already handed to the endpoint completes normally.
+ *
+ * @api
+ */
+void adcStreamStop(void) {
+
+  chSysLock();
+  running = FALSE;
+  if (chVTIsArmedI(&restart_vt))
+    chVTResetI(&restart_vt);
+  chSysUnlock();
+
+  adcStopConversion(&ADCD1);
+  adcStop(&ADCD1);
+
+  chSysLock();
+  stream_flush_i();
+  chSysUnlock();
+}
+
+/**
+ * @brief   Returns a snapshot of the counters and of the latest frame.
+ *
+ * @param[out] stp      pointer to the counters snapshot
+ * @param[out] frame    latest decimated frame, zeroed if none yet
+ *
+ * @api
+ */
+void adcStreamGetStats(adc_stream_stats_t *stp,
+                       adcsample_t frame[ADC_STREAM_NUM_CHANNELS]) {
+  unsigned i;
+
+  chSysLock();
+  *stp = stats;
+  for (i = 0; i < ADC_STREAM_NUM_CHANNELS; i++)
+    frame[i] = (latest != NULL) ?
+               latest->samples[(latest->hdr.frames - 1) *
+                               ADC_STREAM_NUM_CHANNELS + i] : 0;
+  chSysUnlock();
+}
+
+#if ADC_STREAM_USE_USB || defined(__DOXYGEN__)
+/**
+ * @brief   USB device configured handler.
+ * @details Reclaims the blocks owned by the endpoint before the reset and
+ *          binds the stream to the driver.
+ *
+ * @param[in] usbp      pointer to the @p USBDriver object
+ *
+ * @iclass
+ */
+void adcStreamConfigureHookI(USBDriver *usbp) {
+
+  stream_flush_i();
+  if ((inflight != NULL) && (inflight != latest))
+    chPoolFreeI(&block_pool, inflight);
+  inflight = NULL;
+  zlp_pending = FALSE;
+  stream_usbp = usbp;
+}
+
+/**
+ * @brief   Default data transmitted callback.
+ * @details The application must use this function as callback for the IN
+ *          data endpoint.
+ *
+ * @param[in] usbp      pointer to the @p USBDriver object
+ * @param[in] ep        endpoint number
+ */
+void adcStreamDataTransmitted(USBDriver *usbp, usbep_t ep) {
+
+  chSysLockFromIsr();
+  if (inflight != NULL) {
+    /* Isochronous transfers are single packets, no termination needed.*/
+    if (!ADC_STREAM_USB_ISOC && !zlp_pending &&
+        !(sizeof (adc_stream_block_t) & (ADC_STREAM_USB_PKT_SIZE - 1))) {
+      /* The block ended on a packet boundary, a zero sized packet closes
+         the transfer on the host side.*/
+      zlp_pending = TRUE;
+      usbPrepareTransmit(usbp, ep, NULL, 0);
+      usbStartTransmitI(usbp, ep);
+      chSysUnlockFromIsr();
+      return;
+    }
+    zlp_pending = FALSE;
+    stats.sent++;
+    if (inflight != latest)
+      chPoolFreeI(&block_pool, inflight);
+    inflight = NULL;
+  }
+  stream_kick_i();
+  chSysUnlockFromIsr();
+}
+#endif /* ADC_STREAM_USE_USB */
+
+#endif /* HAL_USE_ADC */
+
+/** @} */
@@ -0,0 +1,218 @@
+/**
+ * @file    adc_stream.h
+ * @brief   Circular DMA ADC acquisition and USB streaming macros and
+ *          structures.
+ *
+ * @{
+ */
+
+#ifndef _ADC_STREAM_H_
+#define _ADC_STREAM_H_
+
+#if HAL_USE_ADC || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @name    ADC_STREAM configuration options
+ * @{
+ */
+/**
+ * @brief   Number of channels sampled in each frame.
+ * @note    Must be even, channel pairs are decimated as packed halfwords.
+ */
+#if !defined(ADC_STREAM_NUM_CHANNELS) || defined(__DOXYGEN__)
+#define ADC_STREAM_NUM_CHANNELS     4
+#endif
+
+/**
+ * @brief   Boxcar decimation factor.
+ * @note    Must be a power of two not greater than 8, so that the sum of
+ *          12 bits samples never leaves a signed 16 bits lane.
+ */
+#if !defined(ADC_STREAM_DECIMATION) || defined(__DOXYGEN__)
+#define ADC_STREAM_DECIMATION       8
+#endif
+
+/**
+ * @brief   Decimated frames carried by each output block.
+ * @details Each half of the circular DMA buffer holds exactly the raw
+ *          frames needed to fill one block.
+ */
+#if !defined(ADC_STREAM_BLOCK_FRAMES) || defined(__DOXYGEN__)
+#define ADC_STREAM_BLOCK_FRAMES     32
+#endif
+
+/**
+ * @brief   Number of output blocks in the pool.
+ * @details Blocks not yet taken by the host are held here, when the pool
+ *          is exhausted new blocks are dropped and counted.
+ */
+#if !defined(ADC_STREAM_NUM_BLOCKS) || defined(__DOXYGEN__)
+#define ADC_STREAM_NUM_BLOCKS       4
+#endif
+
+/**
+ * @brief   USB streaming sink switch.
+ * @details If enabled the blocks are sent to the host over
+ *          @p ADC_STREAM_USB_EP, otherwise they are produced, counted and
+ *          recycled locally.
+ * @note    The default is @p FALSE because the OTG FS core only has
+ *          endpoints 1-3 and all of them are taken by the CDC and
+ *          instrument interfaces. Enable it when running on OTG HS.
+ */
+#if !defined(ADC_STREAM_USE_USB) || defined(__DOXYGEN__)
+#define ADC_STREAM_USE_USB          FALSE
+#endif
+
+/**
+ * @brief   IN endpoint used for the sample stream.
+ */
+#if !defined(ADC_STREAM_USB_EP) || defined(__DOXYGEN__)
+#define ADC_STREAM_USB_EP           4
+#endif
+
+/**
+ * @brief   Isochronous streaming.
+ * @details If enabled the endpoint is isochronous, one block is sent in
+ *          each frame so the stream gets reserved bandwidth. The block in
+ *          flight and the next queued one form a double buffer.
+ */
+#if !defined(ADC_STREAM_USB_ISOC) || defined(__DOXYGEN__)
+#define ADC_STREAM_USB_ISOC         FALSE
+#endif
+
+/**
+ * @brief   IN endpoint maximum packet size.
+ * @note    In isochronous mode a whole block must fit in one packet.
+ */
+#if !defined(ADC_STREAM_USB_PKT_SIZE) || defined(__DOXYGEN__)
+#if ADC_STREAM_USB_ISOC || defined(__DOXYGEN__)
+#define ADC_STREAM_USB_PKT_SIZE     ADC_STREAM_BLOCK_SIZE
+#else
+#define ADC_STREAM_USB_PKT_SIZE     0x0040
+#endif
+#endif
+/** @} */
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+#if (ADC_STREAM_NUM_CHANNELS & 1) != 0
+#error "ADC_STREAM_NUM_CHANNELS must be even"
+#endif
+
+#if (ADC_STREAM_DECIMATION == 1)
+#define ADC_STREAM_DECIMATION_SHIFT 0
+#elif (ADC_STREAM_DECIMATION == 2)
+#define ADC_STREAM_DECIMATION_SHIFT 1
+#elif (ADC_STREAM_DECIMATION == 4)
+#define ADC_STREAM_DECIMATION_SHIFT 2
+#elif (ADC_STREAM_DECIMATION == 8)
+#define ADC_STREAM_DECIMATION_SHIFT 3
+#else
+#error "ADC_STREAM_DECIMATION must be 1, 2, 4 or 8"
+#endif
+
+/**
+ * @brief   Raw frames in each half of the circular buffer.
+ */
+#define ADC_STREAM_HALF_FRAMES                                              \
+  (ADC_STREAM_BLOCK_FRAMES * ADC_STREAM_DECIMATION)
+
+/**
+ * @brief   Size of an output block in bytes.
+ */
+#define ADC_STREAM_BLOCK_SIZE                                               \
+  (12 + ADC_STREAM_BLOCK_FRAMES * ADC_STREAM_NUM_CHANNELS * 2)
+
+#if ADC_STREAM_USB_ISOC && (ADC_STREAM_USB_PKT_SIZE < ADC_STREAM_BLOCK_SIZE)
+#error "ADC_STREAM_USB_PKT_SIZE too small for isochronous streaming"
+#endif
+
+#if ADC_STREAM_USE_USB && !HAL_USE_USB
+#error "ADC_STREAM_USE_USB requires HAL_USE_USB"
+#endif
+
+#if ADC_STREAM_USE_USB && (ADC_STREAM_USB_EP > USB_MAX_ENDPOINTS)
+#error "ADC_STREAM_USB_EP not available on this OTG core"
+#endif
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Output block header, sent in front of every block.
+ */
+typedef struct {
+  /** @brief Block sequence number, gaps mean dropped blocks.*/
+  uint32_t                  seq;
+  /** @brief Total blocks dropped so far.*/
+  uint32_t                  dropped;
+  /** @brief Decimated frames in this block.*/
+  uint16_t                  frames;
+  /** @brief Channels in each frame.*/
+  uint8_t                   channels;
+  /** @brief Decimation factor applied.*/
+  uint8_t                   decimation;
+} adc_stream_header_t;
+
+/**
+ * @brief   Output block, header followed by interleaved samples.
+ */
+typedef struct {
+  adc_stream_header_t       hdr;
+  adcsample_t               samples[ADC_STREAM_BLOCK_FRAMES *
+                                    ADC_STREAM_NUM_CHANNELS];
+} adc_stream_block_t;
+
+/**
+ * @brief   Pipeline counters.
+ */
+typedef struct {
+  /** @brief Blocks produced from the DMA buffer.*/
+  uint32_t                  produced;
+  /** @brief Blocks handed to the host.*/
+  uint32_t                  sent;
+  /** @brief Blocks dropped because the pool was exhausted.*/
+  uint32_t                  dropped;
+  /** @brief ADC overflow or DMA errors, each one restarts the stream.*/
+  uint32_t                  errors;
+} adc_stream_stats_t;
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void adcStreamStart(void);
+  void adcStreamStop(void);
+  void adcStreamGetStats(adc_stream_stats_t *stp,
+                         adcsample_t frame[ADC_STREAM_NUM_CHANNELS]);
+#if ADC_STREAM_USE_USB
+  void adcStreamConfigureHookI(USBDriver *usbp);
+  void adcStreamDataTransmitted(USBDriver *usbp, usbep_t ep);
+#endif
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_USE_ADC */
+
+#endif /* _ADC_STREAM_H_ */
+
+/** @} */
@@ -0,0 +1,135 @@
+/**
+ * @file    boot.c
+ * @brief   Boot timeline and startup helpers code.
+ * @details The cycle counter is started by the board early initialization,
+ *          so the timeline covers everything after the clock setup,
+ *          including the DATA and BSS initialization in crt0.
+ *
+ * @{
+ */
+
+#include "ch.h"
+#include "hal.h"
+#include "chprintf.h"
+
+#include "boot.h"
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local variables.                                                   */
+/*===========================================================================*/
+
+static boot_phase_t phases[BOOT_MAX_PHASES];
+static unsigned nphases;
+
+/**
+ * @brief   Reset flags latched by @p bootInit().
+ */
+static uint32_t reset_flags;
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+static const char *reset_cause(void) {
+
+  if (reset_flags & RCC_CSR_LPWRRSTF)
+    return "low power";
+  if (reset_flags & RCC_CSR_WWDGRSTF)
+    return "window watchdog";
+  if (reset_flags & RCC_CSR_WDGRSTF)
+    return "watchdog";
+  if (reset_flags & RCC_CSR_SFTRSTF)
+    return "software";
+  /* POR and BOR also assert the reset pin, checked first.*/
+  if (reset_flags & (RCC_CSR_PORRSTF | RCC_CSR_BORRSTF))
+    return "power on";
+  if (reset_flags & RCC_CSR_PADRSTF)
+    return "pin";
+  return "unknown";
+}
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Latches and clears the reset flags, records the first phase.
+ * @note    Must be called on entry of @p main(), before @p halInit().
+ *
+ * @api
+ */
+void bootInit(void) {
+
+  reset_flags = RCC->CSR;
+  RCC->CSR |= RCC_CSR_RMVF;
+  bootMark("startup");
+}
+
+/**
+ * @brief   Records the end of a boot phase.
+ * @note    Marks beyond @p BOOT_MAX_PHASES are ignored.
+ *
+ * @param[in] name      phase name, must be a literal
+ *
+ * @api
+ */
+void bootMark(const char *name) {
+  halrtcnt_t now = halGetCounterValue();
+
+  chSysLock();
+  if (nphases < BOOT_MAX_PHASES) {
+    phases[nphases].name  = name;
+    phases[nphases].stamp = now;
+    nphases++;
+  }
+  chSysUnlock();
+}
+
+/**
+ * @brief   Time the USB pull-up must stay disabled before connecting.
+ * @details No wait is needed if the bus is not powered or if the reset
+ *          was a power on, in both cases no host can have the device
+ *          enumerated.
+ *
+ * @return              The disconnect time in system ticks.
+ *
+ * @api
+ */
+systime_t bootUsbDisconnectTime(void) {
+
+  if (!palReadPad(GPIOA, GPIOA_VBUS_FS))
+    return 0;
+  if (reset_flags & (RCC_CSR_PORRSTF | RCC_CSR_BORRSTF))
+    return 0;
+  return MS2ST(BOOT_USB_DISCONNECT_TIME);
+}
+
+/**
+ * @brief   Prints the boot timeline.
+ *
+ * @param[in] chp       output stream
+ *
+ * @api
+ */
+void bootPrintTimeline(BaseSequentialStream *chp) {
+  halrtcnt_t prev = 0;
+  unsigned i;
+
+  chprintf(chp, "reset cause: %s\r\n", reset_cause());
+  chprintf(chp, "phase              end us  phase us\r\n");
+  for (i = 0; i < nphases; i++) {
+    chprintf(chp, "%-16s %8U %9U\r\n", phases[i].name,
+             RTT2US(phases[i].stamp), RTT2US(phases[i].stamp - prev));
+    prev = phases[i].stamp;
+  }
+}
+
+/** @} */
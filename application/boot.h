@@ -0,0 +1,84 @@
+/**
+ * @file    boot.h
+ * @brief   Boot timeline and startup helpers macros and structures.
+ *
+ * @{
+ */
+
+#ifndef _BOOT_H_
+#define _BOOT_H_
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @name    BOOT configuration options
+ * @{
+ */
+/**
+ * @brief   Maximum number of recorded boot phases.
+ */
+#if !defined(BOOT_MAX_PHASES) || defined(__DOXYGEN__)
+#define BOOT_MAX_PHASES             16
+#endif
+
+/**
+ * @brief   USB detach time in milliseconds.
+ * @details Time the pull-up is kept disabled when a host may still have
+ *          the device enumerated from before the reset, so that the host
+ *          notices the detach.
+ */
+#if !defined(BOOT_USB_DISCONNECT_TIME) || defined(__DOXYGEN__)
+#define BOOT_USB_DISCONNECT_TIME    100
+#endif
+/** @} */
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+#if !HAL_IMPLEMENTS_COUNTERS
+#error "BOOT requires the realtime counter service"
+#endif
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Boot phase record.
+ */
+typedef struct {
+  /** @brief Phase name, the phase ends at @p stamp.*/
+  const char                *name;
+  /** @brief Cycle counter at the end of the phase.*/
+  halrtcnt_t                stamp;
+} boot_phase_t;
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void bootInit(void);
+  void bootMark(const char *name);
+  systime_t bootUsbDisconnectTime(void);
+  void bootPrintTimeline(BaseSequentialStream *chp);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BOOT_H_ */
+
+/** @} */
@@ -0,0 +1,388 @@
+/**
+ * @file    bulk_pkt_usb.c
+ * @brief   Packets over USB bulk endpoints Driver code.
+ * @details Alternative to the bulk bytes driver for packetized protocols,
+ *          USB transfers are performed directly on caller-owned buffers
+ *          posted in a ring, there is no intermediate queue.
+ *
+ * @{
+ */
+
+#include "ch.h"
+#include "hal.h"
+
+#include "bulk_pkt_usb.h"
+
+#if HAL_USE_USB || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+#define RING_MASK                   (BULK_PKT_USB_RING_SIZE - 1)
+
+#define ring_slot(rp, i)            (&(rp)->slots[(i) & RING_MASK])
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local variables.                                                   */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+static void ring_reset(bpu_ring_t *rp) {
+
+  rp->wr   = 0;
+  rp->busy = 0;
+  rp->rd   = 0;
+}
+
+/**
+ * @brief   Starts a receive on the oldest posted buffer, if any.
+ * @note    @p usbPrepareReceive() only programs the endpoint registers so
+ *          it is safe to call it within the critical zone.
+ */
+static void rx_start_i(BulkPacketUSBDriver *bpup) {
+  USBDriver *usbp = bpup->config->usbp;
+  usbep_t ep = bpup->config->bulk_out;
+  bpu_slot_t *sp;
+
+  if ((usbGetDriverStateI(usbp) != USB_ACTIVE) ||
+      usbGetReceiveStatusI(usbp, ep) || (bpup->rx.busy == bpup->rx.wr))
+    return;
+
+  sp = ring_slot(&bpup->rx, bpup->rx.busy);
+  usbPrepareReceive(usbp, ep, sp->buf, sp->n);
+  usbStartReceiveI(usbp, ep);
+}
+
+/**
+ * @brief   Starts a transmit of the oldest posted buffer, if any.
+ */
+static void tx_start_i(BulkPacketUSBDriver *bpup) {
+  USBDriver *usbp = bpup->config->usbp;
+  usbep_t ep = bpup->config->bulk_in;
+  bpu_slot_t *sp;
+
+  if ((usbGetDriverStateI(usbp) != USB_ACTIVE) ||
+      usbGetTransmitStatusI(usbp, ep) || (bpup->tx.busy == bpup->tx.wr))
+    return;
+
+  sp = ring_slot(&bpup->tx, bpup->tx.busy);
+  usbPrepareTransmit(usbp, ep, sp->buf, sp->n);
+  usbStartTransmitI(usbp, ep);
+}
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Initializes a bulk packets over USB driver object.
+ *
+ * @param[out] bpup     pointer to a @p BulkPacketUSBDriver structure
+ *
+ * @init
+ */
+void bpuObjectInit(BulkPacketUSBDriver *bpup) {
+
+  bpup->state  = BPU_STOP;
+  bpup->config = NULL;
+  chEvtInit(&bpup->event);
+  ring_reset(&bpup->rx);
+  chSemInit(&bpup->rxsem, 0);
+  ring_reset(&bpup->tx);
+  chSemInit(&bpup->txsem, BULK_PKT_USB_RING_SIZE);
+  bpup->txzlp  = FALSE;
+}
+
+/**
+ * @brief   Configures and starts the driver.
+ *
+ * @param[in] bpup      pointer to a @p BulkPacketUSBDriver object
+ * @param[in] config    the bulk packets over USB driver configuration
+ *
+ * @api
+ */
+void bpuStart(BulkPacketUSBDriver *bpup, const BulkPacketUSBConfig *config) {
+
+  chDbgCheck((bpup != NULL) && (config != NULL), "bpuStart");
+
+  chSysLock();
+  chDbgAssert(bpup->state == BPU_STOP, "bpuStart(), #1", "invalid state");
+  chDbgAssert((usbGetEndpointParamX(config->usbp, config->bulk_in) == NULL) &&
+              (usbGetEndpointParamX(config->usbp, config->bulk_out) == NULL),
+              "bpuStart(), #2",
+              "endpoint already in use");
+  bpup->config = config;
+  usbSetEndpointParamI(config->usbp, config->bulk_in, bpup);
+  usbSetEndpointParamI(config->usbp, config->bulk_out, bpup);
+  bpup->state = BPU_READY;
+  chSysUnlock();
+}
+
+/**
+ * @brief   Stops the driver.
+ * @details Threads waiting for buffers are awakened with @p RDY_RESET,
+ *          all the posted buffers are returned to the caller.
+ *
+ * @param[in] bpup      pointer to a @p BulkPacketUSBDriver object
+ *
+ * @api
+ */
+void bpuStop(BulkPacketUSBDriver *bpup) {
+
+  chDbgCheck(bpup != NULL, "bpuStop");
+
+  chSysLock();
+  chDbgAssert((bpup->state == BPU_STOP) || (bpup->state == BPU_READY),
+              "bpuStop(), #1",
+              "invalid state");
+  if (bpup->state == BPU_READY) {
+    usbSetEndpointParamI(bpup->config->usbp, bpup->config->bulk_in, NULL);
+    usbSetEndpointParamI(bpup->config->usbp, bpup->config->bulk_out, NULL);
+  }
+  bpup->state = BPU_STOP;
+  ring_reset(&bpup->rx);
+  chSemResetI(&bpup->rxsem, 0);
+  ring_reset(&bpup->tx);
+  chSemResetI(&bpup->txsem, BULK_PKT_USB_RING_SIZE);
+  bpup->txzlp = FALSE;
+  chSchRescheduleS();
+  chSysUnlock();
+}
+
+/**
+ * @brief   Posts a receive buffer.
+ * @details The buffer is filled by exactly one USB transfer, a transfer
+ *          ends when @p n bytes have been received or on a short packet.
+ * @note    @p n should be a multiple of the endpoint maximum packet size.
+ * @note    At most @p BULK_PKT_USB_RING_SIZE buffers can be posted and not
+ *          yet returned by @p bpuReceiveTimeout().
+ *
+ * @param[in] bpup      pointer to a @p BulkPacketUSBDriver object
+ * @param[in] buf       caller-owned buffer
+ * @param[in] n         buffer size
+ *
+ * @iclass
+ */
+void bpuPostReceiveI(BulkPacketUSBDriver *bpup, uint8_t *buf, size_t n) {
+  bpu_slot_t *sp;
+
+  chDbgCheckClassI();
+  chDbgCheck((bpup != NULL) && (buf != NULL) && (n > 0), "bpuPostReceiveI");
+  chDbgAssert(bpup->rx.wr - bpup->rx.rd < BULK_PKT_USB_RING_SIZE,
+              "bpuPostReceiveI(), #1",
+              "ring full");
+
+  sp = ring_slot(&bpup->rx, bpup->rx.wr);
+  sp->buf = buf;
+  sp->n   = n;
+  bpup->rx.wr++;
+  if (bpup->state == BPU_READY)
+    rx_start_i(bpup);
+}
+
+/**
+ * @brief   Posts a receive buffer.
+ * @details See @p bpuPostReceiveI().
+ *
+ * @param[in] bpup      pointer to a @p BulkPacketUSBDriver object
+ * @param[in] buf       caller-owned buffer
+ * @param[in] n         buffer size
+ *
+ * @api
+ */
+void bpuPostReceive(BulkPacketUSBDriver *bpup, uint8_t *buf, size_t n) {
+
+  chSysLock();
+  bpuPostReceiveI(bpup, buf, n);
+  chSysUnlock();
+}
+
+/**
+ * @brief   Returns the oldest filled receive buffer.
+ * @details The buffer goes back to the caller which can process it and
+ *          post it again.
+ *
+ * @param[in] bpup      pointer to a @p BulkPacketUSBDriver object
+ * @param[out] bufp     pointer to the returned buffer
+ * @param[in] time      the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The number of bytes received or an error code.
+ * @retval RDY_TIMEOUT  if a buffer was not filled within the specified
+ *                      timeout.
+ * @retval RDY_RESET    if the driver has been stopped.
+ *
+ * @api
+ */
+msg_t bpuReceiveTimeout(BulkPacketUSBDriver *bpup, uint8_t **bufp,
+                        systime_t time) {
+  bpu_slot_t *sp;
+  msg_t msg;
+
+  chDbgCheck((bpup != NULL) && (bufp != NULL), "bpuReceiveTimeout");
+
+  chSysLock();
+  if ((msg = chSemWaitTimeoutS(&bpup->rxsem, time)) == RDY_OK) {
+    sp = ring_slot(&bpup->rx, bpup->rx.rd);
+    bpup->rx.rd++;
+    *bufp = sp->buf;
+    msg = (msg_t)sp->n;
+  }
+  chSysUnlock();
+  return msg;
+}
+
+/**
+ * @brief   Posts a packet for transmission.
+ * @details The buffer is sent as one USB transfer, terminated by a zero
+ *          length packet when its size is a multiple of the endpoint
+ *          maximum packet size. The function waits for a free slot, the
+ *          buffer is owned by the driver until it is released.
+ * @note    Transmit buffers are released in order, a caller rotating
+ *          among @p BULK_PKT_USB_RING_SIZE + 1 buffers can safely refill
+ *          the next one as soon as this function returns.
+ *
+ * @param[in] bpup      pointer to a @p BulkPacketUSBDriver object
+ * @param[in] buf       caller-owned buffer
+ * @param[in] n         packet size
+ * @param[in] time      the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The operation status.
+ * @retval RDY_OK       if the packet has been posted.
+ * @retval RDY_TIMEOUT  if a slot did not free within the specified
+ *                      timeout.
+ * @retval RDY_RESET    if the driver has been stopped or the device has
+ *                      been reconfigured.
+ *
+ * @api
+ */
+msg_t bpuPostTransmitTimeout(BulkPacketUSBDriver *bpup, uint8_t *buf,
+                             size_t n, systime_t time) {
+  bpu_slot_t *sp;
+  msg_t msg;
+
+  chDbgCheck((bpup != NULL) && (buf != NULL), "bpuPostTransmitTimeout");
+
+  chSysLock();
+  if ((msg = chSemWaitTimeoutS(&bpup->txsem, time)) == RDY_OK) {
+    sp = ring_slot(&bpup->tx, bpup->tx.wr);
+    sp->buf = buf;
+    sp->n   = n;
+    bpup->tx.wr++;
+    if (bpup->state == BPU_READY)
+      tx_start_i(bpup);
+  }
+  chSysUnlock();
+  return msg;
+}
+
+/**
+ * @brief   USB device configured handler.
+ * @details Transmissions in progress are lost with the bus reset, pending
+ *          transmit buffers are released and the writers awakened with
+ *          @p RDY_RESET. Posted receive buffers are kept and reception
+ *          restarts from the oldest one.
+ *
+ * @param[in] usbp      pointer to the @p USBDriver object
+ *
+ * @iclass
+ */
+void bpuConfigureHookI(USBDriver *usbp) {
+  usbep_t ep;
+
+  for (ep = 1; ep <= USB_MAX_ENDPOINTS; ep++) {
+    BulkPacketUSBDriver *bpup = usbGetEndpointParamX(usbp, ep);
+
+    if ((bpup == NULL) || (usbp->epc[ep] == NULL) ||
+        (usbp->epc[ep]->out_cb != bpuDataReceived) ||
+        (bpup->state != BPU_READY) || (bpup->config->bulk_out != ep))
+      continue;
+
+    ring_reset(&bpup->tx);
+    chSemResetI(&bpup->txsem, BULK_PKT_USB_RING_SIZE);
+    bpup->txzlp = FALSE;
+    chEvtBroadcastFlagsI(&bpup->event, BPU_CONNECTED);
+    rx_start_i(bpup);
+  }
+}
+
+/**
+ * @brief   Default data transmitted callback.
+ * @details The application must use this function as callback for the IN
+ *          data endpoint.
+ *
+ * @param[in] usbp      pointer to the @p USBDriver object
+ * @param[in] ep        endpoint number
+ */
+void bpuDataTransmitted(USBDriver *usbp, usbep_t ep) {
+  BulkPacketUSBDriver *bpup = usbGetEndpointParamX(usbp, ep);
+  bpu_slot_t *sp;
+
+  if ((bpup == NULL) || (bpup->tx.busy == bpup->tx.wr))
+    return;
+
+  chSysLockFromIsr();
+  sp = ring_slot(&bpup->tx, bpup->tx.busy);
+  if (!bpup->txzlp && (sp->n > 0) &&
+      ((sp->n & (usbp->epc[ep]->in_maxsize - 1)) == 0)) {
+    /* Transmit zero sized packet in case the last one has maximum allowed
+       size. Otherwise the recipient may expect more data coming soon and
+       not return buffered data to app. See section 5.8.3 Bulk Transfer
+       Packet Size Constraints of the USB Specification document.*/
+    bpup->txzlp = TRUE;
+    usbPrepareTransmit(usbp, ep, NULL, 0);
+    usbStartTransmitI(usbp, ep);
+  }
+  else {
+    /* Buffer released, the next one is started.*/
+    bpup->txzlp = FALSE;
+    bpup->tx.busy++;
+    bpup->tx.rd = bpup->tx.busy;
+    chSemSignalI(&bpup->txsem);
+    chEvtBroadcastFlagsI(&bpup->event, BPU_TX_DONE);
+    tx_start_i(bpup);
+  }
+  chSysUnlockFromIsr();
+}
+
+/**
+ * @brief   Default data received callback.
+ * @details The application must use this function as callback for the OUT
+ *          data endpoint.
+ *
+ * @param[in] usbp      pointer to the @p USBDriver object
+ * @param[in] ep        endpoint number
+ */
+void bpuDataReceived(USBDriver *usbp, usbep_t ep) {
+  BulkPacketUSBDriver *bpup = usbGetEndpointParamX(usbp, ep);
+  bpu_slot_t *sp;
+
+  if ((bpup == NULL) || (bpup->rx.busy == bpup->rx.wr))
+    return;
+
+  chSysLockFromIsr();
+  sp = ring_slot(&bpup->rx, bpup->rx.busy);
+  sp->n = usbGetReceiveTransactionSizeI(usbp, ep);
+  bpup->rx.busy++;
+  chSemSignalI(&bpup->rxsem);
+  chEvtBroadcastFlagsI(&bpup->event, BPU_RX_DONE);
+  rx_start_i(bpup);
+  chSysUnlockFromIsr();
+}
+
+#endif /* HAL_USE_USB */
+
+/** @} */
@@ -0,0 +1,183 @@
+/**
+ * @file    bulk_pkt_usb.h
+ * @brief   Packets over USB bulk endpoints Driver macros and structures.
+ *
+ * @{
+ */
+
+#ifndef _BULK_PKT_USB_H_
+#define _BULK_PKT_USB_H_
+
+#if HAL_USE_USB || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/**
+ * @name    Event flags
+ * @{
+ */
+/** @brief The USB device has been configured.*/
+#define BPU_CONNECTED               1
+/** @brief A receive buffer has been filled.*/
+#define BPU_RX_DONE                 2
+/** @brief A transmit buffer has been released.*/
+#define BPU_TX_DONE                 4
+/** @} */
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @name    BULK_PKT_USB configuration options
+ * @{
+ */
+/**
+ * @brief   Number of buffers that can be posted on each direction.
+ * @note    Must be a power of two.
+ */
+#if !defined(BULK_PKT_USB_RING_SIZE) || defined(__DOXYGEN__)
+#define BULK_PKT_USB_RING_SIZE      4
+#endif
+/** @} */
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+#if !CH_USE_SEMAPHORES || !CH_USE_EVENTS
+#error "Bulk packets over USB Driver requires CH_USE_SEMAPHORES, "
+       "CH_USE_EVENTS"
+#endif
+
+#if (BULK_PKT_USB_RING_SIZE & (BULK_PKT_USB_RING_SIZE - 1)) != 0
+#error "BULK_PKT_USB_RING_SIZE must be a power of two"
+#endif
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief Driver state machine possible states.
+ */
+typedef enum {
+  BPU_UNINIT = 0,                   /**< Not initialized.                   */
+  BPU_STOP = 1,                     /**< Stopped.                           */
+  BPU_READY = 2                     /**< Ready.                             */
+} bpustate_t;
+
+/**
+ * @brief   Bulk packets over USB Driver configuration structure.
+ * @details An instance of this structure must be passed to @p bpuStart()
+ *          in order to configure and start the driver operations.
+ */
+typedef struct {
+  /**
+   * @brief   USB driver to use.
+   */
+  USBDriver                 *usbp;
+  /**
+   * @brief   Bulk IN endpoint used for outgoing packets.
+   */
+  usbep_t                   bulk_in;
+  /**
+   * @brief   Bulk OUT endpoint used for incoming packets.
+   */
+  usbep_t                   bulk_out;
+} BulkPacketUSBConfig;
+
+/**
+ * @brief   Posted buffer descriptor.
+ */
+typedef struct {
+  /** @brief Caller-owned buffer.*/
+  uint8_t                   *buf;
+  /** @brief Buffer size on receive, packet size on transmit.*/
+  size_t                    n;
+} bpu_slot_t;
+
+/**
+ * @brief   Ring of posted buffers.
+ * @details Slots between @p rd and @p busy are completed, slots between
+ *          @p busy and @p wr are posted and not yet transferred. The
+ *          indexes are free running and masked on access.
+ */
+typedef struct {
+  bpu_slot_t                slots[BULK_PKT_USB_RING_SIZE];
+  /** @brief Next slot to be posted.*/
+  unsigned                  wr;
+  /** @brief Slot being transferred.*/
+  unsigned                  busy;
+  /** @brief Oldest completed slot.*/
+  unsigned                  rd;
+} bpu_ring_t;
+
+/**
+ * @brief   Structure representing a bulk packets over USB driver.
+ * @details Data moves directly between the endpoint FIFO and the buffers
+ *          posted by the caller, one buffer per USB transfer.
+ */
+typedef struct {
+  /** @brief Driver state.*/
+  bpustate_t                state;
+  /** @brief Current configuration data.*/
+  const BulkPacketUSBConfig *config;
+  /** @brief Event source, broadcasts the @p BPU_xxx flags.*/
+  EventSource               event;
+  /** @brief Posted receive buffers.*/
+  bpu_ring_t                rx;
+  /** @brief Counts the filled receive buffers.*/
+  Semaphore                 rxsem;
+  /** @brief Posted transmit buffers.*/
+  bpu_ring_t                tx;
+  /** @brief Counts the free transmit slots.*/
+  Semaphore                 txsem;
+  /** @brief A zero length packet terminates the current transmission.*/
+  bool_t                    txzlp;
+} BulkPacketUSBDriver;
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/**
+ * @brief   Returns the driver event source.
+ *
+ * @param[in] bpup      pointer to a @p BulkPacketUSBDriver object
+ * @return              Pointer to the @p EventSource.
+ *
+ * @api
+ */
+#define bpuGetEventSource(bpup) (&(bpup)->event)
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void bpuObjectInit(BulkPacketUSBDriver *bpup);
+  void bpuStart(BulkPacketUSBDriver *bpup, const BulkPacketUSBConfig *config);
+  void bpuStop(BulkPacketUSBDriver *bpup);
+  void bpuPostReceiveI(BulkPacketUSBDriver *bpup, uint8_t *buf, size_t n);
+  void bpuPostReceive(BulkPacketUSBDriver *bpup, uint8_t *buf, size_t n);
+  msg_t bpuReceiveTimeout(BulkPacketUSBDriver *bpup, uint8_t **bufp,
+                          systime_t time);
+  msg_t bpuPostTransmitTimeout(BulkPacketUSBDriver *bpup, uint8_t *buf,
+                               size_t n, systime_t time);
+  void bpuConfigureHookI(USBDriver *usbp);
+  void bpuDataTransmitted(USBDriver *usbp, usbep_t ep);
+  void bpuDataReceived(USBDriver *usbp, usbep_t ep);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HAL_USE_USB */
+
+#endif /* _BULK_PKT_USB_H_ */
+
+/** @} */
@@ -9,13 +9,7 @@
 #include "ch.h"
 #include "hal.h"
 
-// Our control I/O is a bulk stream on endpoint 3
-#define USB_CTRL_EP 0x03
-#define USB_BULK_IN_EP USB_CTRL_EP
-#define USB_BULK_OUT_EP USB_CTRL_EP
-
 #include "bulk_usb.h"
-extern BulkUSBDriver BDU1;
 
 #if HAL_USE_SERIAL_USB || defined(__DOXYGEN__)
 
@@ -101,21 +95,53 @@ static void inotify(GenericQueue *qp) {
   /* If there is in the queue enough space to hold at least one packet and
      a transaction is not yet started then a new transaction is started for
      the available space.*/
-  maxsize = bdup->config->usbp->epc[USB_BULK_OUT_EP]->out_maxsize;
-  if (!usbGetReceiveStatusI(bdup->config->usbp, USB_BULK_OUT_EP) &&
+  maxsize = bdup->config->usbp->epc[bdup->config->bulk_out]->out_maxsize;
+  if (!usbGetReceiveStatusI(bdup->config->usbp, bdup->config->bulk_out) &&
       ((n = chIQGetEmptyI(&bdup->iqueue)) >= maxsize)) {
     chSysUnlock();
 
     n = (n / maxsize) * maxsize;
     usbPrepareQueuedReceive(bdup->config->usbp,
-                            USB_BULK_OUT_EP,
+                            bdup->config->bulk_out,
                             &bdup->iqueue, n);
 
     chSysLock();
-    usbStartReceiveI(bdup->config->usbp, USB_BULK_OUT_EP);
+    usbStartReceiveI(bdup->config->usbp, bdup->config->bulk_out);
   }
 }
 
+#if BULK_USB_TX_COALESCE || defined(__DOXYGEN__)
+/**
+ * @brief   Starts a transmission of all the queued data.
+ * @note    @p usbPrepareQueuedTransmit() only programs the endpoint so it
+ *          is invoked within the critical zone, this makes the function
+ *          usable from both the timer callback and thread context.
+ */
+static void tx_flush_i(BulkUSBDriver *bdup) {
+  USBDriver *usbp = bdup->config->usbp;
+  size_t n;
+
+  if (chVTIsArmedI(&bdup->txvt))
+    chVTResetI(&bdup->txvt);
+  if ((usbGetDriverStateI(usbp) == USB_ACTIVE) &&
+      !usbGetTransmitStatusI(usbp, bdup->config->bulk_in) &&
+      ((n = chOQGetFullI(&bdup->oqueue)) > 0)) {
+    usbPrepareQueuedTransmit(usbp, bdup->config->bulk_in, &bdup->oqueue, n);
+    usbStartTransmitI(usbp, bdup->config->bulk_in);
+  }
+}
+
+/**
+ * @brief   Short packet flush timer callback.
+ */
+static void txflush(void *p) {
+
+  chSysLockFromIsr();
+  tx_flush_i((BulkUSBDriver *)p);
+  chSysUnlockFromIsr();
+}
+#endif /* BULK_USB_TX_COALESCE */
+
 /**
  * @brief   Notification of data inserted into the output queue.
  */
@@ -130,16 +156,26 @@ static void onotify(GenericQueue *qp) {
 
   /* If there is not an ongoing transaction and the output queue contains
      data then a new transaction is started.*/
-  if (!usbGetTransmitStatusI(bdup->config->usbp, USB_BULK_IN_EP) &&
+  if (!usbGetTransmitStatusI(bdup->config->usbp, bdup->config->bulk_in) &&
       ((n = chOQGetFullI(&bdup->oqueue)) > 0)) {
+#if BULK_USB_TX_COALESCE
+    /* Less than a packet, waiting for more data or for the flush timer.*/
+    if (n < bdup->config->usbp->epc[bdup->config->bulk_in]->in_maxsize) {
+      if (!chVTIsArmedI(&bdup->txvt))
+        chVTSetI(&bdup->txvt, US2ST(BULK_USB_TX_FLUSH_US), txflush, bdup);
+      return;
+    }
+    if (chVTIsArmedI(&bdup->txvt))
+      chVTResetI(&bdup->txvt);
+#endif
     chSysUnlock();
 
     usbPrepareQueuedTransmit(bdup->config->usbp,
-                             USB_BULK_IN_EP,
+                             bdup->config->bulk_in,
                              &bdup->oqueue, n);
 
     chSysLock();
-    usbStartTransmitI(bdup->config->usbp, USB_BULK_IN_EP);
+    usbStartTransmitI(bdup->config->usbp, bdup->config->bulk_in);
   }
 }
 
@@ -171,8 +207,11 @@ void bduObjectInit(BulkUSBDriver *bdup) {
   bdup->vmt = &vmt;
   chEvtInit(&bdup->event);
   bdup->state = BDU_STOP;
-  chIQInit(&bdup->iqueue, bdup->ib, BULK_USB_BUFFERS_SIZE, inotify, bdup);
-  chOQInit(&bdup->oqueue, bdup->ob, BULK_USB_BUFFERS_SIZE, onotify, bdup);
+  /* The buffers are attached by bduStart(), until then the queues are
+     empty and full.*/
+  chIQInit(&bdup->iqueue, NULL, 0, inotify, bdup);
+  chOQInit(&bdup->oqueue, NULL, 0, onotify, bdup);
+  bdup->txvt.vt_func = NULL;
 }
 
 /**
@@ -185,15 +224,41 @@ void bduObjectInit(BulkUSBDriver *bdup) {
  */
 void bduStart(BulkUSBDriver *bdup, const BulkUSBConfig *config) {
 
-  chDbgCheck(bdup != NULL, "bduStart");
+  chDbgCheck((bdup != NULL) && (config != NULL) &&
+             (config->ib != NULL) && (config->ib_size > 0) &&
+             (config->ob != NULL) && (config->ob_size > 0), "bduStart");
 
   chSysLock();
   chDbgAssert((bdup->state == BDU_STOP) || (bdup->state == BDU_READY),
               "bduStart(), #1",
               "invalid state");
+  if (bdup->state == BDU_STOP) {
+    /* Attaching the channel buffers, threads blocked on the queues while
+       the driver was stopped are released with Q_RESET.*/
+    bdup->iqueue.q_buffer = config->ib;
+    bdup->iqueue.q_top = config->ib + config->ib_size;
+    chIQResetI(&bdup->iqueue);
+    bdup->oqueue.q_buffer = config->ob;
+    bdup->oqueue.q_top = config->ob + config->ob_size;
+    chOQResetI(&bdup->oqueue);
+  }
+  else {
+    chDbgAssert((bdup->iqueue.q_buffer == config->ib) &&
+                (bdup->oqueue.q_buffer == config->ob),
+                "bduStart(), #3",
+                "buffers changed while running");
+  }
+  chDbgAssert(((usbGetEndpointParamX(config->usbp, config->bulk_in) == NULL) ||
+               (usbGetEndpointParamX(config->usbp, config->bulk_in) == bdup)) &&
+              ((usbGetEndpointParamX(config->usbp, config->bulk_out) == NULL) ||
+               (usbGetEndpointParamX(config->usbp, config->bulk_out) == bdup)),
+              "bduStart(), #2",
+              "endpoint already in use");
   bdup->config = config;
-  config->usbp->param = bdup;
+  usbSetEndpointParamI(config->usbp, config->bulk_in, bdup);
+  usbSetEndpointParamI(config->usbp, config->bulk_out, bdup);
   bdup->state = BDU_READY;
+  chSchRescheduleS();
   chSysUnlock();
 }
 
@@ -208,44 +273,88 @@ void bduStart(BulkUSBDriver *bdup, const BulkUSBConfig *config) {
  */
 void bduStop(BulkUSBDriver *bdup) {
 
-  chDbgCheck(bdup != NULL, "sdStop");
+  chDbgCheck(bdup != NULL, "bduStop");
 
   chSysLock();
   chDbgAssert((bdup->state == BDU_STOP) || (bdup->state == BDU_READY),
               "bduStop(), #1",
               "invalid state");
+  if (bdup->state == BDU_READY) {
+    usbSetEndpointParamI(bdup->config->usbp, bdup->config->bulk_in, NULL);
+    usbSetEndpointParamI(bdup->config->usbp, bdup->config->bulk_out, NULL);
+  }
+  if (chVTIsArmedI(&bdup->txvt))
+    chVTResetI(&bdup->txvt);
   bdup->state = BDU_STOP;
   chSysUnlock();
 }
 
+#if BULK_USB_TX_COALESCE || defined(__DOXYGEN__)
+/**
+ * @brief   Sends the data held in the output queue.
+ * @details In coalescing mode a transmission is started immediately for
+ *          the queued data, without waiting for the flush timer.
+ *
+ * @param[in] bdup      pointer to a @p BulkUSBDriver object
+ *
+ * @iclass
+ */
+void bduFlushI(BulkUSBDriver *bdup) {
+
+  chDbgCheckClassI();
+  chDbgCheck(bdup != NULL, "bduFlushI");
+
+  tx_flush_i(bdup);
+}
+
+/**
+ * @brief   Sends the data held in the output queue.
+ * @details See @p bduFlushI().
+ *
+ * @param[in] bdup      pointer to a @p BulkUSBDriver object
+ *
+ * @api
+ */
+void bduFlush(BulkUSBDriver *bdup) {
+
+  chSysLock();
+  bduFlushI(bdup);
+  chSysUnlock();
+}
+#endif /* BULK_USB_TX_COALESCE */
+
 /**
  * @brief   USB device configured handler.
+ * @details All the bulk drivers started on @p usbp are reset and their
+ *          first OUT transaction is started. The drivers are found through
+ *          the endpoints whose OUT callback is @p bduDataReceived(), so any
+ *          number of bulk channels can share the USB driver with other
+ *          classes using @p usbp->param.
  *
  * @param[in] usbp      pointer to the @p USBDriver object
  *
  * @iclass
  */
+void bduConfigureHookI(USBDriver *usbp) {
+  usbep_t ep;
 
-//  ******* W A R N I N G   W A R N I N G   W A R N I N G *******
-// There's an architectural problem here. We have a layered stack of drivers ...
-// BulkUSBDriver sits on top of USBDriver. We have the same instance of USBDriver for 
-// our CDC-ACM  channel, but both upper layer drivers want to overwrite the usb driver's
-// user defined pointer (param) to point up to themselves. These routines then use this
-// param to get pointers to themselves. I've hacked around this with a hardcoded
-// fixup of bdup.  This is bad, but it gets around  the immediate problem.
+  for (ep = 1; ep <= USB_MAX_ENDPOINTS; ep++) {
+    BulkUSBDriver *bdup = usbGetEndpointParamX(usbp, ep);
 
-void bduConfigureHookI(USBDriver *usbp) {
-//  BulkUSBDriver *bdup = usbp->param;
-  BulkUSBDriver *bdup = &BDU1;
+    if ((bdup == NULL) || (usbp->epc[ep] == NULL) ||
+        (usbp->epc[ep]->out_cb != bduDataReceived) ||
+        (bdup->state != BDU_READY) || (bdup->config->bulk_out != ep))
+      continue;
 
-  chIQResetI(&bdup->iqueue);
-  chOQResetI(&bdup->oqueue);
-  chnAddFlagsI(bdup, CHN_CONNECTED);
+    chIQResetI(&bdup->iqueue);
+    chOQResetI(&bdup->oqueue);
+    chnAddFlagsI(bdup, CHN_CONNECTED);
 
-  /* Starts the first OUT transaction immediately.*/
-  usbPrepareQueuedReceive(usbp, USB_BULK_OUT_EP, &bdup->iqueue,
-                          usbp->epc[USB_BULK_OUT_EP]->out_maxsize);
-  usbStartReceiveI(usbp, USB_BULK_OUT_EP);
+    /* Starts the first OUT transaction immediately.*/
+    usbPrepareQueuedReceive(usbp, ep, &bdup->iqueue,
+                            usbp->epc[ep]->out_maxsize);
+    usbStartReceiveI(usbp, ep);
+  }
 }
 
 /**
@@ -285,21 +394,31 @@ bool_t bduRequestsHook(USBDriver *usbp) {
 /**
  * @brief   Default data transmitted callback.
  * @details The application must use this function as callback for the IN
- *          data endpoint.
+ *          data endpoint of each bulk channel, the driver is looked up
+ *          from the endpoint number.
  *
  * @param[in] usbp      pointer to the @p USBDriver object
  * @param[in] ep        endpoint number
  */
 void bduDataTransmitted(USBDriver *usbp, usbep_t ep) {
   size_t n;
+  BulkUSBDriver *bdup = usbGetEndpointParamX(usbp, ep);
 
-  BulkUSBDriver *bdup = &BDU1;
-
-  (void)ep;
+  if (bdup == NULL)
+    return;
 
   chSysLockFromIsr();
   chnAddFlagsI(bdup, CHN_OUTPUT_EMPTY);
 
+#if BULK_USB_TX_COALESCE
+  if (((n = chOQGetFullI(&bdup->oqueue)) > 0) &&
+      (n < usbp->epc[ep]->in_maxsize)) {
+    /* Less than a packet, waiting for more data or for the flush timer.*/
+    if (!chVTIsArmedI(&bdup->txvt))
+      chVTSetI(&bdup->txvt, US2ST(BULK_USB_TX_FLUSH_US), txflush, bdup);
+  }
+  else
+#endif
   if ((n = chOQGetFullI(&bdup->oqueue)) > 0) {
     /* The endpoint cannot be busy, we are in the context of the callback,
        so it is safe to transmit without a check.*/
@@ -330,24 +449,25 @@ void bduDataTransmitted(USBDriver *usbp, usbep_t ep) {
 /**
  * @brief   Default data received callback.
  * @details The application must use this function as callback for the OUT
- *          data endpoint.
+ *          data endpoint of each bulk channel, the driver is looked up
+ *          from the endpoint number.
  *
  * @param[in] usbp      pointer to the @p USBDriver object
  * @param[in] ep        endpoint number
  */
 void bduDataReceived(USBDriver *usbp, usbep_t ep) {
   size_t n, maxsize;
+  BulkUSBDriver *bdup = usbGetEndpointParamX(usbp, ep);
 
-  BulkUSBDriver *bdup = &BDU1;
+  if (bdup == NULL)
+    return;
 
-  
-  (void)ep;
   chSysLockFromIsr();
   chnAddFlagsI(bdup, CHN_INPUT_AVAILABLE);
 
   /* Writes to the input queue can only happen when there is enough space
      to hold at least one packet.*/
-  maxsize = usbp->epc[USB_BULK_OUT_EP]->out_maxsize;
+  maxsize = usbp->epc[ep]->out_maxsize;
   if ((n = chIQGetEmptyI(&bdup->iqueue)) >= maxsize) {
     /* The endpoint cannot be busy, we are in the context of the callback,
        so a packet is in the buffer for sure.*/
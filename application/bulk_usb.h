@@ -24,14 +24,22 @@
  * @{
  */
 /**
- * @brief   Bulk bytes over USB buffers size.
- * @details Configuration parameter, the buffer size must be a multiple of
- *          the USB data endpoint maximum packet size.
- * @note    The default is 256 bytes for both the transmission and receive
- *          buffers.
+ * @brief   Transmit coalescing mode.
+ * @details If enabled, data shorter than a packet is held in the output
+ *          queue until a full packet is available, @p bduFlush() is called
+ *          or @p BULK_USB_TX_FLUSH_US microseconds elapse. This reduces the
+ *          number of short packets when replies are written in pieces.
  */
-#if !defined(BULK_USB_BUFFERS_SIZE) || defined(__DOXYGEN__)
-#define BULK_USB_BUFFERS_SIZE     2560
+#if !defined(BULK_USB_TX_COALESCE) || defined(__DOXYGEN__)
+#define BULK_USB_TX_COALESCE      FALSE
+#endif
+
+/**
+ * @brief   Short packet flush delay in microseconds.
+ * @note    The delay is rounded up to the next system tick.
+ */
+#if !defined(BULK_USB_TX_FLUSH_US) || defined(__DOXYGEN__)
+#define BULK_USB_TX_FLUSH_US      1000
 #endif
 /** @} */
 
@@ -72,6 +80,34 @@ typedef struct {
    * @brief   USB driver to use.
    */
   USBDriver                 *usbp;
+  /**
+   * @brief   Bulk IN endpoint used for outgoing data transfer.
+   */
+  usbep_t                   bulk_in;
+  /**
+   * @brief   Bulk OUT endpoint used for incoming data transfer.
+   */
+  usbep_t                   bulk_out;
+  /**
+   * @brief   Input queue buffer.
+   * @note    The size must be a multiple of the OUT endpoint maximum
+   *          packet size.
+   */
+  uint8_t                   *ib;
+  /**
+   * @brief   Input queue buffer size.
+   */
+  size_t                    ib_size;
+  /**
+   * @brief   Output queue buffer.
+   * @note    The size must be a multiple of the IN endpoint maximum
+   *          packet size.
+   */
+  uint8_t                   *ob;
+  /**
+   * @brief   Output queue buffer size.
+   */
+  size_t                    ob_size;
 } BulkUSBConfig;
 
 /**
@@ -85,13 +121,11 @@ typedef struct {
   InputQueue                iqueue;                                         \
   /* Output queue.*/                                                        \
   OutputQueue               oqueue;                                         \
-  /* Input buffer.*/                                                        \
-  uint8_t                   ib[BULK_USB_BUFFERS_SIZE];                    \
-  /* Output buffer.*/                                                       \
-  uint8_t                   ob[BULK_USB_BUFFERS_SIZE];                    \
   /* End of the mandatory fields.*/                                         \
   /* Current configuration data.*/                                          \
-  const BulkUSBConfig     *config;
+  const BulkUSBConfig     *config;                                          \
+  /* Short packet flush timer, used in coalescing mode.*/                   \
+  VirtualTimer              txvt;
 
 /**
  * @brief   @p BulkUSBDriver specific methods.
@@ -136,6 +170,10 @@ extern "C" {
   void bduObjectInit(BulkUSBDriver *sdp);
   void bduStart(BulkUSBDriver *bdup, const BulkUSBConfig *config);
   void bduStop(BulkUSBDriver *bdup);
+#if BULK_USB_TX_COALESCE
+  void bduFlushI(BulkUSBDriver *bdup);
+  void bduFlush(BulkUSBDriver *bdup);
+#endif
   void bduConfigureHookI(USBDriver *usbp);
   bool_t bduRequestsHook(USBDriver *usbp);
   void bduDataTransmitted(USBDriver *usbp, usbep_t ep);
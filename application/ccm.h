@@ -0,0 +1,68 @@
+/**
+ * @file    ccm.h
+ * @brief   CCM RAM placement macros.
+ * @details The 64kB CCM RAM is only connected to the core D-bus, data
+ *          placed there never contends with the DMA masters on the bus
+ *          matrix. The DMA cannot reach it, buffers used by a DMA
+ *          must be declared with @p DMA_RAM.
+ * @note    Placement requires the STM32F407xG_CCM.ld linker script
+ *          (USE_CCM = yes in the Makefile), with the plain script the
+ *          objects fall back to the main SRAM BSS.
+ *
+ * @{
+ */
+
+#ifndef _CCM_H_
+#define _CCM_H_
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/**
+ * @brief   Places an object in the CCM RAM.
+ * @note    The object is not initialized at startup, only use it for
+ *          objects without initializer that are set up at runtime.
+ */
+#define CCM_RAM             __attribute__((section(".bss.ccm")))
+
+/**
+ * @brief   Places an object in the DMA reachable SRAM.
+ * @details Marks a buffer as used by a DMA, combining it with
+ *          @p CCM_RAM in the same declaration is a compile error.
+ */
+#define DMA_RAM             __attribute__((section(".bss.dma")))
+
+/**
+ * @brief   Static working area allocated in the CCM RAM.
+ * @note    Threads whose stacks are in the CCM RAM must not pass stack
+ *          buffers to drivers using a DMA.
+ *
+ * @param[in] s         the name to be assigned to the stack array
+ * @param[in] n         the stack size to be assigned to the thread
+ */
+#define CCM_WORKING_AREA(s, n) CCM_RAM WORKING_AREA(s, n)
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#endif /* _CCM_H_ */
+
+/** @} */
@@ -452,7 +452,9 @@
  */
 #if !defined(THREAD_EXT_FIELDS) || defined(__DOXYGEN__)
 #define THREAD_EXT_FIELDS                                                   \
-  /* Add threads custom fields here.*/
+  /* Add threads custom fields here.*/                                      \
+  /* Deferred log ring, see dlog.h.*/                                       \
+  void *p_dlog;
 #endif
 
 /**
@@ -465,6 +467,7 @@
 #if !defined(THREAD_EXT_INIT_HOOK) || defined(__DOXYGEN__)
 #define THREAD_EXT_INIT_HOOK(tp) {                                          \
   /* Add threads initialization code here.*/                                \
+  (tp)->p_dlog = NULL;                                                      \
 }
 #endif
 
@@ -495,10 +498,12 @@
 /**
  * @brief   Idle Loop hook.
  * @details This hook is continuously invoked by the idle thread loop.
+ *          The firmware image hashing runs here, see fwhash.c.
  */
 #if !defined(IDLE_LOOP_HOOK) || defined(__DOXYGEN__)
+void fwHashIdleHook(void);
 #define IDLE_LOOP_HOOK() {                                                  \
-  /* Idle loop code here.*/                                                 \
+  fwHashIdleHook();                                                         \
 }
 #endif
 
@@ -530,6 +535,19 @@
 /* Port-specific settings (override port settings defaulted in chcore.h).    */
 /*===========================================================================*/
 
+/**
+ * @brief   Idle thread stack size.
+ * @details Enlarged from the port default, the idle loop hook runs the
+ *          SHA-256 engine. GCC -fstack-usage at -O2 on x86-64 gives 296
+ *          bytes for the deepest chain, fwHashIdleHook() 80 (pass_done()
+ *          inlined), sha256Update() 64 and sha256_blocks() 152. The ARM
+ *          frames have not been measured, Thumb-2 has fewer registers and
+ *          sha256_blocks() spills more, hence the margin. Enable
+ *          @p CH_DBG_FILL_THREADS and run the "fwhash" shell command to
+ *          read the idle stack never used on the target.
+ */
+#define PORT_IDLE_THREAD_STACK_SIZE     512
+
 #endif  /* _CHCONF_H_ */
 
 /** @} */
@@ -27,6 +27,12 @@
 #include "instr_cmds.h"
 #include "instr_task.h"
 #include "usbcmdio.h"
+#include "adc_stream.h"
+#include "dlog.h"
+#include "boot.h"
+#include "sha256.h"
+#include "fwhash.h"
+#include <string.h>
 
 SerialUSBDriver SDU1;
 const ShellCommand commands[];
@@ -74,7 +80,6 @@ void cmd_threads(BaseSequentialStream *chp, int argc, char *argv[]) {
 void cmd_id(BaseSequentialStream *chp, int argc, char *argv[]) 
 {
   (void)argv;
-  MD5_TEK myHash;
   if (argc > 0) {
     chprintf(chp, "Usage: id\r\n");
     return;
@@ -83,14 +88,186 @@ void cmd_id(BaseSequentialStream *chp, int argc, char *argv[])
   print_ID      (chp,&dbgPktBuf);
   get_instrument_SSN(&dbgPktBuf);
   print_SSN     (chp,&dbgPktBuf);
-  myHash = ssn_to_MD5();
-  print_UID48   (chp,&myHash);
+  print_UID48   (chp,get_instrument_UID128());
+  fwHashPrintStatus(chp);
+}
+
+void cmd_adc(BaseSequentialStream *chp, int argc, char *argv[])
+{
+  adc_stream_stats_t st;
+  adcsample_t frame[ADC_STREAM_NUM_CHANNELS];
+  unsigned i;
+
+  (void)argv;
+  if (argc > 0) {
+    chprintf(chp, "Usage: adc\r\n");
+    return;
+  }
+  adcStreamGetStats(&st, frame);
+  chprintf(chp, "blocks produced  : %lu\r\n", st.produced);
+  chprintf(chp, "blocks sent      : %lu\r\n", st.sent);
+  chprintf(chp, "blocks dropped   : %lu\r\n", st.dropped);
+  chprintf(chp, "adc errors       : %lu\r\n", st.errors);
+  chprintf(chp, "usb sink         : %s\r\n",
+           ADC_STREAM_USE_USB ? "enabled" : "disabled");
+  chprintf(chp, "latest frame     :");
+  for (i = 0; i < ADC_STREAM_NUM_CHANNELS; i++)
+    chprintf(chp, " %u", frame[i]);
+  chprintf(chp, "\r\n");
+}
+
+#define PBENCH_LINES 200
+
+// Prints a fixed text and reports the achieved characters per second,
+// "pbench put" emits the same text one character at a time for comparison
+void cmd_pbench(BaseSequentialStream *chp, int argc, char *argv[])
+{
+  char line[80];
+  systime_t start, elapsed;
+  uint32_t chars = 0;
+  bool_t put;
+  unsigned i;
+  int n, k;
+
+  put = (argc == 1) && (strcmp(argv[0], "put") == 0);
+  if ((argc > 1) || ((argc == 1) && !put)) {
+    chprintf(chp, "Usage: pbench [put]\r\n");
+    return;
+  }
+  start = chTimeNow();
+  for (i = 0; i < PBENCH_LINES; i++) {
+    if (put) {
+      n = chsnprintf(line, sizeof(line), "pbench %4u 0x%.8lx %s\r\n", i,
+                     (uint32_t)start, "abcdefghijklmnopqrstuvwxyz");
+      for (k = 0; k < n; k++)
+        chSequentialStreamPut(chp, (uint8_t)line[k]);
+    }
+    else
+      n = chprintf(chp, "pbench %4u 0x%.8lx %s\r\n", i,
+                   (uint32_t)start, "abcdefghijklmnopqrstuvwxyz");
+    chars += n;
+  }
+  elapsed = chTimeNow() - start;
+  if (elapsed == 0)
+    elapsed = 1;
+  chprintf(chp, "%lu chars in %lu ms, %lu chars/s (%s)\r\n", chars,
+           (uint32_t)elapsed * 1000 / CH_FREQUENCY,
+           chars * CH_FREQUENCY / (uint32_t)elapsed, put ? "put" : "write");
+}
+
+// Deferred log rings status
+void cmd_dlog(BaseSequentialStream *chp, int argc, char *argv[])
+{
+  (void)argv;
+  if (argc > 0) {
+    chprintf(chp, "Usage: dlog\r\n");
+    return;
+  }
+  dlogPrintStats(chp);
+}
+
+// Boot phases timeline
+void cmd_boot(BaseSequentialStream *chp, int argc, char *argv[])
+{
+  (void)argv;
+  if (argc > 0) {
+    chprintf(chp, "Usage: boot\r\n");
+    return;
+  }
+  bootPrintTimeline(chp);
+}
+
+#define MD5BENCH_BLOCK 1024
+#define MD5BENCH_COUNT 64
+
+// MD5 known answer tests and throughput, over an aligned and an unaligned
+// buffer
+void cmd_md5(BaseSequentialStream *chp, int argc, char *argv[])
+{
+  static uint32_t data[MD5BENCH_BLOCK / 4 + 1];
+  MD5_TEK ctx;
+  halrtcnt_t start, cycles;
+  unsigned i, off;
+
+  (void)argv;
+  if (argc > 0) {
+    chprintf(chp, "Usage: md5\r\n");
+    return;
+  }
+  chprintf(chp, "known answer tests: %d failures\r\n", MD5SelfTest());
+  for (i = 0; i < sizeof(data); i++)
+    ((uint8_t *)data)[i] = (uint8_t)i;
+  for (off = 0; off < 2; off++) {
+    start = halGetCounterValue();
+    MD5Init(&ctx);
+    for (i = 0; i < MD5BENCH_COUNT; i++)
+      MD5Update(&ctx, (const uint8_t *)data + off, MD5BENCH_BLOCK);
+    MD5Final(&ctx);
+    cycles = halGetCounterValue() - start;
+    chprintf(chp, "%s: %u bytes in %U us, %U cycles/byte\r\n",
+             off ? "unaligned" : "aligned  ",
+             MD5BENCH_BLOCK * MD5BENCH_COUNT, RTT2US(cycles),
+             cycles / (MD5BENCH_BLOCK * MD5BENCH_COUNT));
+  }
+}
+
+#define SHA256BENCH_BLOCK 1024
+#define SHA256BENCH_COUNT 64
+
+// SHA-256 known answer tests and throughput, over an aligned and an
+// unaligned buffer
+void cmd_sha256(BaseSequentialStream *chp, int argc, char *argv[])
+{
+  static uint32_t data[SHA256BENCH_BLOCK / 4 + 1];
+  sha256_ctx_t ctx;
+  uint8_t digest[SHA256_DIGEST_SIZE];
+  halrtcnt_t start, cycles;
+  unsigned i, off;
+
+  (void)argv;
+  if (argc > 0) {
+    chprintf(chp, "Usage: sha256\r\n");
+    return;
+  }
+  chprintf(chp, "known answer tests: %d failures\r\n", sha256SelfTest());
+  for (i = 0; i < sizeof(data); i++)
+    ((uint8_t *)data)[i] = (uint8_t)i;
+  for (off = 0; off < 2; off++) {
+    start = halGetCounterValue();
+    sha256Init(&ctx);
+    for (i = 0; i < SHA256BENCH_COUNT; i++)
+      sha256Update(&ctx, (const uint8_t *)data + off, SHA256BENCH_BLOCK);
+    sha256Final(&ctx, digest);
+    cycles = halGetCounterValue() - start;
+    chprintf(chp, "%s: %u bytes in %U us, %U cycles/byte\r\n",
+             off ? "unaligned" : "aligned  ",
+             SHA256BENCH_BLOCK * SHA256BENCH_COUNT, RTT2US(cycles),
+             cycles / (SHA256BENCH_BLOCK * SHA256BENCH_COUNT));
+  }
+}
+
+void cmd_fwhash(BaseSequentialStream *chp, int argc, char *argv[])
+{
+  if ((argc > 1) || ((argc == 1) && strcmp(argv[0], "restart"))) {
+    chprintf(chp, "Usage: fwhash [restart]\r\n");
+    return;
+  }
+  if (argc == 1)
+    fwHashStart();
+  fwHashPrintStatus(chp);
 }
 
 const ShellCommand commands[] = {
   {"mem", cmd_mem},
   {"threads", cmd_threads},
   {"id", cmd_id},
+  {"adc", cmd_adc},
+  {"pbench", cmd_pbench},
+  {"dlog", cmd_dlog},
+  {"boot", cmd_boot},
+  {"md5", cmd_md5},
+  {"sha256", cmd_sha256},
+  {"fwhash", cmd_fwhash},
   {NULL, NULL}
 };
 
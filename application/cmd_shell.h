@@ -46,6 +46,41 @@ void cmd_shadow (BaseSequentialStream *chp, int argc, char *argv[]);
 void cmd_id     (BaseSequentialStream *chp, int argc, char *argv[]);
 void cmd_read   (BaseSequentialStream *chp, int argc, char *argv[]);
 
+/**
+ * @brief   cmd-shell cmd: report ADC stream counters
+ */
+void cmd_adc(BaseSequentialStream *chp, int argc, char *argv[]);
+
+/**
+ * @brief   cmd-shell cmd: chprintf throughput benchmark
+ */
+void cmd_pbench (BaseSequentialStream *chp, int argc, char *argv[]);
+
+/**
+ * @brief   cmd-shell cmd: deferred log rings status
+ */
+void cmd_dlog (BaseSequentialStream *chp, int argc, char *argv[]);
+
+/**
+ * @brief   cmd-shell cmd: boot phases timeline
+ */
+void cmd_boot (BaseSequentialStream *chp, int argc, char *argv[]);
+
+/**
+ * @brief   cmd-shell cmd: MD5 self test and throughput
+ */
+void cmd_md5 (BaseSequentialStream *chp, int argc, char *argv[]);
+
+/**
+ * @brief   cmd-shell cmd: SHA-256 self test and throughput
+ */
+void cmd_sha256 (BaseSequentialStream *chp, int argc, char *argv[]);
+
+/**
+ * @brief   cmd-shell cmd: firmware image digest, optionally re-verified
+ */
+void cmd_fwhash (BaseSequentialStream *chp, int argc, char *argv[]);
+
 #endif /* _CMD_SHELL_H_ */
 
 /** @} */
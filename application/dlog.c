@@ -0,0 +1,254 @@
+/**
+ * @file    dlog.c
+ * @brief   Deferred binary logger code.
+ * @details Log calls store a timestamp, the format string address and the
+ *          raw argument words into a ring owned by the calling thread,
+ *          formatting is performed later by a low priority drain thread.
+ *          A full ring drops the record, the logging thread never blocks.
+ *
+ * @{
+ */
+
+#include "ch.h"
+#include "hal.h"
+#include "chprintf.h"
+
+#include "ccm.h"
+#include "dlog.h"
+
+#if !HAL_IMPLEMENTS_COUNTERS
+#error "DLOG requires the realtime counter service"
+#endif
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+#define RING_MASK                   (DLOG_RING_SIZE - 1)
+
+/**
+ * @brief   Prevents the compiler from moving memory accesses across it.
+ * @note    Producer and consumer run on the same core, the ring indexes
+ *          only need to be published after the record contents.
+ */
+#define compiler_barrier()          asm volatile ("" : : : "memory")
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local variables.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Ring shared by the threads without a ring of their own.
+ * @note    Kept in the zeroed .bss, unlike the per-thread rings it is
+ *          never initialized by @p dlogThreadInit() and it terminates the
+ *          rings list from power-on.
+ */
+static dlog_ring_t shared_ring;
+
+/**
+ * @brief   Registered rings, the shared one is always the last.
+ */
+static dlog_ring_t *rings = &shared_ring;
+
+static CCM_WORKING_AREA(wa_dlog, DLOG_THREAD_STACK_SIZE);
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+static void ring_put(dlog_ring_t *rp, const char *fmt, uint32_t a1,
+                     uint32_t a2, uint32_t a3, uint32_t a4) {
+  uint32_t head = rp->head;
+  dlog_record_t *rec;
+
+  if (head - rp->tail >= DLOG_RING_SIZE) {
+    rp->dropped++;
+    return;
+  }
+  rec = &rp->recs[head & RING_MASK];
+  rec->stamp   = halGetCounterValue();
+  rec->fmt     = fmt;
+  rec->args[0] = a1;
+  rec->args[1] = a2;
+  rec->args[2] = a3;
+  rec->args[3] = a4;
+  compiler_barrier();
+  rp->head = head + 1;
+}
+
+static bool_t ring_get(dlog_ring_t *rp, dlog_record_t *rec) {
+  uint32_t tail = rp->tail;
+
+  if (tail == rp->head)
+    return FALSE;
+  compiler_barrier();
+  *rec = rp->recs[tail & RING_MASK];
+  compiler_barrier();
+  rp->tail = tail + 1;
+  return TRUE;
+}
+
+/**
+ * @brief   Finds the ring holding the oldest record.
+ *
+ * @return              The ring or @p NULL if all the rings are empty.
+ */
+static dlog_ring_t *ring_oldest(void) {
+  dlog_ring_t *rp, *oldest = NULL;
+  uint32_t stamp = 0;
+
+  for (rp = rings; rp != NULL; rp = rp->next) {
+    uint32_t tail = rp->tail;
+
+    if (tail == rp->head)
+      continue;
+    compiler_barrier();
+    if ((oldest == NULL) ||
+        ((int32_t)(rp->recs[tail & RING_MASK].stamp - stamp) < 0)) {
+      oldest = rp;
+      stamp  = rp->recs[tail & RING_MASK].stamp;
+    }
+  }
+  return oldest;
+}
+
+static msg_t dlog_thread(void *arg) {
+  BaseSequentialStream *chp = arg;
+  dlog_ring_t *rp;
+  dlog_record_t rec;
+
+  chRegSetThreadName("dlog");
+  while (TRUE) {
+    while ((rp = ring_oldest()) != NULL) {
+      ring_get(rp, &rec);
+      chprintf(chp, "%10U %s: ", rec.stamp,
+               rp->name != NULL ? rp->name : "-");
+      chprintf(chp, rec.fmt, rec.args[0], rec.args[1],
+               rec.args[2], rec.args[3]);
+    }
+    chThdSleepMilliseconds(DLOG_DRAIN_INTERVAL);
+  }
+  return 0;
+}
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Gives the calling thread its own log ring.
+ * @details Log calls from threads without a ring go to a shared ring
+ *          written within a critical zone.
+ *
+ * @param[out] rp       pointer to the ring, must stay allocated
+ *
+ * @api
+ */
+void dlogThreadInit(dlog_ring_t *rp) {
+  Thread *tp = chThdSelf();
+
+  chDbgCheck(rp != NULL, "dlogThreadInit");
+  chDbgAssert(tp->p_dlog == NULL, "dlogThreadInit(), #1",
+              "already initialized");
+
+  rp->head    = 0;
+  rp->tail    = 0;
+  rp->dropped = 0;
+#if CH_USE_REGISTRY
+  rp->name    = tp->p_name;
+#else
+  rp->name    = NULL;
+#endif
+
+  chSysLock();
+  rp->next = rings;
+  rings = rp;
+  tp->p_dlog = rp;
+  chSysUnlock();
+}
+
+/**
+ * @brief   Records a log entry.
+ * @note    Use the @p dlog() macro instead.
+ *
+ * @param[in] fmt       format string, must be a literal
+ * @param[in] a1        first argument word
+ * @param[in] a2        second argument word
+ * @param[in] a3        third argument word
+ * @param[in] a4        fourth argument word
+ *
+ * @api
+ */
+void dlogWrite(const char *fmt, uint32_t a1, uint32_t a2,
+               uint32_t a3, uint32_t a4) {
+  dlog_ring_t *rp = chThdSelf()->p_dlog;
+
+  if (rp != NULL)
+    ring_put(rp, fmt, a1, a2, a3, a4);
+  else {
+    chSysLock();
+    ring_put(&shared_ring, fmt, a1, a2, a3, a4);
+    chSysUnlock();
+  }
+}
+
+/**
+ * @brief   Removes raw records in timestamp order.
+ * @details For host side formatting, the records can be sent as they are
+ *          and the format strings resolved from the firmware ELF file.
+ * @note    Must not be used while the drain thread is running.
+ *
+ * @param[out] buf      destination buffer
+ * @param[in] n         maximum number of records
+ * @return              The number of records copied.
+ *
+ * @api
+ */
+size_t dlogFetch(dlog_record_t *buf, size_t n) {
+  dlog_ring_t *rp;
+  size_t i = 0;
+
+  while ((i < n) && ((rp = ring_oldest()) != NULL))
+    ring_get(rp, &buf[i++]);
+  return i;
+}
+
+/**
+ * @brief   Starts the drain thread.
+ * @details Records are formatted on the specified stream, if the stream
+ *          blocks only the drain thread is affected and records are
+ *          dropped once the rings are full.
+ *
+ * @param[in] chp       output stream
+ * @param[in] prio      drain thread priority, should be low
+ *
+ * @api
+ */
+void dlogStart(BaseSequentialStream *chp, tprio_t prio) {
+
+  chDbgCheck(chp != NULL, "dlogStart");
+
+  chThdCreateStatic(wa_dlog, sizeof(wa_dlog), prio, dlog_thread, chp);
+}
+
+/**
+ * @brief   Prints the rings status.
+ *
+ * @param[in] chp       output stream
+ *
+ * @api
+ */
+void dlogPrintStats(BaseSequentialStream *chp) {
+  dlog_ring_t *rp;
+
+  for (rp = rings; rp != NULL; rp = rp->next)
+    chprintf(chp, "%-12s pending %3U logged %10U dropped %10U\r\n",
+             rp->name != NULL ? rp->name : "(shared)",
+             rp->head - rp->tail, rp->head, rp->dropped);
+}
+
+/** @} */
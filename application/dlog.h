@@ -0,0 +1,148 @@
+/**
+ * @file    dlog.h
+ * @brief   Deferred binary logger macros and structures.
+ *
+ * @{
+ */
+
+#ifndef _DLOG_H_
+#define _DLOG_H_
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Maximum number of arguments of a log call.
+ */
+#define DLOG_MAX_ARGS               4
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @name    DLOG configuration options
+ * @{
+ */
+/**
+ * @brief   Number of records in each ring.
+ * @note    Must be a power of two.
+ */
+#if !defined(DLOG_RING_SIZE) || defined(__DOXYGEN__)
+#define DLOG_RING_SIZE              32
+#endif
+
+/**
+ * @brief   Drain thread polling interval in milliseconds.
+ */
+#if !defined(DLOG_DRAIN_INTERVAL) || defined(__DOXYGEN__)
+#define DLOG_DRAIN_INTERVAL         20
+#endif
+
+/**
+ * @brief   Drain thread stack size.
+ */
+#if !defined(DLOG_THREAD_STACK_SIZE) || defined(__DOXYGEN__)
+#define DLOG_THREAD_STACK_SIZE      512
+#endif
+/** @} */
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+#if (DLOG_RING_SIZE & (DLOG_RING_SIZE - 1)) != 0
+#error "DLOG_RING_SIZE must be a power of two"
+#endif
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Log record.
+ * @details The format string address is the record identifier, a host
+ *          tool can resolve it from the firmware ELF file.
+ */
+typedef struct {
+  /** @brief Cycle counter at the log call.*/
+  uint32_t                  stamp;
+  /** @brief Format string, must be a literal.*/
+  const char                *fmt;
+  /** @brief Raw argument words.*/
+  uint32_t                  args[DLOG_MAX_ARGS];
+} dlog_record_t;
+
+/**
+ * @brief   Log ring.
+ * @details Single producer, single consumer. The producer only writes
+ *          @p head and the drain thread only writes @p tail, no lock is
+ *          required on either side.
+ */
+typedef struct dlog_ring {
+  /** @brief Next ring in the registry.*/
+  struct dlog_ring          *next;
+  /** @brief Producer thread name, @p NULL for the shared ring.*/
+  const char                *name;
+  /** @brief Next record to be written, free running.*/
+  volatile uint32_t         head;
+  /** @brief Next record to be read, free running.*/
+  volatile uint32_t         tail;
+  /** @brief Records lost because the ring was full.*/
+  uint32_t                  dropped;
+  /** @brief Records.*/
+  dlog_record_t             recs[DLOG_RING_SIZE];
+} dlog_ring_t;
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/**
+ * @brief   Logs a message with up to @p DLOG_MAX_ARGS arguments.
+ * @details Only the format string address and the raw arguments are
+ *          recorded, formatting happens later in the drain thread.
+ * @note    Arguments are stored as 32 bits words, @p %s arguments must
+ *          point to strings that outlive the record.
+ * @note    Not callable from interrupt handlers.
+ *
+ * @api
+ */
+#define dlog(...)                                                           \
+  DLOG_SELECT(__VA_ARGS__, dlog_4, dlog_3, dlog_2, dlog_1, dlog_0, )        \
+  (__VA_ARGS__)
+
+#define DLOG_SELECT(fmt, a1, a2, a3, a4, name, ...) name
+#define dlog_0(fmt)                                                         \
+  dlogWrite(fmt, 0, 0, 0, 0)
+#define dlog_1(fmt, a1)                                                     \
+  dlogWrite(fmt, (uint32_t)(a1), 0, 0, 0)
+#define dlog_2(fmt, a1, a2)                                                 \
+  dlogWrite(fmt, (uint32_t)(a1), (uint32_t)(a2), 0, 0)
+#define dlog_3(fmt, a1, a2, a3)                                             \
+  dlogWrite(fmt, (uint32_t)(a1), (uint32_t)(a2), (uint32_t)(a3), 0)
+#define dlog_4(fmt, a1, a2, a3, a4)                                         \
+  dlogWrite(fmt, (uint32_t)(a1), (uint32_t)(a2), (uint32_t)(a3),            \
+            (uint32_t)(a4))
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void dlogThreadInit(dlog_ring_t *rp);
+  void dlogWrite(const char *fmt, uint32_t a1, uint32_t a2,
+                 uint32_t a3, uint32_t a4);
+  size_t dlogFetch(dlog_record_t *buf, size_t n);
+  void dlogStart(BaseSequentialStream *chp, tprio_t prio);
+  void dlogPrintStats(BaseSequentialStream *chp);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _DLOG_H_ */
+
+/** @} */
@@ -0,0 +1,213 @@
+/**
+ * @file    fwhash.c
+ * @brief   Firmware image integrity service code.
+ * @details The flash image, from the vector table to the end of the DATA
+ *          initializers, is hashed with SHA-256 by the idle thread, one
+ *          @p FWHASH_CHUNK_SIZE bytes chunk per idle loop iteration, so
+ *          the check only uses otherwise idle CPU time. The digest equals
+ *          the SHA-256 of the binary produced by objcopy.
+ *
+ * @{
+ */
+
+#include <string.h>
+
+#include "ch.h"
+#include "hal.h"
+#include "chprintf.h"
+
+#include "ccm.h"
+#include "fwhash.h"
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+/* Vector table, first object in flash.*/
+extern uint32_t _vectors;
+/* Linker symbols, see crt0.c.*/
+extern uint32_t _textdata;
+extern uint32_t _data;
+extern uint32_t _edata;
+
+#define IMAGE_START     ((const uint8_t *)&_vectors)
+#define IMAGE_END       ((const uint8_t *)&_textdata +                      \
+                         ((const uint8_t *)&_edata - (const uint8_t *)&_data))
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local variables.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Service status, written under lock.
+ */
+static fwhash_status_t status;
+
+/**
+ * @brief   Pass requested by @p fwHashStart().
+ */
+static bool_t restart;
+
+/* Idle thread only.*/
+static CCM_RAM sha256_ctx_t ctx;
+static const uint8_t *pos;
+static uint32_t cycles;
+static uint8_t first_digest[SHA256_DIGEST_SIZE];
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+static void pass_done(void) {
+  uint8_t digest[SHA256_DIGEST_SIZE];
+  bool_t mismatch;
+
+  sha256Final(&ctx, digest);
+  if (status.passes == 0)
+    memcpy(first_digest, digest, sizeof(first_digest));
+  mismatch = memcmp(first_digest, digest, sizeof(first_digest)) != 0;
+
+  chSysLock();
+  memcpy(status.digest, digest, sizeof(status.digest));
+  status.done = status.length;
+  status.cycles = cycles;
+  if (mismatch)
+    status.mismatches++;
+  status.passes++;
+  status.state = FWHASH_DONE;
+  chSysUnlock();
+}
+
+#if CH_DBG_FILL_THREADS
+/* Idle stack bytes still holding the fill value, never used so far.*/
+static size_t idle_stack_unused(void) {
+  const uint8_t *base = (const uint8_t *)_idle_thread_wa + sizeof(Thread);
+  const uint8_t *top = (const uint8_t *)_idle_thread_wa +
+                       sizeof(_idle_thread_wa);
+  const uint8_t *p = base;
+
+  while ((p < top) && (*p == CH_STACK_FILL_VALUE))
+    p++;
+  return (size_t)(p - base);
+}
+#endif
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Requests a hashing pass over the firmware image.
+ * @details A pass already in progress is restarted. The digest of the
+ *          previous pass is kept until the new pass completes.
+ *
+ * @api
+ */
+void fwHashStart(void) {
+
+  chSysLock();
+  restart = TRUE;
+  chSysUnlock();
+}
+
+/**
+ * @brief   Hashes the next chunk of the firmware image.
+ * @note    Called from @p IDLE_LOOP_HOOK(), it must never block.
+ *
+ * @notapi
+ */
+void fwHashIdleHook(void) {
+  halrtcnt_t start;
+  size_t n;
+
+  chSysLock();
+  if (restart) {
+    restart = FALSE;
+    status.state = FWHASH_RUNNING;
+    status.done = 0;
+    status.length = (uint32_t)(IMAGE_END - IMAGE_START);
+    chSysUnlock();
+    sha256Init(&ctx);
+    pos = IMAGE_START;
+    cycles = 0;
+    return;
+  }
+  if (status.state != FWHASH_RUNNING) {
+    chSysUnlock();
+    return;
+  }
+  chSysUnlock();
+
+  start = halGetCounterValue();
+  n = (size_t)(IMAGE_END - pos);
+  if (n > FWHASH_CHUNK_SIZE)
+    n = FWHASH_CHUNK_SIZE;
+  sha256Update(&ctx, pos, n);
+  pos += n;
+  cycles += halGetCounterValue() - start;
+
+  if (pos == IMAGE_END)
+    pass_done();
+  else {
+    chSysLock();
+    status.done = (uint32_t)(pos - IMAGE_START);
+    chSysUnlock();
+  }
+}
+
+/**
+ * @brief   Returns a consistent copy of the service status.
+ *
+ * @param[out] sp       pointer to the status copy
+ *
+ * @api
+ */
+void fwHashGetStatus(fwhash_status_t *sp) {
+
+  chDbgCheck(sp != NULL, "fwHashGetStatus");
+
+  chSysLock();
+  *sp = status;
+  chSysUnlock();
+}
+
+/**
+ * @brief   Prints the service status.
+ * @details With @p CH_DBG_FILL_THREADS enabled the idle stack bytes never
+ *          used are printed too, the hashing runs on that stack.
+ *
+ * @param[in] chp       output stream
+ *
+ * @api
+ */
+void fwHashPrintStatus(BaseSequentialStream *chp) {
+  static const char * const states[] = {"idle", "running", "done"};
+  fwhash_status_t st;
+  unsigned i;
+
+  fwHashGetStatus(&st);
+  chprintf(chp, "  FW SHA256 ");
+  if (st.passes == 0)
+    chprintf(chp, "pending");
+  else
+    for (i = 0; i < SHA256_DIGEST_SIZE; i++)
+      chprintf(chp, "%.2x", st.digest[i]);
+  chprintf(chp, "\r\n");
+  chprintf(chp, "  FW image %U bytes at 0x%.8x, %s %U%%\r\n",
+           st.length, (uint32_t)IMAGE_START, states[st.state],
+           st.length ? (uint32_t)((uint64_t)st.done * 100 / st.length) : 0);
+  if (st.passes != 0)
+    chprintf(chp, "  FW passes %U, mismatches %U, last %U us in idle\r\n",
+             st.passes, st.mismatches, RTT2US(st.cycles));
+#if CH_DBG_FILL_THREADS
+  chprintf(chp, "  Idle stack %U of %U bytes never used\r\n",
+           (uint32_t)idle_stack_unused(),
+           (uint32_t)(sizeof(_idle_thread_wa) - sizeof(Thread)));
+#endif
+}
+
+/** @} */
@@ -0,0 +1,98 @@
+/**
+ * @file    fwhash.h
+ * @brief   Firmware image integrity service macros and structures.
+ *
+ * @{
+ */
+
+#ifndef _FWHASH_H_
+#define _FWHASH_H_
+
+#include "sha256.h"
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @name    FWHASH configuration options
+ * @{
+ */
+/**
+ * @brief   Bytes hashed per idle loop iteration.
+ * @details Bounds the time the idle thread spends in the hash engine
+ *          before checking again for a reschedule, 256 bytes are about
+ *          45us at 168MHz. Must be a multiple of @p SHA256_BLOCK_SIZE.
+ */
+#if !defined(FWHASH_CHUNK_SIZE) || defined(__DOXYGEN__)
+#define FWHASH_CHUNK_SIZE           256
+#endif
+/** @} */
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+#if (FWHASH_CHUNK_SIZE % SHA256_BLOCK_SIZE) != 0
+#error "FWHASH_CHUNK_SIZE must be a multiple of SHA256_BLOCK_SIZE"
+#endif
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Service state.
+ */
+typedef enum {
+  FWHASH_IDLE = 0,                  /**< Not started.                       */
+  FWHASH_RUNNING = 1,               /**< Hashing in the idle thread.        */
+  FWHASH_DONE = 2                   /**< Digest available.                  */
+} fwhashstate_t;
+
+/**
+ * @brief   Service status snapshot.
+ */
+typedef struct {
+  /** @brief Service state.*/
+  fwhashstate_t             state;
+  /** @brief Bytes hashed in the current pass.*/
+  uint32_t                  done;
+  /** @brief Image length in bytes.*/
+  uint32_t                  length;
+  /** @brief Number of completed passes.*/
+  uint32_t                  passes;
+  /** @brief Passes whose digest differed from the first pass.*/
+  uint32_t                  mismatches;
+  /** @brief Cycles spent in the last completed pass.*/
+  uint32_t                  cycles;
+  /** @brief Image digest, valid once a pass is complete.*/
+  uint8_t                   digest[SHA256_DIGEST_SIZE];
+} fwhash_status_t;
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void fwHashStart(void);
+  void fwHashIdleHook(void);
+  void fwHashGetStatus(fwhash_status_t *sp);
+  void fwHashPrintStatus(BaseSequentialStream *chp);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FWHASH_H_ */
+
+/** @} */
@@ -52,7 +52,7 @@
  * @brief   Enables the ADC subsystem.
  */
 #if !defined(HAL_USE_ADC) || defined(__DOXYGEN__)
-#define HAL_USE_ADC                 FALSE
+#define HAL_USE_ADC                 TRUE
 #endif
 
 /**
@@ -321,7 +321,27 @@
  *          buffers.
  */
 #if !defined(SERIAL_BUFFERS_SIZE) || defined(__DOXYGEN__)
-#define SERIAL_BUFFERS_SIZE         16
+#define SERIAL_BUFFERS_SIZE         512
+#endif
+
+/*===========================================================================*/
+/* SERIAL_USB and BULK_USB drivers related settings.                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Holds short writes to the USB serial port until a packet fills
+ *          or the flush delay expires.
+ */
+#if !defined(SERIAL_USB_TX_COALESCE) || defined(__DOXYGEN__)
+#define SERIAL_USB_TX_COALESCE      TRUE
+#endif
+
+/**
+ * @brief   Holds short writes to the USB bulk channels until a packet
+ *          fills, @p bduFlush() is called or the flush delay expires.
+ */
+#if !defined(BULK_USB_TX_COALESCE) || defined(__DOXYGEN__)
+#define BULK_USB_TX_COALESCE        TRUE
 #endif
 
 /*===========================================================================*/
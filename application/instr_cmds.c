@@ -28,6 +28,7 @@
 #include "bulk_usb.h"
 #include "instr_cmds.h"
 #include "md5_tek.h"
+#include "fwhash.h"
 
 extern usb_packet_t      pktInBuf;       // global instance of a   USB packet, max size = 254 bytes
 extern usb_packet_t      dbgPktBuf;
@@ -116,19 +117,18 @@ void print_SSN(BaseSequentialStream *chp, usb_packet_t *pPkt) {
 } // end print_SSN
 
 
-void print_UID48(BaseSequentialStream *chp, MD5_TEK *pHash) {
-  // payload_ssn_t mySSN = (payload_ssn_t)pPkt->payload.ssn_resp;
+void print_UID48(BaseSequentialStream *chp, const uint8_t *pDigest) {
   int k=0;
 
   chprintf(chp, "  UID-128  0x");
   for (k = 0; k < 16; k++) {
-	  chprintf(chp, "%.2x", pHash->digest[k]);
+	  chprintf(chp, "%.2x", pDigest[k]);
   }
   chprintf(chp, "\r\n");
 
   chprintf(chp, "  UID-48   0x");
   for (k = 0; k < 6; k++) {
-	  chprintf(chp, "%.2x", pHash->digest[k]);
+	  chprintf(chp, "%.2x", pDigest[k]);
   }
   chprintf(chp, "\r\n");
 } // end print_UID48
@@ -155,75 +155,64 @@ void get_instrument_SSN(usb_packet_t *buffer) {
   buffer->length = 4 + 1 + 15; // 1=ssn_cnt, 12 = (4 bytes per ssn_value) * 3 + 3 dummy pads
 } // end get_instrument_SSN
 
+// MD5 of the SSN, the UID-128, computed once by init_instrument_UID
+static uint8_t uidDigest[16];
+static bool_t  uidValid = FALSE;
+
 // ssn_to_MD5:  this is the STM32 version, assumes a 96-bit SSN
+// the SSN words are digested in place, in memory order (little-endian)
 MD5_TEK ssn_to_MD5(void) {
   MD5_TEK  myHash;
-  uint32_t ssn_uint32[3];
-  uint8_t  ssn_uint8[SSN_AS_BYTES_SZ]; // digest input data
-  uint8_t *pbDD  = NULL;               // pointer to byte, digest data
-  uint8_t *pbSSN = NULL;               // pointer to byte, values of mySSN
-  int j,k;
-
-  // Read the chip's unique ID (silicon serial number -> SSN)
-  for (k=0;k<3;k++) {
-	ssn_uint32[k] = *(pSSN_ENTRY+k);  // little-endian, low-order first
-  }
-
-  // copy SSN into md5  context buffer, a byte at a time
-  pbDD  = &ssn_uint8[0];
-  for (k=0;k<3;k++) {     // 96-bits: operate on 3 32-bit chunks
-	pbSSN = (uint8_t*)&(ssn_uint32[k]);
-	for (j=0;j<4;j++) {   // copy 4 bytes of SSN to digest
-	  *pbDD++ = *pbSSN++;
-	}
-  }
 
   MD5Init  (&myHash);
-  MD5Update(&myHash, (unsigned char*)&ssn_uint8, SSN_AS_BYTES_SZ);
+  MD5Update(&myHash, (const unsigned char*)pSSN_ENTRY, SSN_AS_BYTES_SZ);
   MD5Final (&myHash);
   return     myHash;
 } // end ssn_to_MD5
 
-// compute the chip UID, a 3-step operation
-//     1  read the chip silicon serial number (SSN)
-//     2  digest the SSN using MD5 hash
-//     3  load payload with the first 48-bits of MD5
-void get_instrument_UID(usb_packet_t *buffer) {
-  payload_uid_t myUID;
+// digest the SSN once, at boot, the SSN never changes
+// must be called before the dispatcher and the shell are started
+void init_instrument_UID(void) {
   MD5_TEK  myHash;
-  uint32_t ssn_uint32[3];
-  uint8_t  ssn_uint8[SSN_AS_BYTES_SZ]; // digest input data
-  uint8_t *pbDD  = NULL;               // pointer to byte, digest data
-  uint8_t *pbSSN = NULL;               // pointer to byte, values of mySSN
-  int j,k;
-  memset(&myUID,0,sizeof(myUID));
-
-  // Read the chip's unique ID (silicon serial number -> SSN)
-  for (k=0;k<3;k++) {
-	ssn_uint32[k] = *(pSSN_ENTRY+k);  // little-endian, low-order first
-  }
 
-  // copy SSN into md5 context buffer, a byte at a time
-  pbDD  = &ssn_uint8[0];
-  for (k=0;k<3;k++) {     // 96-bits: operate on 3 32-bit chunks
-	pbSSN = (uint8_t*)&(ssn_uint32[k]);
-	for (j=0;j<4;j++) {   // copy 4 bytes of SSN to digest
-	  *pbDD++ = *pbSSN++;
-	}
-  }
+  myHash = ssn_to_MD5();
+  memcpy(uidDigest, myHash.digest, sizeof(uidDigest));
+  uidValid = TRUE;
+} // end init_instrument_UID
 
-  MD5Init  (&myHash);
-  MD5Update(&myHash, (unsigned char*)&ssn_uint8, SSN_AS_BYTES_SZ);
-  MD5Final (&myHash);
+// the cached UID-128, the UID-48 is its first 6 bytes
+const uint8_t *get_instrument_UID128(void) {
+  chDbgAssert(uidValid, "get_instrument_UID128(), #1", "not initialized");
+  return uidDigest;
+} // end get_instrument_UID128
 
-  for (k=0;k<6;k++) {  // copy first 48 bits of hash (6 bytes) to payload
-	  myUID.uid_values[k] = myHash.digest[k];
-  }
+// load payload with the first 48-bits of the cached UID
+void get_instrument_UID(usb_packet_t *buffer) {
+  payload_uid_t myUID;
 
+  memcpy(myUID.uid_values, get_instrument_UID128(), sizeof(myUID.uid_values));
   buffer->payload.uid_resp = (payload_uid_t)myUID;
   buffer->length = 4 + 6; // 1=uid_cnt, 6 = (6 bytes of UID)
 } // end get_instrument_UID
 
+// load payload with the firmware image integrity status
+// the digest is computed by the idle thread, see fwhash.c
+void get_instrument_DIAG(usb_packet_t *buffer) {
+  payload_diag_t   myDiag;
+  fwhash_status_t  st;
+
+  fwHashGetStatus(&st);
+  memset(&myDiag,0,sizeof(myDiag));
+  myDiag.fw_state    = (uint8_t)st.state;
+  myDiag.fw_progress = st.length ? (uint8_t)((uint64_t)st.done * 100 / st.length) : 0;
+  myDiag.fw_passes   = st.passes     > 255 ? 255 : (uint8_t)st.passes;
+  myDiag.fw_mismatch = st.mismatches > 255 ? 255 : (uint8_t)st.mismatches;
+  myDiag.fw_len      = st.length;
+  memcpy(myDiag.fw_sha256, st.digest, sizeof(myDiag.fw_sha256));
+  buffer->payload.diag_resp = (payload_diag_t)myDiag;
+  buffer->length = 4 + sizeof(payload_diag_t); // 4 status bytes, length, 32 digest bytes
+} // end get_instrument_DIAG
+
 
 // The following code 
 typedef struct
@@ -46,8 +46,11 @@
 void get_instrument_ID(usb_packet_t *buffer);
 void get_instrument_SSN(usb_packet_t *buffer);
 void get_instrument_UID(usb_packet_t *buffer);
+void get_instrument_DIAG(usb_packet_t *buffer);  // firmware image SHA-256
+void init_instrument_UID(void);            // computes the cached UID, at boot
+const uint8_t *get_instrument_UID128(void);
 MD5_TEK ssn_to_MD5(void);  // this is a 96-bit SMT32 version
-void print_UID48(BaseSequentialStream *chp, MD5_TEK *pCTXT);
+void print_UID48(BaseSequentialStream *chp, const uint8_t *pDigest);
 void print_ID   (BaseSequentialStream *chp, usb_packet_t *pPkt);
 void print_SSN  (BaseSequentialStream *chp, usb_packet_t *pPkt);
 
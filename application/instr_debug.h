@@ -10,19 +10,16 @@
 
 
 
-// HACK ALERT:
-//   If we fill up the virtual com port's output buffer with nobody connected,
-//   the USB device will stall, waiting to drain off our printf's, so ...
-//      only print if queue has at least 64 bytes of "headroom"
+/* Included by version.h ahead of the ChibiOS headers.*/
+#include "ch.h"
+#include "dlog.h"
+
 #define RELEASE
-#ifndef RELEASE
-#define dprintf(args...)                    \
-  if (chOQGetFullI(&SDU1.oqueue)<64) {      \
-     chprintf(shell_cfg1.sc_channel, args); \
-     chThdSleep(MS2ST(50)); }
-#else
-#define dprintf(args...)
-#endif
+
+// dprintf only records the format string and the raw arguments, the text
+// is produced later by the dlog drain thread (see dlog.h). At most four
+// arguments, %s arguments must point to strings that are never modified.
+#define dprintf(...) dlog(__VA_ARGS__)
 
 #define GREEN_ON palSetPad(GPIOD,12)
 #define GREEN_OFF palClearPad(GPIOD,12)
@@ -0,0 +1,485 @@
+/**
+ * @file    instr_net.c
+ * @brief   Instrument packet protocol over TCP and UDP code.
+ * @details Serves the @p usb_packet_t command dispatcher over the lwIP raw
+ *          API. Packets are framed in place on the received pbuf chain and
+ *          handed to the instrument thread, which dispatches them, so a
+ *          slow command never stalls the tcpip thread. Several requests
+ *          can be queued in a single segment or datagram, every client
+ *          has one request in flight and the responses are sent in order
+ *          from the tcpip thread.
+ *
+ * @{
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "ch.h"
+#include "hal.h"
+
+#include "lwip/opt.h"
+#include "lwip/pbuf.h"
+#include "lwip/tcp.h"
+#include "lwip/udp.h"
+#include "lwip/tcpip.h"
+
+#include "usbcmdio.h"
+#include "instr_task.h"
+#include "instr_net.h"
+
+#if INSTR_USE_NET || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+#if INSTR_NET_MAX_CONNS + 1 > INSTR_REQUEST_QUEUE_SIZE
+#error "INSTR_REQUEST_QUEUE_SIZE too small for INSTR_NET_MAX_CONNS"
+#endif
+
+/**
+ * @brief   TCP connection state.
+ */
+typedef struct {
+  /** @brief Connection PCB, @p NULL if the connection is closed.*/
+  struct tcp_pcb            *pcb;
+  /** @brief Received data not yet answered.*/
+  struct pbuf               *rx;
+  /** @brief Offset of the next packet in @p rx.*/
+  u16_t                     rxoff;
+  /** @brief Length of the packet at @p rxoff being served, zero if none.*/
+  u8_t                      rxlen;
+  /** @brief The request is owned by the instrument thread.*/
+  bool_t                    busy;
+  /** @brief Request of the packet being served.*/
+  instr_request_t           req;
+} instr_conn_t;
+
+/**
+ * @brief   UDP endpoint state, one datagram is served at a time.
+ */
+typedef struct {
+  struct udp_pcb            *pcb;
+  /** @brief Datagram being served, @p NULL if none.*/
+  struct pbuf               *rx;
+  /** @brief Offset of the packet being served in @p rx.*/
+  u16_t                     rxoff;
+  /** @brief Length of the packet being served.*/
+  u8_t                      rxlen;
+  ip_addr_t                 addr;
+  u16_t                     port;
+  /** @brief Responses gathered so far.*/
+  struct pbuf               *out;
+  u16_t                     used;
+  instr_request_t           req;
+} instr_udp_t;
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Network front end statistics.
+ */
+instr_net_stats_t instr_net_stats;
+
+/*===========================================================================*/
+/* Driver local variables.                                                   */
+/*===========================================================================*/
+
+static instr_conn_t conns[INSTR_NET_MAX_CONNS];
+
+static instr_udp_t udps;
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Finds the pbuf holding an offset of a chain.
+ *
+ * @param[in] p         pbuf chain
+ * @param[in,out] offp  offset in the chain, on return offset in the pbuf
+ * @return              The pbuf, @p NULL if past the end of the chain.
+ */
+static struct pbuf *frame_seek(struct pbuf *p, u16_t *offp) {
+
+  while ((p != NULL) && (*offp >= p->len)) {
+    *offp -= p->len;
+    p = p->next;
+  }
+  return p;
+}
+
+/**
+ * @brief   Checks the packet at an offset of a pbuf chain.
+ *
+ * @param[in] p         received pbuf chain
+ * @param[in] off       offset of the packet
+ * @return              The packet length.
+ * @retval 0            if the packet is not yet complete.
+ * @retval -1           if the packet is malformed.
+ */
+static int frame_check(struct pbuf *p, u16_t off) {
+  u16_t avail = p->tot_len - off;
+  u8_t len;
+
+  if (avail < USB_PKT_MIN_HEADER_SZ)
+    return 0;
+  /* A single length byte, any value fits in an usb_packet_t.*/
+  p = frame_seek(p, &off);
+  len = ((const u8_t *)p->payload)[off];
+  if (len < USB_PKT_MIN_HEADER_SZ)
+    return -1;
+  return len <= avail ? len : 0;
+}
+
+/**
+ * @brief   Hands a packet to the instrument thread.
+ * @details A packet contiguous in a pbuf is parsed in place, the pbuf must
+ *          not be freed until the request completes. Only a packet
+ *          crossing a pbuf boundary is gathered into the request.
+ */
+static void frame_post(instr_request_t *rp, struct pbuf *p, u16_t off,
+                       u8_t len) {
+  struct pbuf *q = frame_seek(p, &off);
+
+  if (off + len <= q->len)
+    rp->req = (const uint8_t *)q->payload + off;
+  else {
+    pbuf_copy_partial(q, &rp->rsp, len, off);
+    rp->req = (const uint8_t *)&rp->rsp;
+  }
+  rp->rval = len;
+  instr_net_stats.requests++;
+  /* Cannot fail, every client has at most one request in the mailbox.*/
+  (void)instrPostRequest(rp);
+}
+
+/**
+ * @brief   Request completion, runs in the instrument thread.
+ * @details The response is processed in the tcpip thread.
+ */
+static void frame_done(instr_request_t *rp, tcpip_callback_fn func) {
+
+  while (tcpip_callback(func, rp) != ERR_OK)
+    chThdSleepMilliseconds(1);
+}
+
+static void conn_free(instr_conn_t *cp) {
+
+  /* The received data is still read by the instrument thread.*/
+  if (!cp->busy) {
+    if (cp->rx != NULL)
+      pbuf_free(cp->rx);
+    cp->rx = NULL;
+    cp->rxoff = 0;
+    cp->rxlen = 0;
+  }
+  cp->pcb = NULL;
+}
+
+static err_t conn_close(instr_conn_t *cp) {
+  struct tcp_pcb *pcb = cp->pcb;
+
+  tcp_arg(pcb, NULL);
+  tcp_recv(pcb, NULL);
+  tcp_sent(pcb, NULL);
+  tcp_poll(pcb, NULL, 0);
+  tcp_err(pcb, NULL);
+  conn_free(cp);
+  if (tcp_close(pcb) != ERR_OK) {
+    tcp_abort(pcb);
+    return ERR_ABRT;
+  }
+  return ERR_OK;
+}
+
+/**
+ * @brief   Serves the complete packets received on a connection.
+ * @details Packets are answered one at a time and in order. A packet is
+ *          consumed only when its response has been queued, when the send
+ *          buffer cannot take the response the packet is kept and its
+ *          window stays closed, the response is retried from the sent and
+ *          poll callbacks.
+ *
+ * @return              @p ERR_ABRT if the connection has been aborted.
+ */
+static err_t conn_process(instr_conn_t *cp) {
+  struct tcp_pcb *pcb = cp->pcb;
+  u16_t consumed = 0;
+  bool_t queued = FALSE;
+  int len;
+
+  while ((cp->rx != NULL) && !cp->busy) {
+    if (cp->rxlen > 0) {
+      /* Response ready.*/
+      if (cp->req.send) {
+        if (tcp_write(pcb, &cp->req.rsp, cp->req.rsp.length,
+                      TCP_WRITE_FLAG_COPY | TCP_WRITE_FLAG_MORE) != ERR_OK)
+          break;
+        queued = TRUE;
+      }
+      cp->rxoff += cp->rxlen;
+      consumed += cp->rxlen;
+      cp->rxlen = 0;
+
+      /* Releasing the fully consumed pbufs at the head of the chain.*/
+      while ((cp->rx != NULL) && (cp->rxoff >= cp->rx->len)) {
+        struct pbuf *q = cp->rx->next;
+
+        cp->rxoff -= cp->rx->len;
+        if (q != NULL)
+          pbuf_ref(q);
+        pbuf_free(cp->rx);
+        cp->rx = q;
+      }
+      continue;
+    }
+
+    len = frame_check(cp->rx, cp->rxoff);
+    if (len == 0)
+      break;
+    if (len < 0) {
+      /* Framing lost, there is no way to resync the stream.*/
+      instr_net_stats.errors++;
+      tcp_recv(pcb, NULL);
+      conn_free(cp);
+      tcp_abort(pcb);
+      return ERR_ABRT;
+    }
+    cp->rxlen = (u8_t)len;
+    cp->busy = TRUE;
+    frame_post(&cp->req, cp->rx, cp->rxoff, (u8_t)len);
+  }
+
+  if (consumed > 0)
+    tcp_recved(pcb, consumed);
+  if (queued)
+    tcp_output(pcb);
+  return ERR_OK;
+}
+
+/**
+ * @brief   TCP response ready, runs in the tcpip thread.
+ */
+static void conn_done(void *arg) {
+  instr_conn_t *cp = (instr_conn_t *)((u8_t *)arg -
+                                      offsetof(instr_conn_t, req));
+
+  cp->busy = FALSE;
+  if (cp->pcb == NULL)
+    conn_free(cp);
+  else
+    conn_process(cp);
+}
+
+static void conn_req_done(instr_request_t *rp) {
+
+  frame_done(rp, conn_done);
+}
+
+static err_t tcp_recv_cb(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
+                         err_t err) {
+  instr_conn_t *cp = arg;
+
+  (void)pcb;
+
+  if ((p == NULL) || (err != ERR_OK)) {
+    if (p != NULL)
+      pbuf_free(p);
+    return conn_close(cp);
+  }
+
+  if (cp->rx == NULL)
+    cp->rx = p;
+  else
+    pbuf_cat(cp->rx, p);
+  return conn_process(cp);
+}
+
+static err_t tcp_sent_cb(void *arg, struct tcp_pcb *pcb, u16_t len) {
+
+  (void)pcb;
+  (void)len;
+
+  /* Space freed in the send buffer, resuming the pending responses.*/
+  return conn_process(arg);
+}
+
+static err_t tcp_poll_cb(void *arg, struct tcp_pcb *pcb) {
+
+  (void)pcb;
+
+  /* Retrying a response refused with nothing in flight.*/
+  return conn_process(arg);
+}
+
+static void tcp_err_cb(void *arg, err_t err) {
+
+  (void)err;
+
+  /* The PCB has already been freed by lwIP.*/
+  if (arg != NULL)
+    conn_free(arg);
+}
+
+static err_t tcp_accept_cb(void *arg, struct tcp_pcb *pcb, err_t err) {
+  struct tcp_pcb *lpcb = arg;
+  unsigned i;
+
+  (void)err;
+
+  tcp_accepted(lpcb);
+  for (i = 0; i < INSTR_NET_MAX_CONNS; i++) {
+    /* A slot is reused once its last request has completed.*/
+    if ((conns[i].pcb == NULL) && !conns[i].busy) {
+      conns[i].pcb = pcb;
+      conns[i].req.done = conn_req_done;
+      tcp_arg(pcb, &conns[i]);
+      tcp_recv(pcb, tcp_recv_cb);
+      tcp_sent(pcb, tcp_sent_cb);
+      tcp_poll(pcb, tcp_poll_cb, INSTR_NET_POLL_INTERVAL);
+      tcp_err(pcb, tcp_err_cb);
+      /* Request/response traffic, responses must not wait for an ACK.*/
+      tcp_nagle_disable(pcb);
+      instr_net_stats.accepted++;
+      return ERR_OK;
+    }
+  }
+  instr_net_stats.refused++;
+  return ERR_MEM;
+}
+
+static void udp_send_out(void) {
+
+  pbuf_realloc(udps.out, udps.used);
+  udp_sendto(udps.pcb, udps.out, &udps.addr, udps.port);
+  pbuf_free(udps.out);
+  udps.out = NULL;
+}
+
+/**
+ * @brief   Serves the packets of the current datagram.
+ * @details Every datagram carries whole packets, trailing garbage is
+ *          ignored. The responses are gathered into datagrams of up to
+ *          @p INSTR_NET_UDP_MAX bytes.
+ */
+static void udp_process(void) {
+  int len;
+
+  if (udps.rxlen > 0) {
+    /* Response ready.*/
+    if (udps.req.send) {
+      u8_t n = udps.req.rsp.length;
+
+      if ((udps.out != NULL) && (udps.used + n > INSTR_NET_UDP_MAX))
+        udp_send_out();
+      if (udps.out == NULL) {
+        udps.out = pbuf_alloc(PBUF_TRANSPORT, INSTR_NET_UDP_MAX, PBUF_RAM);
+        udps.used = 0;
+      }
+      if (udps.out != NULL) {
+        memcpy((u8_t *)udps.out->payload + udps.used, &udps.req.rsp, n);
+        udps.used += n;
+      }
+    }
+    udps.rxoff += udps.rxlen;
+    udps.rxlen = 0;
+  }
+
+  len = frame_check(udps.rx, udps.rxoff);
+  if (len > 0) {
+    udps.rxlen = (u8_t)len;
+    frame_post(&udps.req, udps.rx, udps.rxoff, (u8_t)len);
+    return;
+  }
+
+  /* Datagram done.*/
+  if (len < 0)
+    instr_net_stats.errors++;
+  pbuf_free(udps.rx);
+  udps.rx = NULL;
+  if (udps.out != NULL)
+    udp_send_out();
+}
+
+/**
+ * @brief   UDP response ready, runs in the tcpip thread.
+ */
+static void udp_done(void *arg) {
+
+  (void)arg;
+
+  udp_process();
+}
+
+static void udp_req_done(instr_request_t *rp) {
+
+  frame_done(rp, udp_done);
+}
+
+static void udp_recv_cb(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                        ip_addr_t *addr, u16_t port) {
+
+  (void)arg;
+  (void)pcb;
+
+  if (udps.rx != NULL) {
+    /* Previous datagram still being served.*/
+    instr_net_stats.dropped++;
+    pbuf_free(p);
+    return;
+  }
+  udps.rx = p;
+  udps.rxoff = 0;
+  udps.rxlen = 0;
+  ip_addr_copy(udps.addr, *addr);
+  udps.port = port;
+  udp_process();
+}
+
+/**
+ * @brief   Creates the listeners, runs in the tcpip thread.
+ */
+static void net_init(void *arg) {
+  struct tcp_pcb *pcb, *lpcb;
+  struct udp_pcb *upcb;
+
+  (void)arg;
+
+  pcb = tcp_new();
+  chDbgAssert(pcb != NULL, "net_init(), #1", "no TCP PCB");
+  tcp_bind(pcb, IP_ADDR_ANY, INSTR_NET_PORT);
+  lpcb = tcp_listen_with_backlog(pcb, INSTR_NET_MAX_CONNS);
+  chDbgAssert(lpcb != NULL, "net_init(), #2", "no listen PCB");
+  tcp_arg(lpcb, lpcb);
+  tcp_accept(lpcb, tcp_accept_cb);
+
+  upcb = udp_new();
+  chDbgAssert(upcb != NULL, "net_init(), #3", "no UDP PCB");
+  udp_bind(upcb, IP_ADDR_ANY, INSTR_NET_PORT);
+  udp_recv(upcb, udp_recv_cb, NULL);
+  udps.pcb = upcb;
+  udps.req.done = udp_req_done;
+}
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Starts serving the instrument protocol on the network.
+ * @pre     The lwIP thread must have been started.
+ *
+ * @api
+ */
+void instrNetStart(void) {
+
+  tcpip_callback(net_init, NULL);
+}
+
+#endif /* INSTR_USE_NET */
+
+/** @} */
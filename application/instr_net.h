@@ -0,0 +1,112 @@
+/**
+ * @file    instr_net.h
+ * @brief   Instrument packet protocol over TCP and UDP macros and structures.
+ *
+ * @{
+ */
+
+#ifndef _INSTR_NET_H_
+#define _INSTR_NET_H_
+
+#if INSTR_USE_NET || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @name    INSTR_NET configuration options
+ * @{
+ */
+/**
+ * @brief   TCP and UDP port of the instrument protocol.
+ */
+#if !defined(INSTR_NET_PORT) || defined(__DOXYGEN__)
+#define INSTR_NET_PORT              4320
+#endif
+
+/**
+ * @brief   Maximum number of simultaneous TCP connections.
+ */
+#if !defined(INSTR_NET_MAX_CONNS) || defined(__DOXYGEN__)
+#define INSTR_NET_MAX_CONNS         2
+#endif
+
+/**
+ * @brief   Maximum size of a UDP response datagram.
+ * @details Responses to the packets of a request datagram are gathered
+ *          into datagrams of up to this size.
+ */
+#if !defined(INSTR_NET_UDP_MAX) || defined(__DOXYGEN__)
+#define INSTR_NET_UDP_MAX           1024
+#endif
+
+/**
+ * @brief   TCP poll interval, in units of the lwIP slow timer.
+ * @details A response refused by a full send buffer is retried when the
+ *          data in flight is acknowledged, or at this interval.
+ */
+#if !defined(INSTR_NET_POLL_INTERVAL) || defined(__DOXYGEN__)
+#define INSTR_NET_POLL_INTERVAL     1
+#endif
+/** @} */
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+#if !LWIP_TCP || !LWIP_UDP
+#error "INSTR_NET requires LWIP_TCP and LWIP_UDP"
+#endif
+
+#if INSTR_NET_UDP_MAX < 256
+#error "INSTR_NET_UDP_MAX must hold at least one packet"
+#endif
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Network front end statistics.
+ */
+typedef struct {
+  /** @brief Accepted TCP connections.*/
+  uint32_t                  accepted;
+  /** @brief Connections refused because all slots were in use.*/
+  uint32_t                  refused;
+  /** @brief Dispatched request packets.*/
+  uint32_t                  requests;
+  /** @brief Malformed packets, the TCP connection is dropped.*/
+  uint32_t                  errors;
+  /** @brief UDP datagrams dropped while the previous one was served.*/
+  uint32_t                  dropped;
+} instr_net_stats_t;
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+extern instr_net_stats_t instr_net_stats;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void instrNetStart(void);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* INSTR_USE_NET */
+
+#endif /* _INSTR_NET_H_ */
+
+/** @} */
@@ -28,6 +28,7 @@
 
 #include "ch.h"
 #include "hal.h"
+#include <string.h>
 #include <strings.h>
 
 #include   "bbi2c.h"
@@ -40,6 +41,8 @@
 
 #include "instr_task.h"
 #include "instr_debug.h"
+#include "boot.h"
+#include "ccm.h"
 #include "instr_error.h"   // error and status definitions: OK or HOK = 0, status is positive, errors negative
 
 #include "OSandPlatform.h"
@@ -58,6 +61,8 @@ static uint8_t  i2c_addr = 0x1c; //0b0011100;
 
 #define PKTIO_TIMEOUT -1
 
+static void serveRequests(systime_t time);
+
 // return:  number of bytes received... unless err
 static int readPacket(usb_packet_t *buffer, systime_t tmo)
 {
@@ -66,8 +71,9 @@ static int readPacket(usb_packet_t *buffer, systime_t tmo)
   uint_fast8_t rval;
   systime_t tmoTime=chTimeNow() + tmo;
   
-  //Wait for the first 4 bytes (header)
+  //Wait for the first 4 bytes (header), serving the queued requests
   do {
+    serveRequests(TIME_IMMEDIATE);
     rval=BDU1.vmt->readt(&BDU1,(uint8_t *)buffer,4,2);
     if (tmo && chTimeNow()>tmoTime) return(PKTIO_TIMEOUT);
   } while (rval<=0);
@@ -103,8 +109,12 @@ static int writePacket(usb_packet_t *buffer, systime_t tmo)
     rval=BDU1.vmt->writet(&BDU1,(uint8_t *)buffer,nbytes,2);
     nbytes -= rval;
     nwritten += rval;
-    if (tmo && chTimeNow()>tmoTime) return(nwritten);
+    if (tmo && chTimeNow()>tmoTime) break;
   } while(nbytes > 0);
+#if BULK_USB_TX_COALESCE
+  // Whole packet queued, don't wait for the coalescing timer
+  bduFlush(&BDU1);
+#endif
   return(nwritten);
 }
 
@@ -114,33 +124,125 @@ static int writePacket(usb_packet_t *buffer, systime_t tmo)
 //
 //   Recognize 7 commands:  ACK, NAK, RESET, ID, WRITE, READ, ECHO
 
+// Requests from the other front ends, only the instrument thread dispatches
+static msg_t requestBuf[INSTR_REQUEST_QUEUE_SIZE];
+static MAILBOX_DECL(requestMbx, requestBuf, INSTR_REQUEST_QUEUE_SIZE);
+
+// Execute one command packet, the response is built in rsp
+// req:     request bytes, read bytewise, may be rsp itself
+// rval:    number of bytes received
+// return:  TRUE if the response must be sent back
+bool_t dispatchRequest(const uint8_t *req, int rval, usb_packet_t *rsp)
+{
+  uint16_t aCheckSum = 0;
+  ChipDriverStatus_t chipStatus = SUCCESS;
+  bool_t send = TRUE;
+  usb_packet_t *pkt = rsp;
+
+  // Only the header is needed, ECHO copies the payload below
+  if (req != (const uint8_t *)rsp) {
+    bzero(rsp, sizeof(usb_packet_t));
+    memcpy(rsp, req, USB_PKT_MIN_HEADER_SZ);
+  }
+  switch (pkt->type) {
+  case CMD_ACK:
+  case CMD_NAK:
+  case CMD_RESET:
+    pkt->length = 4;
+    break;
+  case CMD_ID:
+    dprintf("ID \r\n");
+    get_instrument_ID(pkt); // my_id;
+    // pkt->length=4+sizeof(payload_id_response_t);
+    break;
+  case CMD_ECHO:
+    dprintf("ECHO \r\n");
+    if ((req != (const uint8_t *)rsp) && (rval > USB_PKT_MIN_HEADER_SZ))
+      memcpy(rsp->payload.asBytes, req + USB_PKT_MIN_HEADER_SZ,
+             rval - USB_PKT_MIN_HEADER_SZ < (int)sizeof(rsp->payload.asBytes) ?
+             rval - USB_PKT_MIN_HEADER_SZ : (int)sizeof(rsp->payload.asBytes));
+    send = (rval > 0);              // echo the incoming packet, if non-zero
+    break;
+  case CMD_SSN:
+    dprintf("SSN \r\n");
+    get_instrument_SSN(pkt);
+    break;
+  case CMD_UID:
+    dprintf("UID \r\n");
+    get_instrument_UID(pkt);
+    break;
+  case CMD_DIAG:
+    dprintf("DIAG \r\n");
+    get_instrument_DIAG(pkt);
+    break;
+  default:
+    dprintf("ERROR: unrecognized command: %u\r\n",pkt->type);
+    pkt->length = 4;
+    chipStatus = ERR_UNKNOWN;
+    break;
+  }
+  // all packet's ACK unless error, NAK included
+  if (chipStatus == SUCCESS)
+    pkt->type = CMD_ACK;
+  else
+    pkt->type = CMD_NAK;
+  // aCheckSum = compute_fletch(pkt);
+  pkt->checksum = aCheckSum;  // TODO: compute FLETCH
+  return send;
+}
+
+// Execute one command packet, the response is built in place
+bool_t dispatchPacket(usb_packet_t *pkt, int rval)
+{
+  return dispatchRequest((const uint8_t *)pkt, rval, pkt);
+}
+
+// Queue a request, the caller is notified through rp->done
+msg_t instrPostRequest(instr_request_t *rp)
+{
+  return chMBPost(&requestMbx, (msg_t)rp, TIME_IMMEDIATE);
+}
+
+// Serve the queued requests, waiting up to time for the first one
+static void serveRequests(systime_t time)
+{
+  msg_t msg;
+
+  while (chMBFetch(&requestMbx, &msg, time) == RDY_OK) {
+    instr_request_t *rp = (instr_request_t *)msg;
+
+    rp->send = dispatchRequest(rp->req, rp->rval, &rp->rsp);
+    rp->done(rp);
+    time = TIME_IMMEDIATE;
+  }
+}
+
 /*
  * This is the "instrument thread" 
  * Reads packets and dispatches to instrument control routines
  */
 
 __attribute__((noreturn)) msg_t InstrumentThread(void *arg) {
-  size_t rval; 
-#ifndef RELEASE
+  int rval; 
   size_t wval;
-#endif
-  uint16_t aCheckSum = 0;
+  static CCM_RAM dlog_ring_t dlogRing;
 #ifdef _TEST_BBI2C
   uint8_t status;
   static uint8_t txbuf[32];
   static uint8_t rxbuf[32];
 #endif // _TEST_BBI2C
-  ChipDriverStatus_t chipStatus = SUCCESS;
   // volatile int32_t dly = 0, dmmy = 0;
   // int j,k;
   // uint8_t bit, pldata;
   
   (void)arg;
   chRegSetThreadName("Instrument");
+  dlogThreadInit(&dlogRing);
 
 
   /* Reader thread loop.*/
-  while (!USBconfigured) chThdSleep(100); //Wait here until USB hw is configured
+  while (!USBconfigured) serveRequests(MS2ST(1)); //Wait here until USB hw is configured
+  bootMark("usb configured");
 
   RED_OFF;
   while (TRUE) {
@@ -156,107 +258,9 @@ __attribute__((noreturn)) msg_t InstrumentThread(void *arg) {
     //   Recognize 8 commands:  ACK, NAK, RESET, ID, WRITE, READ, ECHO, SHADOW
 
     // DB1_HI;
-    switch (pktInBuf.type) {
-    case CMD_ACK:
-      pktInBuf.length = 4;
-      // aCheckSum = compute_fletch(&pktInBuf);
-      pktInBuf.checksum = aCheckSum;  // TODO: compute FLETCH
-#ifdef RELEASE
-      writePacket(&pktInBuf,0);
-#else
+    if (dispatchPacket(&pktInBuf, rval)) {
       wval=writePacket(&pktInBuf,0);
-      dprintf("ACK sent %u \r\n",wval);
-#endif
-      break;
-    case CMD_NAK:
-      pktInBuf.length = 4;
-      pktInBuf.type = CMD_ACK;        // all packet's ACK unless error
-      // aCheckSum = compute_fletch(&pktInBuf);
-      pktInBuf.checksum = aCheckSum;  // TODO: compute FLETCH
-#ifdef RELEASE
-      writePacket(&pktInBuf,0);
-#else
-      wval=writePacket(&pktInBuf,0);
-      dprintf("NAK sent %u\r\n",wval);
-#endif
-      break;
-    case CMD_RESET:
-
-      pktInBuf.length = 4;
-      if (chipStatus == SUCCESS) 
-        pktInBuf.type = CMD_ACK;        // all packet's ACK unless error
-      else
-        pktInBuf.type = CMD_NAK; 
-      // aCheckSum = compute_fletch(&pktInBuf);
-      pktInBuf.checksum = aCheckSum;  // TODO: compute FLETCH
-#ifdef RELEASE
-      writePacket(&pktInBuf,0);
-#else
-      wval=writePacket(&pktInBuf,0);
-      dprintf("RESET sent %u\r\n",wval);
-#endif
-      break;
-    case CMD_ID:
-      dprintf("ID \r\n");
-      get_instrument_ID(&pktInBuf); // my_id;
-      // pktInBuf.length=4+sizeof(payload_id_response_t);
-      if (chipStatus == SUCCESS) 
-        pktInBuf.type = CMD_ACK;        // all packet's ACK unless error
-      else
-        pktInBuf.type = CMD_NAK; 
-      // aCheckSum = compute_fletch(&pktInBuf);
-      pktInBuf.checksum = aCheckSum;  // TODO: compute FLETCH
-#ifdef RELEASE
-      writePacket(&pktInBuf,0);
-#else
-      wval=writePacket(&pktInBuf,0);
-      dprintf("ID sent %u \r\n",wval);
-#endif
-      break;
-    case CMD_ECHO:
-      dprintf("ECHO \r\n");
-      pktInBuf.type = CMD_ACK;        // all packet's ACK unless error
-      // aCheckSum = compute_fletch(&pktInBuf);
-      pktInBuf.checksum = aCheckSum;  // TODO: compute FLETCH
-      if (rval > 0) {                 // echo the incoming packet, if non-zero
-#ifdef RELEASE
-        writePacket(&pktInBuf,0);
-#else
-        wval=writePacket(&pktInBuf,0);
-        dprintf("ECHO sent %d\r\n",wval);
-#endif
-      }
-      break;
-    case CMD_SSN:
-      dprintf("SSN \r\n");
-      get_instrument_SSN(&pktInBuf);
-      if (chipStatus == SUCCESS) 
-        pktInBuf.type = CMD_ACK;
-      else
-        pktInBuf.type = CMD_NAK; 
-      // aCheckSum = compute_fletch(&pktInBuf);
-      pktInBuf.checksum = aCheckSum;  // TODO: compute FLETCH
-      writePacket(&pktInBuf,0);
-      break;
-    case CMD_UID:
-      dprintf("UID \r\n");
-      get_instrument_UID(&pktInBuf);
-      if (chipStatus == SUCCESS) 
-        pktInBuf.type = CMD_ACK;
-      else
-        pktInBuf.type = CMD_NAK; 
-      // aCheckSum = compute_fletch(&pktInBuf);
-      pktInBuf.checksum = aCheckSum;  // TODO: compute FLETCH
-      writePacket(&pktInBuf,0);
-      break;
-    default:
-      dprintf("ERROR: unrecognized command: %u\r\n",pktInBuf.type);
-      pktInBuf.length = 4;
-      pktInBuf.type = CMD_NAK;        // packet's NAK on error
-      // aCheckSum = compute_fletch(&pktInBuf);
-      pktInBuf.checksum = aCheckSum;  // TODO: compute FLETCH
-      writePacket(&pktInBuf,0);
-      break;
+      dprintf("sent %u\r\n",wval);
     }
 
 #ifdef _SPI_TEST
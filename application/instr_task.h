@@ -30,6 +30,58 @@
 
 #include "usbcmdio.h"
 
+/**
+ * @brief   size of the instrument thread requests mailbox
+ * @details Requests from the front ends other than USB, every front end
+ *          keeps at most one request per client in flight.
+ */
+#if !defined(INSTR_REQUEST_QUEUE_SIZE) || defined(__DOXYGEN__)
+#define INSTR_REQUEST_QUEUE_SIZE    4
+#endif
+
+typedef struct instr_request instr_request_t;
+
+/**
+ * @brief   request completion callback, called by the instrument thread
+ */
+typedef void (*instr_done_t)(instr_request_t *rp);
+
+/**
+ * @brief   command request handed to the instrument thread
+ */
+struct instr_request {
+  /** @brief request packet bytes, must stay valid until completion */
+  const uint8_t         *req;
+  /** @brief number of bytes received */
+  int                   rval;
+  /** @brief response, the request may be gathered here */
+  usb_packet_t          rsp;
+  /** @brief TRUE if the response must be sent back */
+  bool_t                send;
+  /** @brief completion callback */
+  instr_done_t          done;
+};
+
+/**
+ * @brief   executes a command packet, the response is built in place
+ * @return  TRUE if the response must be sent back
+ */
+bool_t dispatchPacket(usb_packet_t *pkt, int rval);
+
+/**
+ * @brief   executes a command packet into a separate response
+ * @details the request is only read bytewise and may be unaligned, it
+ *          may also be the response buffer itself
+ * @return  TRUE if the response must be sent back
+ */
+bool_t dispatchRequest(const uint8_t *req, int rval, usb_packet_t *rsp);
+
+/**
+ * @brief   queues a request to the instrument thread
+ * @return  RDY_OK, or RDY_TIMEOUT if the mailbox is full
+ */
+msg_t instrPostRequest(instr_request_t *rp);
+
 /**
  * @brief   definition of the instrument thread
  */
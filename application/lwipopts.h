@@ -0,0 +1,40 @@
+/**
+ * @file    lwipopts.h
+ * @brief   lwIP configuration, used when building with USE_LWIP = yes.
+ * @details Only the raw API is used, the instrument protocol runs in the
+ *          tcpip thread.
+ *
+ * @{
+ */
+
+#ifndef __LWIPOPTS_H__
+#define __LWIPOPTS_H__
+
+/* Memory.*/
+#define MEM_ALIGNMENT                   4
+#define MEM_SIZE                        (8 * 1024)
+#define PBUF_POOL_SIZE                  8
+#define MEMP_NUM_TCP_PCB                4
+#define MEMP_NUM_TCP_SEG                16
+
+/* Sequential and socket APIs are not used.*/
+#define LWIP_NETCONN                    0
+#define LWIP_SOCKET                     0
+#define MEMP_NUM_NETCONN                0
+#define TCPIP_MBOX_SIZE                 8
+
+/* TCP, small request/response packets.*/
+#define TCP_MSS                         1460
+#define TCP_SND_BUF                     (4 * TCP_MSS)
+#define TCP_SND_QUEUELEN                16
+#define TCP_WND                         (4 * TCP_MSS)
+#define TCP_LISTEN_BACKLOG              1
+
+/* Static addressing, see lwipthread.h.*/
+#define LWIP_DHCP                       0
+
+#define LWIP_STATS                      0
+
+#endif /* __LWIPOPTS_H__ */
+
+/** @} */
@@ -27,10 +27,20 @@
 #include "cmd_shell.h"
 
 #include "bulk_usb.h"
+#include "adc_stream.h"
 #include "usbcfg.h"
+#include "boot.h"
+#include "ccm.h"
+#include "fwhash.h"
 #include <strings.h>
 
 #include "instr_task.h"
+#include "instr_cmds.h"
+#if INSTR_USE_NET
+#include "lwipthread.h"
+#include "lwip/opt.h"
+#include "instr_net.h"
+#endif
 #include "instr_debug.h"       // common debug macros:  dprintf
 
 extern SerialUSBDriver SDU1;   // virtual serial port over USB
@@ -51,17 +61,74 @@ static const SPIConfig spi2cfg = {
 };
 
 
+/*
+ * Serial driver 2 configuration, debug console.
+ * 2Mbaud (exact divider from the 42MHz APB1 clock), 8N1. Reception and
+ * transmission run on DMA, see STM32_SERIAL_USART2_USE_DMA in mcuconf.h.
+ */
+static const SerialConfig sd2cfg = {
+  2000000,
+  0,
+  USART_CR2_STOP1_BITS | USART_CR2_LINEN,
+  0
+};
+
 /*===========================================================================*/
 /* Initialization and main thread.                                           */
 /*===========================================================================*/
 
-static WORKING_AREA(waInstrumentThread, 4096);
+static CCM_WORKING_AREA(waInstrumentThread, 4096);
+static CCM_WORKING_AREA(waUsbBoot, 256);
+#ifdef _BBI2C_INCLUDED
+static CCM_WORKING_AREA(waEqBoot, 512);
+#endif
+
+/*
+ * USB bring-up, the pull-up stays off only as long as a host could still
+ * have the device enumerated from before the reset.
+ */
+static msg_t UsbBootThread(void *arg) {
+
+  (void)arg;
+  chRegSetThreadName("usbboot");
+  usbDisconnectBus(serusbcfg.usbp);
+  chThdSleep(bootUsbDisconnectTime());
+  usbStart(serusbcfg.usbp, &usbcfg);
+  usbConnectBus(serusbcfg.usbp);
+  bootMark("usb connect");
+  return 0;
+}
+
+#ifdef _BBI2C_INCLUDED
+/*
+ * Equalizer bring-up, independent from the other peripherals.
+ */
+static msg_t EqBootThread(void *arg) {
+
+  (void)arg;
+  chRegSetThreadName("eqboot");
+  init_bbI2C();
+
+  //Clear and setup the equalizer chip
+  hmc6545setup(&equalizer, NULL, 0x1c, "equalizer");
+  hmc6545softRst(&equalizer);
+  hmc6545clearChip(&equalizer);
+  BLUE_ON;
+  bootMark("equalizer");
+  return 0;
+}
+#endif
 
 /*
  * Application entry point.
  */
 int main(void) {
   Thread *shelltp = NULL;
+#ifdef _BBI2C_INCLUDED
+  Thread *eqtp;
+#endif
+
+  bootInit();
 
   /*
    * System initializations.
@@ -71,7 +138,14 @@ int main(void) {
    *   RTOS is active.
    */
   halInit();
+  bootMark("hal");
   chSysInit();
+  bootMark("kernel");
+
+  /*
+   * Computes the cached UID once, it is served on every CMD_UID and "id".
+   */
+  init_instrument_UID();
 
   /* LED GPIO init
    * PD12 - Green, PD13 - Orange, PD14 - Red, PD15 - Blue
@@ -119,40 +193,34 @@ int main(void) {
   bduStart(&BDU1, &blkusbcfg);
 
 
-  //This one needs to be last so the usb device's upstream pointer is this driver
+  // The serial driver owns the usb device's upstream pointer (param), bulk
+  // channels are routed per endpoint so they can be started in any order.
   sduObjectInit(&SDU1);
   sduStart(&SDU1, &serusbcfg);
   
   
   /*
-   * Activates the USB driver and then the USB bus pull-up on D+.
-   * Note, a delay is inserted in order to not have to disconnect the cable
-   * after a reset.
+   * Activates the USB driver and then the USB bus pull-up on D+, in its own
+   * thread because of the detach delay after a warm reset.
    */
-  usbDisconnectBus(serusbcfg.usbp);
-  chThdSleepMilliseconds(1000);
-  usbStart(serusbcfg.usbp, &usbcfg);
-  usbConnectBus(serusbcfg.usbp);
+  chThdCreateStatic(waUsbBoot, sizeof(waUsbBoot), NORMALPRIO + 1,
+                    UsbBootThread, NULL);
 
   /*
-   * Activates the serial driver 2 using the driver default configuration.
+   * Activates the serial driver 2 using the debug console configuration.
    * PA2(TX) and PA3(RX) are routed to USART2.
    */
-  sdStart(&SD2, NULL);
+  sdStart(&SD2, &sd2cfg);
   palSetPadMode(GPIOA, 2, PAL_MODE_ALTERNATE(7));
   palSetPadMode(GPIOA, 3, PAL_MODE_ALTERNATE(7));
 
   /*
-   * Initialize I2C #1 Driver. Setup SDA=PB7, SCL=PB8
+   * Initialize I2C #1 Driver. Setup SDA=PB7, SCL=PB8, the equalizer setup
+   * runs while the other peripherals are started.
    */
 #ifdef _BBI2C_INCLUDED
-  init_bbI2C();
-
-  //Clear and setup the equalizer chip
-  hmc6545setup(&equalizer, NULL, 0x1c, "equalizer");
-  hmc6545softRst(&equalizer);
-  hmc6545clearChip(&equalizer);
-  BLUE_ON;
+  eqtp = chThdCreateStatic(waEqBoot, sizeof(waEqBoot), NORMALPRIO - 1,
+                           EqBootThread, NULL);
 #endif
 
 
@@ -174,12 +242,51 @@ int main(void) {
                 PAL_STM32_OSPEED_HIGHEST);           /* MOSI.    */
 
 
+  /*
+   * Starts the ADC stream. Analog inputs:
+   * PB0 - IN8, PB1 - IN9, PC1 - IN11, PC2 - IN12.
+   */
+  palSetPadMode(GPIOB, 0, PAL_MODE_INPUT_ANALOG);
+  palSetPadMode(GPIOB, 1, PAL_MODE_INPUT_ANALOG);
+  palSetPadMode(GPIOC, 1, PAL_MODE_INPUT_ANALOG);
+  palSetPadMode(GPIOC, 2, PAL_MODE_INPUT_ANALOG);
+  adcStreamStart();
+
+  /*
+   * Starts formatting the deferred debug log on the shell channel.
+   */
+  dlogStart(shell_cfg1.sc_channel, LOWPRIO);
+
+  /*
+   * Verifies the firmware image in the background, the idle thread hashes
+   * it, served on CMD_DIAG and "id".
+   */
+  fwHashStart();
+
+  bootMark("peripherals");
+
+#ifdef _BBI2C_INCLUDED
+  /* The instrument thread uses the equalizer.*/
+  chThdWait(eqtp);
+#endif
+
   /*
    * Creates the Instrument thread
    */
   chThdCreateStatic(waInstrumentThread, sizeof(waInstrumentThread),
                     NORMALPRIO + 10, InstrumentThread, NULL);
 
+#if INSTR_USE_NET
+  /*
+   * Starts the TCP/IP stack and the instrument protocol network front end.
+   */
+  chThdCreateStatic(wa_lwip_thread, LWIP_THREAD_STACK_SIZE, NORMALPRIO + 1,
+                    lwip_thread, NULL);
+  instrNetStart();
+#endif
+
+  bootMark("threads");
+
   /*
    * Normal main() thread activity, in this demo it just performs
    * a shell respawn upon its termination.
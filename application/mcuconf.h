@@ -65,11 +65,20 @@
 #define STM32_PVD_ENABLE                    FALSE
 #define STM32_PLS                           STM32_PLS_LEV0
 
+/*
+ * DMA helper settings, memory to memory copy service.
+ */
+#define STM32_DMA_USE_MEMCPY                FALSE
+#define STM32_DMA_MEMCPY_STREAM             STM32_DMA_STREAM_ID(2, 1)
+#define STM32_DMA_MEMCPY_IRQ_PRIORITY       12
+#define STM32_DMA_MEMCPY_DMA_PRIORITY       0
+#define STM32_DMA_MEMCPY_THRESHOLD          64
+
 /*
  * ADC driver system settings.
  */
 #define STM32_ADC_ADCPRE                    ADC_CCR_ADCPRE_DIV4
-#define STM32_ADC_USE_ADC1                  FALSE
+#define STM32_ADC_USE_ADC1                  TRUE
 #define STM32_ADC_USE_ADC2                  FALSE
 #define STM32_ADC_USE_ADC3                  FALSE
 #define STM32_ADC_ADC1_DMA_STREAM           STM32_DMA_STREAM_ID(2, 4)
@@ -206,6 +215,24 @@
 #define STM32_SERIAL_UART4_PRIORITY         12
 #define STM32_SERIAL_UART5_PRIORITY         12
 #define STM32_SERIAL_USART6_PRIORITY        12
+#define STM32_SERIAL_USART1_USE_DMA         FALSE
+#define STM32_SERIAL_USART2_USE_DMA         TRUE
+#define STM32_SERIAL_USART3_USE_DMA         FALSE
+#define STM32_SERIAL_USART6_USE_DMA         FALSE
+#define STM32_SERIAL_DMA_RX_BUFFER_SIZE     256
+#define STM32_SERIAL_USART1_RX_DMA_STREAM   STM32_DMA_STREAM_ID(2, 5)
+#define STM32_SERIAL_USART1_TX_DMA_STREAM   STM32_DMA_STREAM_ID(2, 7)
+#define STM32_SERIAL_USART2_RX_DMA_STREAM   STM32_DMA_STREAM_ID(1, 5)
+#define STM32_SERIAL_USART2_TX_DMA_STREAM   STM32_DMA_STREAM_ID(1, 6)
+#define STM32_SERIAL_USART3_RX_DMA_STREAM   STM32_DMA_STREAM_ID(1, 1)
+#define STM32_SERIAL_USART3_TX_DMA_STREAM   STM32_DMA_STREAM_ID(1, 3)
+#define STM32_SERIAL_USART6_RX_DMA_STREAM   STM32_DMA_STREAM_ID(2, 2)
+#define STM32_SERIAL_USART6_TX_DMA_STREAM   STM32_DMA_STREAM_ID(2, 7)
+#define STM32_SERIAL_USART1_DMA_PRIORITY    0
+#define STM32_SERIAL_USART2_DMA_PRIORITY    0
+#define STM32_SERIAL_USART3_DMA_PRIORITY    0
+#define STM32_SERIAL_USART6_DMA_PRIORITY    0
+#define STM32_SERIAL_DMA_ERROR_HOOK(sdp)    chSysHalt()
 
 /*
  * SPI driver system settings.
@@ -226,6 +253,7 @@
 #define STM32_SPI_SPI2_IRQ_PRIORITY         10
 #define STM32_SPI_SPI3_IRQ_PRIORITY         10
 #define STM32_SPI_DMA_ERROR_HOOK(spip)      chSysHalt()
+#define STM32_SPI_USE_STREAMING             TRUE
 
 /*
  * UART driver system settings.
@@ -264,5 +292,7 @@
 #define STM32_USB_OTG_THREAD_PRIO           LOWPRIO
 #define STM32_USB_OTG_THREAD_STACK_SIZE     128
 #define STM32_USB_OTGFIFO_FILL_BASEPRI      0
+#define STM32_USB_OTG_ISR_FILL              TRUE
+#define STM32_USB_OTG_ISR_FILL_MAX_SIZE     256
 
 
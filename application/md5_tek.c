@@ -39,27 +39,26 @@
  */
 
 /* -- include the following if the md5_tek.h header file is separate -- */
+#include <string.h>
 #include "md5_tek.h"
 
+/* Tek changes to the reference version:
+ *  - whole blocks are transformed straight from the caller's buffer, with
+ *    aligned word loads, only the partial head and tail are buffered
+ *  - the byte-wise decode/encode loops are only used on big-endian hosts
+ *  - MD5UpdateV() digests a list of buffers, MD5Digest() is a one-shot
+ *  - MD5SelfTest() checks the RFC 1321 known answers, without stdio
+ */
+
 /* forward declaration */
-static void Transform (UINT4 *buf, UINT4 *in);  // gc++ port:  need full signature
-
-static unsigned char PADDING[64] = {
-  0x80, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
-  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
-};
+static void Transform (UINT4 *buf, const unsigned char *block);
 
-/* F, G and H are basic MD5 functions: selection, majority, parity */
-#define F(x, y, z) (((x) & (y)) | ((~x) & (z)))
-#define G(x, y, z) (((x) & (z)) | ((y) & (~z)))
+/* F, G and H are basic MD5 functions: selection, majority, parity.
+   F and G are in the equivalent forms that save one operation. */
+#define F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define G(x, y, z) ((y) ^ ((z) & ((x) ^ (y))))
 #define H(x, y, z) ((x) ^ (y) ^ (z))
-#define I(x, y, z) ((y) ^ ((x) | (~z))) 
+#define I(x, y, z) ((y) ^ ((x) | (~z)))
 
 /* ROTATE_LEFT rotates x left n bits */
 #define ROTATE_LEFT(x, n) (((x) << (n)) | ((x) >> (32-(n))))
@@ -67,7 +66,7 @@ static unsigned char PADDING[64] = {
 /* FF, GG, HH, and II transformations for rounds 1, 2, 3, and 4 */
 /* Rotation is separate from addition to prevent recomputation */
 #define FF(a, b, c, d, x, s, ac) \
-  {(a) += F ((b), (c), (d)) + (x) + (ac); \
+  {(a) += F ((b), (c), (d)) + (x) + (UINT4)(ac); \
    (a) = ROTATE_LEFT ((a), (s)); \
    (a) += (b); \
   }
@@ -87,6 +86,10 @@ static unsigned char PADDING[64] = {
    (a) += (b); \
   }
 
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define MD5_BIG_ENDIAN 1
+#endif
+
 void MD5Init (MD5_TEK * mdContext)
 {
   mdContext->i[0] = mdContext->i[1] = (UINT4)0;
@@ -99,14 +102,13 @@ void MD5Init (MD5_TEK * mdContext)
   mdContext->buf[3] = (UINT4)0x10325476;
 }
 
-void MD5Update (MD5_TEK *mdContext, unsigned char *inBuf, unsigned int inLen)
+void MD5Update (MD5_TEK *mdContext, const unsigned char *inBuf,
+                unsigned int inLen)
 {
-  UINT4 in[16];
-  int mdi;
-  unsigned int i, ii;
+  unsigned int mdi, n;
 
   /* compute number of bytes mod 64 */
-  mdi = (int)((mdContext->i[0] >> 3) & 0x3F);
+  mdi = (unsigned int)((mdContext->i[0] >> 3) & 0x3F);
 
   /* update number of bits */
   if ((mdContext->i[0] + ((UINT4)inLen << 3)) < mdContext->i[0])
@@ -114,66 +116,125 @@ void MD5Update (MD5_TEK *mdContext, unsigned char *inBuf, unsigned int inLen)
   mdContext->i[0] += ((UINT4)inLen << 3);
   mdContext->i[1] += ((UINT4)inLen >> 29);
 
-  while (inLen--) {
-    /* add new character to buffer, increment mdi */
-    mdContext->in[mdi++] = *inBuf++;
-
-    /* transform if necessary */
-    if (mdi == 0x40) {
-      for (i = 0, ii = 0; i < 16; i++, ii += 4)
-        in[i] = (((UINT4)mdContext->in[ii+3]) << 24) |
-                (((UINT4)mdContext->in[ii+2]) << 16) |
-                (((UINT4)mdContext->in[ii+1]) << 8) |
-                ((UINT4)mdContext->in[ii]);
-      Transform (mdContext->buf, in);
-      mdi = 0;
+  /* complete a buffered partial block first */
+  if (mdi != 0) {
+    n = 64 - mdi;
+    if (inLen < n) {
+      memcpy(&mdContext->in[mdi], inBuf, inLen);
+      return;
     }
+    memcpy(&mdContext->in[mdi], inBuf, n);
+    Transform (mdContext->buf, mdContext->in);
+    inBuf += n;
+    inLen -= n;
+  }
+
+  /* whole blocks straight from the caller's buffer */
+  while (inLen >= 64) {
+    Transform (mdContext->buf, inBuf);
+    inBuf += 64;
+    inLen -= 64;
+  }
+
+  /* keep the tail for the next call */
+  memcpy(mdContext->in, inBuf, inLen);
+}
+
+void MD5UpdateV (MD5_TEK *mdContext, const MD5_BUF *bufs, unsigned int n)
+{
+  while (n--) {
+    MD5Update (mdContext, (const unsigned char *)bufs->data, bufs->len);
+    bufs++;
   }
 }
 
 void MD5Final (MD5_TEK *mdContext)
 {
-  UINT4 in[16];
-  int mdi;
-  unsigned int i, ii;
-  unsigned int padLen;
+  UINT4 bits[2];
+  unsigned int mdi;
 
   /* save number of bits */
-  in[14] = mdContext->i[0];
-  in[15] = mdContext->i[1];
+  bits[0] = mdContext->i[0];
+  bits[1] = mdContext->i[1];
 
   /* compute number of bytes mod 64 */
-  mdi = (int)((mdContext->i[0] >> 3) & 0x3F);
-
-  /* pad out to 56 mod 64 */
-  padLen = (mdi < 56) ? (56 - mdi) : (120 - mdi);
-  MD5Update (mdContext, PADDING, padLen);
+  mdi = (unsigned int)((mdContext->i[0] >> 3) & 0x3F);
+
+  /* pad out to 56 mod 64, a second block is needed past 55 bytes */
+  mdContext->in[mdi++] = 0x80;
+  if (mdi > 56) {
+    memset(&mdContext->in[mdi], 0, 64 - mdi);
+    Transform (mdContext->buf, mdContext->in);
+    mdi = 0;
+  }
+  memset(&mdContext->in[mdi], 0, 56 - mdi);
 
   /* append length in bits and transform */
-  for (i = 0, ii = 0; i < 14; i++, ii += 4)
-    in[i] = (((UINT4)mdContext->in[ii+3]) << 24) |
-            (((UINT4)mdContext->in[ii+2]) << 16) |
-            (((UINT4)mdContext->in[ii+1]) << 8) |
-            ((UINT4)mdContext->in[ii]);
-  Transform (mdContext->buf, in);
+#ifdef MD5_BIG_ENDIAN
+  {
+    unsigned int k;
+
+    for (k = 0; k < 8; k++)
+      mdContext->in[56 + k] = (unsigned char)(bits[k >> 2] >> (8 * (k & 3)));
+  }
+#else
+  memcpy(&mdContext->in[56], bits, 8);
+#endif
+  Transform (mdContext->buf, mdContext->in);
 
   /* store buffer in digest */
-  for (i = 0, ii = 0; i < 4; i++, ii += 4) {
-    mdContext->digest[ii] = (unsigned char)(mdContext->buf[i] & 0xFF);
-    mdContext->digest[ii+1] =
-      (unsigned char)((mdContext->buf[i] >> 8) & 0xFF);
-    mdContext->digest[ii+2] =
-      (unsigned char)((mdContext->buf[i] >> 16) & 0xFF);
-    mdContext->digest[ii+3] =
-      (unsigned char)((mdContext->buf[i] >> 24) & 0xFF);
+#ifdef MD5_BIG_ENDIAN
+  {
+    unsigned int k;
+
+    for (k = 0; k < 16; k++)
+      mdContext->digest[k] =
+        (unsigned char)(mdContext->buf[k >> 2] >> (8 * (k & 3)));
   }
+#else
+  memcpy(mdContext->digest, mdContext->buf, 16);
+#endif
 }
 
-/* Basic MD5 step. Transform buf based on in.
+void MD5Digest (const void *data, unsigned int len, unsigned char *digest)
+{
+  MD5_TEK mdContext;
+
+  MD5Init (&mdContext);
+  MD5Update (&mdContext, (const unsigned char *)data, len);
+  MD5Final (&mdContext);
+  memcpy(digest, mdContext.digest, 16);
+}
+
+/* Basic MD5 step. Transform buf based on a 64 bytes block.
  */
-static void Transform (UINT4* buf, UINT4* in)  // gc++ port: put type with param
+static void Transform (UINT4 *buf, const unsigned char *block)
 {
   UINT4 a = buf[0], b = buf[1], c = buf[2], d = buf[3];
+  UINT4 w[16];
+  const UINT4 *in;
+
+#ifdef MD5_BIG_ENDIAN
+  {
+    unsigned int i, ii;
+
+    for (i = 0, ii = 0; i < 16; i++, ii += 4)
+      w[i] = (((UINT4)block[ii+3]) << 24) |
+             (((UINT4)block[ii+2]) << 16) |
+             (((UINT4)block[ii+1]) << 8) |
+             ((UINT4)block[ii]);
+    in = w;
+  }
+#else
+  /* the message words are little-endian, aligned blocks are used as they
+     are, unaligned ones go through a copy */
+  if (((unsigned long)block & 3) == 0)
+    in = (const UINT4 *)block;
+  else {
+    memcpy(w, block, 64);
+    in = w;
+  }
+#endif
 
   /* Round 1 */
 #define S11 7
@@ -268,6 +329,69 @@ static void Transform (UINT4* buf, UINT4* in)  // gc++ port: put type with param
   buf[2] += c;
   buf[3] += d;
 }
+/* RFC 1321 test suite, the expected digests are in hex. */
+static const struct {
+  const char *msg;
+  const char *hex;
+} md5Kat[] = {
+  {"", "d41d8cd98f00b204e9800998ecf8427e"},
+  {"a", "0cc175b9c0f1b6a831c399e269772661"},
+  {"abc", "900150983cd24fb0d6963f7d28e17f72"},
+  {"message digest", "f96b697d7cb7938d525a2f31aaf161d0"},
+  {"abcdefghijklmnopqrstuvwxyz", "c3fcd3d76192e4007dfb496cca67e13b"},
+  {"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789",
+   "d174ab98d277d9f5a5611c2c9f419d9f"},
+  {"1234567890123456789012345678901234567890"
+   "1234567890123456789012345678901234567890",
+   "57edf4a22be3c955ac49da2e2107b67a"}
+};
+
+static int MDCompare (const unsigned char *digest, const char *hex)
+{
+  static const char digits[] = "0123456789abcdef";
+  int k;
+
+  for (k = 0; k < 16; k++)
+    if ((hex[2*k] != digits[digest[k] >> 4]) ||
+        (hex[2*k+1] != digits[digest[k] & 15]))
+      return 1;
+  return 0;
+}
+
+/* Runs the known answer tests, each message is digested in one piece
+   and again split in three unaligned pieces through MD5UpdateV().
+   Returns the number of failures.
+ */
+int MD5SelfTest (void)
+{
+  unsigned char copy[1 + 80];
+  unsigned char digest[16];
+  MD5_BUF parts[3];
+  MD5_TEK mdContext;
+  unsigned int i, len;
+  int failures = 0;
+
+  for (i = 0; i < sizeof(md5Kat) / sizeof(md5Kat[0]); i++) {
+    len = strlen(md5Kat[i].msg);
+
+    MD5Digest (md5Kat[i].msg, len, digest);
+    failures += MDCompare (digest, md5Kat[i].hex);
+
+    memcpy(&copy[1], md5Kat[i].msg, len);
+    parts[0].data = &copy[1];
+    parts[0].len  = len / 3;
+    parts[1].data = &copy[1 + len / 3];
+    parts[1].len  = len / 3;
+    parts[2].data = &copy[1 + 2 * (len / 3)];
+    parts[2].len  = len - 2 * (len / 3);
+    MD5Init (&mdContext);
+    MD5UpdateV (&mdContext, parts, 3);
+    MD5Final (&mdContext);
+    failures += MDCompare (mdContext.digest, md5Kat[i].hex);
+  }
+  return failures;
+}
+
 // #if 0
 /*
  **********************************************************************
@@ -337,7 +461,8 @@ static long TEST_BYTES = (long)TEST_BLOCK_SIZE * (long)TEST_BLOCKS;
 void MDTimeTrial (void)
 {
   MD5_TEK mdContext;
-  time_t endTime, startTime;
+  clock_t endTime, startTime;
+  double seconds;
   unsigned char data[TEST_BLOCK_SIZE];
   unsigned int i;
 
@@ -347,7 +472,7 @@ void MDTimeTrial (void)
 
   /* start timer */
   printf ("MD5 time trial. Processing %ld characters...\n", TEST_BYTES);
-  time (&startTime);
+  startTime = clock ();
 
   /* digest data in TEST_BLOCK_SIZE byte blocks */
   MD5Init (&mdContext);
@@ -356,14 +481,17 @@ void MDTimeTrial (void)
   MD5Final (&mdContext);
 
   /* stop timer, get time difference */
-  time (&endTime);
+  endTime = clock ();
+  seconds = (double)(endTime - startTime) / CLOCKS_PER_SEC;
+  if (seconds <= 0.0)
+    seconds = 1.0 / CLOCKS_PER_SEC;
   MDPrint (&mdContext);
   printf (" is digest of test input.\n");
   printf
-    ("Seconds to process test input: %ld\n", (long)(endTime-startTime));
+    ("Seconds to process test input: %.3f\n", seconds);
   printf
-    ("Characters processed per second: %ld\n",
-     TEST_BYTES/(endTime-startTime));
+    ("Characters processed per second: %.0f\n",
+     TEST_BYTES / seconds);
 }
 
 /* Computes the message digest for string inString.
@@ -441,13 +569,18 @@ void MDTestSuite (void)
   MDString
     ("1234567890123456789012345678901234567890\
 1234567890123456789012345678901234567890");
+  printf ("Known answer tests: %d failures\n", MD5SelfTest ());
   /* Contents of file foo are "abc" */
   MDFile ("foo");
 }
-#if 0
-void main (argc, argv)
-int argc;
-char *argv[];
+
+/* Host build of the test driver:
+     cc -O2 -DMD5_TEK_MAIN -o md5 md5_tek.c
+     ./md5 -x      known answer tests
+     ./md5 -t      throughput
+ */
+#ifdef MD5_TEK_MAIN
+int main (int argc, char *argv[])
 {
   int i;
 
@@ -469,6 +602,7 @@ char *argv[];
       else if (strcmp (argv[i], "-x") == 0)
         MDTestSuite ();
       else MDFile (argv[i]);
+  return 0;
 }
 #endif
 
@@ -44,8 +44,10 @@ extern "C" {
  **********************************************************************
  */
 
+#include <stdint.h>
+
 /* typedef a 32 bit type */
-typedef unsigned long int UINT4;
+typedef uint32_t UINT4;
 
 /* Data structure for MD5 (Message Digest) computation */
 typedef struct {
@@ -55,9 +57,19 @@ typedef struct {
   unsigned char digest[16];     /* actual digest after MD5Final call */
 } MD5_TEK;
 
+/* One buffer of a list digested by MD5UpdateV */
+typedef struct {
+  const void *data;
+  unsigned int len;
+} MD5_BUF;
+
 void MD5Init   (MD5_TEK *mdContext);
-void MD5Update (MD5_TEK *mdContext, unsigned char *inBuf, unsigned int inLen);
+void MD5Update (MD5_TEK *mdContext, const unsigned char *inBuf,
+                unsigned int inLen);
+void MD5UpdateV(MD5_TEK *mdContext, const MD5_BUF *bufs, unsigned int n);
 void MD5Final  (MD5_TEK *mdContext);
+void MD5Digest (const void *data, unsigned int len, unsigned char *digest);
+int  MD5SelfTest(void);
 
 // previously, these were static, only visible in md5_tek.c
 void MDTimeTrial(void);
@@ -0,0 +1,301 @@
+/**
+ * @file    sha256.c
+ * @brief   SHA-256 code.
+ * @details FIPS 180-4 SHA-256 written for ARMv7E-M:
+ *          - the 64 rounds and the message schedule are fully unrolled,
+ *            the working variables are renamed instead of moved and the
+ *            schedule is kept in a 16 words circular window.
+ *          - the Sigma functions are factored so that every rotation can
+ *            be folded by the compiler into the shifted operand of an
+ *            @p EOR, for example @p S0() is 2 rotations and 2 XORs
+ *            instead of 3 and 2.
+ *          - aligned input is read in place with word loads and @p REV,
+ *            unaligned input goes through a single block copy.
+ *          .
+ *
+ * @{
+ */
+
+#include <string.h>
+
+#include "sha256.h"
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+#define ROR(x, n)       (((x) >> (n)) | ((x) << (32 - (n))))
+
+#define CH(x, y, z)     ((z) ^ ((x) & ((y) ^ (z))))
+#define MAJ(x, y, z)    (((x) & (y)) | ((z) & ((x) | (y))))
+
+/* ROR(x,2) ^ ROR(x,13) ^ ROR(x,22) */
+#define S0(x)           ROR((x) ^ ROR((x), 11) ^ ROR((x), 20), 2)
+/* ROR(x,6) ^ ROR(x,11) ^ ROR(x,25) */
+#define S1(x)           ROR((x) ^ ROR((x), 5) ^ ROR((x), 19), 6)
+/* ROR(x,7) ^ ROR(x,18) ^ (x >> 3) */
+#define s0(x)           (ROR((x) ^ ROR((x), 11), 7) ^ ((x) >> 3))
+/* ROR(x,17) ^ ROR(x,19) ^ (x >> 10) */
+#define s1(x)           (ROR((x) ^ ROR((x), 2), 17) ^ ((x) >> 10))
+
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#define BE32(x)         (x)
+#else
+#define BE32(x)         __builtin_bswap32(x)
+#endif
+
+/* Word view of the byte input, exempt from the strict aliasing rules.*/
+typedef uint32_t __attribute__((may_alias)) word_t;
+
+/* Message schedule window, W(i) for i >= 16 overwrites W(i - 16).*/
+#define W(i)            w[(i) & 15]
+#define LOAD(i)         (W(i) = BE32(words[i]))
+#define SCHED(i)        (W(i) += s1(W((i) + 14)) + W((i) + 9) + s0(W((i) + 1)))
+
+#define RND(a, b, c, d, e, f, g, h, i, x) {                                 \
+  uint32_t t1 = (h) + S1(e) + CH(e, f, g) + k[i] + (x);                     \
+  (d) += t1;                                                                \
+  (h) = t1 + S0(a) + MAJ(a, b, c);                                          \
+}
+
+#define RND8(i, X) {                                                        \
+  RND(a, b, c, d, e, f, g, h, (i) + 0, X((i) + 0));                         \
+  RND(h, a, b, c, d, e, f, g, (i) + 1, X((i) + 1));                         \
+  RND(g, h, a, b, c, d, e, f, (i) + 2, X((i) + 2));                         \
+  RND(f, g, h, a, b, c, d, e, (i) + 3, X((i) + 3));                         \
+  RND(e, f, g, h, a, b, c, d, (i) + 4, X((i) + 4));                         \
+  RND(d, e, f, g, h, a, b, c, (i) + 5, X((i) + 5));                         \
+  RND(c, d, e, f, g, h, a, b, (i) + 6, X((i) + 6));                         \
+  RND(b, c, d, e, f, g, h, a, (i) + 7, X((i) + 7));                         \
+}
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local variables.                                                   */
+/*===========================================================================*/
+
+static const uint32_t k[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+  0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+  0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+  0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+  0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+  0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+  0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+  0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+  0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Digests whole blocks.
+ *
+ * @param[in,out] state intermediate hash value
+ * @param[in] p         pointer to the blocks
+ * @param[in] nblocks   number of blocks
+ */
+static void sha256_blocks(uint32_t *state, const uint8_t *p, size_t nblocks) {
+  uint32_t a, b, c, d, e, f, g, h;
+  uint32_t w[16], tmp[16];
+  const word_t *words;
+
+  while (nblocks--) {
+    if (((uintptr_t)p & 3) == 0)
+      words = (const word_t *)p;
+    else {
+      memcpy(tmp, p, SHA256_BLOCK_SIZE);
+      words = tmp;
+    }
+
+    a = state[0]; b = state[1]; c = state[2]; d = state[3];
+    e = state[4]; f = state[5]; g = state[6]; h = state[7];
+
+    RND8(0, LOAD);
+    RND8(8, LOAD);
+    RND8(16, SCHED);
+    RND8(24, SCHED);
+    RND8(32, SCHED);
+    RND8(40, SCHED);
+    RND8(48, SCHED);
+    RND8(56, SCHED);
+
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    p += SHA256_BLOCK_SIZE;
+  }
+}
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Initializes a SHA-256 context.
+ *
+ * @param[out] ctx      pointer to the context
+ */
+void sha256Init(sha256_ctx_t *ctx) {
+
+  ctx->state[0] = 0x6a09e667;
+  ctx->state[1] = 0xbb67ae85;
+  ctx->state[2] = 0x3c6ef372;
+  ctx->state[3] = 0xa54ff53a;
+  ctx->state[4] = 0x510e527f;
+  ctx->state[5] = 0x9b05688c;
+  ctx->state[6] = 0x1f83d9ab;
+  ctx->state[7] = 0x5be0cd19;
+  ctx->count = 0;
+}
+
+/**
+ * @brief   Digests data.
+ * @details Whole blocks are digested straight from the caller's buffer,
+ *          only the partial head and tail are buffered in the context.
+ *
+ * @param[in,out] ctx   pointer to the context
+ * @param[in] data      pointer to the data
+ * @param[in] n         number of bytes
+ */
+void sha256Update(sha256_ctx_t *ctx, const void *data, size_t n) {
+  const uint8_t *p = data;
+  size_t used = (size_t)(ctx->count & (SHA256_BLOCK_SIZE - 1));
+  size_t nblocks;
+
+  ctx->count += n;
+
+  if (used != 0) {
+    size_t fill = SHA256_BLOCK_SIZE - used;
+
+    if (n < fill) {
+      memcpy(&ctx->buf[used], p, n);
+      return;
+    }
+    memcpy(&ctx->buf[used], p, fill);
+    sha256_blocks(ctx->state, ctx->buf, 1);
+    p += fill;
+    n -= fill;
+  }
+
+  nblocks = n / SHA256_BLOCK_SIZE;
+  if (nblocks > 0) {
+    sha256_blocks(ctx->state, p, nblocks);
+    p += nblocks * SHA256_BLOCK_SIZE;
+    n -= nblocks * SHA256_BLOCK_SIZE;
+  }
+
+  memcpy(ctx->buf, p, n);
+}
+
+/**
+ * @brief   Completes the digest.
+ * @note    The context must be initialized again before reuse.
+ *
+ * @param[in,out] ctx   pointer to the context
+ * @param[out] digest   buffer of @p SHA256_DIGEST_SIZE bytes
+ */
+void sha256Final(sha256_ctx_t *ctx, uint8_t *digest) {
+  size_t used = (size_t)(ctx->count & (SHA256_BLOCK_SIZE - 1));
+  uint64_t bits = ctx->count << 3;
+  unsigned i;
+
+  ctx->buf[used++] = 0x80;
+  if (used > SHA256_BLOCK_SIZE - 8) {
+    memset(&ctx->buf[used], 0, SHA256_BLOCK_SIZE - used);
+    sha256_blocks(ctx->state, ctx->buf, 1);
+    used = 0;
+  }
+  memset(&ctx->buf[used], 0, SHA256_BLOCK_SIZE - 8 - used);
+  for (i = 0; i < 8; i++)
+    ctx->buf[SHA256_BLOCK_SIZE - 1 - i] = (uint8_t)(bits >> (8 * i));
+  sha256_blocks(ctx->state, ctx->buf, 1);
+
+  for (i = 0; i < 8; i++) {
+    digest[4 * i + 0] = (uint8_t)(ctx->state[i] >> 24);
+    digest[4 * i + 1] = (uint8_t)(ctx->state[i] >> 16);
+    digest[4 * i + 2] = (uint8_t)(ctx->state[i] >> 8);
+    digest[4 * i + 3] = (uint8_t)(ctx->state[i]);
+  }
+}
+
+/**
+ * @brief   Digests a buffer in one call.
+ *
+ * @param[in] data      pointer to the data
+ * @param[in] n         number of bytes
+ * @param[out] digest   buffer of @p SHA256_DIGEST_SIZE bytes
+ */
+void sha256Digest(const void *data, size_t n, uint8_t *digest) {
+  sha256_ctx_t ctx;
+
+  sha256Init(&ctx);
+  sha256Update(&ctx, data, n);
+  sha256Final(&ctx, digest);
+}
+
+/**
+ * @brief   Runs the FIPS 180 known answer tests.
+ * @details The two block message is also digested one byte at a time
+ *          and from an unaligned copy.
+ *
+ * @return              The number of failures.
+ */
+int sha256SelfTest(void) {
+  static const char msg2[] =
+    "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+  static const uint8_t kat[3][SHA256_DIGEST_SIZE] = {
+    /* "" */
+    {0xe3, 0xb0, 0xc4, 0x42, 0x98, 0xfc, 0x1c, 0x14,
+     0x9a, 0xfb, 0xf4, 0xc8, 0x99, 0x6f, 0xb9, 0x24,
+     0x27, 0xae, 0x41, 0xe4, 0x64, 0x9b, 0x93, 0x4c,
+     0xa4, 0x95, 0x99, 0x1b, 0x78, 0x52, 0xb8, 0x55},
+    /* "abc" */
+    {0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea,
+     0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+     0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c,
+     0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad},
+    /* msg2 */
+    {0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8,
+     0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+     0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67,
+     0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1}
+  };
+  uint8_t copy[1 + sizeof(msg2)];
+  uint8_t digest[SHA256_DIGEST_SIZE];
+  sha256_ctx_t ctx;
+  int failures = 0;
+  size_t i;
+
+  sha256Digest("", 0, digest);
+  failures += memcmp(digest, kat[0], SHA256_DIGEST_SIZE) != 0;
+  sha256Digest("abc", 3, digest);
+  failures += memcmp(digest, kat[1], SHA256_DIGEST_SIZE) != 0;
+  sha256Digest(msg2, sizeof(msg2) - 1, digest);
+  failures += memcmp(digest, kat[2], SHA256_DIGEST_SIZE) != 0;
+
+  sha256Init(&ctx);
+  for (i = 0; i < sizeof(msg2) - 1; i++)
+    sha256Update(&ctx, &msg2[i], 1);
+  sha256Final(&ctx, digest);
+  failures += memcmp(digest, kat[2], SHA256_DIGEST_SIZE) != 0;
+
+  memcpy(&copy[1], msg2, sizeof(msg2) - 1);
+  sha256Digest(&copy[1], sizeof(msg2) - 1, digest);
+  failures += memcmp(digest, kat[2], SHA256_DIGEST_SIZE) != 0;
+
+  return failures;
+}
+
+/** @} */
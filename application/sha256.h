@@ -0,0 +1,76 @@
+/**
+ * @file    sha256.h
+ * @brief   SHA-256 macros and structures.
+ * @note    No dependency on the RTOS, the module also builds on a host,
+ *          see bsd_sha1/sha2-1.0.1/sha2speed.c.
+ *
+ * @{
+ */
+
+#ifndef _SHA256_H_
+#define _SHA256_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Size of a SHA-256 block in bytes.
+ */
+#define SHA256_BLOCK_SIZE           64
+
+/**
+ * @brief   Size of a SHA-256 digest in bytes.
+ */
+#define SHA256_DIGEST_SIZE          32
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   SHA-256 context.
+ */
+typedef struct {
+  /** @brief Intermediate hash value.*/
+  uint32_t                  state[8];
+  /** @brief Number of bytes digested so far.*/
+  uint64_t                  count;
+  /** @brief Buffered partial block.*/
+  uint8_t                   buf[SHA256_BLOCK_SIZE];
+} sha256_ctx_t;
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void sha256Init(sha256_ctx_t *ctx);
+  void sha256Update(sha256_ctx_t *ctx, const void *data, size_t n);
+  void sha256Final(sha256_ctx_t *ctx, uint8_t *digest);
+  void sha256Digest(const void *data, size_t n, uint8_t *digest);
+  int sha256SelfTest(void);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _SHA256_H_ */
+
+/** @} */
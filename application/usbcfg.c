@@ -28,6 +28,23 @@
 #define USB_BULK_OUT_EP USB_CTRL_EP
 
 #include "bulk_usb.h"
+#include "adc_stream.h"
+
+/* The ADC stream interface is only present when its endpoint exists.*/
+#if HAL_USE_ADC && ADC_STREAM_USE_USB
+#define VCOM_CONFIGURATION_SIZE     (90 + 9 + 7)
+#define VCOM_NUM_INTERFACES         0x04
+#else
+#define VCOM_CONFIGURATION_SIZE     90
+#define VCOM_NUM_INTERFACES         0x03
+#endif
+
+/*
+ * Isochronous IN endpoint descriptor. bmAttributes 0x05 is isochronous,
+ * asynchronous, data endpoint; one packet every 2^(interval-1) frames.
+ */
+#define USB_DESC_ISOC_IN_ENDPOINT(ep, size, interval)                       \
+  USB_DESC_ENDPOINT((ep) | 0x80, 0x05, (size), (interval))
 
 uint_fast8_t USBconfigured=0;
 
@@ -58,10 +75,10 @@ static const USBDescriptor vcom_device_descriptor = {
 };
 
 /* Configuration Descriptor tree for a CDC.*/
-static const uint8_t vcom_configuration_descriptor_data[90] = {
+static const uint8_t vcom_configuration_descriptor_data[VCOM_CONFIGURATION_SIZE] = {
   /* Configuration Descriptor.*/
-  USB_DESC_CONFIGURATION(90,            /* wTotalLength.                    */
-                         0x03,          /* bNumInterfaces.                  */
+  USB_DESC_CONFIGURATION(VCOM_CONFIGURATION_SIZE, /* wTotalLength.          */
+                         VCOM_NUM_INTERFACES,     /* bNumInterfaces.        */
                          0x01,          /* bConfigurationValue.             */
                          0,             /* iConfiguration.                  */
                          0xC0,          /* bmAttributes (self powered).     */
@@ -155,6 +172,29 @@ static const uint8_t vcom_configuration_descriptor_data[90] = {
                          0x02,          /* bmAttributes (Bulk).             */
                          0x0040,        /* wMaxPacketSize.                  */
                          0x00)          /* bInterval.                       */
+#if HAL_USE_ADC && ADC_STREAM_USE_USB
+  ,
+// ADC sample stream, bulk IN only
+  /* Interface Descriptor.*/
+  USB_DESC_INTERFACE    (0x03,          /* bInterfaceNumber.                */
+                         0x00,          /* bAlternateSetting.               */
+                         0x01,          /* bNumEndpoints.                   */
+                         0xff,          /* bInterfaceClass (vendor).        */
+                         0xff,          /* bInterfaceSubClass.              */
+                         0xff,          /* bInterfaceProtocol.              */
+                         0x00),         /* iInterface.                      */
+  /* ADC stream IN Descriptor. (device -> host) */
+#if ADC_STREAM_USB_ISOC
+  USB_DESC_ISOC_IN_ENDPOINT(ADC_STREAM_USB_EP,
+                         ADC_STREAM_USB_PKT_SIZE, /* wMaxPacketSize.        */
+                         0x01)          /* bInterval (every frame).         */
+#else
+  USB_DESC_ENDPOINT     (ADC_STREAM_USB_EP|0x80,  /* bEndpointAddress.*/
+                         0x02,          /* bmAttributes (Bulk).             */
+                         ADC_STREAM_USB_PKT_SIZE, /* wMaxPacketSize.        */
+                         0x00)          /* bInterval.                       */
+#endif
+#endif
 };
 
 /*
@@ -311,6 +351,33 @@ static const USBEndpointConfig ep3config = {
   NULL
 };
 
+#if HAL_USE_ADC && ADC_STREAM_USE_USB
+/**
+ * @brief   IN ADC stream endpoint state. (DEVICE -> HOST)
+ */
+static USBInEndpointState adcepinstate;
+
+/**
+ * @brief   ADC stream endpoint initialization structure (IN only).
+ */
+static const USBEndpointConfig adcepconfig = {
+#if ADC_STREAM_USB_ISOC
+  USB_EP_MODE_TYPE_ISOC,
+#else
+  USB_EP_MODE_TYPE_BULK,
+#endif
+  NULL,
+  adcStreamDataTransmitted,
+  NULL,
+  ADC_STREAM_USB_PKT_SIZE,
+  0x0000,
+  &adcepinstate,
+  NULL,
+  2,
+  NULL
+};
+#endif
+
 /*
  * Handles the USB driver global events.
  */
@@ -331,10 +398,16 @@ static void usb_event(USBDriver *usbp, usbevent_t event) {
     usbInitEndpointI(usbp, USB_CDC_DATA_REQUEST_EP, &ep1config);
     usbInitEndpointI(usbp, USB_CDC_INTERRUPT_REQUEST_EP, &ep2config);
     usbInitEndpointI(usbp, USB_CTRL_EP, &ep3config);
+#if HAL_USE_ADC && ADC_STREAM_USE_USB
+    usbInitEndpointI(usbp, ADC_STREAM_USB_EP, &adcepconfig);
+#endif
 
     /* Resetting the state of the CDC subsystem.*/
     bduConfigureHookI(usbp);
     sduConfigureHookI(usbp);
+#if HAL_USE_ADC && ADC_STREAM_USE_USB
+    adcStreamConfigureHookI(usbp);
+#endif
     chSysUnlockFromIsr();
     USBconfigured=1;
     return;
@@ -367,8 +440,20 @@ const SerialUSBConfig serusbcfg = {
   &USBD1
 };
 
-// Bulk endpoint driver
+// Bulk endpoint driver, the buffers are multiples of the 64 bytes packet
+#define BDU1_IB_SIZE 2560
+#define BDU1_OB_SIZE 2560
+
+static uint8_t bdu1_ib[BDU1_IB_SIZE];
+static uint8_t bdu1_ob[BDU1_OB_SIZE];
+
 const BulkUSBConfig blkusbcfg = {
-  &USBD1
+  &USBD1,
+  USB_BULK_IN_EP,
+  USB_BULK_OUT_EP,
+  bdu1_ib,
+  sizeof(bdu1_ib),
+  bdu1_ob,
+  sizeof(bdu1_ob)
 };
 
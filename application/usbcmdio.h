@@ -79,6 +79,15 @@ typedef struct {  // SSN: silicon serial number
 typedef struct {  // UID: unique ID
   uint8_t  uid_values[6]; // 48-bits
 } payload_uid_t;
+
+typedef struct {  // DIAG: firmware image integrity
+  uint8_t  fw_state;      // 0 = idle, 1 = hashing, 2 = done
+  uint8_t  fw_progress;   // percent of the image hashed
+  uint8_t  fw_passes;     // completed passes, saturates at 255
+  uint8_t  fw_mismatch;   // passes that differed from the first, saturates
+  uint32_t fw_len;        // image length in bytes
+  uint8_t  fw_sha256[32]; // SHA-256 of the image, valid if fw_passes > 0
+} payload_diag_t;
     
 typedef struct {
   uint8_t length;    // Number of bytes in this packet: len + type + cksum(2-bytes) so min = 4 bytes
@@ -90,6 +99,7 @@ typedef struct {
     payload_reg_io_t reg_io;
     payload_ssn_t    ssn_resp;
     payload_uid_t    uid_resp;
+    payload_diag_t   diag_resp;
   } payload;
 } usb_packet_t;
 
@@ -58,6 +58,12 @@ const PALConfig pal_default_config =
 void __early_init(void) {
 
   stm32_clock_init();
+
+  /* Cycle counter started here so that the boot timeline also covers the
+     DATA and BSS initialization, it is not reset by a system reset.*/
+  SCS_DEMCR |= SCS_DEMCR_TRCENA;
+  DWT_CYCCNT = 0;
+  DWT_CTRL  |= DWT_CTRL_CYCCNTENA;
 }
 
 #if HAL_USE_SDC || defined(__DOXYGEN__)
@@ -38,6 +38,10 @@
 #include <sys/time.h>
 
 #include "sha2.h"
+#ifdef SHA2SPEED_TEK
+/* Also benchmark the firmware SHA-256, see application/sha256.c */
+#include "sha256.h"
+#endif
 
 #define BUFSIZE	16384
 
@@ -69,6 +73,13 @@ int main(int argc, char **argv) {
 	struct timeval	start, end;
 	double		t, ave256, ave384, ave512;
 	double		best256, best384, best512;
+#ifdef SHA2SPEED_TEK
+	sha256_ctx_t	ctek;
+	unsigned char	dtek[SHA256_DIGEST_SIZE];
+	char		mdtek[2 * SHA256_DIGEST_SIZE + 1];
+	double		avetek = 0, besttek = 100000;
+	int		k, mismatch = 0;
+#endif
 
 	if (argc > 4) {
 		usage(argv[0]);
@@ -117,6 +128,31 @@ int main(int argc, char **argv) {
 		}
 		printf("SHA-256[%d] (%.4f/%.4f/%.4f seconds) = 0x%s\n", i+1, t, ave256/(i+1), best256, md);
 
+#ifdef SHA2SPEED_TEK
+		sha256Init(&ctek);
+		gettimeofday(&start, (struct timezone*)0);
+		for (j = 0; j < blocks; j++) {
+			sha256Update(&ctek, buf, BUFSIZE);
+		}
+		if (bytes % BUFSIZE) {
+			sha256Update(&ctek, buf, bytes % BUFSIZE);
+		}
+		sha256Final(&ctek, dtek);
+		gettimeofday(&end, (struct timezone*)0);
+		for (k = 0; k < SHA256_DIGEST_SIZE; k++) {
+			sprintf(&mdtek[2 * k], "%02x", dtek[k]);
+		}
+		if (strcmp(mdtek, md) != 0) {
+			mismatch++;
+		}
+		t = ((end.tv_sec - start.tv_sec) * 1000000.0 + (end.tv_usec - start.tv_usec)) / 1000000.0;
+		avetek += t;
+		if (t < besttek) {
+			besttek = t;
+		}
+		printf("SHA-256 TEK[%d] (%.4f/%.4f/%.4f seconds) = 0x%s\n", i+1, t, avetek/(i+1), besttek, mdtek);
+#endif
+
 		gettimeofday(&start, (struct timezone*)0);
 		for (j = 0; j < blocks; j++) {
 			SHA384_Update(&c384, (unsigned char*)buf, BUFSIZE);
@@ -164,11 +200,23 @@ int main(int argc, char **argv) {
 	}
 	printspeed("SHA-256 average:", bytes, ave256);
 	printspeed("SHA-256 best:   ", bytes, best256);
+#ifdef SHA2SPEED_TEK
+	avetek /= rep;
+	printspeed("SHA-256 TEK average:", bytes, avetek);
+	printspeed("SHA-256 TEK best:   ", bytes, besttek);
+	printf("SHA-256 TEK self test: %d failures, %d digest mismatches\n",
+	       sha256SelfTest(), mismatch);
+#endif
 	printspeed("SHA-384 average:", bytes, ave384);
 	printspeed("SHA-384 best:   ", bytes, best384);
 	printspeed("SHA-512 average:", bytes, ave512);
 	printspeed("SHA-512 best:   ", bytes, best512);
 
+#ifdef SHA2SPEED_TEK
+	if (mismatch) {
+		return 2;
+	}
+#endif
 	return 1;
 }
 
@@ -198,7 +198,7 @@ typedef struct {
  *
  * @api
  */
-#define blkDisconnect(ip) ((ip)->vmt-disconnect(ip))
+#define blkDisconnect(ip) ((ip)->vmt->disconnect(ip))
 
 /**
  * @brief   Reads one or more blocks.
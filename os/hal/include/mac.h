@@ -203,6 +203,15 @@ extern "C" {
                                  systime_t time);
   void macReleaseReceiveDescriptor(MACReceiveDescriptor *rdp);
   bool_t macPollLinkStatus(MACDriver *macp);
+#if MAC_USE_ZERO_COPY
+  msg_t macWaitTransmitChain(MACDriver *macp, MACTransmitChain *tcp,
+                             unsigned n, mactxreclaimcb_t cb,
+                             systime_t time);
+  void macAddTransmitSegment(MACTransmitChain *tcp,
+                             const uint8_t *buf, size_t size);
+  void macReleaseTransmitChain(MACTransmitChain *tcp, void *param);
+  void macReclaimTransmitChains(MACDriver *macp, mactxreclaimcb_t cb);
+#endif
 #ifdef __cplusplus
 }
 #endif
@@ -59,6 +59,16 @@
 #if !defined(MMC_NICE_WAITING) || defined(__DOXYGEN__)
 #define MMC_NICE_WAITING            TRUE
 #endif
+
+/**
+ * @brief   Data blocks CRC checking.
+ * @details If enabled the CRC checking is switched on in the card using
+ *          CMD59, the CRC-16 of the data blocks is generated on write and
+ *          verified on read.
+ */
+#if !defined(MMC_USE_CRC) || defined(__DOXYGEN__)
+#define MMC_USE_CRC                 FALSE
+#endif
 /** @} */
 
 /*===========================================================================*/
@@ -84,6 +84,7 @@
 #define MMCSD_CMD_READ_SINGLE_BLOCK     17
 #define MMCSD_CMD_READ_MULTIPLE_BLOCK   18
 #define MMCSD_CMD_SET_BLOCK_COUNT       23
+#define MMCSD_CMD_SET_WR_ERASE_COUNT    23
 #define MMCSD_CMD_WRITE_BLOCK           24
 #define MMCSD_CMD_WRITE_MULTIPLE_BLOCK  25
 #define MMCSD_CMD_ERASE_RW_BLK_START    32
@@ -93,6 +94,7 @@
 #define MMCSD_CMD_LOCK_UNLOCK           42
 #define MMCSD_CMD_APP_CMD               55
 #define MMCSD_CMD_READ_OCR              58
+#define MMCSD_CMD_CRC_ON_OFF            59
 /** @} */
 
 /**
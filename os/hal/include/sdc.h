@@ -96,6 +96,33 @@
 #if !defined(SDC_NICE_WAITING) || defined(__DOXYGEN__)
 #define SDC_NICE_WAITING                TRUE
 #endif
+
+/**
+ * @brief   Enables the asynchronous jobs API.
+ * @details Read and write jobs are queued to a driver thread and served
+ *          back to back, the caller is notified by callback or by waiting
+ *          on the job.
+ */
+#if !defined(SDC_USE_ASYNC) || defined(__DOXYGEN__)
+#define SDC_USE_ASYNC                   FALSE
+#endif
+
+/**
+ * @brief   Stack size of the jobs thread.
+ */
+#if !defined(SDC_ASYNC_THREAD_STACK_SIZE) || defined(__DOXYGEN__)
+#define SDC_ASYNC_THREAD_STACK_SIZE     256
+#endif
+
+/**
+ * @brief   Priority of the jobs thread.
+ * @note    It should be above the priority of the threads queuing jobs
+ *          so that the next job is started as soon as the previous one
+ *          completes.
+ */
+#if !defined(SDC_ASYNC_THREAD_PRIORITY) || defined(__DOXYGEN__)
+#define SDC_ASYNC_THREAD_PRIORITY       (NORMALPRIO + 1)
+#endif
 /** @} */
 
 /*===========================================================================*/
@@ -106,8 +133,56 @@
 /* Driver data structures and types.                                         */
 /*===========================================================================*/
 
+#if SDC_USE_ASYNC || defined(__DOXYGEN__)
+/**
+ * @brief   Type of an asynchronous read or write job.
+ */
+typedef struct sdc_job sdc_job_t;
+#endif
+
 #include "sdc_lld.h"
 
+#if SDC_USE_ASYNC || defined(__DOXYGEN__)
+/**
+ * @brief   Job completion callback type.
+ * @note    The callback is invoked by the jobs thread from within a locked
+ *          zone, only I-class functions can be used. A new job can be
+ *          queued using @p sdcStartReadI() or @p sdcStartWriteI().
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ * @param[in] jp        pointer to the completed job
+ */
+typedef void (*sdccallback_t)(SDCDriver *sdcp, sdc_job_t *jp);
+
+/**
+ * @brief   Asynchronous job structure.
+ * @details The job is owned by the driver from its start to its
+ *          completion, the caller provides the storage.
+ */
+struct sdc_job {
+  /** @brief Next job in the queue.*/
+  sdc_job_t                 *next;
+  /** @brief First block to transfer.*/
+  uint32_t                  startblk;
+  /** @brief Data buffer.*/
+  uint8_t                   *buf;
+  /** @brief Number of blocks to transfer.*/
+  uint32_t                  n;
+  /** @brief @p TRUE for write jobs.*/
+  bool_t                    write;
+  /** @brief Completion callback or @p NULL.*/
+  sdccallback_t             cb;
+  /** @brief Callback parameter.*/
+  void                      *param;
+  /** @brief Thread waiting for the job or @p NULL.*/
+  Thread                    *thread;
+  /** @brief Operation status, meaningful after completion.*/
+  bool_t                    result;
+  /** @brief Job completed flag.*/
+  volatile bool_t           done;
+};
+#endif /* SDC_USE_ASYNC */
+
 /*===========================================================================*/
 /* Driver macros.                                                            */
 /*===========================================================================*/
@@ -149,6 +224,17 @@
 #define sdcIsWriteProtected(sdcp) (sdc_lld_is_write_protected(sdcp))
 /** @} */
 
+#if SDC_USE_ASYNC || defined(__DOXYGEN__)
+/**
+ * @brief   Returns @p TRUE if the job has completed.
+ *
+ * @param[in] jp        pointer to a @p sdc_job_t structure
+ *
+ * @iclass
+ */
+#define sdcJobIsDoneI(jp) ((jp)->done)
+#endif
+
 /*===========================================================================*/
 /* External declarations.                                                    */
 /*===========================================================================*/
@@ -171,6 +257,21 @@ extern "C" {
   bool_t sdcGetInfo(SDCDriver *sdcp, BlockDeviceInfo *bdip);
   bool_t sdcErase(SDCDriver *mmcp, uint32_t startblk, uint32_t endblk);
   bool_t _sdc_wait_for_transfer_state(SDCDriver *sdcp);
+#if SDC_USE_ASYNC
+  void sdcStartReadI(SDCDriver *sdcp, sdc_job_t *jp, uint32_t startblk,
+                     uint8_t *buf, uint32_t n,
+                     sdccallback_t cb, void *param);
+  void sdcStartRead(SDCDriver *sdcp, sdc_job_t *jp, uint32_t startblk,
+                    uint8_t *buf, uint32_t n,
+                    sdccallback_t cb, void *param);
+  void sdcStartWriteI(SDCDriver *sdcp, sdc_job_t *jp, uint32_t startblk,
+                      const uint8_t *buf, uint32_t n,
+                      sdccallback_t cb, void *param);
+  void sdcStartWrite(SDCDriver *sdcp, sdc_job_t *jp, uint32_t startblk,
+                     const uint8_t *buf, uint32_t n,
+                     sdccallback_t cb, void *param);
+  bool_t sdcWaitJob(sdc_job_t *jp);
+#endif
 #ifdef __cplusplus
 }
 #endif
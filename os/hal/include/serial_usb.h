@@ -53,6 +53,25 @@
 #if !defined(SERIAL_USB_BUFFERS_SIZE) || defined(__DOXYGEN__)
 #define SERIAL_USB_BUFFERS_SIZE     1024
 #endif
+
+/**
+ * @brief   Transmit coalescing mode.
+ * @details If enabled, data shorter than a packet is held in the output
+ *          queue until a full packet is available, @p sduFlush() is called
+ *          or @p SERIAL_USB_TX_FLUSH_US microseconds elapse. This reduces the
+ *          number of short packets when replies are written in pieces.
+ */
+#if !defined(SERIAL_USB_TX_COALESCE) || defined(__DOXYGEN__)
+#define SERIAL_USB_TX_COALESCE      FALSE
+#endif
+
+/**
+ * @brief   Short packet flush delay in microseconds.
+ * @note    The delay is rounded up to the next system tick.
+ */
+#if !defined(SERIAL_USB_TX_FLUSH_US) || defined(__DOXYGEN__)
+#define SERIAL_USB_TX_FLUSH_US      1000
+#endif
 /** @} */
 
 /*===========================================================================*/
@@ -111,7 +130,9 @@ typedef struct {
   uint8_t                   ob[SERIAL_USB_BUFFERS_SIZE];                    \
   /* End of the mandatory fields.*/                                         \
   /* Current configuration data.*/                                          \
-  const SerialUSBConfig     *config;
+  const SerialUSBConfig     *config;                                        \
+  /* Short packet flush timer, used in coalescing mode.*/                   \
+  VirtualTimer              txvt;
 
 /**
  * @brief   @p SerialUSBDriver specific methods.
@@ -156,6 +177,10 @@ extern "C" {
   void sduObjectInit(SerialUSBDriver *sdp);
   void sduStart(SerialUSBDriver *sdup, const SerialUSBConfig *config);
   void sduStop(SerialUSBDriver *sdup);
+#if SERIAL_USB_TX_COALESCE
+  void sduFlushI(SerialUSBDriver *sdup);
+  void sduFlush(SerialUSBDriver *sdup);
+#endif
   void sduConfigureHookI(USBDriver *usbp);
   bool_t sduRequestsHook(USBDriver *usbp);
   void sduDataTransmitted(USBDriver *usbp, usbep_t ep);
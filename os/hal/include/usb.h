@@ -348,6 +348,33 @@ typedef const USBDescriptor * (*usbgetdescriptor_t)(USBDriver *usbp,
  */
 #define usbGetDriverStateI(usbp) ((usbp)->state)
 
+/**
+ * @brief   Associates an upper layer object to an endpoint.
+ * @details The endpoint callbacks can retrieve the object using
+ *          @p usbGetEndpointParamX(), this allows several drivers of the
+ *          same class to share a single @p USBDriver.
+ * @note    IN and OUT directions of the same endpoint number share the
+ *          same field.
+ *
+ * @param[in] usbp      pointer to the @p USBDriver object
+ * @param[in] ep        endpoint number
+ * @param[in] p         pointer to the object
+ *
+ * @iclass
+ */
+#define usbSetEndpointParamI(usbp, ep, p) ((usbp)->epparam[ep] = (p))
+
+/**
+ * @brief   Returns the object associated to an endpoint.
+ *
+ * @param[in] usbp      pointer to the @p USBDriver object
+ * @param[in] ep        endpoint number
+ * @return              The object pointer or @p NULL if none.
+ *
+ * @special
+ */
+#define usbGetEndpointParamX(usbp, ep) ((usbp)->epparam[ep])
+
 /**
  * @brief   Fetches a 16 bits word value from an USB message.
  *
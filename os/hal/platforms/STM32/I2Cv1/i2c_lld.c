@@ -114,6 +114,20 @@ I2CDriver I2CD3;
  *
  * @notapi
  */
+#if STM32_I2C_USE_JOB_QUEUE
+#define wakeup_isr(i2cp, msg) {                                             \
+  chSysLockFromIsr();                                                       \
+  if ((i2cp)->job != NULL)                                                  \
+    i2c_lld_job_end_i(i2cp, msg);                                           \
+  else if ((i2cp)->thread != NULL) {                                        \
+    Thread *tp = (i2cp)->thread;                                            \
+    (i2cp)->thread = NULL;                                                  \
+    tp->p_u.rdymsg = (msg);                                                 \
+    chSchReadyI(tp);                                                        \
+  }                                                                         \
+  chSysUnlockFromIsr();                                                     \
+}
+#else /* !STM32_I2C_USE_JOB_QUEUE */
 #define wakeup_isr(i2cp, msg) {                                             \
   chSysLockFromIsr();                                                       \
   if ((i2cp)->thread != NULL) {                                             \
@@ -124,6 +138,7 @@ I2CDriver I2CD3;
   }                                                                         \
   chSysUnlockFromIsr();                                                     \
 }
+#endif /* !STM32_I2C_USE_JOB_QUEUE */
 
 /**
  * @brief   Aborts an I2C transaction.
@@ -167,6 +182,179 @@ static void i2c_lld_safety_timeout(void *p) {
   chSysUnlockFromIsr();
 }
 
+#if STM32_I2C_USE_JOB_QUEUE || defined(__DOXYGEN__)
+/**
+ * @brief   Notifies the completion of a job.
+ *
+ * @param[in] i2cp      pointer to the @p I2CDriver object
+ * @param[in] jp        pointer to the @p I2CJob object
+ * @param[in] msg       job result
+ *
+ * @notapi
+ */
+static void i2c_lld_job_notify_i(I2CDriver *i2cp, I2CJob *jp, msg_t msg) {
+
+  jp->status = msg;
+  if (jp->end_cb != NULL)
+    jp->end_cb(i2cp, jp);
+  if (jp->thread != NULL) {
+    Thread *tp = jp->thread;
+    jp->thread = NULL;
+    tp->p_u.rdymsg = msg;
+    chSchReadyI(tp);
+  }
+}
+
+/**
+ * @brief   Fails all the jobs still waiting in the queue.
+ *
+ * @param[in] i2cp      pointer to the @p I2CDriver object
+ * @param[in] msg       result of the flushed jobs
+ *
+ * @notapi
+ */
+static void i2c_lld_job_flush_i(I2CDriver *i2cp, msg_t msg) {
+  I2CJob *jp;
+
+  while ((jp = i2cp->jqhead) != NULL) {
+    i2cp->jqhead = jp->next;
+    jp->errors = I2CD_JOB_ABORTED;
+    i2c_lld_job_notify_i(i2cp, jp, msg);
+  }
+  i2cp->jqtail = NULL;
+}
+
+/**
+ * @brief   Handling of stalled I2C jobs.
+ *
+ * @param[in] p         pointer to the @p I2CDriver object
+ *
+ * @notapi
+ */
+static void i2c_lld_job_timeout(void *p) {
+  I2CDriver *i2cp = (I2CDriver *)p;
+  I2CJob *jp;
+
+  chSysLockFromIsr();
+  if ((jp = i2cp->job) != NULL) {
+    i2c_lld_abort_operation(i2cp);
+    i2cp->job = NULL;
+    jp->errors = I2CD_NO_ERROR;
+    i2c_lld_job_notify_i(i2cp, jp, RDY_TIMEOUT);
+
+    /* After a timeout the bus is in an uncertain state, the driver must be
+       restarted as for the synchronous API.*/
+    i2c_lld_job_flush_i(i2cp, RDY_RESET);
+    i2cp->state = I2C_LOCKED;
+  }
+  chSysUnlockFromIsr();
+}
+
+static void i2c_lld_job_start_next_i(I2CDriver *i2cp);
+
+/**
+ * @brief   Bus idle check retry.
+ *
+ * @param[in] p         pointer to the @p I2CDriver object
+ *
+ * @notapi
+ */
+static void i2c_lld_job_retry(void *p) {
+  I2CDriver *i2cp = (I2CDriver *)p;
+
+  chSysLockFromIsr();
+  i2c_lld_job_start_next_i(i2cp);
+  chSysUnlockFromIsr();
+}
+
+/**
+ * @brief   Starts the next queued job, if any.
+ * @details The function is invoked from the interrupt handlers, the STOP
+ *          condition of the previous job has just been requested so the
+ *          bus is usually idle within a single SCL period. If it is not
+ *          the check is repeated on the next system tick, see
+ *          @p STM32_I2C_JOB_IDLE_RETRIES.
+ *
+ * @param[in] i2cp      pointer to the @p I2CDriver object
+ *
+ * @notapi
+ */
+static void i2c_lld_job_start_next_i(I2CDriver *i2cp) {
+  I2C_TypeDef *dp = i2cp->i2c;
+  I2CJob *jp;
+
+  /* A bus idle check is already scheduled.*/
+  if (chVTIsArmedI(&i2cp->jobvt))
+    return;
+
+  while ((jp = i2cp->jqhead) != NULL) {
+    bool_t busy = (dp->SR2 & I2C_SR2_BUSY) || (dp->CR1 & I2C_CR1_STOP);
+
+    if (busy && (i2cp->jobretries > 0)) {
+      i2cp->jobretries--;
+      chVTSetI(&i2cp->jobvt, 1, i2c_lld_job_retry, (void *)i2cp);
+      return;
+    }
+
+    i2cp->jqhead = jp->next;
+    if (i2cp->jqhead == NULL)
+      i2cp->jqtail = NULL;
+    i2cp->jobretries = STM32_I2C_JOB_IDLE_RETRIES;
+
+    if (busy) {
+      jp->errors = I2CD_BUS_ERROR;
+      i2c_lld_job_notify_i(i2cp, jp, RDY_RESET);
+      continue;
+    }
+
+    i2cp->job    = jp;
+    i2cp->errors = I2CD_NO_ERROR;
+    if (jp->timeout != TIME_INFINITE)
+      chVTSetI(&i2cp->jobvt, jp->timeout, i2c_lld_job_timeout, (void *)i2cp);
+
+    /* DMA setup, a zero sized RX stream means transmit only.*/
+    dmaStreamSetMemory0(i2cp->dmatx, jp->txbuf);
+    dmaStreamSetTransactionSize(i2cp->dmatx, jp->txbytes);
+    dmaStreamSetMemory0(i2cp->dmarx, jp->rxbuf);
+    dmaStreamSetTransactionSize(i2cp->dmarx, jp->rxbytes);
+
+    /* Starts the operation, LSB = 1 -> receive.*/
+    dp->CR2 |= I2C_CR2_ITEVTEN;
+    if (jp->txbytes > 0) {
+      i2cp->state = I2C_ACTIVE_TX;
+      i2cp->addr  = jp->addr << 1;
+      dp->CR1 |= I2C_CR1_START;
+    }
+    else {
+      i2cp->state = I2C_ACTIVE_RX;
+      i2cp->addr  = (jp->addr << 1) | 0x01;
+      dp->CR1 |= I2C_CR1_START | I2C_CR1_ACK;
+    }
+    return;
+  }
+  i2cp->state = I2C_READY;
+}
+
+/**
+ * @brief   Completes the job on the bus and chains the next one.
+ *
+ * @param[in] i2cp      pointer to the @p I2CDriver object
+ * @param[in] msg       job result
+ *
+ * @notapi
+ */
+static void i2c_lld_job_end_i(I2CDriver *i2cp, msg_t msg) {
+  I2CJob *jp = i2cp->job;
+
+  if (chVTIsArmedI(&i2cp->jobvt))
+    chVTResetI(&i2cp->jobvt);
+  i2cp->job  = NULL;
+  jp->errors = i2cp->errors;
+  i2c_lld_job_notify_i(i2cp, jp, msg);
+  i2c_lld_job_start_next_i(i2cp);
+}
+#endif /* STM32_I2C_USE_JOB_QUEUE */
+
 /**
  * @brief   Set clock speed.
  *
@@ -546,6 +734,13 @@ void i2c_lld_init(void) {
   I2CD1.i2c    = I2C1;
   I2CD1.dmarx  = STM32_DMA_STREAM(STM32_I2C_I2C1_RX_DMA_STREAM);
   I2CD1.dmatx  = STM32_DMA_STREAM(STM32_I2C_I2C1_TX_DMA_STREAM);
+#if STM32_I2C_USE_JOB_QUEUE
+  I2CD1.job    = NULL;
+  I2CD1.jqhead = NULL;
+  I2CD1.jqtail = NULL;
+  I2CD1.jobvt.vt_func = NULL;
+  I2CD1.jobretries = STM32_I2C_JOB_IDLE_RETRIES;
+#endif
 #endif /* STM32_I2C_USE_I2C1 */
 
 #if STM32_I2C_USE_I2C2
@@ -554,6 +749,13 @@ void i2c_lld_init(void) {
   I2CD2.i2c    = I2C2;
   I2CD2.dmarx  = STM32_DMA_STREAM(STM32_I2C_I2C2_RX_DMA_STREAM);
   I2CD2.dmatx  = STM32_DMA_STREAM(STM32_I2C_I2C2_TX_DMA_STREAM);
+#if STM32_I2C_USE_JOB_QUEUE
+  I2CD2.job    = NULL;
+  I2CD2.jqhead = NULL;
+  I2CD2.jqtail = NULL;
+  I2CD2.jobvt.vt_func = NULL;
+  I2CD2.jobretries = STM32_I2C_JOB_IDLE_RETRIES;
+#endif
 #endif /* STM32_I2C_USE_I2C2 */
 
 #if STM32_I2C_USE_I2C3
@@ -562,6 +764,13 @@ void i2c_lld_init(void) {
   I2CD3.i2c    = I2C3;
   I2CD3.dmarx  = STM32_DMA_STREAM(STM32_I2C_I2C3_RX_DMA_STREAM);
   I2CD3.dmatx  = STM32_DMA_STREAM(STM32_I2C_I2C3_TX_DMA_STREAM);
+#if STM32_I2C_USE_JOB_QUEUE
+  I2CD3.job    = NULL;
+  I2CD3.jqhead = NULL;
+  I2CD3.jqtail = NULL;
+  I2CD3.jobvt.vt_func = NULL;
+  I2CD3.jobretries = STM32_I2C_JOB_IDLE_RETRIES;
+#endif
 #endif /* STM32_I2C_USE_I2C3 */
 }
 
@@ -696,6 +905,21 @@ void i2c_lld_stop(I2CDriver *i2cp) {
 
     /* I2C disable.*/
     i2c_lld_abort_operation(i2cp);
+#if STM32_I2C_USE_JOB_QUEUE
+    /* Pending jobs are failed, the threads waiting for them are
+       rescheduled by i2cStop().*/
+    if (chVTIsArmedI(&i2cp->jobvt))
+      chVTResetI(&i2cp->jobvt);
+    if (i2cp->job != NULL) {
+      I2CJob *jp = i2cp->job;
+
+      i2cp->job  = NULL;
+      jp->errors = I2CD_JOB_ABORTED;
+      i2c_lld_job_notify_i(i2cp, jp, RDY_RESET);
+    }
+    i2c_lld_job_flush_i(i2cp, RDY_RESET);
+    i2cp->jobretries = STM32_I2C_JOB_IDLE_RETRIES;
+#endif
     dmaStreamRelease(i2cp->dmatx);
     dmaStreamRelease(i2cp->dmarx);
 
@@ -889,6 +1113,98 @@ msg_t i2c_lld_master_transmit_timeout(I2CDriver *i2cp, i2caddr_t addr,
   return chThdSelf()->p_u.rdymsg;
 }
 
+#if STM32_I2C_USE_JOB_QUEUE || defined(__DOXYGEN__)
+/**
+ * @brief   Queues an I2C job.
+ * @details The job is started immediately if the bus is idle else it is
+ *          appended to the queue, queued jobs are started back to back from
+ *          the interrupt handlers without threads involvement.
+ * @note    The synchronous APIs must not be used while jobs are pending on
+ *          the same driver.
+ *
+ * @param[in] i2cp      pointer to the @p I2CDriver object
+ * @param[in] jp        pointer to the @p I2CJob object
+ *
+ * @iclass
+ */
+void i2cQueueJobI(I2CDriver *i2cp, I2CJob *jp) {
+
+  chDbgCheckClassI();
+
+  jp->next   = NULL;
+  jp->errors = I2CD_NO_ERROR;
+  if (i2cp->jqtail != NULL)
+    i2cp->jqtail->next = jp;
+  else
+    i2cp->jqhead = jp;
+  i2cp->jqtail = jp;
+
+  if (i2cp->state == I2C_READY)
+    i2c_lld_job_start_next_i(i2cp);
+}
+
+/**
+ * @brief   Queues an I2C job.
+ * @details The job is started immediately if the bus is idle else it is
+ *          appended to the queue.
+ *
+ * @param[in] i2cp      pointer to the @p I2CDriver object
+ * @param[in] jp        pointer to the @p I2CJob object
+ *
+ * @api
+ */
+void i2cQueueJob(I2CDriver *i2cp, I2CJob *jp) {
+
+  chDbgCheck((i2cp != NULL) && (jp != NULL) && (jp->addr != 0) &&
+             ((jp->txbytes > 0) || (jp->rxbytes > 0)) &&
+             ((jp->txbytes == 0) || (jp->txbuf != NULL)) &&
+             ((jp->rxbytes == 0) || (jp->rxbuf != NULL)) &&
+             (jp->timeout != TIME_IMMEDIATE),
+             "i2cQueueJob");
+
+  chSysLock();
+  chDbgAssert((i2cp->state == I2C_READY) || (i2cp->state == I2C_ACTIVE_TX) ||
+              (i2cp->state == I2C_ACTIVE_RX),
+              "i2cQueueJob(), #1", "invalid state");
+  jp->thread = NULL;
+  i2cQueueJobI(i2cp, jp);
+  chSysUnlock();
+}
+
+/**
+ * @brief   Queues an I2C job and waits for its completion.
+ *
+ * @param[in] i2cp      pointer to the @p I2CDriver object
+ * @param[in] jp        pointer to the @p I2CJob object
+ * @return              The job result.
+ * @retval RDY_OK       if the job succeeded.
+ * @retval RDY_RESET    if one or more I2C errors occurred, the errors are
+ *                      available in the job @p errors field.
+ * @retval RDY_TIMEOUT  if the job timed out, the driver must be stopped and
+ *                      restarted.
+ *
+ * @api
+ */
+msg_t i2cExecuteJob(I2CDriver *i2cp, I2CJob *jp) {
+  msg_t msg;
+
+  chDbgCheck((i2cp != NULL) && (jp != NULL), "i2cExecuteJob");
+
+  chSysLock();
+  chDbgAssert((i2cp->state == I2C_READY) || (i2cp->state == I2C_ACTIVE_TX) ||
+              (i2cp->state == I2C_ACTIVE_RX),
+              "i2cExecuteJob(), #1", "invalid state");
+  jp->thread = chThdSelf();
+  i2cQueueJobI(i2cp, jp);
+  /* The job could have been completed already if it failed to start.*/
+  if (jp->thread != NULL)
+    chSchGoSleepS(THD_STATE_SUSPENDED);
+  msg = jp->status;
+  chSysUnlock();
+  return msg;
+}
+#endif /* STM32_I2C_USE_JOB_QUEUE */
+
 #endif /* HAL_USE_I2C */
 
 /** @} */
@@ -44,6 +44,12 @@
  */
 #define I2C_CLK_FREQ  ((STM32_PCLK1) / 1000000)
 
+/**
+ * @brief   Queued job error, the job was aborted by @p i2cStop() or by
+ *          the timeout of a previous job.
+ */
+#define I2CD_JOB_ABORTED            0x80
+
 /*===========================================================================*/
 /* Driver pre-compile time settings.                                         */
 /*===========================================================================*/
@@ -139,6 +145,28 @@
 #define STM32_I2C_DMA_ERROR_HOOK(i2cp)  chSysHalt()
 #endif
 
+/**
+ * @brief   Asynchronous jobs queue enable switch.
+ * @details If set to @p TRUE the @p i2cQueueJob() API is included, queued
+ *          jobs are chained back to back from the interrupt handlers.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(STM32_I2C_USE_JOB_QUEUE) || defined(__DOXYGEN__)
+#define STM32_I2C_USE_JOB_QUEUE         FALSE
+#endif
+
+/**
+ * @brief   Number of bus idle checks before a queued job fails.
+ * @details A job is started only on an idle bus. While the STOP condition
+ *          of the previous job is still in progress, or the bus is held by
+ *          another device, the check is repeated on the next system tick
+ *          instead of waiting in the interrupt handler. After this number
+ *          of retries the job fails with @p I2CD_BUS_ERROR.
+ */
+#if !defined(STM32_I2C_JOB_IDLE_RETRIES) || defined(__DOXYGEN__)
+#define STM32_I2C_JOB_IDLE_RETRIES      3
+#endif
+
 #if STM32_ADVANCED_DMA || defined(__DOXYGEN__)
 
 /**
@@ -352,6 +380,76 @@ typedef struct {
  */
 typedef struct I2CDriver I2CDriver;
 
+#if STM32_I2C_USE_JOB_QUEUE || defined(__DOXYGEN__)
+/**
+ * @brief   Type of an I2C job.
+ */
+typedef struct I2CJob I2CJob;
+
+/**
+ * @brief   I2C job completion callback type.
+ * @note    The callback is invoked from ISR context inside a system locked
+ *          zone so I-class functions can be invoked from it.
+ *
+ * @param[in] i2cp      pointer to the @p I2CDriver object
+ * @param[in] jp        pointer to the completed @p I2CJob object
+ */
+typedef void (*i2cjobcallback_t)(I2CDriver *i2cp, I2CJob *jp);
+
+/**
+ * @brief   Structure representing an I2C job.
+ * @details A job is a transmission, a reception or a "read after write"
+ *          transaction, the structure is owned by the driver from the
+ *          moment it is queued until its callback has been invoked.
+ */
+struct I2CJob {
+  /**
+   * @brief   Next job in the queue.
+   */
+  I2CJob                    *next;
+  /**
+   * @brief   Slave device address (7 bits) without R/W bit.
+   */
+  i2caddr_t                 addr;
+  /**
+   * @brief   Transmit buffer or @p NULL.
+   */
+  const uint8_t             *txbuf;
+  /**
+   * @brief   Number of bytes to be transmitted, zero for receive only.
+   */
+  size_t                    txbytes;
+  /**
+   * @brief   Receive buffer or @p NULL.
+   */
+  uint8_t                   *rxbuf;
+  /**
+   * @brief   Number of bytes to be received, zero for transmit only.
+   */
+  size_t                    rxbytes;
+  /**
+   * @brief   Job timeout or @p TIME_INFINITE.
+   */
+  systime_t                 timeout;
+  /**
+   * @brief   Completion callback or @p NULL.
+   */
+  i2cjobcallback_t          end_cb;
+  /**
+   * @brief   Thread waiting for the job completion.
+   */
+  Thread                    *thread;
+  /**
+   * @brief   Job result, @p RDY_OK, @p RDY_RESET or @p RDY_TIMEOUT.
+   */
+  msg_t                     status;
+  /**
+   * @brief   Errors mask of the job.
+   */
+  i2cflags_t                errors;
+};
+#endif /* STM32_I2C_USE_JOB_QUEUE */
+
 /**
  * @brief Structure representing an I2C driver.
  */
@@ -406,6 +504,29 @@ struct I2CDriver{
    * @brief     Pointer to the I2Cx registers block.
    */
   I2C_TypeDef               *i2c;
+#if STM32_I2C_USE_JOB_QUEUE || defined(__DOXYGEN__)
+  /**
+   * @brief     Job currently on the bus or @p NULL.
+   */
+  I2CJob                    *job;
+  /**
+   * @brief     First job waiting in the queue.
+   */
+  I2CJob                    *jqhead;
+  /**
+   * @brief     Last job waiting in the queue.
+   */
+  I2CJob                    *jqtail;
+  /**
+   * @brief     Timer of the job currently on the bus or of the next bus
+   *            idle check.
+   */
+  VirtualTimer              jobvt;
+  /**
+   * @brief     Bus idle checks left to the first job in the queue.
+   */
+  unsigned                  jobretries;
+#endif
 };
 
 /*===========================================================================*/
@@ -452,6 +573,11 @@ extern "C" {
   msg_t i2c_lld_master_receive_timeout(I2CDriver *i2cp, i2caddr_t addr,
                                        uint8_t *rxbuf, size_t rxbytes,
                                        systime_t timeout);
+#if STM32_I2C_USE_JOB_QUEUE
+  void i2cQueueJobI(I2CDriver *i2cp, I2CJob *jp);
+  void i2cQueueJob(I2CDriver *i2cp, I2CJob *jp);
+  msg_t i2cExecuteJob(I2CDriver *i2cp, I2CJob *jp);
+#endif
 #ifdef __cplusplus
 }
 #endif
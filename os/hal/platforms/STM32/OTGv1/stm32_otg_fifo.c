@@ -0,0 +1,370 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    STM32/OTGv1/stm32_otg_fifo.c
+ * @brief   STM32 OTG FIFO transfer helpers code.
+ * @details Moves packets between the OTG FIFOs and linear buffers or
+ *          circular queues. The FIFO register is only accessed through
+ *          @p OTG_FIFO_PUSH() and @p OTG_FIFO_POP(), the host register
+ *          model in test/host overrides them.
+ *
+ * @addtogroup USB
+ * @{
+ */
+
+#include "ch.h"
+#include "hal.h"
+#include "stm32_otg_fifo.h"
+
+#if HAL_USE_USB || defined(__DOXYGEN__)
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local variables.                                                   */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Pushes a series of words into a FIFO.
+ * @details Word aligned buffers are streamed four words at time so that
+ *          the loads are combined into multiple load instructions.
+ *
+ * @param[in] fifop     pointer to the FIFO register
+ * @param[in] buf       pointer to the words buffer, not necessarily word
+ *                      aligned
+ * @param[in] n         number of words to push
+ *
+ * @return              A pointer after the last word pushed.
+ *
+ * @notapi
+ */
+static uint8_t *otg_do_push(volatile uint32_t *fifop, uint8_t *buf, size_t n) {
+
+  if (((uint32_t)buf & 3) == 0) {
+    uint32_t *wp = (uint32_t *)buf;
+
+    while (n >= 4) {
+      uint32_t w0 = wp[0], w1 = wp[1], w2 = wp[2], w3 = wp[3];
+
+      OTG_FIFO_PUSH(fifop, w0);
+      OTG_FIFO_PUSH(fifop, w1);
+      OTG_FIFO_PUSH(fifop, w2);
+      OTG_FIFO_PUSH(fifop, w3);
+      wp += 4;
+      n -= 4;
+    }
+    while (n > 0) {
+      OTG_FIFO_PUSH(fifop, *wp++);
+      n--;
+    }
+    return (uint8_t *)wp;
+  }
+
+  while (n > 0) {
+    /* Note, this line relies on the Cortex-M3/M4 ability to perform
+       unaligned word accesses and on the LSB-first memory organization.*/
+    OTG_FIFO_PUSH(fifop, *((uint32_t *)buf));
+    buf += 4;
+    n--;
+  }
+  return buf;
+}
+
+/**
+ * @brief   Gathers up to four bytes from a queue into a word.
+ * @details Used for the word lying across the circular buffer boundary
+ *          and for the trailing bytes of a transfer.
+ *
+ * @param[in] qp        pointer to a @p GenericQueue object
+ * @param[in] n         number of bytes, from 1 to 4
+ * @return              The bytes packed LSB-first.
+ *
+ * @notapi
+ */
+static uint32_t otg_queue_gather(GenericQueue *qp, size_t n) {
+  uint32_t w = 0;
+  unsigned i;
+
+  for (i = 0; i < n; i++) {
+    w |= (uint32_t)*qp->q_rdptr++ << (i * 8);
+    if (qp->q_rdptr >= qp->q_top)
+      qp->q_rdptr = qp->q_buffer;
+  }
+  return w;
+}
+
+/**
+ * @brief   Scatters up to four bytes of a word into a queue.
+ *
+ * @param[in] qp        pointer to a @p GenericQueue object
+ * @param[in] w         the bytes packed LSB-first
+ * @param[in] n         number of bytes, from 1 to 4
+ *
+ * @notapi
+ */
+static void otg_queue_scatter(GenericQueue *qp, uint32_t w, size_t n) {
+  unsigned i;
+
+  for (i = 0; i < n; i++) {
+    *qp->q_wrptr++ = (uint8_t)(w >> (i * 8));
+    if (qp->q_wrptr >= qp->q_top)
+      qp->q_wrptr = qp->q_buffer;
+  }
+}
+
+/**
+ * @brief   Pops a series of words from a FIFO.
+ * @details Word aligned buffers are streamed four words at time so that
+ *          the stores are combined into multiple store instructions.
+ *
+ * @param[in] fifop     pointer to the FIFO register
+ * @param[in] buf       pointer to the words buffer, not necessarily word
+ *                      aligned
+ * @param[in] n         number of words to push
+ *
+ * @return              A pointer after the last word pushed.
+ *
+ * @notapi
+ */
+static uint8_t *otg_do_pop(volatile uint32_t *fifop, uint8_t *buf, size_t n) {
+
+  if (((uint32_t)buf & 3) == 0) {
+    uint32_t *wp = (uint32_t *)buf;
+
+    while (n >= 4) {
+      uint32_t w0 = OTG_FIFO_POP(fifop);
+      uint32_t w1 = OTG_FIFO_POP(fifop);
+      uint32_t w2 = OTG_FIFO_POP(fifop);
+      uint32_t w3 = OTG_FIFO_POP(fifop);
+
+      wp[0] = w0;
+      wp[1] = w1;
+      wp[2] = w2;
+      wp[3] = w3;
+      wp += 4;
+      n -= 4;
+    }
+    while (n > 0) {
+      *wp++ = OTG_FIFO_POP(fifop);
+      n--;
+    }
+    return (uint8_t *)wp;
+  }
+
+  while (n > 0) {
+    uint32_t w = OTG_FIFO_POP(fifop);
+    /* Note, this line relies on the Cortex-M3/M4 ability to perform
+       unaligned word accesses and on the LSB-first memory organization.*/
+    *((uint32_t *)buf) = w;
+    buf += 4;
+    n--;
+  }
+  return buf;
+}
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Updates a queue counter after a FIFO transfer.
+ * @details The waiting threads are made ready but no reschedule is
+ *          performed, the caller reschedules once per batch of transfers.
+ *
+ * @param[in] qp        pointer to a @p GenericQueue object
+ * @param[in] n         number of bytes transferred
+ *
+ * @iclass
+ */
+void otg_queue_update_i(GenericQueue *qp, size_t n) {
+
+  qp->q_counter += n;
+  while (notempty(&qp->q_waiting))
+    chSchReadyI(fifo_remove(&qp->q_waiting))->p_u.rdymsg = Q_OK;
+}
+
+/**
+ * @brief   Writes to a TX FIFO.
+ *
+ * @param[in] fifop     pointer to the FIFO register
+ * @param[in] buf       buffer where to copy the endpoint data
+ * @param[in] n         maximum number of bytes to copy
+ *
+ * @notapi
+ */
+void otg_fifo_write_from_buffer(volatile uint32_t *fifop,
+                                const uint8_t *buf,
+                                size_t n) {
+
+  otg_do_push(fifop, (uint8_t *)buf, (n + 3) / 4);
+}
+
+/**
+ * @brief   Copies data from a queue into a TX FIFO.
+ * @details Whole words are streamed up to the circular buffer boundary,
+ *          a word can straddle the boundary only if the read pointer is
+ *          not word aligned. With rings whose size is a multiple of four
+ *          this happens at most once per transfer.
+ * @note    The queue counter is not updated, the caller releases the
+ *          space and wakes the writers.
+ *
+ * @param[in] fifop     pointer to the FIFO register
+ * @param[in] oqp       pointer to an @p OutputQueue object
+ * @param[in] n         maximum number of bytes to copy
+ *
+ * @notapi
+ */
+void otg_fifo_copy_from_queue(volatile uint32_t *fifop,
+                              OutputQueue *oqp,
+                              size_t n) {
+  size_t nw = n / 4;
+
+  while (nw > 0) {
+    size_t nw2end = (size_t)(oqp->q_top - oqp->q_rdptr) / 4;
+
+    if (nw2end > 0) {
+      size_t streak = nw <= nw2end ? nw : nw2end;
+
+      oqp->q_rdptr = otg_do_push(fifop, oqp->q_rdptr, streak);
+      if (oqp->q_rdptr >= oqp->q_top)
+        oqp->q_rdptr = oqp->q_buffer;
+      nw -= streak;
+    }
+    else {
+      /* Word lying across the circular buffer boundary.*/
+      OTG_FIFO_PUSH(fifop, otg_queue_gather(oqp, 4));
+      nw--;
+    }
+  }
+
+  /* Trailing bytes, if any.*/
+  if ((n & 3) != 0)
+    OTG_FIFO_PUSH(fifop, otg_queue_gather(oqp, n & 3));
+}
+
+/**
+ * @brief   Writes to a TX FIFO fetching data from a queue.
+ *
+ * @param[in] fifop     pointer to the FIFO register
+ * @param[in] oqp       pointer to an @p OutputQueue object
+ * @param[in] n         maximum number of bytes to copy
+ *
+ * @notapi
+ */
+void otg_fifo_write_from_queue(volatile uint32_t *fifop,
+                               OutputQueue *oqp,
+                               size_t n) {
+
+  otg_fifo_copy_from_queue(fifop, oqp, n);
+
+  /* Updating queue.*/
+  chSysLock();
+  otg_queue_update_i(oqp, n);
+  chSysUnlock();
+}
+
+/**
+ * @brief   Reads a packet from the RXFIFO.
+ *
+ * @param[in] fifop     pointer to the FIFO register
+ * @param[out] buf      buffer where to copy the endpoint data
+ * @param[in] n         number of bytes to pull from the FIFO
+ * @param[in] max       number of bytes to copy into the buffer
+ *
+ * @notapi
+ */
+void otg_fifo_read_to_buffer(volatile uint32_t *fifop,
+                             uint8_t *buf,
+                             size_t n,
+                             size_t max) {
+
+  n = (n + 3) / 4;
+  max = (max + 3) / 4;
+  while (n) {
+    uint32_t w = OTG_FIFO_POP(fifop);
+    if (max) {
+      /* Note, this line relies on the Cortex-M3/M4 ability to perform
+         unaligned word accesses and on the LSB-first memory organization.*/
+      *((uint32_t *)buf) = w;
+      buf += 4;
+      max--;
+    }
+    n--;
+  }
+}
+
+/**
+ * @brief   Reads a packet from the RXFIFO.
+ * @details Whole words are streamed up to the circular buffer boundary,
+ *          see @p otg_fifo_copy_from_queue() for the boundary handling.
+ *
+ * @param[in] fifop     pointer to the FIFO register
+ * @param[in] iqp       pointer to an @p InputQueue object
+ * @param[in] n         number of bytes to pull from the FIFO
+ *
+ * @notapi
+ */
+void otg_fifo_read_to_queue(volatile uint32_t *fifop,
+                            InputQueue *iqp,
+                            size_t n) {
+  size_t nw = n / 4;
+
+  while (nw > 0) {
+    size_t nw2end = (size_t)(iqp->q_top - iqp->q_wrptr) / 4;
+
+    if (nw2end > 0) {
+      size_t streak = nw <= nw2end ? nw : nw2end;
+
+      iqp->q_wrptr = otg_do_pop(fifop, iqp->q_wrptr, streak);
+      if (iqp->q_wrptr >= iqp->q_top)
+        iqp->q_wrptr = iqp->q_buffer;
+      nw -= streak;
+    }
+    else {
+      /* Word lying across the circular buffer boundary.*/
+      otg_queue_scatter(iqp, OTG_FIFO_POP(fifop), 4);
+      nw--;
+    }
+  }
+
+  /* Trailing bytes, if any.*/
+  if ((n & 3) != 0)
+    otg_queue_scatter(iqp, OTG_FIFO_POP(fifop), n & 3);
+
+  /* Updating queue.*/
+  chSysLock();
+  otg_queue_update_i(iqp, n);
+  chSysUnlock();
+}
+
+#endif /* HAL_USE_USB */
+
+/** @} */
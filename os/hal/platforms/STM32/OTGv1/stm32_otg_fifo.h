@@ -0,0 +1,96 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    STM32/OTGv1/stm32_otg_fifo.h
+ * @brief   STM32 OTG FIFO transfer helpers header.
+ *
+ * @addtogroup USB
+ * @{
+ */
+
+#ifndef _STM32_OTG_FIFO_H_
+#define _STM32_OTG_FIFO_H_
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/**
+ * @brief   Writes a word into a FIFO register.
+ */
+#if !defined(OTG_FIFO_PUSH) || defined(__DOXYGEN__)
+#define OTG_FIFO_PUSH(fifop, w)     (*(fifop) = (w))
+#endif
+
+/**
+ * @brief   Reads a word from a FIFO register.
+ */
+#if !defined(OTG_FIFO_POP) || defined(__DOXYGEN__)
+#define OTG_FIFO_POP(fifop)         (*(fifop))
+#endif
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void otg_queue_update_i(GenericQueue *qp, size_t n);
+  void otg_fifo_write_from_buffer(volatile uint32_t *fifop,
+                                  const uint8_t *buf,
+                                  size_t n);
+  void otg_fifo_copy_from_queue(volatile uint32_t *fifop,
+                                OutputQueue *oqp,
+                                size_t n);
+  void otg_fifo_write_from_queue(volatile uint32_t *fifop,
+                                 OutputQueue *oqp,
+                                 size_t n);
+  void otg_fifo_read_to_buffer(volatile uint32_t *fifop,
+                               uint8_t *buf,
+                               size_t n,
+                               size_t max);
+  void otg_fifo_read_to_queue(volatile uint32_t *fifop,
+                              InputQueue *iqp,
+                              size_t n);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _STM32_OTG_FIFO_H_ */
+
+/** @} */
@@ -30,6 +30,7 @@
 
 #include "ch.h"
 #include "hal.h"
+#include "stm32_otg_fifo.h"
 
 #if HAL_USE_USB || defined(__DOXYGEN__)
 
@@ -229,216 +230,6 @@ static uint32_t otg_ram_alloc(USBDriver *usbp, size_t size) {
   return next;
 }
 
-/**
- * @brief   Pushes a series of words into a FIFO.
- *
- * @param[in] fifop     pointer to the FIFO register
- * @param[in] buf       pointer to the words buffer, not necessarily word
- *                      aligned
- * @param[in] n         number of words to push
- *
- * @return              A pointer after the last word pushed.
- *
- * @notapi
- */
-static uint8_t *otg_do_push(volatile uint32_t *fifop, uint8_t *buf, size_t n) {
-
-  while (n > 0) {
-    /* Note, this line relies on the Cortex-M3/M4 ability to perform
-       unaligned word accesses and on the LSB-first memory organization.*/
-    *fifop = *((uint32_t *)buf);
-    buf += 4;
-    n--;
-  }
-  return buf;
-}
-
-/**
- * @brief   Writes to a TX FIFO.
- *
- * @param[in] fifop     pointer to the FIFO register
- * @param[in] buf       buffer where to copy the endpoint data
- * @param[in] n         maximum number of bytes to copy
- *
- * @notapi
- */
-static void otg_fifo_write_from_buffer(volatile uint32_t *fifop,
-                                       const uint8_t *buf,
-                                       size_t n) {
-
-  otg_do_push(fifop, (uint8_t *)buf, (n + 3) / 4);
-}
-
-/**
- * @brief   Writes to a TX FIFO fetching data from a queue.
- *
- * @param[in] fifop     pointer to the FIFO register
- * @param[in] oqp       pointer to an @p OutputQueue object
- * @param[in] n         maximum number of bytes to copy
- *
- * @notapi
- */
-static void otg_fifo_write_from_queue(volatile uint32_t *fifop,
-                                      OutputQueue *oqp,
-                                      size_t n) {
-  size_t ntogo;
-
-  ntogo = n;
-  while (ntogo > 0) {
-    uint32_t w, i;
-    size_t nw = ntogo / 4;
-
-    if (nw > 0) {
-      size_t streak;
-      uint32_t nw2end = (oqp->q_top - oqp->q_rdptr) / 4;
-
-      ntogo -= (streak = nw <= nw2end ? nw : nw2end) * 4;
-      oqp->q_rdptr = otg_do_push(fifop, oqp->q_rdptr, streak);
-      if (oqp->q_rdptr >= oqp->q_top) {
-        oqp->q_rdptr = oqp->q_buffer;
-        continue;
-      }
-    }
-
-    /* If this condition is not satisfied then there is a word lying across
-       queue circular buffer boundary or there are some remaining bytes.*/
-    if (ntogo <= 0)
-      break;
-
-    /* One byte at time.*/
-    w = 0;
-    i = 0;
-    while ((ntogo > 0) && (i < 4)) {
-      w |= (uint32_t)*oqp->q_rdptr++ << (i * 8);
-      if (oqp->q_rdptr >= oqp->q_top)
-        oqp->q_rdptr = oqp->q_buffer;
-      ntogo--;
-      i++;
-    }
-    *fifop = w;
-  }
-
-  /* Updating queue.*/
-  chSysLock();
-  oqp->q_counter += n;
-  while (notempty(&oqp->q_waiting))
-    chSchReadyI(fifo_remove(&oqp->q_waiting))->p_u.rdymsg = Q_OK;
-  chSchRescheduleS();
-  chSysUnlock();
-}
-
-/**
- * @brief   Pops a series of words from a FIFO.
- *
- * @param[in] fifop     pointer to the FIFO register
- * @param[in] buf       pointer to the words buffer, not necessarily word
- *                      aligned
- * @param[in] n         number of words to push
- *
- * @return              A pointer after the last word pushed.
- *
- * @notapi
- */
-static uint8_t *otg_do_pop(volatile uint32_t *fifop, uint8_t *buf, size_t n) {
-
-  while (n > 0) {
-    uint32_t w = *fifop;
-    /* Note, this line relies on the Cortex-M3/M4 ability to perform
-       unaligned word accesses and on the LSB-first memory organization.*/
-    *((uint32_t *)buf) = w;
-    buf += 4;
-    n--;
-  }
-  return buf;
-}
-
-/**
- * @brief   Reads a packet from the RXFIFO.
- *
- * @param[in] fifop     pointer to the FIFO register
- * @param[out] buf      buffer where to copy the endpoint data
- * @param[in] n         number of bytes to pull from the FIFO
- * @param[in] max       number of bytes to copy into the buffer
- *
- * @notapi
- */
-static void otg_fifo_read_to_buffer(volatile uint32_t *fifop,
-                                    uint8_t *buf,
-                                    size_t n,
-                                    size_t max) {
-
-  n = (n + 3) / 4;
-  max = (max + 3) / 4;
-  while (n) {
-    uint32_t w = *fifop;
-    if (max) {
-      /* Note, this line relies on the Cortex-M3/M4 ability to perform
-         unaligned word accesses and on the LSB-first memory organization.*/
-      *((uint32_t *)buf) = w;
-      buf += 4;
-      max--;
-    }
-    n--;
-  }
-}
-
-/**
- * @brief   Reads a packet from the RXFIFO.
- *
- * @param[in] fifop     pointer to the FIFO register
- * @param[in] iqp       pointer to an @p InputQueue object
- * @param[in] n         number of bytes to pull from the FIFO
- *
- * @notapi
- */
-static void otg_fifo_read_to_queue(volatile uint32_t *fifop,
-                                   InputQueue *iqp,
-                                   size_t n) {
-  size_t ntogo;
-
-  ntogo = n;
-  while (ntogo > 0) {
-    uint32_t w, i;
-    size_t nw = ntogo / 4;
-
-    if (nw > 0) {
-      size_t streak;
-      uint32_t nw2end = (iqp->q_wrptr - iqp->q_wrptr) / 4;
-
-      ntogo -= (streak = nw <= nw2end ? nw : nw2end) * 4;
-      iqp->q_wrptr = otg_do_pop(fifop, iqp->q_wrptr, streak);
-      if (iqp->q_wrptr >= iqp->q_top) {
-        iqp->q_wrptr = iqp->q_buffer;
-        continue;
-      }
-    }
-
-    /* If this condition is not satisfied then there is a word lying across
-       queue circular buffer boundary or there are some remaining bytes.*/
-    if (ntogo <= 0)
-      break;
-
-    /* One byte at time.*/
-    w = *fifop;
-    i = 0;
-    while ((ntogo > 0) && (i < 4)) {
-      *iqp->q_wrptr++ = (uint8_t)(w >> (i * 8));
-      if (iqp->q_wrptr >= iqp->q_top)
-        iqp->q_wrptr = iqp->q_buffer;
-      ntogo--;
-      i++;
-    }
-  }
-
-  /* Updating queue.*/
-  chSysLock();
-  iqp->q_counter += n;
-  while (notempty(&iqp->q_waiting))
-    chSchReadyI(fifo_remove(&iqp->q_waiting))->p_u.rdymsg = Q_OK;
-  chSchRescheduleS();
-  chSysUnlock();
-}
-
 /**
  * @brief   Incoming packets handler.
  *
@@ -537,6 +328,77 @@ static bool_t otg_txfifo_handler(USBDriver *usbp, usbep_t ep) {
 #endif
 }
 
+#if STM32_USB_OTG_ISR_FILL || defined(__DOXYGEN__)
+/**
+ * @brief   Outgoing packets handler invoked from the IN endpoint ISR.
+ * @details Short transactions are copied into the TXFIFO directly from the
+ *          ISR, the OTG interrupt cannot be preempted by the pump so the
+ *          packet writes are not interleaved with other FIFO accesses.
+ *
+ * @param[in] usbp      pointer to the @p USBDriver object
+ * @param[in] ep        endpoint number
+ * @return              The operation status.
+ * @retval FALSE        transaction too large, left to the pump thread.
+ * @retval TRUE         transaction served, completely or until the TXFIFO
+ *                      was full.
+ *
+ * @notapi
+ */
+static bool_t otg_txfifo_isr_fill(USBDriver *usbp, usbep_t ep) {
+  USBInEndpointState *isp = usbp->epc[ep]->in_state;
+
+  if ((isp->txsize - isp->txcnt) > STM32_USB_OTG_ISR_FILL_MAX_SIZE)
+    return FALSE;
+
+  while (isp->txcnt < isp->txsize) {
+    uint32_t n = isp->txsize - isp->txcnt;
+
+    if (n > usbp->epc[ep]->in_maxsize)
+      n = usbp->epc[ep]->in_maxsize;
+
+    /* Not enough space, the TXFE interrupt stays enabled and the filling
+       continues on the next one.*/
+    if (((usbp->otg->ie[ep].DTXFSTS & DTXFSTS_INEPTFSAV_MASK) * 4) < n)
+      return TRUE;
+
+    if (isp->txqueued) {
+      otg_fifo_copy_from_queue(usbp->otg->FIFO[ep],
+                               isp->mode.queue.txqueue, n);
+      chSysLockFromIsr();
+      otg_queue_update_i(isp->mode.queue.txqueue, n);
+      chSysUnlockFromIsr();
+    }
+    else {
+      otg_fifo_write_from_buffer(usbp->otg->FIFO[ep],
+                                 isp->mode.linear.txbuf, n);
+      isp->mode.linear.txbuf += n;
+    }
+    isp->txcnt += n;
+  }
+
+  /* Transaction completely in the FIFO.*/
+  usbp->otg->DIEPEMPMSK &= ~DIEPEMPMSK_INEPTXFEM(ep);
+  return TRUE;
+}
+#endif /* STM32_USB_OTG_ISR_FILL */
+
+/**
+ * @brief   Ends the abort of an isochronous IN endpoint.
+ * @details The NAK effective and endpoint disabled interrupts are masked
+ *          again when no more aborts are in progress.
+ *
+ * @param[in] usbp      pointer to the @p USBDriver object
+ * @param[in] ep        endpoint number
+ *
+ * @notapi
+ */
+static void otg_isoc_in_abort_end(USBDriver *usbp, usbep_t ep) {
+
+  usbp->isoabort &= ~(1 << ep);
+  if (usbp->isoabort == 0)
+    usbp->otg->DIEPMSK &= ~(DIEPMSK_INEPNEM | DIEPMSK_EPDM);
+}
+
 /**
  * @brief   Generic endpoint IN handler.
  *
@@ -555,11 +417,34 @@ static void otg_epin_handler(USBDriver *usbp, usbep_t ep) {
     /* Timeouts not handled yet, not sure how to handle.*/
   }
   if ((epint & DIEPINT_XFRC) && (otgp->DIEPMSK & DIEPMSK_XFRCM)) {
-    /* Transmit transfer complete.*/
+    /* Transmit transfer complete, the transfer made it before the NAK
+       became effective so an abort in progress is no more needed.*/
+    if (usbp->isoabort & (1 << ep))
+      otg_isoc_in_abort_end(usbp, ep);
     _usb_isr_invoke_in_cb(usbp, ep);
   }
+  if (usbp->isoabort & (1 << ep)) {
+    if ((epint & DIEPINT_INEPNE) &&
+        (otgp->ie[ep].DIEPCTL & DIEPCTL_EPENA)) {
+      /* NAK effective, the endpoint can now be disabled.*/
+      otgp->ie[ep].DIEPCTL |= DIEPCTL_EPDIS | DIEPCTL_SNAK;
+    }
+    if (epint & DIEPINT_EPDISD) {
+      /* Endpoint disabled, the stale data is flushed and the transfer
+         terminated, the data did not reach the host.*/
+      otg_txfifo_flush(usbp, ep);
+      otg_isoc_in_abort_end(usbp, ep);
+      _usb_isr_invoke_in_cb(usbp, ep);
+    }
+  }
   if ((epint & DIEPINT_TXFE) &&
       (otgp->DIEPEMPMSK & DIEPEMPMSK_INEPTXFEM(ep))) {
+#if STM32_USB_OTG_ISR_FILL
+    /* Short transactions are served here without involving the pump.*/
+    if (((usbp->txpending & (1 << ep)) == 0) &&
+        otg_txfifo_isr_fill(usbp, ep))
+      return;
+#endif
     /* The thread is made ready, it will be scheduled on ISR exit.*/
     chSysLockFromIsr();
     usbp->txpending |= (1 << ep);
@@ -569,6 +454,45 @@ static void otg_epin_handler(USBDriver *usbp, usbep_t ep) {
   }
 }
 
+/**
+ * @brief   Incomplete isochronous IN transfer handler.
+ * @details An isochronous IN endpoint still enabled at the end of a frame
+ *          but not scheduled for the next one missed its slot, the data
+ *          in its FIFO is stale. The abort follows the reference manual
+ *          sequence without waiting in the ISR: the NAK is set here, the
+ *          endpoint is disabled on the NAK effective interrupt and the
+ *          FIFO flushed and the transfer terminated on the endpoint
+ *          disabled interrupt, see @p otg_epin_handler().
+ *
+ * @param[in] usbp      pointer to the @p USBDriver object
+ *
+ * @notapi
+ */
+static void otg_isoc_in_failed_handler(USBDriver *usbp) {
+  stm32_otg_t *otgp = usbp->otg;
+  uint32_t nextodd = (otgp->DSTS & DSTS_FNSOF(1)) == 0;
+  usbep_t ep;
+
+  for (ep = 1; ep <= usbp->otgparams->num_endpoints; ep++) {
+    uint32_t ctl = otgp->ie[ep].DIEPCTL;
+
+    if (((ctl & DIEPCTL_EPTYP_MASK) != DIEPCTL_EPTYP_ISO) ||
+        !(ctl & DIEPCTL_EPENA) || (usbp->isoabort & (1 << ep)))
+      continue;
+
+    /* Transfers started during this frame are scheduled for the next one,
+       see usb_lld_start_in(), they are still in time.*/
+    if (((ctl & DIEPCTL_EONUM) != 0) == nextodd)
+      continue;
+
+    otgp->ie[ep].DIEPCTL = ctl | DIEPCTL_SNAK;
+    otgp->DIEPEMPMSK &= ~DIEPEMPMSK_INEPTXFEM(ep);
+    usbp->txpending &= ~(1 << ep);
+    usbp->isoabort |= (1 << ep);
+    otgp->DIEPMSK |= DIEPMSK_INEPNEM | DIEPMSK_EPDM;
+  }
+}
+
 /**
  * @brief   Generic endpoint OUT handler.
  *
@@ -636,6 +560,11 @@ static void usb_lld_serve_interrupt(USBDriver *usbp) {
     chSysUnlockFromIsr();
   }
 
+  /* Isochronous IN transfers not completed in their frame.*/
+  if (sts & GINTSTS_IISOIXFR) {
+    otg_isoc_in_failed_handler(usbp);
+  }
+
   /* IN/OUT endpoints event handling.*/
   src = otgp->DAINT;
   if (sts & GINTSTS_IEPINT) {
@@ -729,6 +658,10 @@ static msg_t usb_lld_pump(void *p) {
       }
     }
     chSysLock();
+
+    /* Queue waiters made ready during this pass are scheduled once, the
+       FIFO handlers do not reschedule on each transfer.*/
+    chSchRescheduleS();
   }
   chSysUnlock();
   return 0;
@@ -870,6 +803,7 @@ void usb_lld_start(USBDriver *usbp) {
     /* Creates the data pump threads in a suspended state. Note, it is
        created only once, the first time @p usbStart() is invoked.*/
     usbp->txpending = 0;
+    usbp->isoabort = 0;
     if (usbp->thd_ptr == NULL)
       usbp->thd_ptr = usbp->thd_wait = chThdCreateI(usbp->wa_pump,
                                                     sizeof usbp->wa_pump,
@@ -932,6 +866,7 @@ void usb_lld_stop(USBDriver *usbp) {
   if (usbp->state != USB_STOP) {
 
     usbp->txpending = 0;
+    usbp->isoabort  = 0;
 
     otgp->DAINTMSK   = 0;
     otgp->GAHBCFG    = 0;
@@ -982,6 +917,10 @@ void usb_lld_reset(USBDriver *usbp) {
   /* Resets the FIFO memory allocator.*/
   otg_ram_reset(usbp);
 
+  /* No isochronous endpoints after this point.*/
+  usbp->otg->GINTMSK &= ~GINTMSK_IISOIXFRM;
+  usbp->isoabort = 0;
+
   /* Receive FIFO size initialization, the address is always zero.*/
   otgp->GRXFSIZ = usbp->otgparams->rx_fifo_size;
   otg_rxfifo_flush(usbp);
@@ -1076,6 +1015,10 @@ void usb_lld_init_endpoint(USBDriver *usbp, usbep_t ep) {
                            DIEPCTL_TXFNUM(ep) |
                            DIEPCTL_MPSIZ(usbp->epc[ep]->in_maxsize);
     otgp->DAINTMSK |= DAINTMSK_IEPM(ep);
+
+    /* Isochronous endpoints need the missed frame notification.*/
+    if ((usbp->epc[ep]->ep_mode & USB_EP_MODE_TYPE) == USB_EP_MODE_TYPE_ISOC)
+      otgp->GINTMSK |= GINTMSK_IISOIXFRM;
   }
   else {
     otgp->DIEPTXF[ep - 1] = 0x02000400; /* Reset value.*/
@@ -1097,8 +1040,10 @@ void usb_lld_disable_endpoints(USBDriver *usbp) {
   /* Resets the FIFO memory allocator.*/
   otg_ram_reset(usbp);
 
-  /* Disabling all endpoints.*/
+  /* Disabling all endpoints, aborts in progress are terminated too.*/
   otg_disable_ep(usbp);
+  usbp->isoabort = 0;
+  usbp->otg->DIEPMSK &= ~(DIEPMSK_INEPNEM | DIEPMSK_EPDM);
 }
 
 /**
@@ -1210,8 +1155,17 @@ void usb_lld_prepare_transmit(USBDriver *usbp, usbep_t ep) {
     /* Normal case.*/
     uint32_t pcnt = (isp->txsize + usbp->epc[ep]->in_maxsize - 1) /
                     usbp->epc[ep]->in_maxsize;
-    usbp->otg->ie[ep].DIEPTSIZ = DIEPTSIZ_PKTCNT(pcnt) |
-                                 DIEPTSIZ_XFRSIZ(usbp->epc[ep]->in_state->txsize);
+    uint32_t tsiz = DIEPTSIZ_PKTCNT(pcnt) |
+                    DIEPTSIZ_XFRSIZ(usbp->epc[ep]->in_state->txsize);
+
+    /* Isochronous transfers are sent within a single frame, the packets
+       count is also the multi count.*/
+    if ((usbp->epc[ep]->ep_mode & USB_EP_MODE_TYPE) == USB_EP_MODE_TYPE_ISOC) {
+      chDbgAssert(pcnt <= 3, "usb_lld_prepare_transmit(), #1",
+                  "too large for one frame");
+      tsiz |= DIEPTSIZ_MCNT(pcnt);
+    }
+    usbp->otg->ie[ep].DIEPTSIZ = tsiz;
   }
 
 }
@@ -1238,8 +1192,17 @@ void usb_lld_start_out(USBDriver *usbp, usbep_t ep) {
  * @notapi
  */
 void usb_lld_start_in(USBDriver *usbp, usbep_t ep) {
+  uint32_t ctl = DIEPCTL_EPENA | DIEPCTL_CNAK;
 
-  usbp->otg->ie[ep].DIEPCTL |= DIEPCTL_EPENA | DIEPCTL_CNAK;
+  /* Isochronous transfers are scheduled for the next frame, the even/odd
+     frame bit must be the opposite of the current frame.*/
+  if ((usbp->epc[ep]->ep_mode & USB_EP_MODE_TYPE) == USB_EP_MODE_TYPE_ISOC) {
+    if (usbp->otg->DSTS & DSTS_FNSOF(1))
+      ctl |= DIEPCTL_SEVNFRM;
+    else
+      ctl |= DIEPCTL_SODDFRM;
+  }
+  usbp->otg->ie[ep].DIEPCTL |= ctl;
   usbp->otg->DIEPEMPMSK |= DIEPEMPMSK_INEPTXFEM(ep);
 }
 
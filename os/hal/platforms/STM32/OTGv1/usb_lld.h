@@ -136,6 +136,29 @@
 #define STM32_USB_OTGFIFO_FILL_BASEPRI      0
 #endif
 
+/**
+ * @brief   TX FIFO filling from the IN endpoint ISR.
+ * @details If set to @p TRUE the TX FIFO of an IN endpoint is filled
+ *          directly in the endpoint interrupt handler when the remaining
+ *          transaction size does not exceed
+ *          @p STM32_USB_OTG_ISR_FILL_MAX_SIZE, larger transactions are
+ *          still served by the data pump thread. This removes a thread
+ *          wakeup and a context switch from the latency of short packets.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(STM32_USB_OTG_ISR_FILL) || defined(__DOXYGEN__)
+#define STM32_USB_OTG_ISR_FILL              FALSE
+#endif
+
+/**
+ * @brief   Largest remaining IN transaction filled from the ISR.
+ * @details Bounds the time spent copying into the FIFO with the OTG
+ *          interrupt active.
+ */
+#if !defined(STM32_USB_OTG_ISR_FILL_MAX_SIZE) || defined(__DOXYGEN__)
+#define STM32_USB_OTG_ISR_FILL_MAX_SIZE     64
+#endif
+
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
@@ -372,6 +395,13 @@ struct USBDriver {
    *          application-defined handler to the USB driver.
    */
   void                          *param;
+  /**
+   * @brief   Per-endpoint user fields.
+   * @details Used to route the endpoint callbacks to the upper layer driver
+   *          owning the endpoint when several drivers share the same
+   *          @p USBDriver, see @p usbSetEndpointParamI().
+   */
+  void                          *epparam[USB_MAX_ENDPOINTS + 1];
   /**
    * @brief   Bit map of the transmitting IN endpoints.
    */
@@ -436,6 +466,10 @@ struct USBDriver {
    * @brief   Mask of TXFIFOs to be filled by the pump thread.
    */
   uint32_t                      txpending;
+  /**
+   * @brief   Mask of isochronous IN endpoints being aborted.
+   */
+  uint32_t                      isoabort;
   /**
    * @brief   Pointer to the thread.
    */
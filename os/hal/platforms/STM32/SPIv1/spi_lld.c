@@ -89,6 +89,65 @@ static uint16_t dummyrx;
 /* Driver local functions.                                                   */
 /*===========================================================================*/
 
+#if STM32_SPI_USE_STREAMING || defined(__DOXYGEN__)
+/**
+ * @brief   Returns the size in bytes of a frame.
+ *
+ * @param[in] spip      pointer to the @p SPIDriver object
+ */
+#define spi_lld_frame_size(spip)                                            \
+  (((spip)->config->cr1 & SPI_CR1_DFF) != 0 ? 2 : 1)
+
+/**
+ * @brief   Streaming mode end-of-buffer service routine.
+ *
+ * @param[in] spip      pointer to the @p SPIDriver object
+ * @param[in] flags     pre-shifted content of the ISR register
+ */
+static void spi_lld_serve_stream_interrupt(SPIDriver *spip, uint32_t flags) {
+  const SPIStreamConfig *scfg = spip->stream;
+  bool_t overrun = FALSE;
+  uint32_t half;
+  size_t n;
+
+  if ((flags & STM32_DMA_ISR_TCIF) == 0)
+    return;
+
+  /* The DMA already switched to the other memory target, the buffer half
+     just completed is the one not selected by the CT bit.*/
+  half = (spip->dmarx->stream->CR & STM32_DMA_CR_CT) != 0 ? 0 : 1;
+
+  /* The same half completing twice means that an interrupt has been lost
+     and a whole buffer half has been overwritten before being reported.*/
+  if (half == spip->lasthalf)
+    overrun = TRUE;
+  spip->lasthalf = half;
+
+  /* The DMA was not able to keep up with the receiver, the OVR flag is
+     cleared by reading DR then SR.*/
+  if ((spip->spi->SR & SPI_SR_OVR) != 0) {
+    (void)spip->spi->DR;
+    (void)spip->spi->SR;
+    overrun = TRUE;
+  }
+
+  if (overrun) {
+    spip->overruns++;
+    if (scfg->error_cb != NULL) {
+      scfg->error_cb(spip);
+      /* The callback could have stopped the stream.*/
+      if (spip->stream == NULL)
+        return;
+    }
+  }
+
+  n = scfg->depth / 2;
+  scfg->data_cb(spip,
+                (uint8_t *)scfg->rxbuf + half * n * spi_lld_frame_size(spip),
+                n);
+}
+#endif /* STM32_SPI_USE_STREAMING */
+
 /**
  * @brief   Shared end-of-rx service routine.
  *
@@ -106,6 +165,14 @@ static void spi_lld_serve_rx_interrupt(SPIDriver *spip, uint32_t flags) {
   (void)flags;
 #endif
 
+#if STM32_SPI_USE_STREAMING
+  /* In streaming mode the DMA is never stopped.*/
+  if (spip->stream != NULL) {
+    spi_lld_serve_stream_interrupt(spip, flags);
+    return;
+  }
+#endif
+
   /* Stop everything.*/
   dmaStreamDisable(spip->dmatx);
   dmaStreamDisable(spip->dmarx);
@@ -155,6 +222,9 @@ void spi_lld_init(void) {
 #if STM32_SPI_USE_SPI1
   spiObjectInit(&SPID1);
   SPID1.spi       = SPI1;
+#if STM32_SPI_USE_STREAMING
+  SPID1.stream    = NULL;
+#endif
   SPID1.dmarx     = STM32_DMA_STREAM(STM32_SPI_SPI1_RX_DMA_STREAM);
   SPID1.dmatx     = STM32_DMA_STREAM(STM32_SPI_SPI1_TX_DMA_STREAM);
   SPID1.rxdmamode = STM32_DMA_CR_CHSEL(SPI1_RX_DMA_CHANNEL) |
@@ -173,6 +243,9 @@ void spi_lld_init(void) {
 #if STM32_SPI_USE_SPI2
   spiObjectInit(&SPID2);
   SPID2.spi       = SPI2;
+#if STM32_SPI_USE_STREAMING
+  SPID2.stream    = NULL;
+#endif
   SPID2.dmarx     = STM32_DMA_STREAM(STM32_SPI_SPI2_RX_DMA_STREAM);
   SPID2.dmatx     = STM32_DMA_STREAM(STM32_SPI_SPI2_TX_DMA_STREAM);
   SPID2.rxdmamode = STM32_DMA_CR_CHSEL(SPI2_RX_DMA_CHANNEL) |
@@ -191,6 +264,9 @@ void spi_lld_init(void) {
 #if STM32_SPI_USE_SPI3
   spiObjectInit(&SPID3);
   SPID3.spi       = SPI3;
+#if STM32_SPI_USE_STREAMING
+  SPID3.stream    = NULL;
+#endif
   SPID3.dmarx     = STM32_DMA_STREAM(STM32_SPI_SPI3_RX_DMA_STREAM);
   SPID3.dmatx     = STM32_DMA_STREAM(STM32_SPI_SPI3_TX_DMA_STREAM);
   SPID3.rxdmamode = STM32_DMA_CR_CHSEL(SPI3_RX_DMA_CHANNEL) |
@@ -482,6 +558,129 @@ uint16_t spi_lld_polled_exchange(SPIDriver *spip, uint16_t frame) {
   return spip->spi->DR;
 }
 
+#if STM32_SPI_USE_STREAMING || defined(__DOXYGEN__)
+/**
+ * @brief   Starts a continuous streaming exchange.
+ * @details The receive buffer is filled continuously using the DMA double
+ *          buffer mode, the callback is invoked each time a buffer half
+ *          has been filled. The operation continues until stopped using
+ *          @p spiStopStream() or @p spiStopStreamI().
+ * @pre     A slave must have been selected using @p spiSelect() or
+ *          @p spiSelectI().
+ * @note    The callbacks are invoked from ISR context, the buffer half must
+ *          be processed before the DMA wraps around on it else an overrun
+ *          is reported.
+ *
+ * @param[in] spip      pointer to the @p SPIDriver object
+ * @param[in] scfg      pointer to the @p SPIStreamConfig object
+ *
+ * @iclass
+ */
+void spiStartStreamI(SPIDriver *spip, const SPIStreamConfig *scfg) {
+  size_t n = scfg->depth / 2;
+
+  chDbgCheckClassI();
+
+  spip->stream   = scfg;
+  spip->lasthalf = 1;
+  spip->overruns = 0;
+  spip->state    = SPI_ACTIVE;
+
+  /* Clearing a stale overrun condition left by previous operations.*/
+  (void)spip->spi->DR;
+  (void)spip->spi->SR;
+
+  /* The two buffer halves are the two memory targets of the double buffer
+     mode, the DMA switches between them without software intervention.*/
+  dmaStreamSetMemory0(spip->dmarx, scfg->rxbuf);
+  dmaStreamSetMemory1(spip->dmarx,
+                      (uint8_t *)scfg->rxbuf + n * spi_lld_frame_size(spip));
+  dmaStreamSetTransactionSize(spip->dmarx, n);
+  dmaStreamSetMode(spip->dmarx, spip->rxdmamode | STM32_DMA_CR_MINC |
+                                STM32_DMA_CR_CIRC | STM32_DMA_CR_DBM);
+
+  /* The transmitter just generates the clock in circular mode.*/
+  if (scfg->txbuf != NULL) {
+    dmaStreamSetMemory0(spip->dmatx, scfg->txbuf);
+    dmaStreamSetTransactionSize(spip->dmatx, scfg->depth);
+    dmaStreamSetMode(spip->dmatx, spip->txdmamode | STM32_DMA_CR_MINC |
+                                  STM32_DMA_CR_CIRC);
+  }
+  else {
+    dmaStreamSetMemory0(spip->dmatx, &dummytx);
+    dmaStreamSetTransactionSize(spip->dmatx, scfg->depth);
+    dmaStreamSetMode(spip->dmatx, spip->txdmamode | STM32_DMA_CR_CIRC);
+  }
+
+  dmaStreamEnable(spip->dmarx);
+  dmaStreamEnable(spip->dmatx);
+}
+
+/**
+ * @brief   Starts a continuous streaming exchange.
+ * @details The receive buffer is filled continuously using the DMA double
+ *          buffer mode, the callback is invoked each time a buffer half
+ *          has been filled.
+ * @pre     A slave must have been selected using @p spiSelect() or
+ *          @p spiSelectI().
+ *
+ * @param[in] spip      pointer to the @p SPIDriver object
+ * @param[in] scfg      pointer to the @p SPIStreamConfig object
+ *
+ * @api
+ */
+void spiStartStream(SPIDriver *spip, const SPIStreamConfig *scfg) {
+
+  chDbgCheck((spip != NULL) && (scfg != NULL) && (scfg->data_cb != NULL) &&
+             (scfg->rxbuf != NULL) && (scfg->depth >= 2) &&
+             ((scfg->depth & 1) == 0) && (scfg->depth / 2 <= 0xFFFF),
+             "spiStartStream");
+
+  chSysLock();
+  chDbgAssert(spip->state == SPI_READY, "spiStartStream(), #1", "not ready");
+  spiStartStreamI(spip, scfg);
+  chSysUnlock();
+}
+
+/**
+ * @brief   Stops a streaming exchange.
+ * @note    This function can be invoked from within the streaming
+ *          callbacks.
+ *
+ * @param[in] spip      pointer to the @p SPIDriver object
+ *
+ * @iclass
+ */
+void spiStopStreamI(SPIDriver *spip) {
+
+  chDbgCheckClassI();
+
+  dmaStreamDisable(spip->dmatx);
+  dmaStreamDisable(spip->dmarx);
+  spip->stream = NULL;
+  spip->state  = SPI_READY;
+}
+
+/**
+ * @brief   Stops a streaming exchange.
+ *
+ * @param[in] spip      pointer to the @p SPIDriver object
+ *
+ * @api
+ */
+void spiStopStream(SPIDriver *spip) {
+
+  chDbgCheck(spip != NULL, "spiStopStream");
+
+  chSysLock();
+  chDbgAssert((spip->state == SPI_READY) || (spip->state == SPI_ACTIVE),
+              "spiStopStream(), #1", "invalid state");
+  if (spip->stream != NULL)
+    spiStopStreamI(spip);
+  chSysUnlock();
+}
+#endif /* STM32_SPI_USE_STREAMING */
+
 #endif /* HAL_USE_SPI */
 
 /** @} */
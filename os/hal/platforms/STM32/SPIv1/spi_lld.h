@@ -128,6 +128,18 @@
 #define STM32_SPI_DMA_ERROR_HOOK(spip)      chSysHalt()
 #endif
 
+/**
+ * @brief   Continuous streaming API enable switch.
+ * @details If set to @p TRUE the @p spiStartStream() and @p spiStopStream()
+ *          APIs are included, the streaming mode uses the DMA double buffer
+ *          mode in order to capture data without gaps.
+ * @note    The default is @p FALSE.
+ * @note    This option is only available on platforms with enhanced DMA.
+ */
+#if !defined(STM32_SPI_USE_STREAMING) || defined(__DOXYGEN__)
+#define STM32_SPI_USE_STREAMING             FALSE
+#endif
+
 #if STM32_ADVANCED_DMA || defined(__DOXYGEN__)
 
 /**
@@ -196,6 +208,10 @@
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
 
+#if STM32_SPI_USE_STREAMING && !STM32_ADVANCED_DMA
+#error "SPI streaming mode requires the enhanced DMA"
+#endif
+
 #if STM32_SPI_USE_SPI1 && !STM32_HAS_SPI1
 #error "SPI1 not present in the selected device"
 #endif
@@ -316,6 +332,51 @@ typedef struct {
   uint16_t                  cr1;
 } SPIConfig;
 
+#if STM32_SPI_USE_STREAMING || defined(__DOXYGEN__)
+/**
+ * @brief   SPI streaming notification callback type.
+ *
+ * @param[in] spip      pointer to the @p SPIDriver object triggering the
+ *                      callback
+ * @param[in] buffer    pointer to the buffer half just filled
+ * @param[in] n         number of frames in the buffer half
+ */
+typedef void (*spistreamcallback_t)(SPIDriver *spip, void *buffer, size_t n);
+
+/**
+ * @brief   Streaming mode configuration structure.
+ * @details The receive buffer is split in two halves, the DMA double buffer
+ *          mode fills one half while the other is processed by the
+ *          application so the capture never stops.
+ * @note    The buffers are organized as uint8_t arrays for data sizes below
+ *          or equal to 8 bits else it is organized as uint16_t arrays.
+ */
+typedef struct {
+  /**
+   * @brief Buffer half filled callback, invoked at half and full buffer.
+   */
+  spistreamcallback_t       data_cb;
+  /**
+   * @brief Overrun callback or @p NULL.
+   */
+  spicallback_t             error_cb;
+  /**
+   * @brief Receive buffer, it must be able to hold @p depth frames.
+   */
+  void                      *rxbuf;
+  /**
+   * @brief Transmit pattern repeated while streaming or @p NULL.
+   * @details If specified it must contain @p depth frames, if @p NULL
+   *          idle frames are transmitted.
+   */
+  const void                *txbuf;
+  /**
+   * @brief Total buffer depth in frames, it must be an even number.
+   */
+  size_t                    depth;
+} SPIStreamConfig;
+#endif /* STM32_SPI_USE_STREAMING */
+
 /**
  * @brief   Structure representing a SPI driver.
  */
@@ -352,6 +413,20 @@ struct SPIDriver{
    * @brief Pointer to the SPIx registers block.
    */
   SPI_TypeDef               *spi;
+#if STM32_SPI_USE_STREAMING || defined(__DOXYGEN__)
+  /**
+   * @brief Current streaming configuration or @p NULL if not streaming.
+   */
+  const SPIStreamConfig     *stream;
+  /**
+   * @brief Index of the last buffer half reported to the application.
+   */
+  uint32_t                  lasthalf;
+  /**
+   * @brief Number of overruns detected since the stream was started.
+   */
+  uint32_t                  overruns;
+#endif
   /**
    * @brief Receive DMA stream.
    */
@@ -374,6 +449,18 @@ struct SPIDriver{
 /* Driver macros.                                                            */
 /*===========================================================================*/
 
+#if STM32_SPI_USE_STREAMING || defined(__DOXYGEN__)
+/**
+ * @brief   Returns the number of overruns detected while streaming.
+ *
+ * @param[in] spip      pointer to the @p SPIDriver object
+ * @return              The overruns counter.
+ *
+ * @iclass
+ */
+#define spiStreamGetOverrunsI(spip) ((spip)->overruns)
+#endif
+
 /*===========================================================================*/
 /* External declarations.                                                    */
 /*===========================================================================*/
@@ -404,6 +491,12 @@ extern "C" {
   void spi_lld_send(SPIDriver *spip, size_t n, const void *txbuf);
   void spi_lld_receive(SPIDriver *spip, size_t n, void *rxbuf);
   uint16_t spi_lld_polled_exchange(SPIDriver *spip, uint16_t frame);
+#if STM32_SPI_USE_STREAMING
+  void spiStartStreamI(SPIDriver *spip, const SPIStreamConfig *scfg);
+  void spiStartStream(SPIDriver *spip, const SPIStreamConfig *scfg);
+  void spiStopStreamI(SPIDriver *spip);
+  void spiStopStream(SPIDriver *spip);
+#endif
 #ifdef __cplusplus
 }
 #endif
@@ -26,6 +26,8 @@
  * @{
  */
 
+#include <string.h>
+
 #include "ch.h"
 #include "hal.h"
 
@@ -35,6 +37,38 @@
 /* Driver local definitions.                                                 */
 /*===========================================================================*/
 
+#define USART1_RX_DMA_CHANNEL                                               \
+  STM32_DMA_GETCHANNEL(STM32_SERIAL_USART1_RX_DMA_STREAM,                   \
+                       STM32_USART1_RX_DMA_CHN)
+
+#define USART1_TX_DMA_CHANNEL                                               \
+  STM32_DMA_GETCHANNEL(STM32_SERIAL_USART1_TX_DMA_STREAM,                   \
+                       STM32_USART1_TX_DMA_CHN)
+
+#define USART2_RX_DMA_CHANNEL                                               \
+  STM32_DMA_GETCHANNEL(STM32_SERIAL_USART2_RX_DMA_STREAM,                   \
+                       STM32_USART2_RX_DMA_CHN)
+
+#define USART2_TX_DMA_CHANNEL                                               \
+  STM32_DMA_GETCHANNEL(STM32_SERIAL_USART2_TX_DMA_STREAM,                   \
+                       STM32_USART2_TX_DMA_CHN)
+
+#define USART3_RX_DMA_CHANNEL                                               \
+  STM32_DMA_GETCHANNEL(STM32_SERIAL_USART3_RX_DMA_STREAM,                   \
+                       STM32_USART3_RX_DMA_CHN)
+
+#define USART3_TX_DMA_CHANNEL                                               \
+  STM32_DMA_GETCHANNEL(STM32_SERIAL_USART3_TX_DMA_STREAM,                   \
+                       STM32_USART3_TX_DMA_CHN)
+
+#define USART6_RX_DMA_CHANNEL                                               \
+  STM32_DMA_GETCHANNEL(STM32_SERIAL_USART6_RX_DMA_STREAM,                   \
+                       STM32_USART6_RX_DMA_CHN)
+
+#define USART6_TX_DMA_CHANNEL                                               \
+  STM32_DMA_GETCHANNEL(STM32_SERIAL_USART6_TX_DMA_STREAM,                   \
+                       STM32_USART6_TX_DMA_CHN)
+
 /*===========================================================================*/
 /* Driver exported variables.                                                */
 /*===========================================================================*/
@@ -106,6 +140,34 @@ static void usart_init(SerialDriver *sdp, const SerialConfig *config) {
   else
     u->BRR = STM32_PCLK1 / config->sc_speed;
 
+#if STM32_SERIAL_USE_DMA
+  if (sdp->dmarx != NULL) {
+    /* DMA mode, the receiver runs continuously into the circular buffer
+       and the idle line interrupt flushes partial blocks.*/
+    dmaStreamDisable(sdp->dmarx);
+    dmaStreamDisable(sdp->dmatx);
+    sdp->rxdmapos = 0;
+    sdp->txdmacnt = 0;
+    dmaStreamSetPeripheral(sdp->dmarx, &u->DR);
+    dmaStreamSetMemory0(sdp->dmarx, sdp->rxdmabuf);
+    dmaStreamSetTransactionSize(sdp->dmarx, STM32_SERIAL_DMA_RX_BUFFER_SIZE);
+    dmaStreamSetMode(sdp->dmarx, sdp->rxdmamode);
+    dmaStreamSetPeripheral(sdp->dmatx, &u->DR);
+
+    u->CR2 = config->sc_cr2 | USART_CR2_LBDIE;
+    u->CR3 = config->sc_cr3 | USART_CR3_EIE | USART_CR3_DMAR |
+                              USART_CR3_DMAT;
+    u->SR = 0;
+    (void)u->SR;  /* SR reset step 1.*/
+    (void)u->DR;  /* SR reset step 2.*/
+    dmaStreamEnable(sdp->dmarx);
+    u->CR1 = config->sc_cr1 | USART_CR1_UE | USART_CR1_PEIE |
+                              USART_CR1_IDLEIE | USART_CR1_TE |
+                              USART_CR1_RE;
+    return;
+  }
+#endif
+
   /* Note that some bits are enforced.*/
   u->CR2 = config->sc_cr2 | USART_CR2_LBDIE;
   u->CR3 = config->sc_cr3 | USART_CR3_EIE;
@@ -152,16 +214,212 @@ static void set_error(SerialDriver *sdp, uint16_t sr) {
   chSysUnlockFromIsr();
 }
 
+#if STM32_SERIAL_USE_DMA || defined(__DOXYGEN__)
 /**
- * @brief   Common IRQ handler.
+ * @brief   Moves a block of received bytes into the input queue.
+ * @details Equivalent to invoking @p sdIncomingDataI() for each byte but
+ *          the data is copied in at most two chunks and the waiting
+ *          threads are awakened once.
+ *
+ * @param[in] sdp       pointer to a @p SerialDriver object
+ * @param[in] bp        pointer to the received bytes
+ * @param[in] n         number of bytes
+ */
+static void incoming_block_i(SerialDriver *sdp, const uint8_t *bp, size_t n) {
+  InputQueue *iqp = &sdp->iqueue;
+  size_t space, chunk;
+
+  if (n == 0)
+    return;
+  if (chIQIsEmptyI(iqp))
+    chnAddFlagsI(sdp, CHN_INPUT_AVAILABLE);
+  space = chIQGetEmptyI(iqp);
+  if (n > space) {
+    chnAddFlagsI(sdp, SD_OVERRUN_ERROR);
+    n = space;
+  }
+  iqp->q_counter += n;
+  while (n > 0) {
+    chunk = (size_t)(iqp->q_top - iqp->q_wrptr);
+    if (chunk > n)
+      chunk = n;
+    memcpy(iqp->q_wrptr, bp, chunk);
+    bp += chunk;
+    n -= chunk;
+    iqp->q_wrptr += chunk;
+    if (iqp->q_wrptr >= iqp->q_top)
+      iqp->q_wrptr = iqp->q_buffer;
+  }
+
+  while (notempty(&iqp->q_waiting))
+    chSchReadyI(fifo_remove(&iqp->q_waiting))->p_u.rdymsg = Q_OK;
+}
+
+/**
+ * @brief   Flushes the bytes written by the RX DMA since the last flush.
+ *
+ * @param[in] sdp       pointer to a @p SerialDriver object
+ */
+static void rx_dma_flush_i(SerialDriver *sdp) {
+  size_t pos = STM32_SERIAL_DMA_RX_BUFFER_SIZE -
+               dmaStreamGetTransactionSize(sdp->dmarx);
+
+  /* The counter can read zero for a moment before the circular reload.*/
+  if (pos >= STM32_SERIAL_DMA_RX_BUFFER_SIZE)
+    pos = 0;
+  if (pos < sdp->rxdmapos) {
+    incoming_block_i(sdp, &sdp->rxdmabuf[sdp->rxdmapos],
+                     STM32_SERIAL_DMA_RX_BUFFER_SIZE - sdp->rxdmapos);
+    sdp->rxdmapos = 0;
+  }
+  incoming_block_i(sdp, &sdp->rxdmabuf[sdp->rxdmapos], pos - sdp->rxdmapos);
+  sdp->rxdmapos = pos;
+}
+
+/**
+ * @brief   Starts a TX DMA transfer directly from the output queue.
+ * @details The bytes stay in the queue until the transfer completes, the
+ *          transfer covers the contiguous part of the queue content.
+ *
+ * @param[in] sdp       pointer to a @p SerialDriver object
+ */
+static void tx_dma_start_i(SerialDriver *sdp) {
+  OutputQueue *oqp = &sdp->oqueue;
+  size_t n;
+
+  if (sdp->txdmacnt > 0)
+    return;
+  n = chOQGetFullI(oqp);
+  if (n == 0)
+    return;
+  if (n > (size_t)(oqp->q_top - oqp->q_rdptr))
+    n = (size_t)(oqp->q_top - oqp->q_rdptr);
+  if (n > 0xFFFF)
+    n = 0xFFFF;
+
+  sdp->txdmacnt = n;
+  sdp->usart->SR &= ~USART_SR_TC;
+  dmaStreamSetMemory0(sdp->dmatx, oqp->q_rdptr);
+  dmaStreamSetTransactionSize(sdp->dmatx, n);
+  dmaStreamSetMode(sdp->dmatx, sdp->txdmamode);
+  dmaStreamEnable(sdp->dmatx);
+}
+
+/**
+ * @brief   RX DMA common service routine.
+ *
+ * @param[in] sdp       pointer to a @p SerialDriver object
+ * @param[in] flags     pre-shifted content of the ISR register
+ */
+static void serve_rx_dma_interrupt(SerialDriver *sdp, uint32_t flags) {
+
+  if ((flags & (STM32_DMA_ISR_TEIF | STM32_DMA_ISR_DMEIF)) != 0) {
+    STM32_SERIAL_DMA_ERROR_HOOK(sdp);
+  }
+
+  /* Half and full transfer events.*/
+  chSysLockFromIsr();
+  rx_dma_flush_i(sdp);
+  chSysUnlockFromIsr();
+}
+
+/**
+ * @brief   TX DMA common service routine.
+ *
+ * @param[in] sdp       pointer to a @p SerialDriver object
+ * @param[in] flags     pre-shifted content of the ISR register
+ */
+static void serve_tx_dma_interrupt(SerialDriver *sdp, uint32_t flags) {
+  OutputQueue *oqp = &sdp->oqueue;
+
+  if ((flags & (STM32_DMA_ISR_TEIF | STM32_DMA_ISR_DMEIF)) != 0) {
+    STM32_SERIAL_DMA_ERROR_HOOK(sdp);
+  }
+
+  chSysLockFromIsr();
+  dmaStreamDisable(sdp->dmatx);
+
+  /* Releases the transmitted bytes to the writers.*/
+  oqp->q_counter += sdp->txdmacnt;
+  oqp->q_rdptr += sdp->txdmacnt;
+  if (oqp->q_rdptr >= oqp->q_top)
+    oqp->q_rdptr = oqp->q_buffer;
+  sdp->txdmacnt = 0;
+  while (notempty(&oqp->q_waiting))
+    chSchReadyI(fifo_remove(&oqp->q_waiting))->p_u.rdymsg = Q_OK;
+
+  if (chOQIsEmptyI(oqp)) {
+    chnAddFlagsI(sdp, CHN_OUTPUT_EMPTY);
+    sdp->usart->CR1 |= USART_CR1_TCIE;
+  }
+  else
+    tx_dma_start_i(sdp);
+  chSysUnlockFromIsr();
+}
+
+/**
+ * @brief   Common IRQ handler for USARTs in DMA mode.
+ * @details Data register is only read on error and idle line events, when
+ *          the DMA has already taken any received byte.
  *
  * @param[in] sdp       communication channel associated to the USART
  */
-static void serve_interrupt(SerialDriver *sdp) {
+static void serve_dma_interrupt(SerialDriver *sdp) {
   USART_TypeDef *u = sdp->usart;
   uint16_t cr1 = u->CR1;
   uint16_t sr = u->SR;  /* SR reset step 1.*/
-  uint16_t dr = u->DR;  /* SR reset step 2.*/
+
+  if (sr & (USART_SR_ORE | USART_SR_NE | USART_SR_FE  | USART_SR_PE |
+            USART_SR_IDLE))
+    (void)u->DR;        /* SR reset step 2.*/
+
+  /* Error condition detection.*/
+  if (sr & (USART_SR_ORE | USART_SR_NE | USART_SR_FE  | USART_SR_PE))
+    set_error(sdp, sr);
+  /* Special case, LIN break detection.*/
+  if (sr & USART_SR_LBD) {
+    chSysLockFromIsr();
+    chnAddFlagsI(sdp, SD_BREAK_DETECTED);
+    chSysUnlockFromIsr();
+    u->SR &= ~USART_SR_LBD;
+  }
+  /* Idle line, flushes the partial block.*/
+  if (sr & USART_SR_IDLE) {
+    chSysLockFromIsr();
+    rx_dma_flush_i(sdp);
+    chSysUnlockFromIsr();
+  }
+  /* Physical transmission end.*/
+  if ((cr1 & USART_CR1_TCIE) && (sr & USART_SR_TC)) {
+    chSysLockFromIsr();
+    chnAddFlagsI(sdp, CHN_TRANSMISSION_END);
+    chSysUnlockFromIsr();
+    u->CR1 = cr1 & ~USART_CR1_TCIE;
+    u->SR &= ~USART_SR_TC;
+  }
+}
+#endif /* STM32_SERIAL_USE_DMA */
+
+/**
+ * @brief   Common IRQ handler.
+ *
+ * @param[in] sdp       communication channel associated to the USART
+ */
+static void serve_interrupt(SerialDriver *sdp) {
+  USART_TypeDef *u;
+  uint16_t cr1, sr, dr;
+
+#if STM32_SERIAL_USE_DMA
+  if (sdp->dmarx != NULL) {
+    serve_dma_interrupt(sdp);
+    return;
+  }
+#endif
+
+  u = sdp->usart;
+  cr1 = u->CR1;
+  sr = u->SR;   /* SR reset step 1.*/
+  dr = u->DR;   /* SR reset step 2.*/
 
   /* Error condition detection.*/
   if (sr & (USART_SR_ORE | USART_SR_NE | USART_SR_FE  | USART_SR_PE))
@@ -206,7 +464,11 @@ static void serve_interrupt(SerialDriver *sdp) {
 static void notify1(GenericQueue *qp) {
 
   (void)qp;
+#if STM32_SERIAL_USART1_USE_DMA
+  tx_dma_start_i(&SD1);
+#else
   USART1->CR1 |= USART_CR1_TXEIE;
+#endif
 }
 #endif
 
@@ -214,7 +476,11 @@ static void notify1(GenericQueue *qp) {
 static void notify2(GenericQueue *qp) {
 
   (void)qp;
+#if STM32_SERIAL_USART2_USE_DMA
+  tx_dma_start_i(&SD2);
+#else
   USART2->CR1 |= USART_CR1_TXEIE;
+#endif
 }
 #endif
 
@@ -222,7 +488,11 @@ static void notify2(GenericQueue *qp) {
 static void notify3(GenericQueue *qp) {
 
   (void)qp;
+#if STM32_SERIAL_USART3_USE_DMA
+  tx_dma_start_i(&SD3);
+#else
   USART3->CR1 |= USART_CR1_TXEIE;
+#endif
 }
 #endif
 
@@ -246,7 +516,11 @@ static void notify5(GenericQueue *qp) {
 static void notify6(GenericQueue *qp) {
 
   (void)qp;
+#if STM32_SERIAL_USART6_USE_DMA
+  tx_dma_start_i(&SD6);
+#else
   USART6->CR1 |= USART_CR1_TXEIE;
+#endif
 }
 #endif
 
@@ -382,16 +656,34 @@ void sd_lld_init(void) {
 #if STM32_SERIAL_USE_USART1
   sdObjectInit(&SD1, NULL, notify1);
   SD1.usart = USART1;
+#if STM32_SERIAL_USART1_USE_DMA
+  SD1.dmarx = STM32_DMA_STREAM(STM32_SERIAL_USART1_RX_DMA_STREAM);
+  SD1.dmatx = STM32_DMA_STREAM(STM32_SERIAL_USART1_TX_DMA_STREAM);
+#elif STM32_SERIAL_USE_DMA
+  SD1.dmarx = NULL;
+#endif
 #endif
 
 #if STM32_SERIAL_USE_USART2
   sdObjectInit(&SD2, NULL, notify2);
   SD2.usart = USART2;
+#if STM32_SERIAL_USART2_USE_DMA
+  SD2.dmarx = STM32_DMA_STREAM(STM32_SERIAL_USART2_RX_DMA_STREAM);
+  SD2.dmatx = STM32_DMA_STREAM(STM32_SERIAL_USART2_TX_DMA_STREAM);
+#elif STM32_SERIAL_USE_DMA
+  SD2.dmarx = NULL;
+#endif
 #endif
 
 #if STM32_SERIAL_USE_USART3
   sdObjectInit(&SD3, NULL, notify3);
   SD3.usart = USART3;
+#if STM32_SERIAL_USART3_USE_DMA
+  SD3.dmarx = STM32_DMA_STREAM(STM32_SERIAL_USART3_RX_DMA_STREAM);
+  SD3.dmatx = STM32_DMA_STREAM(STM32_SERIAL_USART3_TX_DMA_STREAM);
+#elif STM32_SERIAL_USE_DMA
+  SD3.dmarx = NULL;
+#endif
 #endif
 
 #if STM32_SERIAL_USE_UART4
@@ -407,6 +699,12 @@ void sd_lld_init(void) {
 #if STM32_SERIAL_USE_USART6
   sdObjectInit(&SD6, NULL, notify6);
   SD6.usart = USART6;
+#if STM32_SERIAL_USART6_USE_DMA
+  SD6.dmarx = STM32_DMA_STREAM(STM32_SERIAL_USART6_RX_DMA_STREAM);
+  SD6.dmatx = STM32_DMA_STREAM(STM32_SERIAL_USART6_TX_DMA_STREAM);
+#elif STM32_SERIAL_USE_DMA
+  SD6.dmarx = NULL;
+#endif
 #endif
 }
 
@@ -428,6 +726,30 @@ void sd_lld_start(SerialDriver *sdp, const SerialConfig *config) {
   if (sdp->state == SD_STOP) {
 #if STM32_SERIAL_USE_USART1
     if (&SD1 == sdp) {
+#if STM32_SERIAL_USART1_USE_DMA
+      bool_t b;
+      b = dmaStreamAllocate(sdp->dmarx,
+                            STM32_SERIAL_USART1_PRIORITY,
+                            (stm32_dmaisr_t)serve_rx_dma_interrupt,
+                            (void *)sdp);
+      chDbgAssert(!b, "sd_lld_start(), #1", "stream already allocated");
+      b = dmaStreamAllocate(sdp->dmatx,
+                            STM32_SERIAL_USART1_PRIORITY,
+                            (stm32_dmaisr_t)serve_tx_dma_interrupt,
+                            (void *)sdp);
+      chDbgAssert(!b, "sd_lld_start(), #2", "stream already allocated");
+      sdp->rxdmamode = STM32_DMA_CR_CHSEL(USART1_RX_DMA_CHANNEL) |
+                       STM32_DMA_CR_PL(STM32_SERIAL_USART1_DMA_PRIORITY) |
+                       STM32_DMA_CR_DIR_P2M | STM32_DMA_CR_MINC |
+                       STM32_DMA_CR_CIRC | STM32_DMA_CR_HTIE |
+                       STM32_DMA_CR_TCIE | STM32_DMA_CR_DMEIE |
+                       STM32_DMA_CR_TEIE;
+      sdp->txdmamode = STM32_DMA_CR_CHSEL(USART1_TX_DMA_CHANNEL) |
+                       STM32_DMA_CR_PL(STM32_SERIAL_USART1_DMA_PRIORITY) |
+                       STM32_DMA_CR_DIR_M2P | STM32_DMA_CR_MINC |
+                       STM32_DMA_CR_TCIE | STM32_DMA_CR_DMEIE |
+                       STM32_DMA_CR_TEIE;
+#endif
       rccEnableUSART1(FALSE);
       nvicEnableVector(STM32_USART1_NUMBER,
                        CORTEX_PRIORITY_MASK(STM32_SERIAL_USART1_PRIORITY));
@@ -435,6 +757,30 @@ void sd_lld_start(SerialDriver *sdp, const SerialConfig *config) {
 #endif
 #if STM32_SERIAL_USE_USART2
     if (&SD2 == sdp) {
+#if STM32_SERIAL_USART2_USE_DMA
+      bool_t b;
+      b = dmaStreamAllocate(sdp->dmarx,
+                            STM32_SERIAL_USART2_PRIORITY,
+                            (stm32_dmaisr_t)serve_rx_dma_interrupt,
+                            (void *)sdp);
+      chDbgAssert(!b, "sd_lld_start(), #3", "stream already allocated");
+      b = dmaStreamAllocate(sdp->dmatx,
+                            STM32_SERIAL_USART2_PRIORITY,
+                            (stm32_dmaisr_t)serve_tx_dma_interrupt,
+                            (void *)sdp);
+      chDbgAssert(!b, "sd_lld_start(), #4", "stream already allocated");
+      sdp->rxdmamode = STM32_DMA_CR_CHSEL(USART2_RX_DMA_CHANNEL) |
+                       STM32_DMA_CR_PL(STM32_SERIAL_USART2_DMA_PRIORITY) |
+                       STM32_DMA_CR_DIR_P2M | STM32_DMA_CR_MINC |
+                       STM32_DMA_CR_CIRC | STM32_DMA_CR_HTIE |
+                       STM32_DMA_CR_TCIE | STM32_DMA_CR_DMEIE |
+                       STM32_DMA_CR_TEIE;
+      sdp->txdmamode = STM32_DMA_CR_CHSEL(USART2_TX_DMA_CHANNEL) |
+                       STM32_DMA_CR_PL(STM32_SERIAL_USART2_DMA_PRIORITY) |
+                       STM32_DMA_CR_DIR_M2P | STM32_DMA_CR_MINC |
+                       STM32_DMA_CR_TCIE | STM32_DMA_CR_DMEIE |
+                       STM32_DMA_CR_TEIE;
+#endif
       rccEnableUSART2(FALSE);
       nvicEnableVector(STM32_USART2_NUMBER,
                        CORTEX_PRIORITY_MASK(STM32_SERIAL_USART2_PRIORITY));
@@ -442,6 +788,30 @@ void sd_lld_start(SerialDriver *sdp, const SerialConfig *config) {
 #endif
 #if STM32_SERIAL_USE_USART3
     if (&SD3 == sdp) {
+#if STM32_SERIAL_USART3_USE_DMA
+      bool_t b;
+      b = dmaStreamAllocate(sdp->dmarx,
+                            STM32_SERIAL_USART3_PRIORITY,
+                            (stm32_dmaisr_t)serve_rx_dma_interrupt,
+                            (void *)sdp);
+      chDbgAssert(!b, "sd_lld_start(), #5", "stream already allocated");
+      b = dmaStreamAllocate(sdp->dmatx,
+                            STM32_SERIAL_USART3_PRIORITY,
+                            (stm32_dmaisr_t)serve_tx_dma_interrupt,
+                            (void *)sdp);
+      chDbgAssert(!b, "sd_lld_start(), #6", "stream already allocated");
+      sdp->rxdmamode = STM32_DMA_CR_CHSEL(USART3_RX_DMA_CHANNEL) |
+                       STM32_DMA_CR_PL(STM32_SERIAL_USART3_DMA_PRIORITY) |
+                       STM32_DMA_CR_DIR_P2M | STM32_DMA_CR_MINC |
+                       STM32_DMA_CR_CIRC | STM32_DMA_CR_HTIE |
+                       STM32_DMA_CR_TCIE | STM32_DMA_CR_DMEIE |
+                       STM32_DMA_CR_TEIE;
+      sdp->txdmamode = STM32_DMA_CR_CHSEL(USART3_TX_DMA_CHANNEL) |
+                       STM32_DMA_CR_PL(STM32_SERIAL_USART3_DMA_PRIORITY) |
+                       STM32_DMA_CR_DIR_M2P | STM32_DMA_CR_MINC |
+                       STM32_DMA_CR_TCIE | STM32_DMA_CR_DMEIE |
+                       STM32_DMA_CR_TEIE;
+#endif
       rccEnableUSART3(FALSE);
       nvicEnableVector(STM32_USART3_NUMBER,
                        CORTEX_PRIORITY_MASK(STM32_SERIAL_USART3_PRIORITY));
@@ -463,6 +833,30 @@ void sd_lld_start(SerialDriver *sdp, const SerialConfig *config) {
 #endif
 #if STM32_SERIAL_USE_USART6
     if (&SD6 == sdp) {
+#if STM32_SERIAL_USART6_USE_DMA
+      bool_t b;
+      b = dmaStreamAllocate(sdp->dmarx,
+                            STM32_SERIAL_USART6_PRIORITY,
+                            (stm32_dmaisr_t)serve_rx_dma_interrupt,
+                            (void *)sdp);
+      chDbgAssert(!b, "sd_lld_start(), #7", "stream already allocated");
+      b = dmaStreamAllocate(sdp->dmatx,
+                            STM32_SERIAL_USART6_PRIORITY,
+                            (stm32_dmaisr_t)serve_tx_dma_interrupt,
+                            (void *)sdp);
+      chDbgAssert(!b, "sd_lld_start(), #8", "stream already allocated");
+      sdp->rxdmamode = STM32_DMA_CR_CHSEL(USART6_RX_DMA_CHANNEL) |
+                       STM32_DMA_CR_PL(STM32_SERIAL_USART6_DMA_PRIORITY) |
+                       STM32_DMA_CR_DIR_P2M | STM32_DMA_CR_MINC |
+                       STM32_DMA_CR_CIRC | STM32_DMA_CR_HTIE |
+                       STM32_DMA_CR_TCIE | STM32_DMA_CR_DMEIE |
+                       STM32_DMA_CR_TEIE;
+      sdp->txdmamode = STM32_DMA_CR_CHSEL(USART6_TX_DMA_CHANNEL) |
+                       STM32_DMA_CR_PL(STM32_SERIAL_USART6_DMA_PRIORITY) |
+                       STM32_DMA_CR_DIR_M2P | STM32_DMA_CR_MINC |
+                       STM32_DMA_CR_TCIE | STM32_DMA_CR_DMEIE |
+                       STM32_DMA_CR_TEIE;
+#endif
       rccEnableUSART6(FALSE);
       nvicEnableVector(STM32_USART6_NUMBER,
                        CORTEX_PRIORITY_MASK(STM32_SERIAL_USART6_PRIORITY));
@@ -485,6 +879,15 @@ void sd_lld_stop(SerialDriver *sdp) {
 
   if (sdp->state == SD_READY) {
     usart_deinit(sdp->usart);
+#if STM32_SERIAL_USE_DMA
+    if (sdp->dmarx != NULL) {
+      dmaStreamDisable(sdp->dmarx);
+      dmaStreamDisable(sdp->dmatx);
+      dmaStreamRelease(sdp->dmarx);
+      dmaStreamRelease(sdp->dmatx);
+      sdp->txdmacnt = 0;
+    }
+#endif
 #if STM32_SERIAL_USE_USART1
     if (&SD1 == sdp) {
       rccDisableUSART1(FALSE);
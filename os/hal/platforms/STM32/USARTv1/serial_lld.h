@@ -138,6 +138,172 @@
 #if !defined(STM32_SERIAL_USART6_PRIORITY) || defined(__DOXYGEN__)
 #define STM32_SERIAL_USART6_PRIORITY        12
 #endif
+
+/**
+ * @brief   USART1 DMA mode enable switch.
+ * @details If set to @p TRUE the USART1 receiver uses a circular DMA buffer
+ *          flushed into the input queue on idle line, half and full
+ *          transfer events, the transmitter sends directly from the
+ *          output queue ring using DMA.
+ * @note    The default is @p FALSE.
+ * @note    This option is only available on platforms with enhanced DMA.
+ */
+#if !defined(STM32_SERIAL_USART1_USE_DMA) || defined(__DOXYGEN__)
+#define STM32_SERIAL_USART1_USE_DMA         FALSE
+#endif
+
+/**
+ * @brief   USART2 DMA mode enable switch.
+ * @details If set to @p TRUE the USART2 receiver uses a circular DMA buffer
+ *          flushed into the input queue on idle line, half and full
+ *          transfer events, the transmitter sends directly from the
+ *          output queue ring using DMA.
+ * @note    The default is @p FALSE.
+ * @note    This option is only available on platforms with enhanced DMA.
+ */
+#if !defined(STM32_SERIAL_USART2_USE_DMA) || defined(__DOXYGEN__)
+#define STM32_SERIAL_USART2_USE_DMA         FALSE
+#endif
+
+/**
+ * @brief   USART3 DMA mode enable switch.
+ * @details If set to @p TRUE the USART3 receiver uses a circular DMA buffer
+ *          flushed into the input queue on idle line, half and full
+ *          transfer events, the transmitter sends directly from the
+ *          output queue ring using DMA.
+ * @note    The default is @p FALSE.
+ * @note    This option is only available on platforms with enhanced DMA.
+ */
+#if !defined(STM32_SERIAL_USART3_USE_DMA) || defined(__DOXYGEN__)
+#define STM32_SERIAL_USART3_USE_DMA         FALSE
+#endif
+
+/**
+ * @brief   USART6 DMA mode enable switch.
+ * @details If set to @p TRUE the USART6 receiver uses a circular DMA buffer
+ *          flushed into the input queue on idle line, half and full
+ *          transfer events, the transmitter sends directly from the
+ *          output queue ring using DMA.
+ * @note    The default is @p FALSE.
+ * @note    This option is only available on platforms with enhanced DMA.
+ */
+#if !defined(STM32_SERIAL_USART6_USE_DMA) || defined(__DOXYGEN__)
+#define STM32_SERIAL_USART6_USE_DMA         FALSE
+#endif
+
+/**
+ * @brief   Size of the circular DMA receive buffer.
+ * @details The buffer must be large enough to absorb the bytes received
+ *          during half of its length worth of interrupt latency.
+ */
+#if !defined(STM32_SERIAL_DMA_RX_BUFFER_SIZE) || defined(__DOXYGEN__)
+#define STM32_SERIAL_DMA_RX_BUFFER_SIZE     256
+#endif
+
+/**
+ * @brief   USART1 DMA priority (0..3|lowest..highest).
+ */
+#if !defined(STM32_SERIAL_USART1_DMA_PRIORITY) || defined(__DOXYGEN__)
+#define STM32_SERIAL_USART1_DMA_PRIORITY    0
+#endif
+
+/**
+ * @brief   USART2 DMA priority (0..3|lowest..highest).
+ */
+#if !defined(STM32_SERIAL_USART2_DMA_PRIORITY) || defined(__DOXYGEN__)
+#define STM32_SERIAL_USART2_DMA_PRIORITY    0
+#endif
+
+/**
+ * @brief   USART3 DMA priority (0..3|lowest..highest).
+ */
+#if !defined(STM32_SERIAL_USART3_DMA_PRIORITY) || defined(__DOXYGEN__)
+#define STM32_SERIAL_USART3_DMA_PRIORITY    0
+#endif
+
+/**
+ * @brief   USART6 DMA priority (0..3|lowest..highest).
+ */
+#if !defined(STM32_SERIAL_USART6_DMA_PRIORITY) || defined(__DOXYGEN__)
+#define STM32_SERIAL_USART6_DMA_PRIORITY    0
+#endif
+
+/**
+ * @brief   Serial DMA error hook.
+ * @note    The default action for DMA errors is a system halt because DMA
+ *          error can only happen because programming errors.
+ */
+#if !defined(STM32_SERIAL_DMA_ERROR_HOOK) || defined(__DOXYGEN__)
+#define STM32_SERIAL_DMA_ERROR_HOOK(sdp)    chSysHalt()
+#endif
+
+#if STM32_ADVANCED_DMA || defined(__DOXYGEN__)
+
+/**
+ * @brief   DMA stream used for USART1 RX operations.
+ * @note    This option is only available on platforms with enhanced DMA.
+ */
+#if !defined(STM32_SERIAL_USART1_RX_DMA_STREAM) || defined(__DOXYGEN__)
+#define STM32_SERIAL_USART1_RX_DMA_STREAM   STM32_DMA_STREAM_ID(2, 5)
+#endif
+
+/**
+ * @brief   DMA stream used for USART1 TX operations.
+ * @note    This option is only available on platforms with enhanced DMA.
+ */
+#if !defined(STM32_SERIAL_USART1_TX_DMA_STREAM) || defined(__DOXYGEN__)
+#define STM32_SERIAL_USART1_TX_DMA_STREAM   STM32_DMA_STREAM_ID(2, 7)
+#endif
+
+/**
+ * @brief   DMA stream used for USART2 RX operations.
+ * @note    This option is only available on platforms with enhanced DMA.
+ */
+#if !defined(STM32_SERIAL_USART2_RX_DMA_STREAM) || defined(__DOXYGEN__)
+#define STM32_SERIAL_USART2_RX_DMA_STREAM   STM32_DMA_STREAM_ID(1, 5)
+#endif
+
+/**
+ * @brief   DMA stream used for USART2 TX operations.
+ * @note    This option is only available on platforms with enhanced DMA.
+ */
+#if !defined(STM32_SERIAL_USART2_TX_DMA_STREAM) || defined(__DOXYGEN__)
+#define STM32_SERIAL_USART2_TX_DMA_STREAM   STM32_DMA_STREAM_ID(1, 6)
+#endif
+
+/**
+ * @brief   DMA stream used for USART3 RX operations.
+ * @note    This option is only available on platforms with enhanced DMA.
+ */
+#if !defined(STM32_SERIAL_USART3_RX_DMA_STREAM) || defined(__DOXYGEN__)
+#define STM32_SERIAL_USART3_RX_DMA_STREAM   STM32_DMA_STREAM_ID(1, 1)
+#endif
+
+/**
+ * @brief   DMA stream used for USART3 TX operations.
+ * @note    This option is only available on platforms with enhanced DMA.
+ */
+#if !defined(STM32_SERIAL_USART3_TX_DMA_STREAM) || defined(__DOXYGEN__)
+#define STM32_SERIAL_USART3_TX_DMA_STREAM   STM32_DMA_STREAM_ID(1, 3)
+#endif
+
+/**
+ * @brief   DMA stream used for USART6 RX operations.
+ * @note    This option is only available on platforms with enhanced DMA.
+ */
+#if !defined(STM32_SERIAL_USART6_RX_DMA_STREAM) || defined(__DOXYGEN__)
+#define STM32_SERIAL_USART6_RX_DMA_STREAM   STM32_DMA_STREAM_ID(2, 2)
+#endif
+
+/**
+ * @brief   DMA stream used for USART6 TX operations.
+ * @note    This option is only available on platforms with enhanced DMA.
+ */
+#if !defined(STM32_SERIAL_USART6_TX_DMA_STREAM) || defined(__DOXYGEN__)
+#define STM32_SERIAL_USART6_TX_DMA_STREAM   STM32_DMA_STREAM_ID(2, 7)
+#endif
+
+#endif /* STM32_ADVANCED_DMA */
 /** @} */
 
 /*===========================================================================*/
@@ -204,6 +370,64 @@
 #error "Invalid IRQ priority assigned to USART6"
 #endif
 
+#if (STM32_SERIAL_USART1_USE_DMA && !STM32_SERIAL_USE_USART1) ||           \
+    (STM32_SERIAL_USART2_USE_DMA && !STM32_SERIAL_USE_USART2) ||           \
+    (STM32_SERIAL_USART3_USE_DMA && !STM32_SERIAL_USE_USART3) ||           \
+    (STM32_SERIAL_USART6_USE_DMA && !STM32_SERIAL_USE_USART6)
+#error "SERIAL DMA mode enabled on an USART not assigned to the driver"
+#endif
+
+/**
+ * @brief   At least one USART operates in DMA mode.
+ */
+#define STM32_SERIAL_USE_DMA                                                \
+  (STM32_SERIAL_USART1_USE_DMA || STM32_SERIAL_USART2_USE_DMA ||            \
+   STM32_SERIAL_USART3_USE_DMA || STM32_SERIAL_USART6_USE_DMA)
+
+#if STM32_SERIAL_USE_DMA && !STM32_ADVANCED_DMA
+#error "SERIAL DMA mode requires an enhanced DMA controller"
+#endif
+
+#if STM32_SERIAL_USE_DMA && (STM32_SERIAL_DMA_RX_BUFFER_SIZE & 1)
+#error "STM32_SERIAL_DMA_RX_BUFFER_SIZE must be even"
+#endif
+
+#if STM32_SERIAL_USART1_USE_DMA &&                                          \
+    (!STM32_DMA_IS_VALID_ID(STM32_SERIAL_USART1_RX_DMA_STREAM,              \
+                            STM32_USART1_RX_DMA_MSK) ||                     \
+     !STM32_DMA_IS_VALID_ID(STM32_SERIAL_USART1_TX_DMA_STREAM,              \
+                            STM32_USART1_TX_DMA_MSK))
+#error "invalid DMA stream associated to USART1"
+#endif
+
+#if STM32_SERIAL_USART2_USE_DMA &&                                          \
+    (!STM32_DMA_IS_VALID_ID(STM32_SERIAL_USART2_RX_DMA_STREAM,              \
+                            STM32_USART2_RX_DMA_MSK) ||                     \
+     !STM32_DMA_IS_VALID_ID(STM32_SERIAL_USART2_TX_DMA_STREAM,              \
+                            STM32_USART2_TX_DMA_MSK))
+#error "invalid DMA stream associated to USART2"
+#endif
+
+#if STM32_SERIAL_USART3_USE_DMA &&                                          \
+    (!STM32_DMA_IS_VALID_ID(STM32_SERIAL_USART3_RX_DMA_STREAM,              \
+                            STM32_USART3_RX_DMA_MSK) ||                     \
+     !STM32_DMA_IS_VALID_ID(STM32_SERIAL_USART3_TX_DMA_STREAM,              \
+                            STM32_USART3_TX_DMA_MSK))
+#error "invalid DMA stream associated to USART3"
+#endif
+
+#if STM32_SERIAL_USART6_USE_DMA &&                                          \
+    (!STM32_DMA_IS_VALID_ID(STM32_SERIAL_USART6_RX_DMA_STREAM,              \
+                            STM32_USART6_RX_DMA_MSK) ||                     \
+     !STM32_DMA_IS_VALID_ID(STM32_SERIAL_USART6_TX_DMA_STREAM,              \
+                            STM32_USART6_TX_DMA_MSK))
+#error "invalid DMA stream associated to USART6"
+#endif
+
+#if STM32_SERIAL_USE_DMA && !defined(STM32_DMA_REQUIRED)
+#define STM32_DMA_REQUIRED
+#endif
+
 /*===========================================================================*/
 /* Driver data structures and types.                                         */
 /*===========================================================================*/
@@ -252,7 +476,32 @@ typedef struct {
   uint8_t                   ob[SERIAL_BUFFERS_SIZE];                        \
   /* End of the mandatory fields.*/                                         \
   /* Pointer to the USART registers block.*/                                \
-  USART_TypeDef             *usart;
+  USART_TypeDef             *usart;                                         \
+  _serial_driver_dma_data
+
+#if STM32_SERIAL_USE_DMA || defined(__DOXYGEN__)
+/**
+ * @brief   @p SerialDriver DMA mode specific data.
+ * @note    When @p dmarx is @p NULL the USART is interrupt driven.
+ */
+#define _serial_driver_dma_data                                             \
+  /* Receive DMA stream or @p NULL.*/                                       \
+  const stm32_dma_stream_t  *dmarx;                                         \
+  /* Transmit DMA stream.*/                                                 \
+  const stm32_dma_stream_t  *dmatx;                                         \
+  /* RX DMA mode bit mask.*/                                                \
+  uint32_t                  rxdmamode;                                      \
+  /* TX DMA mode bit mask.*/                                                \
+  uint32_t                  txdmamode;                                      \
+  /* Bytes of the output queue owned by the running TX DMA transfer.*/      \
+  size_t                    txdmacnt;                                       \
+  /* Next unread position in the circular receive buffer.*/                 \
+  size_t                    rxdmapos;                                       \
+  /* Circular receive buffer.*/                                             \
+  uint8_t                   rxdmabuf[STM32_SERIAL_DMA_RX_BUFFER_SIZE];
+#else
+#define _serial_driver_dma_data
+#endif
 
 /*===========================================================================*/
 /* Driver macros.                                                            */
@@ -77,6 +77,20 @@ static stm32_eth_tx_descriptor_t td[STM32_MAC_TRANSMIT_BUFFERS];
 static uint32_t rb[STM32_MAC_RECEIVE_BUFFERS][BUFFER_SIZE];
 static uint32_t tb[STM32_MAC_TRANSMIT_BUFFERS][BUFFER_SIZE];
 
+#if MAC_USE_ZERO_COPY || defined(__DOXYGEN__)
+/**
+ * @brief   Owner of each transmit descriptor used by a chain.
+ * @details @p NULL if the descriptor is free, the frame parameter on the
+ *          last descriptor of a chain, @p TX_CHAINED on the others.
+ */
+static void *txowner[STM32_MAC_TRANSMIT_BUFFERS];
+
+/**
+ * @brief   Marker of a descriptor used by a chain without parameter.
+ */
+#define TX_CHAINED ((void *)txowner)
+#endif
+
 /*===========================================================================*/
 /* Driver local functions.                                                   */
 /*===========================================================================*/
@@ -169,6 +183,39 @@ static void mac_lld_set_address(const uint8_t *p) {
   ETH->MACHTLR   = 0;
 }
 
+/**
+ * @brief   Checksum insertion control for an outgoing frame.
+ * @details The configured offload mode is used except for IPv4 fragments,
+ *          their payload checksum spans the whole datagram so only the
+ *          header checksum is inserted. Non-IP frames are ignored by the
+ *          checksum engine whatever the setting.
+ *
+ * @param[in] frame     pointer to the start of the frame
+ * @param[in] size      bytes available at @p frame
+ * @return              The @p TDES0 CIC field.
+ *
+ * @notapi
+ */
+static uint32_t mac_lld_get_cic(const uint8_t *frame, size_t size) {
+#if STM32_MAC_IP_CHECKSUM_OFFLOAD > 1
+  const uint8_t *p = frame + 12;
+
+  /* Skipping a VLAN tag, if present.*/
+  if ((size >= 18) && (p[0] == 0x81) && (p[1] == 0x00))
+    p += 4;
+
+  /* IPv4 frame with the MF flag set or a fragment offset.*/
+  if (((size_t)(p - frame) + 2 + 20 <= size) &&
+      (p[0] == 0x08) && (p[1] == 0x00) && (((p[8] & 0x3F) | p[9]) != 0))
+    return STM32_TDES0_CIC(1);
+#else
+  (void)frame;
+  (void)size;
+#endif
+
+  return STM32_TDES0_CIC(STM32_MAC_IP_CHECKSUM_OFFLOAD);
+}
+
 /*===========================================================================*/
 /* Driver interrupt handlers.                                                */
 /*===========================================================================*/
@@ -292,11 +339,18 @@ void mac_lld_start(MACDriver *macp) {
   unsigned i;
 
   /* Resets the state of all descriptors.*/
-  for (i = 0; i < STM32_MAC_RECEIVE_BUFFERS; i++)
+  for (i = 0; i < STM32_MAC_RECEIVE_BUFFERS; i++) {
     rd[i].rdes0 = STM32_RDES0_OWN;
+    rd[i].rdes1 &= ~STM32_RDES1_LOCKED;
+  }
   macp->rxptr = (stm32_eth_rx_descriptor_t *)rd;
-  for (i = 0; i < STM32_MAC_TRANSMIT_BUFFERS; i++)
+  for (i = 0; i < STM32_MAC_TRANSMIT_BUFFERS; i++) {
     td[i].tdes0 = STM32_TDES0_TCH;
+    td[i].tdes2 = (uint32_t)tb[i];
+#if MAC_USE_ZERO_COPY
+    txowner[i]  = NULL;
+#endif
+  }
   macp->txptr = (stm32_eth_tx_descriptor_t *)td;
 
   /* MAC clocks activation and commanded reset procedure.*/
@@ -412,7 +466,12 @@ msg_t mac_lld_get_transmit_descriptor(MACDriver *macp,
 
   /* Ensure that descriptor isn't owned by the Ethernet DMA or locked by
      another thread.*/
-  if (tdes->tdes0 & (STM32_TDES0_OWN | STM32_TDES0_LOCKED)) {
+  if ((tdes->tdes0 & (STM32_TDES0_OWN | STM32_TDES0_LOCKED))
+#if MAC_USE_ZERO_COPY
+      /* Not yet reclaimed after a chain transmission.*/
+      || (txowner[tdes - td] != NULL)
+#endif
+      ) {
     chSysUnlock();
     return RDY_TIMEOUT;
   }
@@ -451,7 +510,8 @@ void mac_lld_release_transmit_descriptor(MACTransmitDescriptor *tdp) {
 
   /* Unlocks the descriptor and returns it to the DMA engine.*/
   tdp->physdesc->tdes1 = tdp->offset;
-  tdp->physdesc->tdes0 = STM32_TDES0_CIC(STM32_MAC_IP_CHECKSUM_OFFLOAD) |
+  tdp->physdesc->tdes0 = mac_lld_get_cic((const uint8_t *)tdp->physdesc->tdes2,
+                                         tdp->offset) |
                          STM32_TDES0_IC | STM32_TDES0_LS | STM32_TDES0_FS |
                          STM32_TDES0_TCH | STM32_TDES0_OWN;
 
@@ -485,18 +545,24 @@ msg_t mac_lld_get_receive_descriptor(MACDriver *macp,
   rdes = macp->rxptr;
 
   /* Iterates through received frames until a valid one is found, invalid
-     frames are discarded.*/
-  while (!(rdes->rdes0 & STM32_RDES0_OWN)) {
+     frames are discarded. The scan stops on a descriptor still held by
+     the upper layer, the ring wrapped around while the frame was in use.*/
+  while (!(rdes->rdes0 & STM32_RDES0_OWN) &&
+         !(rdes->rdes1 & STM32_RDES1_LOCKED)) {
     if (!(rdes->rdes0 & (STM32_RDES0_AFM | STM32_RDES0_ES))
 #if STM32_MAC_IP_CHECKSUM_OFFLOAD
-        && (rdes->rdes0 & STM32_RDES0_FT)
-        && !(rdes->rdes0 & (STM32_RDES0_IPHCE | STM32_RDES0_PCE))
+        /* Only IP frames with a failed header or payload check are
+           dropped, non-IP frames and frames whose payload check was
+           bypassed (IP fragments) are passed up.*/
+        && !((rdes->rdes0 & STM32_RDES0_FT) &&
+             (rdes->rdes0 & (STM32_RDES0_IPHCE | STM32_RDES0_PCE)))
 #endif
         && (rdes->rdes0 & STM32_RDES0_FS) && (rdes->rdes0 & STM32_RDES0_LS)) {
       /* Found a valid one.*/
       rdp->offset   = 0;
       rdp->size     = ((rdes->rdes0 & STM32_RDES0_FL_MASK) >> 16) - 4;
       rdp->physdesc = rdes;
+      rdes->rdes1  |= STM32_RDES1_LOCKED;
       macp->rxptr   = (stm32_eth_rx_descriptor_t *)rdes->rdes3;
 
       chSysUnlock();
@@ -532,6 +598,7 @@ void mac_lld_release_receive_descriptor(MACReceiveDescriptor *rdp) {
   chSysLock();
 
   /* Give buffer back to the Ethernet DMA.*/
+  rdp->physdesc->rdes1 &= ~STM32_RDES1_LOCKED;
   rdp->physdesc->rdes0 = STM32_RDES0_OWN;
 
   /* If the DMA engine is stalled then a restart request is issued.*/
@@ -736,6 +803,162 @@ const uint8_t *mac_lld_get_next_receive_buffer(MACReceiveDescriptor *rdp,
   *sizep = 0;
   return NULL;
 }
+
+/**
+ * @brief   Locks a chain of transmit descriptors.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ * @param[out] tcp      pointer to a @p MACTransmitChain structure
+ * @param[in] n         number of descriptors
+ * @return              The operation status.
+ * @retval RDY_OK       the descriptors have been obtained.
+ * @retval RDY_TIMEOUT  descriptors not available.
+ *
+ * @notapi
+ */
+msg_t mac_lld_get_transmit_chain(MACDriver *macp,
+                                 MACTransmitChain *tcp, unsigned n) {
+  stm32_eth_tx_descriptor_t *tdes;
+  unsigned i;
+
+  if (!macp->link_up)
+    return RDY_TIMEOUT;
+
+  chSysLock();
+
+  /* All the descriptors must be free and reclaimed.*/
+  tdes = macp->txptr;
+  for (i = 0; i < n; i++) {
+    if ((tdes->tdes0 & (STM32_TDES0_OWN | STM32_TDES0_LOCKED)) ||
+        (txowner[tdes - td] != NULL)) {
+      chSysUnlock();
+      return RDY_TIMEOUT;
+    }
+    tdes = (stm32_eth_tx_descriptor_t *)tdes->tdes3;
+  }
+
+  tcp->first = tcp->next = macp->txptr;
+  tcp->n     = n;
+  for (i = 0; i < n; i++) {
+    macp->txptr->tdes0 |= STM32_TDES0_LOCKED;
+    macp->txptr = (stm32_eth_tx_descriptor_t *)macp->txptr->tdes3;
+  }
+
+  chSysUnlock();
+  return RDY_OK;
+}
+
+/**
+ * @brief   Appends a segment to a transmit chain.
+ * @details The descriptor points directly to the segment data, segments
+ *          not reachable by the Ethernet DMA are copied into the
+ *          descriptor buffer instead.
+ *
+ * @param[in] tcp       pointer to a @p MACTransmitChain structure
+ * @param[in] buf       pointer to the segment data
+ * @param[in] size      segment size
+ *
+ * @notapi
+ */
+void mac_lld_add_transmit_segment(MACTransmitChain *tcp,
+                                  const uint8_t *buf, size_t size) {
+  stm32_eth_tx_descriptor_t *tdes;
+
+  chDbgAssert(size <= STM32_MAC_BUFFERS_SIZE,
+              "mac_lld_add_transmit_segment(), #1", "segment too large");
+
+  tdes = tcp->next;
+  if (STM32_MAC_IS_DMA_REACHABLE(buf))
+    tdes->tdes2 = (uint32_t)buf;
+  else {
+    memcpy(tb[tdes - td], buf, size);
+    tdes->tdes2 = (uint32_t)tb[tdes - td];
+  }
+  tdes->tdes1 = size;
+  tcp->next   = (stm32_eth_tx_descriptor_t *)tdes->tdes3;
+  tcp->n--;
+}
+
+/**
+ * @brief   Starts the transmission of a chain as a single frame.
+ * @details The descriptors are handed to the DMA from the last to the
+ *          first so that the DMA never sees a partial frame.
+ *
+ * @param[in] tcp       pointer to a @p MACTransmitChain structure
+ * @param[in] param     parameter passed to the reclaim callback once the
+ *                      frame has been transmitted or @p NULL
+ *
+ * @notapi
+ */
+void mac_lld_release_transmit_chain(MACTransmitChain *tcp, void *param) {
+  stm32_eth_tx_descriptor_t *tdes, *last;
+  uint32_t ls;
+
+  chSysLock();
+
+  /* Finding the last descriptor, it carries the frame parameter.*/
+  last = tcp->first;
+  while ((stm32_eth_tx_descriptor_t *)last->tdes3 != tcp->next)
+    last = (stm32_eth_tx_descriptor_t *)last->tdes3;
+  txowner[last - td] = param != NULL ? param : TX_CHAINED;
+
+  /* Following descriptors, if any.*/
+  tdes = tcp->first;
+  while (tdes != last) {
+    tdes = (stm32_eth_tx_descriptor_t *)tdes->tdes3;
+    if (tdes != last)
+      txowner[tdes - td] = TX_CHAINED;
+    tdes->tdes0 = STM32_TDES0_TCH | STM32_TDES0_OWN |
+                  (tdes == last ? STM32_TDES0_IC | STM32_TDES0_LS : 0);
+  }
+
+  /* First descriptor last.*/
+  ls = tcp->first == last ? STM32_TDES0_IC | STM32_TDES0_LS : 0;
+  if (tcp->first != last)
+    txowner[tcp->first - td] = TX_CHAINED;
+  tcp->first->tdes0 = mac_lld_get_cic((const uint8_t *)tcp->first->tdes2,
+                                      tcp->first->tdes1) | ls |
+                      STM32_TDES0_FS | STM32_TDES0_TCH | STM32_TDES0_OWN;
+
+  /* If the DMA engine is stalled then a restart request is issued.*/
+  if ((ETH->DMASR & ETH_DMASR_TPS) == ETH_DMASR_TPS_Suspended) {
+    ETH->DMASR   = ETH_DMASR_TBUS;
+    ETH->DMATPDR = ETH_DMASR_TBUS; /* Any value is OK.*/
+  }
+
+  chSysUnlock();
+}
+
+/**
+ * @brief   Reclaims the transmit descriptors completed by the DMA.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ * @param[in] cb        reclaim callback or @p NULL
+ *
+ * @notapi
+ */
+void mac_lld_reclaim_transmit_chains(MACDriver *macp, mactxreclaimcb_t cb) {
+  unsigned i;
+
+  (void)macp;
+
+  for (i = 0; i < STM32_MAC_TRANSMIT_BUFFERS; i++) {
+    void *owner;
+
+    chSysLock();
+    owner = txowner[i];
+    if ((owner == NULL) || (td[i].tdes0 & STM32_TDES0_OWN)) {
+      chSysUnlock();
+      continue;
+    }
+    txowner[i]  = NULL;
+    td[i].tdes2 = (uint32_t)tb[i];
+    chSysUnlock();
+
+    if ((owner != TX_CHAINED) && (cb != NULL))
+      cb(owner);
+  }
+}
 #endif /* MAC_USE_ZERO_COPY */
 
 #endif /* HAL_USE_MAC */
@@ -73,6 +73,7 @@
 #define STM32_RDES1_RBS2_MASK       0x1FFF0000
 #define STM32_RDES1_RER             0x00008000
 #define STM32_RDES1_RCH             0x00004000
+#define STM32_RDES1_LOCKED          0x00002000 /* NOTE: Pseudo flag.        */
 #define STM32_RDES1_RBS1_MASK       0x00001FFF
 /** @} */
 
@@ -185,6 +186,10 @@
  *              insertion are enabled, and pseudo-header checksum is
  *              calculated in hardware.
  *          .
+ * @note    Any non-zero value also enables the verification of incoming
+ *          IP, TCP, UDP and ICMP checksums, frames failing it are dropped.
+ * @note    The lwIP bindings derive the @p CHECKSUM_xxx options from this
+ *          setting, mode 2 is not supported there.
  */
 #if !defined(STM32_MAC_IP_CHECKSUM_OFFLOAD) || defined(__DOXYGEN__)
 #define STM32_MAC_IP_CHECKSUM_OFFLOAD       0
@@ -195,10 +200,27 @@
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
 
+#if (STM32_MAC_IP_CHECKSUM_OFFLOAD < 0) || (STM32_MAC_IP_CHECKSUM_OFFLOAD > 3)
+#error "invalid STM32_MAC_IP_CHECKSUM_OFFLOAD value"
+#endif
+
 #if (STM32_MAC_PHY_TIMEOUT > 0) && !HAL_IMPLEMENTS_COUNTERS
 #error "STM32_MAC_PHY_TIMEOUT requires the realtime counter service"
 #endif
 
+/**
+ * @brief   Maximum number of segments in a transmit chain.
+ */
+#define MAC_TRANSMIT_CHAIN_MAX      STM32_MAC_TRANSMIT_BUFFERS
+
+/**
+ * @brief   Checks if an address is reachable by the Ethernet DMA.
+ * @note    Only the SRAM region is considered, the CCM RAM is not
+ *          reachable and flash constants are bounced for safety.
+ */
+#define STM32_MAC_IS_DMA_REACHABLE(p)                                       \
+  (((uint32_t)(p) & 0xF0000000) == 0x20000000)
+
 /*===========================================================================*/
 /* Driver data structures and types.                                         */
 /*===========================================================================*/
@@ -315,6 +337,35 @@ typedef struct {
   stm32_eth_rx_descriptor_t *physdesc;
 } MACReceiveDescriptor;
 
+#if MAC_USE_ZERO_COPY || defined(__DOXYGEN__)
+/**
+ * @brief   Transmit chain reclaim callback type.
+ *
+ * @param[in] param     the parameter passed to @p macReleaseTransmitChain()
+ */
+typedef void (*mactxreclaimcb_t)(void *param);
+
+/**
+ * @brief   Structure representing a chain of transmit descriptors.
+ * @details Each segment of the frame is transmitted directly from the
+ *          caller memory using its own descriptor.
+ */
+typedef struct {
+  /**
+   * @brief First descriptor of the frame.
+   */
+  stm32_eth_tx_descriptor_t *first;
+  /**
+   * @brief Next descriptor to be filled.
+   */
+  stm32_eth_tx_descriptor_t *next;
+  /**
+   * @brief Number of descriptors still to be filled.
+   */
+  unsigned                  n;
+} MACTransmitChain;
+#endif /* MAC_USE_ZERO_COPY */
+
 /*===========================================================================*/
 /* Driver macros.                                                            */
 /*===========================================================================*/
@@ -352,6 +403,13 @@ extern "C" {
                                             size_t *sizep);
   const uint8_t *mac_lld_get_next_receive_buffer(MACReceiveDescriptor *rdp,
                                                  size_t *sizep);
+  msg_t mac_lld_get_transmit_chain(MACDriver *macp,
+                                   MACTransmitChain *tcp, unsigned n);
+  void mac_lld_add_transmit_segment(MACTransmitChain *tcp,
+                                    const uint8_t *buf, size_t size);
+  void mac_lld_release_transmit_chain(MACTransmitChain *tcp, void *param);
+  void mac_lld_reclaim_transmit_chains(MACDriver *macp,
+                                       mactxreclaimcb_t cb);
 #endif /* MAC_USE_ZERO_COPY */
 #ifdef __cplusplus
 }
@@ -26,10 +26,6 @@
  * @{
  */
 
-/*
- TODO: Try preerase blocks before writing (ACMD23).
- */
-
 #include <string.h>
 
 #include "ch.h"
@@ -131,6 +127,20 @@ static bool_t sdc_lld_prepare_write(SDCDriver *sdcp, uint32_t startblk,
     startblk *= MMCSD_BLOCK_SIZE;
 
   if (n > 1) {
+#if STM32_SDC_SDIO_PREERASE
+    /* Pre-erase hint (ACMD23), SD cards can erase the whole range in
+       advance instead of one erase unit at a time while programming.*/
+    if ((sdcp->cardmode & SDC_MODE_CARDTYPE_MASK) != SDC_MODE_CARDTYPE_MMC) {
+      if (sdc_lld_send_cmd_short_crc(sdcp, MMCSD_CMD_APP_CMD,
+                                     sdcp->rca, resp) ||
+          MMCSD_R1_ERROR(resp[0]))
+        return CH_FAILED;
+      if (sdc_lld_send_cmd_short_crc(sdcp, MMCSD_CMD_SET_WR_ERASE_COUNT,
+                                     n, resp) || MMCSD_R1_ERROR(resp[0]))
+        return CH_FAILED;
+    }
+#endif /* STM32_SDC_SDIO_PREERASE */
+
     /* Write multiple blocks command.*/
     if (sdc_lld_send_cmd_short_crc(sdcp, MMCSD_CMD_WRITE_MULTIPLE_BLOCK,
                                    startblk, resp) || MMCSD_R1_ERROR(resp[0]))
@@ -299,7 +309,8 @@ CH_IRQ_HANDLER(STM32_SDIO_HANDLER) {
 
   if (SDCD1.thread != NULL) {
     chSchReadyI(SDCD1.thread);
-    SDCD1.thread = NULL;  }
+    SDCD1.thread = NULL;
+  }
 
   chSysUnlockFromIsr();
 
@@ -97,6 +97,17 @@
 #define STM32_SDC_SDIO_UNALIGNED_SUPPORT    TRUE
 #endif
 
+/**
+ * @brief   Pre-erase hint on multiple blocks writes.
+ * @details If enabled the number of blocks is announced to SD cards using
+ *          ACMD23 before each multiple blocks write, this allows the card
+ *          to erase the whole range at once and speeds up sequential
+ *          writes on most cards.
+ */
+#if !defined(STM32_SDC_SDIO_PREERASE) || defined(__DOXYGEN__)
+#define STM32_SDC_SDIO_PREERASE             TRUE
+#endif
+
 #if STM32_ADVANCED_DMA || defined(__DOXYGEN__)
 
 /**
@@ -265,6 +276,28 @@ struct SDCDriver {
 #if CH_DBG_ENABLE_ASSERTS
   SDIO_TypeDef              *sdio;
 #endif
+#if SDC_USE_ASYNC || defined(__DOXYGEN__)
+  /**
+   * @brief     Asynchronous jobs queue head, the job being served.
+   */
+  sdc_job_t                 *jhead;
+  /**
+   * @brief     Asynchronous jobs queue tail.
+   */
+  sdc_job_t                 *jtail;
+  /**
+   * @brief     Jobs thread, @p NULL before the first @p sdcStart().
+   */
+  Thread                    *jthd;
+  /**
+   * @brief     Jobs thread waiting for a job, @p NULL if busy.
+   */
+  Thread                    *jwait;
+  /**
+   * @brief     Jobs thread working area.
+   */
+  WORKING_AREA(wa_jobs, SDC_ASYNC_THREAD_STACK_SIZE);
+#endif /* SDC_USE_ASYNC */
 };
 
 /*===========================================================================*/
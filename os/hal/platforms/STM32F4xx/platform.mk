@@ -13,6 +13,7 @@ PLATFORMSRC = ${CHIBIOS}/os/hal/platforms/STM32F4xx/stm32_dma.c \
               ${CHIBIOS}/os/hal/platforms/STM32/GPIOv2/pal_lld.c \
  			  ${CHIBIOS}/os/hal/platforms/STM32/I2Cv1/i2c_lld.c \
               ${CHIBIOS}/os/hal/platforms/STM32/OTGv1/usb_lld.c \
+              ${CHIBIOS}/os/hal/platforms/STM32/OTGv1/stm32_otg_fifo.c \
               ${CHIBIOS}/os/hal/platforms/STM32/RTCv2/rtc_lld.c \
               ${CHIBIOS}/os/hal/platforms/STM32/SPIv1/spi_lld.c \
               ${CHIBIOS}/os/hal/platforms/STM32/USARTv1/serial_lld.c \
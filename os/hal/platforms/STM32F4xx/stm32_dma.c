@@ -33,6 +33,8 @@
  * @{
  */
 
+#include <string.h>
+
 #include "ch.h"
 #include "hal.h"
 
@@ -64,6 +66,11 @@
  */
 #define STM32_DMA_FCR_RESET_VALUE   0x00000021
 
+/**
+ * @brief   Maximum number of data items in a single transfer.
+ */
+#define STM32_DMA_MAX_TRANSFER      0xFFFF
+
 /*===========================================================================*/
 /* Driver exported variables.                                                */
 /*===========================================================================*/
@@ -116,10 +123,118 @@ static uint32_t dma_streams_mask;
  */
 static dma_isr_redir_t dma_isr_redir[STM32_DMA_STREAMS];
 
+#if STM32_DMA_USE_MEMCPY || defined(__DOXYGEN__)
+/**
+ * @brief   Memory copy jobs queue, the head job is the running one.
+ */
+static stm32_dma_memcpy_job_t *memcpy_head, *memcpy_tail;
+
+/**
+ * @brief   Bytes covered by the running memory copy transfer.
+ */
+static size_t memcpy_chunk;
+#endif
+
 /*===========================================================================*/
 /* Driver local functions.                                                   */
 /*===========================================================================*/
 
+#if STM32_DMA_USE_MEMCPY || defined(__DOXYGEN__)
+/**
+ * @brief   Completes a memory copy job.
+ * @details The callback is invoked and the waiting thread, if any, is
+ *          readied.
+ *
+ * @param[in] jp        pointer to the completed job
+ */
+static void dma_memcpy_complete_i(stm32_dma_memcpy_job_t *jp) {
+  Thread *tp = jp->thread;
+
+  jp->thread = NULL;
+  jp->done = TRUE;
+  if (jp->cb != NULL)
+    jp->cb(jp);
+  if (tp != NULL)
+    chSchReadyI(tp)->p_u.rdymsg = RDY_OK;
+}
+
+/**
+ * @brief   Programs the next transfer of a memory copy job.
+ * @details Word transfers are used when both addresses are word aligned,
+ *          the FIFO packs the data so the bus sees full words.
+ *
+ * @param[in] jp        pointer to the job at the queue head
+ */
+static void dma_memcpy_start_chunk_i(stm32_dma_memcpy_job_t *jp) {
+  const stm32_dma_stream_t *dmastp = STM32_DMA_STREAM(STM32_DMA_MEMCPY_STREAM);
+  uint32_t mode = STM32_DMA_CR_PL(STM32_DMA_MEMCPY_DMA_PRIORITY) |
+                  STM32_DMA_CR_TCIE | STM32_DMA_CR_TEIE | STM32_DMA_CR_DMEIE;
+  size_t n = jp->n;
+  size_t items;
+
+  if (((((uint32_t)jp->src) | ((uint32_t)jp->dst)) & 3) == 0) {
+    n &= ~(size_t)3;
+    if (n > STM32_DMA_MAX_TRANSFER * 4)
+      n = STM32_DMA_MAX_TRANSFER * 4;
+    items = n / 4;
+    mode |= STM32_DMA_CR_PSIZE_WORD | STM32_DMA_CR_MSIZE_WORD;
+  }
+  else {
+    if (n > STM32_DMA_MAX_TRANSFER)
+      n = STM32_DMA_MAX_TRANSFER;
+    items = n;
+  }
+  memcpy_chunk = n;
+
+  dmaStreamSetFIFO(dmastp, STM32_DMA_FCR_DMDIS | STM32_DMA_FCR_FTH_FULL);
+  dmaStartMemCopy(dmastp, mode, jp->src, jp->dst, items);
+}
+
+/**
+ * @brief   Memory copy stream service routine.
+ *
+ * @param[in] p         not used
+ * @param[in] flags     pre-shifted content of the ISR register
+ */
+static void dma_memcpy_serve_interrupt(void *p, uint32_t flags) {
+  stm32_dma_memcpy_job_t *jp;
+
+  (void)p;
+
+  if ((flags & (STM32_DMA_ISR_TEIF | STM32_DMA_ISR_DMEIF)) != 0) {
+    STM32_DMA_MEMCPY_ERROR_HOOK();
+  }
+  if ((flags & STM32_DMA_ISR_TCIF) == 0)
+    return;
+
+  chSysLockFromIsr();
+  dmaStreamDisable(STM32_DMA_STREAM(STM32_DMA_MEMCPY_STREAM));
+  jp = memcpy_head;
+  jp->src += memcpy_chunk;
+  jp->dst += memcpy_chunk;
+  jp->n -= memcpy_chunk;
+
+  /* A short tail, left by word transfers or by the transfer size limit,
+     is cheaper to copy here than to program another transfer.*/
+  if ((jp->n > 0) && (jp->n < STM32_DMA_MEMCPY_THRESHOLD)) {
+    memcpy(jp->dst, jp->src, jp->n);
+    jp->n = 0;
+  }
+
+  if (jp->n > 0)
+    dma_memcpy_start_chunk_i(jp);
+  else {
+    memcpy_head = jp->next;
+    if (memcpy_head == NULL)
+      memcpy_tail = NULL;
+    else
+      dma_memcpy_start_chunk_i(memcpy_head);
+    dma_memcpy_complete_i(jp);
+  }
+  chSysUnlockFromIsr();
+}
+#endif /* STM32_DMA_USE_MEMCPY */
+
 /*===========================================================================*/
 /* Driver interrupt handlers.                                                */
 /*===========================================================================*/
@@ -433,6 +548,19 @@ void dmaInit(void) {
   DMA1->HIFCR = 0xFFFFFFFF;
   DMA2->LIFCR = 0xFFFFFFFF;
   DMA2->HIFCR = 0xFFFFFFFF;
+
+#if STM32_DMA_USE_MEMCPY
+  {
+    bool_t b;
+
+    memcpy_head = memcpy_tail = NULL;
+    b = dmaStreamAllocate(STM32_DMA_STREAM(STM32_DMA_MEMCPY_STREAM),
+                          STM32_DMA_MEMCPY_IRQ_PRIORITY,
+                          dma_memcpy_serve_interrupt,
+                          NULL);
+    chDbgAssert(!b, "dmaInit(), #1", "stream already allocated");
+  }
+#endif
 }
 
 /**
@@ -527,6 +655,137 @@ void dmaStreamRelease(const stm32_dma_stream_t *dmastp) {
     rccDisableDMA2(FALSE);
 }
 
+#if STM32_DMA_USE_MEMCPY || defined(__DOXYGEN__)
+/**
+ * @brief   Starts an asynchronous memory copy.
+ * @details The job is queued behind the pending ones on the reserved DMA2
+ *          stream, copies shorter than @p STM32_DMA_MEMCPY_THRESHOLD are
+ *          performed immediately by the CPU.
+ * @note    The areas must not overlap and must not be in the CCM RAM.
+ * @note    The source and destination must not be touched until the job
+ *          completes.
+ *
+ * @param[out] jp       pointer to the job storage, owned by the service
+ *                      until completion
+ * @param[out] dst      destination address
+ * @param[in] src       source address
+ * @param[in] n         number of bytes to copy
+ * @param[in] cb        completion callback or @p NULL
+ * @param[in] param     parameter stored into the job for the callback
+ *
+ * @iclass
+ */
+void dmaMemcpyStartI(stm32_dma_memcpy_job_t *jp, void *dst,
+                     const void *src, size_t n,
+                     stm32_dmacpycb_t cb, void *param) {
+
+  chDbgCheckClassI();
+  chDbgCheck((jp != NULL) && ((n == 0) || ((dst != NULL) && (src != NULL))),
+             "dmaMemcpyStartI");
+
+  jp->next   = NULL;
+  jp->src    = src;
+  jp->dst    = dst;
+  jp->n      = n;
+  jp->cb     = cb;
+  jp->param  = param;
+  jp->thread = NULL;
+  jp->done   = FALSE;
+
+  if (n < STM32_DMA_MEMCPY_THRESHOLD) {
+    memcpy(dst, src, n);
+    jp->n = 0;
+    dma_memcpy_complete_i(jp);
+    return;
+  }
+
+  chDbgAssert(!STM32_DMA_IS_CCM(dst) && !STM32_DMA_IS_CCM(src),
+              "dmaMemcpyStartI(), #1", "CCM RAM not reachable by DMA");
+
+  if (memcpy_tail == NULL) {
+    memcpy_head = memcpy_tail = jp;
+    dma_memcpy_start_chunk_i(jp);
+  }
+  else {
+    memcpy_tail->next = jp;
+    memcpy_tail = jp;
+  }
+}
+
+/**
+ * @brief   Starts an asynchronous memory copy.
+ * @details See @p dmaMemcpyStartI().
+ *
+ * @param[out] jp       pointer to the job storage, owned by the service
+ *                      until completion
+ * @param[out] dst      destination address
+ * @param[in] src       source address
+ * @param[in] n         number of bytes to copy
+ * @param[in] cb        completion callback or @p NULL
+ * @param[in] param     parameter stored into the job for the callback
+ *
+ * @api
+ */
+void dmaMemcpyStart(stm32_dma_memcpy_job_t *jp, void *dst,
+                    const void *src, size_t n,
+                    stm32_dmacpycb_t cb, void *param) {
+
+  chSysLock();
+  dmaMemcpyStartI(jp, dst, src, n, cb, param);
+  chSchRescheduleS();
+  chSysUnlock();
+}
+
+/**
+ * @brief   Waits for a memory copy job to complete.
+ * @note    Only one thread can wait on a job.
+ *
+ * @param[in] jp        pointer to a job started with @p dmaMemcpyStart()
+ *
+ * @api
+ */
+void dmaMemcpyWait(stm32_dma_memcpy_job_t *jp) {
+
+  chDbgCheck(jp != NULL, "dmaMemcpyWait");
+
+  chSysLock();
+  chDbgAssert(jp->thread == NULL, "dmaMemcpyWait(), #1", "already waited");
+  if (!jp->done) {
+    jp->thread = chThdSelf();
+    chSchGoSleepS(THD_STATE_SUSPENDED);
+  }
+  chSysUnlock();
+}
+
+/**
+ * @brief   Synchronous memory copy.
+ * @details Copies above the threshold are performed by the DMA while the
+ *          calling thread sleeps, other threads run meanwhile.
+ *
+ * @param[out] dst      destination address
+ * @param[in] src       source address
+ * @param[in] n         number of bytes to copy
+ *
+ * @api
+ */
+void dmaMemcpy(void *dst, const void *src, size_t n) {
+  stm32_dma_memcpy_job_t job;
+
+  if (n < STM32_DMA_MEMCPY_THRESHOLD) {
+    memcpy(dst, src, n);
+    return;
+  }
+
+  chSysLock();
+  dmaMemcpyStartI(&job, dst, src, n, NULL, NULL);
+  if (!job.done) {
+    job.thread = chThdSelf();
+    chSchGoSleepS(THD_STATE_SUSPENDED);
+  }
+  chSysUnlock();
+}
+#endif /* STM32_DMA_USE_MEMCPY */
+
 #endif /* STM32_DMA_REQUIRED */
 
 /** @} */
@@ -208,10 +208,86 @@
 /* Driver pre-compile time settings.                                         */
 /*===========================================================================*/
 
+/**
+ * @name    Configuration options
+ * @{
+ */
+/**
+ * @brief   Memory to memory copy service enable switch.
+ * @details If set to @p TRUE a DMA2 stream is reserved at initialization
+ *          and used to serve the @p dmaMemcpy() job queue.
+ * @note    The default is @p FALSE.
+ */
+#if !defined(STM32_DMA_USE_MEMCPY) || defined(__DOXYGEN__)
+#define STM32_DMA_USE_MEMCPY                FALSE
+#endif
+
+/**
+ * @brief   DMA stream reserved for the memory to memory copy service.
+ * @note    Only DMA2 streams can perform memory to memory transfers.
+ */
+#if !defined(STM32_DMA_MEMCPY_STREAM) || defined(__DOXYGEN__)
+#define STM32_DMA_MEMCPY_STREAM             STM32_DMA_STREAM_ID(2, 1)
+#endif
+
+/**
+ * @brief   Memory to memory copy service interrupt priority level setting.
+ */
+#if !defined(STM32_DMA_MEMCPY_IRQ_PRIORITY) || defined(__DOXYGEN__)
+#define STM32_DMA_MEMCPY_IRQ_PRIORITY       12
+#endif
+
+/**
+ * @brief   Memory to memory copy service DMA priority (0..3|lowest..highest).
+ * @note    The lowest priority is the default so that peripheral streams
+ *          are not delayed by bulk copies.
+ */
+#if !defined(STM32_DMA_MEMCPY_DMA_PRIORITY) || defined(__DOXYGEN__)
+#define STM32_DMA_MEMCPY_DMA_PRIORITY       0
+#endif
+
+/**
+ * @brief   Copy size below which the CPU copies instead of the DMA.
+ * @details Setting up a transfer and serving its interrupt costs more than
+ *          a CPU copy of a few tens of bytes.
+ */
+#if !defined(STM32_DMA_MEMCPY_THRESHOLD) || defined(__DOXYGEN__)
+#define STM32_DMA_MEMCPY_THRESHOLD          64
+#endif
+
+/**
+ * @brief   Memory to memory copy service DMA error hook.
+ * @note    The default action for DMA errors is a system halt because DMA
+ *          error can only happen because programming errors.
+ */
+#if !defined(STM32_DMA_MEMCPY_ERROR_HOOK) || defined(__DOXYGEN__)
+#define STM32_DMA_MEMCPY_ERROR_HOOK()       chSysHalt()
+#endif
+/** @} */
+
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
 
+#if STM32_DMA_USE_MEMCPY
+#if (STM32_DMA_MEMCPY_STREAM < STM32_DMA_STREAM_ID(2, 0)) ||                \
+    (STM32_DMA_MEMCPY_STREAM > STM32_DMA_STREAM_ID(2, 7))
+#error "memory to memory transfers require a DMA2 stream"
+#endif
+
+#if !CORTEX_IS_VALID_KERNEL_PRIORITY(STM32_DMA_MEMCPY_IRQ_PRIORITY)
+#error "Invalid IRQ priority assigned to the memory copy service"
+#endif
+
+#if !STM32_DMA_IS_VALID_PRIORITY(STM32_DMA_MEMCPY_DMA_PRIORITY)
+#error "Invalid DMA priority assigned to the memory copy service"
+#endif
+
+#if !defined(STM32_DMA_REQUIRED)
+#define STM32_DMA_REQUIRED
+#endif
+#endif /* STM32_DMA_USE_MEMCPY */
+
 /*===========================================================================*/
 /* Driver data structures and types.                                         */
 /*===========================================================================*/
@@ -237,10 +313,70 @@ typedef struct {
  */
 typedef void (*stm32_dmaisr_t)(void *p, uint32_t flags);
 
+#if STM32_DMA_USE_MEMCPY || defined(__DOXYGEN__)
+/**
+ * @brief   Type of a memory copy job.
+ */
+typedef struct stm32_dma_memcpy_job stm32_dma_memcpy_job_t;
+
+/**
+ * @brief   Memory copy job completion callback type.
+ * @note    The callback is invoked from ISR context, or from within the
+ *          caller locked zone for copies served by the CPU, only I-class
+ *          functions can be used.
+ *
+ * @param[in] jp        pointer to the completed job
+ */
+typedef void (*stm32_dmacpycb_t)(stm32_dma_memcpy_job_t *jp);
+
+/**
+ * @brief   Memory copy job structure.
+ * @details The job is owned by the service from @p dmaMemcpyStartI() to
+ *          its completion, the caller provides the storage.
+ */
+struct stm32_dma_memcpy_job {
+  /** @brief Next job in the queue.*/
+  stm32_dma_memcpy_job_t    *next;
+  /** @brief Source of the next chunk.*/
+  const uint8_t             *src;
+  /** @brief Destination of the next chunk.*/
+  uint8_t                   *dst;
+  /** @brief Bytes still to be copied.*/
+  size_t                    n;
+  /** @brief Completion callback or @p NULL.*/
+  stm32_dmacpycb_t          cb;
+  /** @brief Callback parameter.*/
+  void                      *param;
+  /** @brief Thread waiting for the job or @p NULL.*/
+  Thread                    *thread;
+  /** @brief Job completed flag.*/
+  volatile bool_t           done;
+};
+#endif /* STM32_DMA_USE_MEMCPY */
+
 /*===========================================================================*/
 /* Driver macros.                                                            */
 /*===========================================================================*/
 
+/**
+ * @brief   Evaluates to @p TRUE if the address is in the CCM data RAM.
+ * @note    The CCM RAM is only connected to the core D-bus, the DMA cannot
+ *          reach it.
+ */
+#define STM32_DMA_IS_CCM(p)                                                 \
+  (((uint32_t)(p) & 0xFFFF0000) == 0x10000000)
+
+#if STM32_DMA_USE_MEMCPY || defined(__DOXYGEN__)
+/**
+ * @brief   Returns @p TRUE if the memory copy job has completed.
+ *
+ * @param[in] jp        pointer to a @p stm32_dma_memcpy_job_t structure
+ *
+ * @iclass
+ */
+#define dmaMemcpyIsDoneI(jp) ((jp)->done)
+#endif
+
 /**
  * @name    Macro Functions
  * @{
@@ -272,6 +408,8 @@ typedef void (*stm32_dmaisr_t)(void *p, uint32_t flags);
  * @special
  */
 #define dmaStreamSetMemory0(dmastp, addr) {                                 \
+  chDbgAssert(!STM32_DMA_IS_CCM(addr), "dmaStreamSetMemory0(), #1",         \
+              "CCM not reachable by DMA");                                  \
   (dmastp)->stream->M0AR  = (uint32_t)(addr);                               \
 }
 
@@ -285,6 +423,8 @@ typedef void (*stm32_dmaisr_t)(void *p, uint32_t flags);
  * @special
  */
 #define dmaStreamSetMemory1(dmastp, addr) {                                 \
+  chDbgAssert(!STM32_DMA_IS_CCM(addr), "dmaStreamSetMemory1(), #1",         \
+              "CCM not reachable by DMA");                                  \
   (dmastp)->stream->M1AR  = (uint32_t)(addr);                               \
 }
 
@@ -452,6 +592,16 @@ extern "C" {
                            stm32_dmaisr_t func,
                            void *param);
   void dmaStreamRelease(const stm32_dma_stream_t *dmastp);
+#if STM32_DMA_USE_MEMCPY
+  void dmaMemcpyStartI(stm32_dma_memcpy_job_t *jp, void *dst,
+                       const void *src, size_t n,
+                       stm32_dmacpycb_t cb, void *param);
+  void dmaMemcpyStart(stm32_dma_memcpy_job_t *jp, void *dst,
+                      const void *src, size_t n,
+                      stm32_dmacpycb_t cb, void *param);
+  void dmaMemcpyWait(stm32_dma_memcpy_job_t *jp);
+  void dmaMemcpy(void *dst, const void *src, size_t n);
+#endif
 #ifdef __cplusplus
 }
 #endif
@@ -131,6 +131,7 @@ void i2cStop(I2CDriver *i2cp) {
   chSysLock();
   i2c_lld_stop(i2cp);
   i2cp->state = I2C_STOP;
+  chSchRescheduleS();
   chSysUnlock();
 }
 
@@ -267,6 +267,118 @@ bool_t macPollLinkStatus(MACDriver *macp) {
   return mac_lld_poll_link_status(macp);
 }
 
+#if MAC_USE_ZERO_COPY || defined(__DOXYGEN__)
+/**
+ * @brief   Allocates a chain of transmit descriptors.
+ * @details The transmit descriptors completed by the DMA are reclaimed
+ *          before each allocation attempt. If the descriptors are not
+ *          available then the invoking thread is queued until a frame
+ *          is transmitted.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ * @param[out] tcp      pointer to a @p MACTransmitChain structure
+ * @param[in] n         number of segments, from 1 to
+ *                      @p MAC_TRANSMIT_CHAIN_MAX
+ * @param[in] cb        reclaim callback or @p NULL
+ * @param[in] time      the number of ticks before the operation timeouts,
+ *                      the following special values are allowed:
+ *                      - @a TIME_IMMEDIATE immediate timeout.
+ *                      - @a TIME_INFINITE no timeout.
+ *                      .
+ * @return              The operation status.
+ * @retval RDY_OK       the descriptors were obtained.
+ * @retval RDY_TIMEOUT  the operation timed out, chain not initialized.
+ *
+ * @api
+ */
+msg_t macWaitTransmitChain(MACDriver *macp, MACTransmitChain *tcp,
+                           unsigned n, mactxreclaimcb_t cb,
+                           systime_t time) {
+  msg_t msg;
+  systime_t now;
+
+  chDbgCheck((macp != NULL) && (tcp != NULL) &&
+             (n > 0) && (n <= MAC_TRANSMIT_CHAIN_MAX),
+             "macWaitTransmitChain");
+  chDbgAssert(macp->state == MAC_ACTIVE, "macWaitTransmitChain(), #1",
+              "not active");
+
+  while (TRUE) {
+    mac_lld_reclaim_transmit_chains(macp, cb);
+    if (((msg = mac_lld_get_transmit_chain(macp, tcp, n)) == RDY_OK) ||
+        (time == 0))
+      break;
+    chSysLock();
+    now = chTimeNow();
+    if ((msg = chSemWaitTimeoutS(&macp->tdsem, time)) == RDY_TIMEOUT) {
+      chSysUnlock();
+      break;
+    }
+    if (time != TIME_INFINITE)
+      time -= (chTimeNow() - now);
+    chSysUnlock();
+  }
+  return msg;
+}
+
+/**
+ * @brief   Appends a segment to a transmit chain.
+ * @note    The segment memory must not be modified until the chain has
+ *          been reclaimed.
+ *
+ * @param[in] tcp       pointer to a @p MACTransmitChain structure
+ * @param[in] buf       pointer to the segment data
+ * @param[in] size      segment size
+ *
+ * @api
+ */
+void macAddTransmitSegment(MACTransmitChain *tcp,
+                           const uint8_t *buf, size_t size) {
+
+  chDbgCheck((tcp != NULL) && (buf != NULL) && (size > 0),
+             "macAddTransmitSegment");
+  chDbgAssert(tcp->n > 0, "macAddTransmitSegment(), #1", "chain full");
+
+  mac_lld_add_transmit_segment(tcp, buf, size);
+}
+
+/**
+ * @brief   Starts the transmission of a chain as a single frame.
+ *
+ * @param[in] tcp       pointer to a @p MACTransmitChain structure
+ * @param[in] param     parameter passed to the reclaim callback once the
+ *                      frame has been transmitted or @p NULL
+ *
+ * @api
+ */
+void macReleaseTransmitChain(MACTransmitChain *tcp, void *param) {
+
+  chDbgCheck(tcp != NULL, "macReleaseTransmitChain");
+  chDbgAssert(tcp->n == 0, "macReleaseTransmitChain(), #1",
+              "segments missing");
+
+  mac_lld_release_transmit_chain(tcp, param);
+}
+
+/**
+ * @brief   Reclaims the transmit chains completed by the DMA.
+ * @details The callback is invoked once for each transmitted chain
+ *          released with a parameter, the segment memory can then be
+ *          freed by the caller.
+ *
+ * @param[in] macp      pointer to the @p MACDriver object
+ * @param[in] cb        reclaim callback or @p NULL
+ *
+ * @api
+ */
+void macReclaimTransmitChains(MACDriver *macp, mactxreclaimcb_t cb) {
+
+  chDbgCheck(macp != NULL, "macReclaimTransmitChains");
+
+  mac_lld_reclaim_transmit_chains(macp, cb);
+}
+#endif /* MAC_USE_ZERO_COPY */
+
 #endif /* HAL_USE_MAC */
 
 /** @} */
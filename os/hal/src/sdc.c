@@ -100,6 +100,111 @@ bool_t _sdc_wait_for_transfer_state(SDCDriver *sdcp) {
   return CH_FAILED;
 }
 
+#if SDC_USE_ASYNC || defined(__DOXYGEN__)
+/**
+ * @brief   Completes an asynchronous job.
+ * @details The callback is invoked and the waiting thread, if any, is
+ *          readied.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ * @param[in] jp        pointer to the completed job
+ * @param[in] result    operation status
+ */
+static void sdc_job_complete_i(SDCDriver *sdcp, sdc_job_t *jp,
+                               bool_t result) {
+  Thread *tp = jp->thread;
+
+  jp->thread = NULL;
+  jp->result = result;
+  jp->done = TRUE;
+  if (jp->cb != NULL)
+    jp->cb(sdcp, jp);
+  if (tp != NULL)
+    chSchReadyI(tp)->p_u.rdymsg = RDY_OK;
+}
+
+/**
+ * @brief   Queues an asynchronous job.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ * @param[out] jp       pointer to the job storage
+ * @param[in] startblk  first block to transfer
+ * @param[in] buf       pointer to the data buffer
+ * @param[in] n         number of blocks to transfer
+ * @param[in] write     @p TRUE for a write job
+ * @param[in] cb        completion callback or @p NULL
+ * @param[in] param     parameter stored into the job for the callback
+ */
+static void sdc_start_job_i(SDCDriver *sdcp, sdc_job_t *jp,
+                            uint32_t startblk, uint8_t *buf, uint32_t n,
+                            bool_t write, sdccallback_t cb, void *param) {
+
+  jp->next     = NULL;
+  jp->startblk = startblk;
+  jp->buf      = buf;
+  jp->n        = n;
+  jp->write    = write;
+  jp->cb       = cb;
+  jp->param    = param;
+  jp->thread   = NULL;
+  jp->result   = CH_FAILED;
+  jp->done     = FALSE;
+
+  if (sdcp->jtail == NULL)
+    sdcp->jhead = sdcp->jtail = jp;
+  else {
+    sdcp->jtail->next = jp;
+    sdcp->jtail = jp;
+  }
+
+  /* Wakes up the jobs thread if idle.*/
+  if (sdcp->jwait != NULL) {
+    chSchReadyI(sdcp->jwait);
+    sdcp->jwait = NULL;
+  }
+}
+
+/**
+ * @brief   Jobs thread.
+ * @details Serves the queued jobs in order, the thread sleeps on the SDIO
+ *          completion interrupt during each transfer and starts the next
+ *          job as soon as the previous one has been completed.
+ *
+ * @param[in] arg       pointer to the @p SDCDriver object
+ */
+static msg_t sdc_jobs_thread(void *arg) {
+  SDCDriver *sdcp = (SDCDriver *)arg;
+  sdc_job_t *jp;
+  bool_t result;
+
+  chRegSetThreadName("sdc_jobs");
+  while (TRUE) {
+    chSysLock();
+    while ((jp = sdcp->jhead) == NULL) {
+      sdcp->jwait = chThdSelf();
+      chSchGoSleepS(THD_STATE_SUSPENDED);
+    }
+    chSysUnlock();
+
+    if (sdcp->state != BLK_READY)
+      result = CH_FAILED;
+    else if (jp->write)
+      result = sdcWrite(sdcp, jp->startblk, jp->buf, jp->n);
+    else
+      result = sdcRead(sdcp, jp->startblk, jp->buf, jp->n);
+
+    chSysLock();
+    sdcp->jhead = jp->next;
+    if (sdcp->jhead == NULL)
+      sdcp->jtail = NULL;
+    sdc_job_complete_i(sdcp, jp, result);
+    chSchRescheduleS();
+    chSysUnlock();
+  }
+  return 0;
+}
+#endif /* SDC_USE_ASYNC */
+
 /*===========================================================================*/
 /* Driver exported functions.                                                */
 /*===========================================================================*/
@@ -130,6 +235,12 @@ void sdcObjectInit(SDCDriver *sdcp) {
   sdcp->errors   = SDC_NO_ERROR;
   sdcp->config   = NULL;
   sdcp->capacity = 0;
+#if SDC_USE_ASYNC
+  sdcp->jhead    = NULL;
+  sdcp->jtail    = NULL;
+  sdcp->jthd     = NULL;
+  sdcp->jwait    = NULL;
+#endif
 }
 
 /**
@@ -152,6 +263,15 @@ void sdcStart(SDCDriver *sdcp, const SDCConfig *config) {
   sdcp->config = config;
   sdc_lld_start(sdcp);
   sdcp->state = BLK_ACTIVE;
+#if SDC_USE_ASYNC
+  /* The jobs thread is created on first activation and kept afterward.*/
+  if (sdcp->jthd == NULL) {
+    sdcp->jthd = chThdCreateI(sdcp->wa_jobs, sizeof(sdcp->wa_jobs),
+                              SDC_ASYNC_THREAD_PRIORITY,
+                              sdc_jobs_thread, sdcp);
+    chSchWakeupS(sdcp->jthd, RDY_OK);
+  }
+#endif
   chSysUnlock();
 }
 
@@ -169,6 +289,9 @@ void sdcStop(SDCDriver *sdcp) {
   chSysLock();
   chDbgAssert((sdcp->state == BLK_STOP) || (sdcp->state == BLK_ACTIVE),
               "sdcStop(), #1", "invalid state");
+#if SDC_USE_ASYNC
+  chDbgAssert(sdcp->jhead == NULL, "sdcStop(), #2", "jobs pending");
+#endif
   sdc_lld_stop(sdcp);
   sdcp->state = BLK_STOP;
   chSysUnlock();
@@ -554,6 +677,148 @@ bool_t sdcErase(SDCDriver *sdcp, uint32_t startblk, uint32_t endblk) {
   return CH_SUCCESS;
 }
 
+#if SDC_USE_ASYNC || defined(__DOXYGEN__)
+/**
+ * @brief   Starts an asynchronous read.
+ * @details The job is queued and served by the driver jobs thread after
+ *          the previously queued jobs.
+ * @note    The synchronous API must not be used while jobs are pending.
+ * @pre     The driver must have been started, the job fails if the
+ *          driver is not in the @p BLK_READY state when it is served.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ * @param[out] jp       pointer to the job storage, owned by the driver
+ *                      until completion
+ * @param[in] startblk  first block to read
+ * @param[out] buf      pointer to the read buffer
+ * @param[in] n         number of blocks to read
+ * @param[in] cb        completion callback or @p NULL
+ * @param[in] param     parameter stored into the job for the callback
+ *
+ * @iclass
+ */
+void sdcStartReadI(SDCDriver *sdcp, sdc_job_t *jp, uint32_t startblk,
+                   uint8_t *buf, uint32_t n,
+                   sdccallback_t cb, void *param) {
+
+  chDbgCheckClassI();
+  chDbgCheck((sdcp != NULL) && (jp != NULL) && (buf != NULL) && (n > 0),
+             "sdcStartReadI");
+  chDbgAssert(sdcp->jthd != NULL, "sdcStartReadI(), #1", "not started");
+
+  sdc_start_job_i(sdcp, jp, startblk, buf, n, FALSE, cb, param);
+}
+
+/**
+ * @brief   Starts an asynchronous read.
+ * @details See @p sdcStartReadI().
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ * @param[out] jp       pointer to the job storage, owned by the driver
+ *                      until completion
+ * @param[in] startblk  first block to read
+ * @param[out] buf      pointer to the read buffer
+ * @param[in] n         number of blocks to read
+ * @param[in] cb        completion callback or @p NULL
+ * @param[in] param     parameter stored into the job for the callback
+ *
+ * @api
+ */
+void sdcStartRead(SDCDriver *sdcp, sdc_job_t *jp, uint32_t startblk,
+                  uint8_t *buf, uint32_t n,
+                  sdccallback_t cb, void *param) {
+
+  chSysLock();
+  sdcStartReadI(sdcp, jp, startblk, buf, n, cb, param);
+  chSchRescheduleS();
+  chSysUnlock();
+}
+
+/**
+ * @brief   Starts an asynchronous write.
+ * @details The job is queued and served by the driver jobs thread after
+ *          the previously queued jobs.
+ * @note    The synchronous API must not be used while jobs are pending.
+ * @pre     The driver must have been started, the job fails if the
+ *          driver is not in the @p BLK_READY state when it is served.
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ * @param[out] jp       pointer to the job storage, owned by the driver
+ *                      until completion
+ * @param[in] startblk  first block to write
+ * @param[in] buf       pointer to the write buffer, it must not be
+ *                      modified until completion
+ * @param[in] n         number of blocks to write
+ * @param[in] cb        completion callback or @p NULL
+ * @param[in] param     parameter stored into the job for the callback
+ *
+ * @iclass
+ */
+void sdcStartWriteI(SDCDriver *sdcp, sdc_job_t *jp, uint32_t startblk,
+                    const uint8_t *buf, uint32_t n,
+                    sdccallback_t cb, void *param) {
+
+  chDbgCheckClassI();
+  chDbgCheck((sdcp != NULL) && (jp != NULL) && (buf != NULL) && (n > 0),
+             "sdcStartWriteI");
+  chDbgAssert(sdcp->jthd != NULL, "sdcStartWriteI(), #1", "not started");
+
+  sdc_start_job_i(sdcp, jp, startblk, (uint8_t *)buf, n, TRUE, cb, param);
+}
+
+/**
+ * @brief   Starts an asynchronous write.
+ * @details See @p sdcStartWriteI().
+ *
+ * @param[in] sdcp      pointer to the @p SDCDriver object
+ * @param[out] jp       pointer to the job storage, owned by the driver
+ *                      until completion
+ * @param[in] startblk  first block to write
+ * @param[in] buf       pointer to the write buffer, it must not be
+ *                      modified until completion
+ * @param[in] n         number of blocks to write
+ * @param[in] cb        completion callback or @p NULL
+ * @param[in] param     parameter stored into the job for the callback
+ *
+ * @api
+ */
+void sdcStartWrite(SDCDriver *sdcp, sdc_job_t *jp, uint32_t startblk,
+                   const uint8_t *buf, uint32_t n,
+                   sdccallback_t cb, void *param) {
+
+  chSysLock();
+  sdcStartWriteI(sdcp, jp, startblk, buf, n, cb, param);
+  chSchRescheduleS();
+  chSysUnlock();
+}
+
+/**
+ * @brief   Waits for an asynchronous job to complete.
+ * @note    Only one thread can wait on a job.
+ *
+ * @param[in] jp        pointer to a started job
+ *
+ * @return              The operation status.
+ * @retval CH_SUCCESS   operation succeeded.
+ * @retval CH_FAILED    operation failed.
+ *
+ * @api
+ */
+bool_t sdcWaitJob(sdc_job_t *jp) {
+
+  chDbgCheck(jp != NULL, "sdcWaitJob");
+
+  chSysLock();
+  chDbgAssert(jp->thread == NULL, "sdcWaitJob(), #1", "already waited");
+  if (!jp->done) {
+    jp->thread = chThdSelf();
+    chSchGoSleepS(THD_STATE_SUSPENDED);
+  }
+  chSysUnlock();
+  return jp->result;
+}
+#endif /* SDC_USE_ASYNC */
+
 #endif /* HAL_USE_SDC */
 
 /** @} */
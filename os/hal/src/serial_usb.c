@@ -138,6 +138,38 @@ static void inotify(GenericQueue *qp) {
   }
 }
 
+#if SERIAL_USB_TX_COALESCE || defined(__DOXYGEN__)
+/**
+ * @brief   Starts a transmission of all the queued data.
+ * @note    @p usbPrepareQueuedTransmit() only programs the endpoint so it
+ *          is invoked within the critical zone, this makes the function
+ *          usable from both the timer callback and thread context.
+ */
+static void tx_flush_i(SerialUSBDriver *sdup) {
+  USBDriver *usbp = sdup->config->usbp;
+  size_t n;
+
+  if (chVTIsArmedI(&sdup->txvt))
+    chVTResetI(&sdup->txvt);
+  if ((usbGetDriverStateI(usbp) == USB_ACTIVE) &&
+      !usbGetTransmitStatusI(usbp, USB_CDC_DATA_REQUEST_EP) &&
+      ((n = chOQGetFullI(&sdup->oqueue)) > 0)) {
+    usbPrepareQueuedTransmit(usbp, USB_CDC_DATA_REQUEST_EP, &sdup->oqueue, n);
+    usbStartTransmitI(usbp, USB_CDC_DATA_REQUEST_EP);
+  }
+}
+
+/**
+ * @brief   Short packet flush timer callback.
+ */
+static void txflush(void *p) {
+
+  chSysLockFromIsr();
+  tx_flush_i((SerialUSBDriver *)p);
+  chSysUnlockFromIsr();
+}
+#endif /* SERIAL_USB_TX_COALESCE */
+
 /**
  * @brief   Notification of data inserted into the output queue.
  */
@@ -154,6 +186,16 @@ static void onotify(GenericQueue *qp) {
      data then a new transaction is started.*/
   if (!usbGetTransmitStatusI(sdup->config->usbp, USB_CDC_DATA_REQUEST_EP) &&
       ((n = chOQGetFullI(&sdup->oqueue)) > 0)) {
+#if SERIAL_USB_TX_COALESCE
+    /* Less than a packet, waiting for more data or for the flush timer.*/
+    if (n < sdup->config->usbp->epc[USB_CDC_DATA_REQUEST_EP]->in_maxsize) {
+      if (!chVTIsArmedI(&sdup->txvt))
+        chVTSetI(&sdup->txvt, US2ST(SERIAL_USB_TX_FLUSH_US), txflush, sdup);
+      return;
+    }
+    if (chVTIsArmedI(&sdup->txvt))
+      chVTResetI(&sdup->txvt);
+#endif
     chSysUnlock();
 
     usbPrepareQueuedTransmit(sdup->config->usbp,
@@ -195,6 +237,7 @@ void sduObjectInit(SerialUSBDriver *sdup) {
   sdup->state = SDU_STOP;
   chIQInit(&sdup->iqueue, sdup->ib, SERIAL_USB_BUFFERS_SIZE, inotify, sdup);
   chOQInit(&sdup->oqueue, sdup->ob, SERIAL_USB_BUFFERS_SIZE, onotify, sdup);
+  sdup->txvt.vt_func = NULL;
 }
 
 /**
@@ -236,10 +279,46 @@ void sduStop(SerialUSBDriver *sdup) {
   chDbgAssert((sdup->state == SDU_STOP) || (sdup->state == SDU_READY),
               "sduStop(), #1",
               "invalid state");
+  if (chVTIsArmedI(&sdup->txvt))
+    chVTResetI(&sdup->txvt);
   sdup->state = SDU_STOP;
   chSysUnlock();
 }
 
+#if SERIAL_USB_TX_COALESCE || defined(__DOXYGEN__)
+/**
+ * @brief   Sends the data held in the output queue.
+ * @details In coalescing mode a transmission is started immediately for
+ *          the queued data, without waiting for the flush timer.
+ *
+ * @param[in] sdup      pointer to a @p SerialUSBDriver object
+ *
+ * @iclass
+ */
+void sduFlushI(SerialUSBDriver *sdup) {
+
+  chDbgCheckClassI();
+  chDbgCheck(sdup != NULL, "sduFlushI");
+
+  tx_flush_i(sdup);
+}
+
+/**
+ * @brief   Sends the data held in the output queue.
+ * @details See @p sduFlushI().
+ *
+ * @param[in] sdup      pointer to a @p SerialUSBDriver object
+ *
+ * @api
+ */
+void sduFlush(SerialUSBDriver *sdup) {
+
+  chSysLock();
+  sduFlushI(sdup);
+  chSysUnlock();
+}
+#endif /* SERIAL_USB_TX_COALESCE */
+
 /**
  * @brief   USB device configured handler.
  *
@@ -313,6 +392,15 @@ void sduDataTransmitted(USBDriver *usbp, usbep_t ep) {
   chSysLockFromIsr();
   chnAddFlagsI(sdup, CHN_OUTPUT_EMPTY);
 
+#if SERIAL_USB_TX_COALESCE
+  if (((n = chOQGetFullI(&sdup->oqueue)) > 0) &&
+      (n < usbp->epc[ep]->in_maxsize)) {
+    /* Less than a packet, waiting for more data or for the flush timer.*/
+    if (!chVTIsArmedI(&sdup->txvt))
+      chVTSetI(&sdup->txvt, US2ST(SERIAL_USB_TX_FLUSH_US), txflush, sdup);
+  }
+  else
+#endif
   if ((n = chOQGetFullI(&sdup->oqueue)) > 0) {
     /* The endpoint cannot be busy, we are in the context of the callback,
        so it is safe to transmit without a check.*/
@@ -238,12 +238,15 @@ void usbInit(void) {
  * @init
  */
 void usbObjectInit(USBDriver *usbp) {
+  unsigned i;
 
   usbp->state        = USB_STOP;
   usbp->config       = NULL;
   usbp->param        = NULL;
   usbp->transmitting = 0;
   usbp->receiving    = 0;
+  for (i = 0; i <= USB_MAX_ENDPOINTS; i++)
+    usbp->epparam[i] = NULL;
 }
 
 /**
@@ -168,6 +168,13 @@ struct USBDriver {
    *          application-defined handler to the USB driver.
    */
   void                          *param;
+  /**
+   * @brief   Per-endpoint user fields.
+   * @details Used to route the endpoint callbacks to the upper layer driver
+   *          owning the endpoint when several drivers share the same
+   *          @p USBDriver, see @p usbSetEndpointParamI().
+   */
+  void                          *epparam[USB_MAX_ENDPOINTS + 1];
   /**
    * @brief   Bit map of the transmitting IN endpoints.
    */
@@ -35,15 +35,43 @@ typedef funcp_t * funcpp_t;
 
 /*
  * Area fill code, it is a macro because here functions cannot be called
- * until stacks are initialized.
+ * until stacks are initialized. Four words are written per iteration so
+ * that the compiler can use multiple store instructions.
  */
 #define fill32(start, end, filler) {                                        \
   uint32_t *p1 = start;                                                     \
   uint32_t *p2 = end;                                                       \
+  while (p2 - p1 >= 4) {                                                    \
+    p1[0] = filler;                                                         \
+    p1[1] = filler;                                                         \
+    p1[2] = filler;                                                         \
+    p1[3] = filler;                                                         \
+    p1 += 4;                                                                \
+  }                                                                         \
   while (p1 < p2)                                                           \
     *p1++ = filler;                                                         \
 }
 
+/*
+ * Area copy code, four words per iteration as above.
+ */
+#define copy32(start, end, src) {                                           \
+  uint32_t *p1 = start;                                                     \
+  uint32_t *p2 = end;                                                       \
+  uint32_t *ps = src;                                                       \
+  while (p2 - p1 >= 4) {                                                    \
+    uint32_t w0 = ps[0], w1 = ps[1], w2 = ps[2], w3 = ps[3];                \
+    p1[0] = w0;                                                             \
+    p1[1] = w1;                                                             \
+    p1[2] = w2;                                                             \
+    p1[3] = w3;                                                             \
+    p1 += 4;                                                                \
+    ps += 4;                                                                \
+  }                                                                         \
+  while (p1 < p2)                                                           \
+    *p1++ = *ps++;                                                          \
+}
+
 /*===========================================================================*/
 /**
  * @name    Startup settings
@@ -290,14 +318,7 @@ void ResetHandler(void) {
 
 #if CRT0_INIT_DATA
   /* DATA segment initialization.*/
-  {
-    uint32_t *tp, *dp;
-
-    tp = &_textdata;
-    dp = &_data;
-    while (dp < &_edata)
-      *dp++ = *tp++;
-  }
+  copy32(&_data, &_edata, &_textdata);
 #endif
 
 #if CRT0_INIT_BSS
@@ -0,0 +1,487 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    blk_cache.c
+ * @brief   Block devices cache code.
+ * @details LRU cache of 512 bytes blocks organized in lines. Small
+ *          requests are served from the lines, misses on a sequential
+ *          stream fill the line up to its end (read-ahead), writes are held
+ *          in the lines and contiguous dirty blocks are written back with
+ *          a single multi-block command. Requests covering whole uncached
+ *          lines bypass the cache.
+ *
+ * @addtogroup BLK_CACHE
+ * @{
+ */
+
+#include <string.h>
+
+#include "ch.h"
+#include "hal.h"
+
+#include "blk_cache.h"
+
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+#define LINE_MASK       (BLK_CACHE_LINE_BLOCKS - 1)
+
+#define line_data(lp, off)                                                  \
+  ((uint8_t *)(lp)->buf + (off) * BLK_CACHE_BLOCK_SIZE)
+
+/*===========================================================================*/
+/* Driver exported variables.                                                */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local variables.                                                   */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
+/**
+ * @brief   Mask of @p cnt blocks starting at @p off within a line.
+ */
+static uint32_t blocks_mask(unsigned off, unsigned cnt) {
+
+  if (cnt >= 32)
+    return 0xFFFFFFFF;
+  return ((1U << cnt) - 1) << off;
+}
+
+/**
+ * @brief   Number of blocks in a mask.
+ */
+static unsigned count_blocks(uint32_t mask) {
+  unsigned n = 0;
+
+  while (mask != 0) {
+    mask &= mask - 1;
+    n++;
+  }
+  return n;
+}
+
+static blk_cache_line_t *find_line(BlockCacheDriver *bcp, uint32_t lineblk) {
+  unsigned i;
+
+  for (i = 0; i < BLK_CACHE_NUM_LINES; i++)
+    if ((bcp->lines[i].valid != 0) && (bcp->lines[i].blk == lineblk))
+      return &bcp->lines[i];
+  return NULL;
+}
+
+/**
+ * @brief   Writes the dirty blocks of a line.
+ * @details Each run of contiguous dirty blocks is written with one command.
+ */
+static bool_t line_write_back(BlockCacheDriver *bcp, blk_cache_line_t *lp) {
+  unsigned off = 0;
+
+  while (lp->dirty != 0) {
+    unsigned run = 0;
+
+    while (!(lp->dirty & (1U << off)))
+      off++;
+    while ((off + run < BLK_CACHE_LINE_BLOCKS) &&
+           (lp->dirty & (1U << (off + run))))
+      run++;
+
+    bcp->stats.writes++;
+    if (blkWrite(bcp->bdp, lp->blk + off, line_data(lp, off), run))
+      return CH_FAILED;
+    lp->dirty &= ~blocks_mask(off, run);
+    off += run;
+  }
+  return CH_SUCCESS;
+}
+
+/**
+ * @brief   Reads the invalid blocks of a line in the range [first, end).
+ */
+static bool_t line_fill(BlockCacheDriver *bcp, blk_cache_line_t *lp,
+                        unsigned first, unsigned end) {
+  unsigned off = first;
+
+  while (off < end) {
+    unsigned run = 0;
+
+    if (lp->valid & (1U << off)) {
+      off++;
+      continue;
+    }
+    while ((off + run < end) && !(lp->valid & (1U << (off + run))))
+      run++;
+
+    bcp->stats.reads++;
+    bcp->stats.misses += run;
+    if (blkRead(bcp->bdp, lp->blk + off, line_data(lp, off), run))
+      return CH_FAILED;
+    lp->valid |= blocks_mask(off, run);
+    off += run;
+  }
+  return CH_SUCCESS;
+}
+
+/**
+ * @brief   Allocates a line for @p lineblk, evicting the least recently
+ *          used one.
+ */
+static blk_cache_line_t *alloc_line(BlockCacheDriver *bcp, uint32_t lineblk) {
+  blk_cache_line_t *lp = &bcp->lines[0];
+  unsigned i;
+
+  for (i = 0; i < BLK_CACHE_NUM_LINES; i++) {
+    if (bcp->lines[i].valid == 0) {
+      lp = &bcp->lines[i];
+      break;
+    }
+    if (bcp->lines[i].stamp - lp->stamp > 0x80000000U)
+      lp = &bcp->lines[i];
+  }
+
+  if (line_write_back(bcp, lp))
+    return NULL;
+  lp->blk   = lineblk;
+  lp->valid = 0;
+  return lp;
+}
+
+/**
+ * @brief   Writes back all the dirty lines in ascending block order.
+ */
+static bool_t flush_all(BlockCacheDriver *bcp) {
+
+  while (TRUE) {
+    blk_cache_line_t *lp = NULL;
+    unsigned i;
+
+    for (i = 0; i < BLK_CACHE_NUM_LINES; i++)
+      if ((bcp->lines[i].dirty != 0) &&
+          ((lp == NULL) || (bcp->lines[i].blk < lp->blk)))
+        lp = &bcp->lines[i];
+    if (lp == NULL)
+      return CH_SUCCESS;
+    if (line_write_back(bcp, lp))
+      return CH_FAILED;
+  }
+}
+
+static void invalidate_all(BlockCacheDriver *bcp) {
+  unsigned i;
+
+  for (i = 0; i < BLK_CACHE_NUM_LINES; i++) {
+    bcp->lines[i].valid = 0;
+    bcp->lines[i].dirty = 0;
+  }
+}
+
+/*
+ * Interface implementation.
+ */
+
+static bool_t is_inserted(void *instance) {
+
+  return blkIsInserted(((BlockCacheDriver *)instance)->bdp);
+}
+
+static bool_t is_protected(void *instance) {
+
+  return blkIsWriteProtected(((BlockCacheDriver *)instance)->bdp);
+}
+
+static bool_t connect(void *instance) {
+  BlockCacheDriver *bcp = (BlockCacheDriver *)instance;
+  BlockDeviceInfo bdi;
+  bool_t err;
+
+  chMtxLock(&bcp->mtx);
+  invalidate_all(bcp);
+  bcp->next_blk = 0;
+  err = blkConnect(bcp->bdp);
+  if (!err)
+    err = blkGetInfo(bcp->bdp, &bdi);
+  if (!err) {
+    chDbgAssert(bdi.blk_size == BLK_CACHE_BLOCK_SIZE,
+                "connect(), #1", "unsupported block size");
+    bcp->blk_num = bdi.blk_num;
+    bcp->state   = BLK_READY;
+  }
+  chMtxUnlock();
+  return err;
+}
+
+static bool_t disconnect(void *instance) {
+  BlockCacheDriver *bcp = (BlockCacheDriver *)instance;
+  bool_t err;
+
+  chMtxLock(&bcp->mtx);
+  err = flush_all(bcp);
+  invalidate_all(bcp);
+  if (blkDisconnect(bcp->bdp))
+    err = CH_FAILED;
+  bcp->state = BLK_ACTIVE;
+  chMtxUnlock();
+  return err;
+}
+
+static bool_t read(void *instance, uint32_t startblk,
+                   uint8_t *buffer, uint32_t n) {
+  BlockCacheDriver *bcp = (BlockCacheDriver *)instance;
+  bool_t sequential;
+
+  chMtxLock(&bcp->mtx);
+  sequential = (startblk == bcp->next_blk);
+  while (n > 0) {
+    uint32_t lineblk = startblk & ~LINE_MASK;
+    unsigned off = startblk & LINE_MASK;
+    unsigned cnt = BLK_CACHE_LINE_BLOCKS - off;
+    unsigned end;
+    blk_cache_line_t *lp;
+
+    if (cnt > n)
+      cnt = n;
+
+    lp = find_line(bcp, lineblk);
+    if (lp == NULL) {
+      if ((off == 0) && (n >= BLK_CACHE_LINE_BLOCKS)) {
+        /* Whole uncached lines, read directly in a single command.*/
+        uint32_t run = BLK_CACHE_LINE_BLOCKS;
+
+        while ((run + BLK_CACHE_LINE_BLOCKS <= n) &&
+               (find_line(bcp, lineblk + run) == NULL))
+          run += BLK_CACHE_LINE_BLOCKS;
+        bcp->stats.reads++;
+        bcp->stats.misses += run;
+        if (blkRead(bcp->bdp, startblk, buffer, run))
+          goto failed;
+        startblk += run;
+        buffer   += run * BLK_CACHE_BLOCK_SIZE;
+        n        -= run;
+        continue;
+      }
+      if ((lp = alloc_line(bcp, lineblk)) == NULL)
+        goto failed;
+    }
+
+    /* On a sequential stream the line is filled up to its end, the
+       following blocks will be requested soon.*/
+    end = off + cnt;
+    if (sequential) {
+      end = BLK_CACHE_LINE_BLOCKS;
+      if ((bcp->blk_num > 0) && (lineblk + end > bcp->blk_num))
+        end = bcp->blk_num - lineblk;
+    }
+    bcp->stats.hits += count_blocks(lp->valid & blocks_mask(off, cnt));
+    if (line_fill(bcp, lp, off, end))
+      goto failed;
+    memcpy(buffer, line_data(lp, off), cnt * BLK_CACHE_BLOCK_SIZE);
+    lp->stamp = ++bcp->clock;
+    startblk += cnt;
+    buffer   += cnt * BLK_CACHE_BLOCK_SIZE;
+    n        -= cnt;
+  }
+  bcp->next_blk = startblk;
+  chMtxUnlock();
+  return CH_SUCCESS;
+
+failed:
+  bcp->next_blk = 0;
+  chMtxUnlock();
+  return CH_FAILED;
+}
+
+static bool_t write(void *instance, uint32_t startblk,
+                    const uint8_t *buffer, uint32_t n) {
+  BlockCacheDriver *bcp = (BlockCacheDriver *)instance;
+
+  chMtxLock(&bcp->mtx);
+  while (n > 0) {
+    uint32_t lineblk = startblk & ~LINE_MASK;
+    unsigned off = startblk & LINE_MASK;
+    unsigned cnt = BLK_CACHE_LINE_BLOCKS - off;
+    uint32_t mask;
+    blk_cache_line_t *lp;
+
+    if (cnt > n)
+      cnt = n;
+
+    lp = find_line(bcp, lineblk);
+    if (lp == NULL) {
+      if ((off == 0) && (n >= BLK_CACHE_LINE_BLOCKS)) {
+        /* Whole uncached lines, written directly in a single command.*/
+        uint32_t run = BLK_CACHE_LINE_BLOCKS;
+
+        while ((run + BLK_CACHE_LINE_BLOCKS <= n) &&
+               (find_line(bcp, lineblk + run) == NULL))
+          run += BLK_CACHE_LINE_BLOCKS;
+        bcp->stats.writes++;
+        if (blkWrite(bcp->bdp, startblk, buffer, run))
+          goto failed;
+        startblk += run;
+        buffer   += run * BLK_CACHE_BLOCK_SIZE;
+        n        -= run;
+        continue;
+      }
+      if ((lp = alloc_line(bcp, lineblk)) == NULL)
+        goto failed;
+    }
+
+    memcpy(line_data(lp, off), buffer, cnt * BLK_CACHE_BLOCK_SIZE);
+    mask = blocks_mask(off, cnt);
+    lp->valid |= mask;
+    lp->dirty |= mask;
+    lp->stamp = ++bcp->clock;
+#if !BLK_CACHE_WRITE_BACK
+    if (line_write_back(bcp, lp))
+      goto failed;
+#endif
+    startblk += cnt;
+    buffer   += cnt * BLK_CACHE_BLOCK_SIZE;
+    n        -= cnt;
+  }
+  chMtxUnlock();
+  return CH_SUCCESS;
+
+failed:
+  chMtxUnlock();
+  return CH_FAILED;
+}
+
+static bool_t sync(void *instance) {
+  BlockCacheDriver *bcp = (BlockCacheDriver *)instance;
+  bool_t err;
+
+  chMtxLock(&bcp->mtx);
+  err = flush_all(bcp);
+  if (blkSync(bcp->bdp))
+    err = CH_FAILED;
+  chMtxUnlock();
+  return err;
+}
+
+static bool_t get_info(void *instance, BlockDeviceInfo *bdip) {
+
+  return blkGetInfo(((BlockCacheDriver *)instance)->bdp, bdip);
+}
+
+static const struct BlockCacheDriverVMT vmt = {
+  is_inserted,
+  is_protected,
+  connect,
+  disconnect,
+  read,
+  write,
+  sync,
+  get_info
+};
+
+/*===========================================================================*/
+/* Driver exported functions.                                                */
+/*===========================================================================*/
+
+/**
+ * @brief   Initializes a block cache object.
+ * @details The cache is layered over @p bdp, the underlying device must
+ *          not be accessed directly while the cache is connected.
+ *
+ * @param[out] bcp      pointer to the @p BlockCacheDriver object
+ * @param[in] bdp       pointer to the cached @p BaseBlockDevice
+ *
+ * @init
+ */
+void bcObjectInit(BlockCacheDriver *bcp, BaseBlockDevice *bdp) {
+
+  chDbgCheck((bcp != NULL) && (bdp != NULL), "bcObjectInit");
+
+  bcp->vmt      = &vmt;
+  bcp->state    = BLK_ACTIVE;
+  bcp->bdp      = bdp;
+  bcp->blk_num  = 0;
+  chMtxInit(&bcp->mtx);
+  bcp->clock    = 0;
+  bcp->next_blk = 0;
+  memset(&bcp->stats, 0, sizeof (bcp->stats));
+  invalidate_all(bcp);
+}
+
+/**
+ * @brief   Writes back all the dirty blocks.
+ * @details Unlike @p blkSync() the underlying device is not synchronized.
+ *
+ * @param[in] bcp       pointer to the @p BlockCacheDriver object
+ * @return              The operation status.
+ * @retval CH_SUCCESS   operation succeeded.
+ * @retval CH_FAILED    operation failed.
+ *
+ * @api
+ */
+bool_t bcFlush(BlockCacheDriver *bcp) {
+  bool_t err;
+
+  chDbgCheck(bcp != NULL, "bcFlush");
+
+  chMtxLock(&bcp->mtx);
+  err = flush_all(bcp);
+  chMtxUnlock();
+  return err;
+}
+
+/**
+ * @brief   Drops all the cached blocks.
+ * @note    Dirty blocks are discarded, use @p bcFlush() before if the
+ *          data must be preserved.
+ *
+ * @param[in] bcp       pointer to the @p BlockCacheDriver object
+ *
+ * @api
+ */
+void bcInvalidate(BlockCacheDriver *bcp) {
+
+  chDbgCheck(bcp != NULL, "bcInvalidate");
+
+  chMtxLock(&bcp->mtx);
+  invalidate_all(bcp);
+  bcp->next_blk = 0;
+  chMtxUnlock();
+}
+
+/**
+ * @brief   Returns the cache statistics.
+ *
+ * @param[in] bcp       pointer to the @p BlockCacheDriver object
+ * @param[out] stp      pointer to the statistics structure to be filled
+ *
+ * @api
+ */
+void bcGetStats(BlockCacheDriver *bcp, blk_cache_stats_t *stp) {
+
+  chDbgCheck((bcp != NULL) && (stp != NULL), "bcGetStats");
+
+  chMtxLock(&bcp->mtx);
+  *stp = bcp->stats;
+  chMtxUnlock();
+}
+
+/** @} */
@@ -0,0 +1,189 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+ * @file    blk_cache.h
+ * @brief   Block devices cache macros and structures.
+ *
+ * @addtogroup BLK_CACHE
+ * @{
+ */
+
+#ifndef _BLK_CACHE_H_
+#define _BLK_CACHE_H_
+
+/*===========================================================================*/
+/* Driver constants.                                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Cached block size, only 512 bytes blocks are supported.
+ */
+#define BLK_CACHE_BLOCK_SIZE        512
+
+/*===========================================================================*/
+/* Driver pre-compile time settings.                                         */
+/*===========================================================================*/
+
+/**
+ * @name    BLK_CACHE configuration options
+ * @{
+ */
+/**
+ * @brief   Number of blocks in a cache line.
+ * @details Lines are aligned to their size on the device, a read miss on a
+ *          sequential stream fills the line up to its end.
+ * @note    Must be a power of two not greater than 32.
+ */
+#if !defined(BLK_CACHE_LINE_BLOCKS) || defined(__DOXYGEN__)
+#define BLK_CACHE_LINE_BLOCKS       8
+#endif
+
+/**
+ * @brief   Number of cache lines.
+ */
+#if !defined(BLK_CACHE_NUM_LINES) || defined(__DOXYGEN__)
+#define BLK_CACHE_NUM_LINES         4
+#endif
+
+/**
+ * @brief   Write-back mode.
+ * @details If enabled written blocks are held in the cache until the line
+ *          is evicted or @p blkSync() is invoked, otherwise the line is
+ *          written through at the end of each write operation.
+ */
+#if !defined(BLK_CACHE_WRITE_BACK) || defined(__DOXYGEN__)
+#define BLK_CACHE_WRITE_BACK        TRUE
+#endif
+/** @} */
+
+/*===========================================================================*/
+/* Derived constants and error checks.                                       */
+/*===========================================================================*/
+
+#if !CH_USE_MUTEXES
+#error "BLK_CACHE requires CH_USE_MUTEXES"
+#endif
+
+#if (BLK_CACHE_LINE_BLOCKS > 32) ||                                         \
+    ((BLK_CACHE_LINE_BLOCKS & (BLK_CACHE_LINE_BLOCKS - 1)) != 0)
+#error "BLK_CACHE_LINE_BLOCKS must be a power of two not greater than 32"
+#endif
+
+/*===========================================================================*/
+/* Driver data structures and types.                                         */
+/*===========================================================================*/
+
+/**
+ * @brief   Cache line.
+ */
+typedef struct {
+  /** @brief First block of the line, meaningful if @p valid is not zero.*/
+  uint32_t                  blk;
+  /** @brief Valid blocks mask.*/
+  uint32_t                  valid;
+  /** @brief Dirty blocks mask, always a subset of @p valid.*/
+  uint32_t                  dirty;
+  /** @brief Last access time, for LRU replacement.*/
+  uint32_t                  stamp;
+  /** @brief Line data, word aligned for DMA.*/
+  uint32_t                  buf[BLK_CACHE_LINE_BLOCKS *
+                                BLK_CACHE_BLOCK_SIZE / 4];
+} blk_cache_line_t;
+
+/**
+ * @brief   Cache statistics.
+ */
+typedef struct {
+  /** @brief Blocks served from the cache.*/
+  uint32_t                  hits;
+  /** @brief Blocks read from the device.*/
+  uint32_t                  misses;
+  /** @brief Read commands issued to the device.*/
+  uint32_t                  reads;
+  /** @brief Write commands issued to the device.*/
+  uint32_t                  writes;
+} blk_cache_stats_t;
+
+/**
+ * @brief   @p BlockCacheDriver specific methods.
+ */
+#define _blk_cache_driver_methods                                           \
+  _base_block_device_methods
+
+/**
+ * @extends BaseBlockDeviceVMT
+ *
+ * @brief   @p BlockCacheDriver virtual methods table.
+ */
+struct BlockCacheDriverVMT {
+  _blk_cache_driver_methods
+};
+
+/**
+ * @extends BaseBlockDevice
+ *
+ * @brief   Block cache class.
+ * @details The cache is itself a block device layered over another block
+ *          device, file systems and the mass storage class can use it in
+ *          place of the underlying driver.
+ */
+typedef struct {
+  /** @brief Virtual Methods Table.*/
+  const struct BlockCacheDriverVMT *vmt;
+  _base_block_device_data
+  /** @brief Cached device.*/
+  BaseBlockDevice           *bdp;
+  /** @brief Device size in blocks.*/
+  uint32_t                  blk_num;
+  /** @brief Access serialization.*/
+  Mutex                     mtx;
+  /** @brief LRU clock.*/
+  uint32_t                  clock;
+  /** @brief Block following the last read, for sequential detection.*/
+  uint32_t                  next_blk;
+  /** @brief Statistics.*/
+  blk_cache_stats_t         stats;
+  /** @brief Cache lines.*/
+  blk_cache_line_t          lines[BLK_CACHE_NUM_LINES];
+} BlockCacheDriver;
+
+/*===========================================================================*/
+/* Driver macros.                                                            */
+/*===========================================================================*/
+
+/*===========================================================================*/
+/* External declarations.                                                    */
+/*===========================================================================*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void bcObjectInit(BlockCacheDriver *bcp, BaseBlockDevice *bdp);
+  bool_t bcFlush(BlockCacheDriver *bcp);
+  void bcInvalidate(BlockCacheDriver *bcp);
+  void bcGetStats(BlockCacheDriver *bcp, blk_cache_stats_t *stp);
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _BLK_CACHE_H_ */
+
+/** @} */
@@ -0,0 +1,4 @@
+# Block devices cache files.
+BLKCACHESRC = ${CHIBIOS}/os/various/blk_cache.c
+
+BLKCACHEINC = ${CHIBIOS}/os/various
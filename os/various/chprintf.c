@@ -37,6 +37,34 @@
 #define MAX_FILLER 11
 #define FLOAT_PRECISION 100000
 
+/**
+ * @brief   Output sink of the formatter.
+ * @details Characters are gathered in @p buf, in stream mode the buffer is
+ *          written to the stream in a single operation when full, in memory
+ *          mode characters exceeding the buffer are only counted.
+ */
+typedef struct {
+  BaseSequentialStream  *chp;
+  uint8_t               *buf;
+  size_t                size;
+  size_t                n;
+  int                   total;
+} fmt_out_t;
+
+static void out_put(fmt_out_t *op, char c) {
+
+  if (op->n >= op->size) {
+    if (op->chp == NULL) {
+      op->total++;
+      return;
+    }
+    chSequentialStreamWrite(op->chp, op->buf, op->n);
+    op->n = 0;
+  }
+  op->buf[op->n++] = (uint8_t)c;
+  op->total++;
+}
+
 static char *long_to_string_with_divisor(char *p,
                                          long num,
                                          unsigned radix,
@@ -89,28 +117,13 @@ static char *ftoa(char *p, double num) {
 #endif
 
 /**
- * @brief   System formatted output function.
- * @details This function implements a minimal @p printf() like functionality
- *          with output on a @p BaseSequentialStream.
- *          The general parameters format is: %[-][width|*][.precision|*][l|L]p.
- *          The following parameter types (p) are supported:
- *          - <b>x</b> hexadecimal integer.
- *          - <b>X</b> hexadecimal long.
- *          - <b>o</b> octal integer.
- *          - <b>O</b> octal long.
- *          - <b>d</b> decimal signed integer.
- *          - <b>D</b> decimal signed long.
- *          - <b>u</b> decimal unsigned integer.
- *          - <b>U</b> decimal unsigned long.
- *          - <b>c</b> character.
- *          - <b>s</b> string.
- *          .
+ * @brief   Formatter core.
  *
- * @param[in] chp       pointer to a @p BaseSequentialStream implementing object
+ * @param[in] op        pointer to the output sink
  * @param[in] fmt       formatting string
+ * @param[in] ap        arguments list
  */
-void chprintf(BaseSequentialStream *chp, const char *fmt, ...) {
-  va_list ap;
+static void format(fmt_out_t *op, const char *fmt, va_list ap) {
   char *p, *s, c, filler;
   int i, precision, width;
   bool_t is_long, left_align;
@@ -122,15 +135,12 @@ void chprintf(BaseSequentialStream *chp, const char *fmt, ...) {
   char tmpbuf[MAX_FILLER + 1];
 #endif
 
-  va_start(ap, fmt);
   while (TRUE) {
     c = *fmt++;
-    if (c == 0) {
-      va_end(ap);
+    if (c == 0)
       return;
-    }
     if (c != '%') {
-      chSequentialStreamPut(chp, (uint8_t)c);
+      out_put(op, c);
       continue;
     }
     p = tmpbuf;
@@ -245,21 +255,123 @@ unsigned_common:
       width = -width;
     if (width < 0) {
       if (*s == '-' && filler == '0') {
-        chSequentialStreamPut(chp, (uint8_t)*s++);
+        out_put(op, *s++);
         i--;
       }
       do
-        chSequentialStreamPut(chp, (uint8_t)filler);
+        out_put(op, filler);
       while (++width != 0);
     }
     while (--i >= 0)
-      chSequentialStreamPut(chp, (uint8_t)*s++);
+      out_put(op, *s++);
 
     while (width) {
-      chSequentialStreamPut(chp, (uint8_t)filler);
+      out_put(op, filler);
       width--;
     }
   }
 }
 
+/**
+ * @brief   System formatted output function.
+ * @details This function implements a minimal @p printf() like functionality
+ *          with output on a @p BaseSequentialStream.
+ *          The output is gathered in a buffer of @p CHPRINTF_BUFFER_SIZE
+ *          bytes on the stack and written to the stream in runs.
+ *          The general parameters format is: %[-][width|*][.precision|*][l|L]p.
+ *          The following parameter types (p) are supported:
+ *          - <b>x</b> hexadecimal integer.
+ *          - <b>X</b> hexadecimal long.
+ *          - <b>o</b> octal integer.
+ *          - <b>O</b> octal long.
+ *          - <b>d</b> decimal signed integer.
+ *          - <b>D</b> decimal signed long.
+ *          - <b>u</b> decimal unsigned integer.
+ *          - <b>U</b> decimal unsigned long.
+ *          - <b>c</b> character.
+ *          - <b>s</b> string.
+ *          .
+ *
+ * @param[in] chp       pointer to a @p BaseSequentialStream implementing object
+ * @param[in] fmt       formatting string
+ * @param[in] ap        arguments list
+ * @return              The number of characters written.
+ *
+ * @api
+ */
+int chvprintf(BaseSequentialStream *chp, const char *fmt, va_list ap) {
+  uint8_t buf[CHPRINTF_BUFFER_SIZE];
+  fmt_out_t out = {chp, buf, sizeof(buf), 0, 0};
+
+  format(&out, fmt, ap);
+  if (out.n > 0)
+    chSequentialStreamWrite(chp, buf, out.n);
+  return out.total;
+}
+
+/**
+ * @brief   System formatted output function.
+ * @details See @p chvprintf() for the supported formats.
+ *
+ * @param[in] chp       pointer to a @p BaseSequentialStream implementing object
+ * @param[in] fmt       formatting string
+ * @return              The number of characters written.
+ *
+ * @api
+ */
+int chprintf(BaseSequentialStream *chp, const char *fmt, ...) {
+  va_list ap;
+  int n;
+
+  va_start(ap, fmt);
+  n = chvprintf(chp, fmt, ap);
+  va_end(ap);
+  return n;
+}
+
+/**
+ * @brief   Formatted output into a memory buffer.
+ * @details See @p chvprintf() for the supported formats. The output is
+ *          truncated to @p size - 1 characters and always terminated.
+ *
+ * @param[out] str      pointer to the destination buffer
+ * @param[in] size      size of the destination buffer
+ * @param[in] fmt       formatting string
+ * @param[in] ap        arguments list
+ * @return              The number of characters that would have been
+ *                      written with a large enough buffer.
+ *
+ * @api
+ */
+int chvsnprintf(char *str, size_t size, const char *fmt, va_list ap) {
+  fmt_out_t out = {NULL, (uint8_t *)str, size > 0 ? size - 1 : 0, 0, 0};
+
+  format(&out, fmt, ap);
+  if (size > 0)
+    str[out.n] = 0;
+  return out.total;
+}
+
+/**
+ * @brief   Formatted output into a memory buffer.
+ * @details See @p chvsnprintf().
+ *
+ * @param[out] str      pointer to the destination buffer
+ * @param[in] size      size of the destination buffer
+ * @param[in] fmt       formatting string
+ * @return              The number of characters that would have been
+ *                      written with a large enough buffer.
+ *
+ * @api
+ */
+int chsnprintf(char *str, size_t size, const char *fmt, ...) {
+  va_list ap;
+  int n;
+
+  va_start(ap, fmt);
+  n = chvsnprintf(str, size, fmt, ap);
+  va_end(ap);
+  return n;
+}
+
 /** @} */
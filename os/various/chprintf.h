@@ -36,10 +36,22 @@
 #define CHPRINTF_USE_FLOAT          FALSE
 #endif
 
+/**
+ * @brief   Size of the stack buffer used to batch the stream output.
+ */
+#if !defined(CHPRINTF_BUFFER_SIZE) || defined(__DOXYGEN__)
+#define CHPRINTF_BUFFER_SIZE        64
+#endif
+
+#include <stdarg.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
-  void chprintf(BaseSequentialStream *chp, const char *fmt, ...);
+  int chvprintf(BaseSequentialStream *chp, const char *fmt, va_list ap);
+  int chprintf(BaseSequentialStream *chp, const char *fmt, ...);
+  int chvsnprintf(char *str, size_t size, const char *fmt, va_list ap);
+  int chsnprintf(char *str, size_t size, const char *fmt, ...);
 #ifdef __cplusplus
 }
 #endif
@@ -30,8 +30,19 @@ extern RTCDriver RTCD1;
 /*-----------------------------------------------------------------------*/
 /* Correspondence between physical drive number and physical drive.      */
 
-#define MMC     0
-#define SDC     0
+#if HAL_USE_MMC_SPI
+#define NATIVE_DEVICE   ((BaseBlockDevice *)&MMCD1)
+#else
+#define NATIVE_DEVICE   ((BaseBlockDevice *)&SDCD1)
+#endif
+
+/**
+ * @brief   Block device backing drive 0.
+ * @details Defaults to the MMC_SPI or SDC driver. The application can point
+ *          it to a device layered over the driver, for example a
+ *          @p BlockCacheDriver, before mounting the volume.
+ */
+BaseBlockDevice *fatfsBlockDevice = NATIVE_DEVICE;
 
 
 
@@ -42,30 +53,8 @@ DSTATUS disk_initialize (
     BYTE drv                /* Physical drive nmuber (0..) */
 )
 {
-  DSTATUS stat;
-
-  switch (drv) {
-#if HAL_USE_MMC_SPI
-  case MMC:
-    stat = 0;
-    /* It is initialized externally, just reads the status.*/
-    if (blkGetDriverState(&MMCD1) != BLK_READY)
-      stat |= STA_NOINIT;
-    if (mmcIsWriteProtected(&MMCD1))
-      stat |=  STA_PROTECT;
-    return stat;
-#else
-  case SDC:
-    stat = 0;
-    /* It is initialized externally, just reads the status.*/
-    if (blkGetDriverState(&SDCD1) != BLK_READY)
-      stat |= STA_NOINIT;
-    if (sdcIsWriteProtected(&SDCD1))
-      stat |=  STA_PROTECT;
-    return stat;
-#endif
-  }
-  return STA_NODISK;
+  /* It is initialized externally, just reads the status.*/
+  return disk_status(drv);
 }
 
 
@@ -79,28 +68,14 @@ DSTATUS disk_status (
 {
   DSTATUS stat;
 
-  switch (drv) {
-#if HAL_USE_MMC_SPI
-  case MMC:
-    stat = 0;
-    /* It is initialized externally, just reads the status.*/
-    if (blkGetDriverState(&MMCD1) != BLK_READY)
-      stat |= STA_NOINIT;
-    if (mmcIsWriteProtected(&MMCD1))
-      stat |= STA_PROTECT;
-    return stat;
-#else
-  case SDC:
-    stat = 0;
-    /* It is initialized externally, just reads the status.*/
-    if (blkGetDriverState(&SDCD1) != BLK_READY)
-      stat |= STA_NOINIT;
-    if (sdcIsWriteProtected(&SDCD1))
-      stat |= STA_PROTECT;
-    return stat;
-#endif
-  }
-  return STA_NODISK;
+  if (drv != 0)
+    return STA_NODISK;
+  stat = 0;
+  if (blkGetDriverState(fatfsBlockDevice) != BLK_READY)
+    stat |= STA_NOINIT;
+  if (blkIsWriteProtected(fatfsBlockDevice))
+    stat |= STA_PROTECT;
+  return stat;
 }
 
 
@@ -115,32 +90,13 @@ DRESULT disk_read (
     BYTE count        /* Number of sectors to read (1..255) */
 )
 {
-  switch (drv) {
-#if HAL_USE_MMC_SPI
-  case MMC:
-    if (blkGetDriverState(&MMCD1) != BLK_READY)
-      return RES_NOTRDY;
-    if (mmcStartSequentialRead(&MMCD1, sector))
-      return RES_ERROR;
-    while (count > 0) {
-      if (mmcSequentialRead(&MMCD1, buff))
-        return RES_ERROR;
-      buff += MMC_SECTOR_SIZE;
-      count--;
-    }
-    if (mmcStopSequentialRead(&MMCD1))
-        return RES_ERROR;
-    return RES_OK;
-#else
-  case SDC:
-    if (blkGetDriverState(&SDCD1) != BLK_READY)
-      return RES_NOTRDY;
-    if (sdcRead(&SDCD1, sector, buff, count))
-      return RES_ERROR;
-    return RES_OK;
-#endif
-  }
-  return RES_PARERR;
+  if (drv != 0)
+    return RES_PARERR;
+  if (blkGetDriverState(fatfsBlockDevice) != BLK_READY)
+    return RES_NOTRDY;
+  if (blkRead(fatfsBlockDevice, sector, buff, count))
+    return RES_ERROR;
+  return RES_OK;
 }
 
 
@@ -156,34 +112,15 @@ DRESULT disk_write (
     BYTE count            /* Number of sectors to write (1..255) */
 )
 {
-  switch (drv) {
-#if HAL_USE_MMC_SPI
-  case MMC:
-    if (blkGetDriverState(&MMCD1) != BLK_READY)
-        return RES_NOTRDY;
-    if (mmcIsWriteProtected(&MMCD1))
-        return RES_WRPRT;
-    if (mmcStartSequentialWrite(&MMCD1, sector))
-        return RES_ERROR;
-    while (count > 0) {
-        if (mmcSequentialWrite(&MMCD1, buff))
-            return RES_ERROR;
-        buff += MMC_SECTOR_SIZE;
-        count--;
-    }
-    if (mmcStopSequentialWrite(&MMCD1))
-        return RES_ERROR;
-    return RES_OK;
-#else
-  case SDC:
-    if (blkGetDriverState(&SDCD1) != BLK_READY)
-      return RES_NOTRDY;
-    if (sdcWrite(&SDCD1, sector, buff, count))
-      return RES_ERROR;
-    return RES_OK;
-#endif
-  }
-  return RES_PARERR;
+  if (drv != 0)
+    return RES_PARERR;
+  if (blkGetDriverState(fatfsBlockDevice) != BLK_READY)
+    return RES_NOTRDY;
+  if (blkIsWriteProtected(fatfsBlockDevice))
+    return RES_WRPRT;
+  if (blkWrite(fatfsBlockDevice, sector, buff, count))
+    return RES_ERROR;
+  return RES_OK;
 }
 #endif /* _READONLY */
 
@@ -198,48 +135,46 @@ DRESULT disk_ioctl (
     void *buff        /* Buffer to send/receive control data */
 )
 {
-  switch (drv) {
-#if HAL_USE_MMC_SPI
-  case MMC:
-    switch (ctrl) {
-    case CTRL_SYNC:
-        return RES_OK;
-    case GET_SECTOR_SIZE:
-        *((WORD *)buff) = MMC_SECTOR_SIZE;
-        return RES_OK;
-#if _USE_ERASE
-    case CTRL_ERASE_SECTOR:
-        mmcErase(&MMCD1, *((DWORD *)buff), *((DWORD *)buff + 1));
-        return RES_OK;
+  BlockDeviceInfo bdi;
+
+  if (drv != 0)
+    return RES_PARERR;
+  switch (ctrl) {
+  case CTRL_SYNC:
+    /* Also writes back the blocks held by a cache layer.*/
+    if (blkSync(fatfsBlockDevice))
+      return RES_ERROR;
+    return RES_OK;
+  case GET_SECTOR_COUNT:
+    if (blkGetInfo(fatfsBlockDevice, &bdi))
+      return RES_ERROR;
+    *((DWORD *)buff) = bdi.blk_num;
+    return RES_OK;
+  case GET_SECTOR_SIZE:
+    if (blkGetInfo(fatfsBlockDevice, &bdi))
+      return RES_ERROR;
+    *((WORD *)buff) = (WORD)bdi.blk_size;
+    return RES_OK;
+#if HAL_USE_SDC
+  case GET_BLOCK_SIZE:
+    *((DWORD *)buff) = 256; /* 512b blocks in one erase block */
+    return RES_OK;
 #endif
-    default:
-        return RES_PARERR;
-    }
-#else
-  case SDC:
-    switch (ctrl) {
-    case CTRL_SYNC:
-        return RES_OK;
-    case GET_SECTOR_COUNT:
-        *((DWORD *)buff) = mmcsdGetCardCapacity(&SDCD1);
-        return RES_OK;
-    case GET_SECTOR_SIZE:
-        *((WORD *)buff) = MMCSD_BLOCK_SIZE;
-        return RES_OK;
-    case GET_BLOCK_SIZE:
-        *((DWORD *)buff) = 256; /* 512b blocks in one erase block */
-        return RES_OK;
 #if _USE_ERASE
-    case CTRL_ERASE_SECTOR:
-        sdcErase(&SDCD1, *((DWORD *)buff), *((DWORD *)buff + 1));
-        return RES_OK;
+  case CTRL_ERASE_SECTOR:
+    /* Erasing below a layered device would leave it with stale blocks.*/
+    if (fatfsBlockDevice != NATIVE_DEVICE)
+      return RES_PARERR;
+#if HAL_USE_MMC_SPI
+    mmcErase(&MMCD1, *((DWORD *)buff), *((DWORD *)buff + 1));
+#else
+    sdcErase(&SDCD1, *((DWORD *)buff), *((DWORD *)buff + 1));
 #endif
-    default:
-        return RES_PARERR;
-    }
+    return RES_OK;
 #endif
+  default:
+    return RES_PARERR;
   }
-  return RES_PARERR;
 }
 
 DWORD get_fattime(void) {
@@ -56,6 +56,7 @@
 #define __CC_H__
 
 #include <ch.h>
+#include <hal.h>
 
 typedef uint8_t         u8_t;
 typedef int8_t          s8_t;
@@ -73,4 +74,42 @@ typedef uint32_t        mem_ptr_t;
 #define BYTE_ORDER LITTLE_ENDIAN
 #define LWIP_PROVIDE_ERRNO
 
+/*
+ * Checksums handled by the MAC, options already set in lwipopts.h take
+ * precedence. Reassembled datagrams are not covered by the receive
+ * check, the MAC bypasses fragments, so TCP and UDP keep the software
+ * check while reassembly is enabled. Outgoing fragmented UDP datagrams
+ * carry a zero (disabled) checksum for the same reason.
+ */
+#if HAL_USE_MAC && defined(STM32_MAC_IP_CHECKSUM_OFFLOAD)
+#if STM32_MAC_IP_CHECKSUM_OFFLOAD == 2
+#error "STM32_MAC_IP_CHECKSUM_OFFLOAD mode 2 is not supported by lwIP"
+#endif
+#if STM32_MAC_IP_CHECKSUM_OFFLOAD > 0
+#ifndef CHECKSUM_GEN_IP
+#define CHECKSUM_GEN_IP                 0
+#endif
+#ifndef CHECKSUM_CHECK_IP
+#define CHECKSUM_CHECK_IP               0
+#endif
+#if !defined(CHECKSUM_CHECK_TCP) && defined(IP_REASSEMBLY) && !IP_REASSEMBLY
+#define CHECKSUM_CHECK_TCP              0
+#endif
+#if !defined(CHECKSUM_CHECK_UDP) && defined(IP_REASSEMBLY) && !IP_REASSEMBLY
+#define CHECKSUM_CHECK_UDP              0
+#endif
+#endif /* STM32_MAC_IP_CHECKSUM_OFFLOAD > 0 */
+#if STM32_MAC_IP_CHECKSUM_OFFLOAD == 3
+#ifndef CHECKSUM_GEN_UDP
+#define CHECKSUM_GEN_UDP                0
+#endif
+#ifndef CHECKSUM_GEN_TCP
+#define CHECKSUM_GEN_TCP                0
+#endif
+#ifndef CHECKSUM_GEN_ICMP
+#define CHECKSUM_GEN_ICMP               0
+#endif
+#endif /* STM32_MAC_IP_CHECKSUM_OFFLOAD == 3 */
+#endif /* HAL_USE_MAC */
+
 #endif /* __CC_H__ */
@@ -64,13 +64,44 @@
 #include "arch/cc.h"
 #include "arch/sys_arch.h"
 
+#if !CH_USE_MEMPOOLS
+#error "lwIP bindings require CH_USE_MEMPOOLS"
+#endif
+
+#if LWIP_SYS_MBOX_SIZE <= 0
+#error "lwIP mailbox sizes not set in lwipopts.h"
+#endif
+
+/* Mailbox with its own buffer, allocated from the pool as a single
+   object.*/
+typedef struct {
+  Mailbox       mb;
+  msg_t         buf[LWIP_SYS_MBOX_SIZE];
+} sys_mbox_obj_t;
+
+static Semaphore sems[LWIP_SYS_SEMS];
+static sys_mbox_obj_t mboxes[LWIP_SYS_MBOXES];
+
+/* Freed objects are reused in LIFO order, a thread repeatedly creating
+   and destroying a semaphore (select(), netifapi calls) gets back the
+   same object without touching the heap.*/
+static MEMORYPOOL_DECL(sem_pool, sizeof(Semaphore), NULL);
+static MEMORYPOOL_DECL(mbox_pool, sizeof(sys_mbox_obj_t), NULL);
+
 void sys_init(void) {
+  static bool_t loaded = FALSE;
 
+  /* Invoked again by lwip_init(), the pools must be loaded once.*/
+  if (!loaded) {
+    chPoolLoadArray(&sem_pool, sems, LWIP_SYS_SEMS);
+    chPoolLoadArray(&mbox_pool, mboxes, LWIP_SYS_MBOXES);
+    loaded = TRUE;
+  }
 }
 
 err_t sys_sem_new(sys_sem_t *sem, u8_t count) {
 
-  *sem = chHeapAlloc(NULL, sizeof(Semaphore));
+  *sem = chPoolAlloc(&sem_pool);
   if (*sem == 0) {
     SYS_STATS_INC(sem.err);
     return ERR_MEM;
@@ -84,7 +115,7 @@ err_t sys_sem_new(sys_sem_t *sem, u8_t count) {
 
 void sys_sem_free(sys_sem_t *sem) {
 
-  chHeapFree(*sem);
+  chPoolFree(&sem_pool, *sem);
   *sem = SYS_SEM_NULL;
   SYS_STATS_DEC(sem.used);
 }
@@ -95,17 +126,18 @@ void sys_sem_signal(sys_sem_t *sem) {
 }
 
 u32_t sys_arch_sem_wait(sys_sem_t *sem, u32_t timeout) {
-  systime_t time, tmo;
+  systime_t time;
+
+  /* Infinite waits, the elapsed time is ignored by callers.*/
+  if (timeout == 0) {
+    chSemWait(*sem);
+    return 0;
+  }
 
-  chSysLock();
-  tmo = timeout > 0 ? (systime_t)timeout : TIME_INFINITE;
   time = chTimeNow();
-  if (chSemWaitTimeoutS(*sem, tmo) != RDY_OK)
-    time = SYS_ARCH_TIMEOUT;
-  else
-    time = chTimeNow() - time;
-  chSysUnlock();
-  return time;
+  if (chSemWaitTimeout(*sem, (systime_t)timeout) != RDY_OK)
+    return SYS_ARCH_TIMEOUT;
+  return chTimeNow() - time;
 }
 
 int sys_sem_valid(sys_sem_t *sem) {
@@ -119,14 +151,17 @@ void sys_sem_set_invalid(sys_sem_t *sem) {
 }
 
 err_t sys_mbox_new(sys_mbox_t *mbox, int size) {
-  
-  *mbox = chHeapAlloc(NULL, sizeof(Mailbox) + sizeof(msg_t) * size);
-  if (*mbox == 0) {
+  sys_mbox_obj_t *mbp;
+
+  if ((size > LWIP_SYS_MBOX_SIZE) ||
+      ((mbp = chPoolAlloc(&mbox_pool)) == NULL)) {
     SYS_STATS_INC(mbox.err);
     return ERR_MEM;
   }
   else {
-    chMBInit(*mbox, (void *)(((uint8_t *)*mbox) + sizeof(Mailbox)), size);
+    /* A zero size means "default" for lwIP.*/
+    chMBInit(&mbp->mb, mbp->buf, size > 0 ? size : LWIP_SYS_MBOX_SIZE);
+    *mbox = &mbp->mb;
     SYS_STATS_INC(mbox.used);
     return ERR_OK;
   }
@@ -141,7 +176,7 @@ void sys_mbox_free(sys_mbox_t *mbox) {
     SYS_STATS_INC(mbox.err);
     chMBReset(*mbox);
   }
-  chHeapFree(*mbox);
+  chPoolFree(&mbox_pool, *mbox);
   *mbox = SYS_MBOX_NULL;
   SYS_STATS_DEC(mbox.used);
 }
@@ -161,17 +196,18 @@ err_t sys_mbox_trypost(sys_mbox_t *mbox, void *msg) {
 }
 
 u32_t sys_arch_mbox_fetch(sys_mbox_t *mbox, void **msg, u32_t timeout) {
-  systime_t time, tmo;
+  systime_t time;
+
+  /* Infinite waits, the elapsed time is ignored by callers.*/
+  if (timeout == 0) {
+    chMBFetch(*mbox, (msg_t *)msg, TIME_INFINITE);
+    return 0;
+  }
 
-  chSysLock();
-  tmo = timeout > 0 ? (systime_t)timeout : TIME_INFINITE;
   time = chTimeNow();
-  if (chMBFetchS(*mbox, (msg_t *)msg, tmo) != RDY_OK)
-    time = SYS_ARCH_TIMEOUT;
-  else
-    time = chTimeNow() - time;
-  chSysUnlock();
-  return time;
+  if (chMBFetch(*mbox, (msg_t *)msg, (systime_t)timeout) != RDY_OK)
+    return SYS_ARCH_TIMEOUT;
+  return chTimeNow() - time;
 }
 
 u32_t sys_arch_mbox_tryfetch(sys_mbox_t *mbox, void **msg) {
@@ -69,4 +69,27 @@ typedef int             sys_prot_t;
 /* let sys.h use binary semaphores for mutexes */
 #define LWIP_COMPAT_MUTEX 1
 
+/* Number of semaphores in the static pool, one for each netconn plus the
+   transient ones used by tcpip, select(), sys_msleep() and DNS lookups.*/
+#if !defined(LWIP_SYS_SEMS) || defined(__DOXYGEN__)
+#define LWIP_SYS_SEMS           (MEMP_NUM_NETCONN + 4)
+#endif
+
+/* Number of mailboxes in the static pool, receive and accept mailboxes
+   for each netconn plus the tcpip thread mailbox.*/
+#if !defined(LWIP_SYS_MBOXES) || defined(__DOXYGEN__)
+#define LWIP_SYS_MBOXES         (2 * MEMP_NUM_NETCONN + 1)
+#endif
+
+#define SYS_ARCH_MAX(a, b)      ((a) > (b) ? (a) : (b))
+
+/* Capacity of each pooled mailbox, the largest size requested by lwIP.*/
+#if !defined(LWIP_SYS_MBOX_SIZE) || defined(__DOXYGEN__)
+#define LWIP_SYS_MBOX_SIZE                                                  \
+  SYS_ARCH_MAX(TCPIP_MBOX_SIZE,                                             \
+  SYS_ARCH_MAX(DEFAULT_ACCEPTMBOX_SIZE,                                     \
+  SYS_ARCH_MAX(DEFAULT_TCP_RECVMBOX_SIZE,                                   \
+  SYS_ARCH_MAX(DEFAULT_UDP_RECVMBOX_SIZE, DEFAULT_RAW_RECVMBOX_SIZE))))
+#endif
+
 #endif /* __SYS_ARCH_H__ */
@@ -85,6 +85,63 @@
  */
 WORKING_AREA(wa_lwip_thread, LWIP_THREAD_STACK_SIZE);
 
+#if MAC_USE_ZERO_COPY
+#if LWIP_ZERO_COPY_RX_PBUFS >= STM32_MAC_RECEIVE_BUFFERS
+#error "LWIP_ZERO_COPY_RX_PBUFS must be lower than STM32_MAC_RECEIVE_BUFFERS"
+#endif
+
+#if !LWIP_SUPPORT_CUSTOM_PBUF
+#error "MAC_USE_ZERO_COPY requires LWIP_SUPPORT_CUSTOM_PBUF"
+#endif
+
+/*
+ * Custom pbuf wrapping a received frame, the frame stays in the MAC
+ * receive buffer until the pbuf is freed by the stack.
+ */
+struct rx_pbuf {
+  struct pbuf_custom    pc;
+  MACReceiveDescriptor  rd;
+  struct rx_pbuf        *next;
+};
+
+static struct rx_pbuf rx_pbufs[LWIP_ZERO_COPY_RX_PBUFS];
+static struct rx_pbuf *rx_free;
+
+/*
+ * Returns a received frame to the MAC, invoked by pbuf_free().
+ */
+static void rx_pbuf_free(struct pbuf *p) {
+  struct rx_pbuf *rxp = (struct rx_pbuf *)p;
+
+  macReleaseReceiveDescriptor(&rxp->rd);
+
+  chSysLock();
+  rxp->next = rx_free;
+  rx_free = rxp;
+  /* Frames queued behind the released descriptor can now be fetched.*/
+  chEvtBroadcastI(macGetReceiveEventSource(&ETHD1));
+  chSchRescheduleS();
+  chSysUnlock();
+}
+
+/*
+ * Releases the pbufs of the transmitted frames.
+ */
+static void tx_pbuf_free(void *param) {
+
+  pbuf_free((struct pbuf *)param);
+}
+
+/*
+ * Reclaims the transmitted frames, runs in the tcpip thread.
+ */
+static void tx_reclaim(void *arg) {
+
+  (void)arg;
+  macReclaimTransmitChains(&ETHD1, tx_pbuf_free);
+}
+#endif /* MAC_USE_ZERO_COPY */
+
 /*
  * Initialization.
  */
@@ -110,6 +167,47 @@ static err_t low_level_output(struct netif *netif, struct pbuf *p) {
   MACTransmitDescriptor td;
 
   (void)netif;
+
+#if MAC_USE_ZERO_COPY && !ETH_PAD_SIZE
+  {
+    MACTransmitChain tc;
+    struct pbuf *hdr;
+    unsigned n = 1;
+
+    /* Only the payload pbufs are lent to the DMA. The first pbuf holds the
+       protocol headers and the stack rewrites them in place, for example
+       when TCP retransmits a segment still owned by the DMA, so they are
+       sent from a private copy. Frames without payload pbufs and frames
+       shared with another owner take the copy path below.*/
+    for (q = p->next; q != NULL; q = q->next)
+      if (q->len > 0)
+        n++;
+    if ((p->ref == 1) && (p->len > 0) && (n > 1) &&
+        (n <= MAC_TRANSMIT_CHAIN_MAX) &&
+        ((hdr = pbuf_alloc(PBUF_RAW, p->len, PBUF_RAM)) != NULL)) {
+      if (macWaitTransmitChain(&ETHD1, &tc, n, tx_pbuf_free,
+                               MS2ST(LWIP_SEND_TIMEOUT)) != RDY_OK) {
+        pbuf_free(hdr);
+        return ERR_TIMEOUT;
+      }
+      MEMCPY(hdr->payload, p->payload, p->len);
+      /* The payload pbufs are referenced until the DMA is done with them.*/
+      pbuf_chain(hdr, p->next);
+      for (q = hdr; q != NULL; q = q->next)
+        if (q->len > 0)
+          macAddTransmitSegment(&tc, (uint8_t *)q->payload, (size_t)q->len);
+      macReleaseTransmitChain(&tc, hdr);
+
+      LINK_STATS_INC(link.xmit);
+
+      return ERR_OK;
+    }
+  }
+
+  /* Descriptors of already transmitted chains are needed below.*/
+  macReclaimTransmitChains(&ETHD1, tx_pbuf_free);
+#endif /* MAC_USE_ZERO_COPY && !ETH_PAD_SIZE */
+
   if (macWaitTransmitDescriptor(&ETHD1, &td, MS2ST(LWIP_SEND_TIMEOUT)) != RDY_OK)
     return ERR_TIMEOUT;
 
@@ -143,6 +241,32 @@ static struct pbuf *low_level_input(struct netif *netif) {
   if (macWaitReceiveDescriptor(&ETHD1, &rd, TIME_IMMEDIATE) == RDY_OK) {
     len = (u16_t)rd.size;
 
+#if MAC_USE_ZERO_COPY && !ETH_PAD_SIZE
+    {
+      struct rx_pbuf *rxp;
+
+      /* The frame is lent to the stack if a wrapper is available, else
+         it is copied into the pool.*/
+      chSysLock();
+      if ((rxp = rx_free) != NULL)
+        rx_free = rxp->next;
+      chSysUnlock();
+      if (rxp != NULL) {
+        size_t size;
+        uint8_t *buf = (uint8_t *)mac_lld_get_next_receive_buffer(&rd, &size);
+
+        rxp->rd = rd;
+        rxp->pc.custom_free_function = rx_pbuf_free;
+        p = pbuf_alloced_custom(PBUF_RAW, len, PBUF_REF, &rxp->pc,
+                                buf, STM32_MAC_BUFFERS_SIZE);
+
+        LINK_STATS_INC(link.recv);
+
+        return p;
+      }
+    }
+#endif /* MAC_USE_ZERO_COPY && !ETH_PAD_SIZE */
+
 #if ETH_PAD_SIZE
     len += ETH_PAD_SIZE;        /* allow room for Ethernet padding */
 #endif
@@ -255,6 +379,17 @@ msg_t lwip_thread(void *p) {
     LWIP_GATEWAY(&gateway);
     LWIP_NETMASK(&netmask);
   }
+#if MAC_USE_ZERO_COPY
+  {
+    unsigned i;
+
+    rx_free = NULL;
+    for (i = 0; i < LWIP_ZERO_COPY_RX_PBUFS; i++) {
+      rx_pbufs[i].next = rx_free;
+      rx_free = &rx_pbufs[i];
+    }
+  }
+#endif
   macStart(&ETHD1, &mac_config);
   netif_add(&thisif, &ip, &netmask, &gateway, NULL, ethernetif_init, tcpip_input);
 
@@ -283,6 +418,10 @@ msg_t lwip_thread(void *p) {
           tcpip_callback_with_block((tcpip_callback_fn) netif_set_link_down,
                                      &thisif, 0);
       }
+#if MAC_USE_ZERO_COPY
+      /* Frees the transmitted pbufs if the stack has been idle.*/
+      tcpip_callback_with_block(tx_reclaim, NULL, 0);
+#endif
     }
     if (mask & FRAME_RECEIVED_ID) {
       struct pbuf *p;
@@ -103,6 +103,16 @@
 #define LWIP_IFNAME1            's'
 #endif
 
+/**
+ * @brief Number of received frames lent to the stack without copy.
+ * @note  Only used when @p MAC_USE_ZERO_COPY is enabled, must be lower than
+ *        the number of MAC receive buffers so that the DMA is never
+ *        starved by the stack.
+ */
+#if !defined(LWIP_ZERO_COPY_RX_PBUFS) || defined(__DOXYGEN__)
+#define LWIP_ZERO_COPY_RX_PBUFS 2
+#endif
+
 /**
  * @brief Runtime TCP/IP settings.
  */
@@ -26,11 +26,32 @@
  * @{
  */
 
+#include <string.h>
+
 #include "ch.h"
 #include "hal.h"
 
 #include "usb_msc.h"
 
+/*===========================================================================*/
+/* Driver local definitions.                                                 */
+/*===========================================================================*/
+
+/**
+ * @brief   Size of a CBW on the wire.
+ */
+#define MSC_CBW_SIZE            31
+
+/**
+ * @brief   Size of a CSW on the wire.
+ */
+#define MSC_CSW_SIZE            13
+
+/**
+ * @brief   Direction bit in the CBW flags, set for device to host.
+ */
+#define MSC_CBW_DIR_IN          0x80
+
 /*===========================================================================*/
 /* Driver exported variables.                                                */
 /*===========================================================================*/
@@ -51,9 +72,9 @@ static const uint8_t scsi_inquiry_data[] = {
   0x00,             /* Direct Access Device.      */
   0x80,             /* RMB = 1: Removable Medium. */
   0x02,             /* ISO, ECMA, ANSI = 2.       */
-  0x00,             /* UFI response format.       */
+  0x02,             /* SPC response format.       */
 
-  36 - 4,           /* Additional Length.         */
+  36 - 5,           /* Additional Length.         */
   0x00,
   0x00,
   0x00,
@@ -66,112 +87,581 @@ static const uint8_t scsi_inquiry_data[] = {
   '1', '.', '0', ' '
 };
 
+/*===========================================================================*/
+/* Driver local functions.                                                   */
+/*===========================================================================*/
+
 /**
- * @brief   Generic buffer.
+ * @brief   Resets the driver transfers.
+ * @details Threads waiting for a transfer are awakened with @p RDY_RESET,
+ *          the MSC thread restarts from the CBW reception.
+ *
+ * @param[in] mscp      pointer to the @p USBMassStorageDriver object
  */
-uint8_t buf[16];
+static void msc_reset_i(USBMassStorageDriver *mscp) {
+
+  mscp->reset = TRUE;
+  chSemResetI(&mscp->insem, 0);
+  chSemResetI(&mscp->outsem, 0);
+  if (mscp->thd_wait != NULL) {
+    chSchReadyI(mscp->thd_wait);
+    mscp->thd_wait = NULL;
+  }
+}
 
-/*===========================================================================*/
-/* MMC interface code.                                                       */
-/*===========================================================================*/
+/**
+ * @brief   Suspends the MSC thread until the next reset.
+ *
+ * @param[in] mscp      pointer to the @p USBMassStorageDriver object
+ */
+static void msc_sleep_s(USBMassStorageDriver *mscp) {
 
-/*===========================================================================*/
-/* SCSI emulation code.                                                      */
-/*===========================================================================*/
+  if (!mscp->reset) {
+    mscp->thd_wait = chThdSelf();
+    chSchGoSleepS(THD_STATE_SUSPENDED);
+  }
+}
 
-static uint8_t scsi_read_format_capacities(uint32_t *nblocks,
-                                           uint32_t *secsize) {
+/**
+ * @brief   Waits for a transfer completion.
+ *
+ * @param[in] mscp      pointer to the @p USBMassStorageDriver object
+ * @param[in] sp        semaphore associated to the endpoint
+ * @return              The wait result.
+ * @retval RDY_OK       transfer completed.
+ * @retval RDY_RESET    the driver has been reset.
+ */
+static msg_t msc_wait(USBMassStorageDriver *mscp, Semaphore *sp) {
+  msg_t msg;
 
-  *nblocks = 1024;
-  *secsize = 512;
-  return 3; /* No Media.*/
+  chSysLock();
+  msg = mscp->reset ? RDY_RESET : chSemWaitS(sp);
+  chSysUnlock();
+  return msg;
 }
 
-/*===========================================================================*/
-/* Mass Storage Class related code.                                          */
-/*===========================================================================*/
+/**
+ * @brief   Starts an IN transfer.
+ *
+ * @return              The operation status.
+ * @retval CH_SUCCESS   transfer started.
+ * @retval CH_FAILED    the driver has been reset.
+ */
+static bool_t msc_start_transmit(USBMassStorageDriver *mscp,
+                                 const void *p, size_t n) {
+  USBDriver *usbp = mscp->config->usbp;
+
+  chSysLock();
+  if (mscp->reset) {
+    chSysUnlock();
+    return CH_FAILED;
+  }
+  usbPrepareTransmit(usbp, mscp->config->bulk_in, p, n);
+  usbStartTransmitI(usbp, mscp->config->bulk_in);
+  chSysUnlock();
+  return CH_SUCCESS;
+}
 
 /**
- * @brief   MSC state machine current state.
+ * @brief   Starts an OUT transfer.
+ *
+ * @return              The operation status.
+ * @retval CH_SUCCESS   transfer started.
+ * @retval CH_FAILED    the driver has been reset.
  */
-static mscstate_t msc_state;
+static bool_t msc_start_receive(USBMassStorageDriver *mscp,
+                                void *p, size_t n) {
+  USBDriver *usbp = mscp->config->usbp;
+
+  chSysLock();
+  if (mscp->reset) {
+    chSysUnlock();
+    return CH_FAILED;
+  }
+  usbPrepareReceive(usbp, mscp->config->bulk_out, p, n);
+  usbStartReceiveI(usbp, mscp->config->bulk_out);
+  chSysUnlock();
+  return CH_SUCCESS;
+}
 
 /**
- * @brief   Received CBW.
+ * @brief   Terminates the host data phase by stalling its pipe.
+ * @details Used when the device transfers less data than announced in
+ *          the CBW, the host clears the stall and reads the CSW.
  */
-static msccbw_t CBW;
+static void msc_stall_data(USBMassStorageDriver *mscp) {
+
+  if (mscp->cbw.dCBWDataTransferLength == 0)
+    return;
+  chSysLock();
+  if (!mscp->reset) {
+    if (mscp->cbw.bmCBWFlags & MSC_CBW_DIR_IN)
+      usbStallTransmitI(mscp->config->usbp, mscp->config->bulk_in);
+    else
+      usbStallReceiveI(mscp->config->usbp, mscp->config->bulk_out);
+  }
+  chSysUnlock();
+}
 
 /**
- * @brief   CSW to be transmitted.
+ * @brief   Fails the current command with the specified sense data.
  */
-static msccsw_t CSW;
+static void msc_fail(USBMassStorageDriver *mscp, uint8_t key, uint8_t asc) {
+
+  mscp->sense_key = key;
+  mscp->sense_asc = asc;
+  mscp->csw.bCSWStatus = MSC_CSW_STATUS_FAILED;
+}
 
 /**
- * @brief   MSC state machine initialization.
+ * @brief   Checks the data phase announced by the host.
+ * @details A command whose data does not fit the host transfer, or moves
+ *          in the opposite direction, is reported as phase error.
  *
- * @param[in] usbp      pointer to the @p USBDriver object
+ * @param[in] mscp      pointer to the @p USBMassStorageDriver object
+ * @param[in] in        @p TRUE if the device sends data
+ * @param[in] n         number of bytes the device intends to transfer
+ * @return              The check result.
+ * @retval CH_SUCCESS   the data phase can be performed.
+ * @retval CH_FAILED    phase error.
  */
-static void msc_reset(USBDriver *usbp) {
+static bool_t msc_check_phase(USBMassStorageDriver *mscp,
+                              bool_t in, uint32_t n) {
+  bool_t dirin = (mscp->cbw.bmCBWFlags & MSC_CBW_DIR_IN) != 0;
+
+  if ((mscp->cbw.dCBWDataTransferLength < n) ||
+      ((n > 0) && (dirin != in))) {
+    mscp->csw.bCSWStatus = MSC_CSW_STATUS_PHASE_ERROR;
+    msc_stall_data(mscp);
+    return CH_FAILED;
+  }
+  return CH_SUCCESS;
+}
 
-  msc_state = MSC_IDLE;
-  chSysLockFromIsr();
-  usbStartReceiveI(usbp, MSC_DATA_OUT_EP, (uint8_t *)&CBW, sizeof CBW);
-  chSysUnlockFromIsr();
+/**
+ * @brief   Sends a short command response.
+ * @details The response is truncated to the host allocation. When the
+ *          host expects more data the IN pipe is stalled after the
+ *          response (6.7.2), a short packet alone does not end the data
+ *          phase if the response is a multiple of the packet size.
+ */
+static msg_t msc_send(USBMassStorageDriver *mscp, const void *p, size_t n) {
+
+  if (!(mscp->cbw.bmCBWFlags & MSC_CBW_DIR_IN)) {
+    mscp->csw.bCSWStatus = MSC_CSW_STATUS_PHASE_ERROR;
+    msc_stall_data(mscp);
+    return RDY_OK;
+  }
+  if (n > mscp->cbw.dCBWDataTransferLength)
+    n = mscp->cbw.dCBWDataTransferLength;
+  if (msc_start_transmit(mscp, p, n))
+    return RDY_RESET;
+  mscp->csw.dCSWDataResidue -= n;
+  if (msc_wait(mscp, &mscp->insem) != RDY_OK)
+    return RDY_RESET;
+  if (mscp->csw.dCSWDataResidue > 0)
+    msc_stall_data(mscp);
+  return RDY_OK;
 }
 
-static void msc_transmit(USBDriver *usbp, const uint8_t *p, size_t n) {
+/**
+ * @brief   Returns @p TRUE if the media can be accessed.
+ */
+static bool_t msc_media_ready(USBMassStorageDriver *mscp) {
+  BaseBlockDevice *bbdp = mscp->config->bbdp;
 
-  if (n > CBW.dCBWDataTransferLength)
-    n = CBW.dCBWDataTransferLength;
-  CSW.dCSWDataResidue = CBW.dCBWDataTransferLength - (uint32_t)n;
-  chSysLockFromIsr();
-  usbStartTransmitI(usbp, MSC_DATA_IN_EP, p, n);
-  chSysUnlockFromIsr();
+  return (blkGetDriverState(bbdp) == BLK_READY) ||
+         (blkGetDriverState(bbdp) == BLK_READING) ||
+         (blkGetDriverState(bbdp) == BLK_WRITING);
 }
 
-static void msc_sendstatus(USBDriver *usbp) {
+/**
+ * @brief   Reads the media capacity.
+ *
+ * @return              The operation status.
+ * @retval CH_SUCCESS   capacity retrieved.
+ * @retval CH_FAILED    media not ready, the command has been failed.
+ */
+static bool_t msc_get_capacity(USBMassStorageDriver *mscp,
+                               BlockDeviceInfo *bdip) {
+
+  if (!msc_media_ready(mscp) ||
+      blkGetInfo(mscp->config->bbdp, bdip) ||
+      (bdip->blk_size != MSC_BLOCK_SIZE)) {
+    msc_fail(mscp, SCSI_SENSE_NOT_READY, SCSI_ASC_MEDIUM_NOT_PRESENT);
+    return CH_FAILED;
+  }
+  return CH_SUCCESS;
+}
 
-  msc_state = MSC_SENDING_CSW;
-  chSysLockFromIsr();
-  usbStartTransmitI(usbp, MSC_DATA_IN_EP, (uint8_t *)&CSW, sizeof CSW);
-  chSysUnlockFromIsr();
+/**
+ * @brief   Validates the LBA range of a READ(10) or WRITE(10) command.
+ *
+ * @return              The check result.
+ * @retval CH_SUCCESS   the range can be accessed.
+ * @retval CH_FAILED    the command has been failed.
+ */
+static bool_t msc_check_range(USBMassStorageDriver *mscp,
+                              uint32_t lba, uint32_t n) {
+  BlockDeviceInfo bdi;
+
+  if (msc_get_capacity(mscp, &bdi))
+    return CH_FAILED;
+  if ((lba >= bdi.blk_num) || (n > bdi.blk_num - lba)) {
+    msc_fail(mscp, SCSI_SENSE_ILLEGAL_REQUEST, SCSI_ASC_LBA_OUT_OF_RANGE);
+    return CH_FAILED;
+  }
+  return CH_SUCCESS;
+}
+
+/**
+ * @brief   READ(10) data phase.
+ * @details Blocks are read in chunks alternating between the two buffers,
+ *          the media read of a chunk overlaps the USB transfer of the
+ *          previous one.
+ */
+static msg_t msc_read10(USBMassStorageDriver *mscp,
+                        uint32_t lba, uint32_t n) {
+  unsigned i = 0;
+  bool_t busy = FALSE;
+
+  while (n > 0) {
+    uint32_t cnt = n < MSC_BUFFER_BLOCKS ? n : MSC_BUFFER_BLOCKS;
+
+    if (blkRead(mscp->config->bbdp, lba, (uint8_t *)mscp->buf[i], cnt)) {
+      msc_fail(mscp, SCSI_SENSE_MEDIUM_ERROR, SCSI_ASC_READ_ERROR);
+      break;
+    }
+    if (busy && (msc_wait(mscp, &mscp->insem) != RDY_OK))
+      return RDY_RESET;
+    if (msc_start_transmit(mscp, mscp->buf[i], cnt * MSC_BLOCK_SIZE))
+      return RDY_RESET;
+    busy = TRUE;
+    mscp->csw.dCSWDataResidue -= cnt * MSC_BLOCK_SIZE;
+    lba += cnt;
+    n -= cnt;
+    i ^= 1;
+  }
+  if (busy && (msc_wait(mscp, &mscp->insem) != RDY_OK))
+    return RDY_RESET;
+  if (mscp->csw.dCSWDataResidue > 0)
+    msc_stall_data(mscp);
+  return RDY_OK;
 }
 
-static bool_t msc_decode(USBDriver *usbp) {
-  uint32_t nblocks, secsize;
+/**
+ * @brief   WRITE(10) data phase.
+ * @details The reception of a chunk into one buffer overlaps the media
+ *          write of the previous chunk from the other buffer. After a
+ *          media error the remaining data is received and discarded.
+ */
+static msg_t msc_write10(USBMassStorageDriver *mscp,
+                         uint32_t lba, uint32_t n) {
+  unsigned i = 0;
+  uint32_t cnt = n < MSC_BUFFER_BLOCKS ? n : MSC_BUFFER_BLOCKS;
+
+  if (msc_start_receive(mscp, mscp->buf[0], cnt * MSC_BLOCK_SIZE))
+    return RDY_RESET;
+  while (n > 0) {
+    uint32_t next;
+
+    if (msc_wait(mscp, &mscp->outsem) != RDY_OK)
+      return RDY_RESET;
+    mscp->csw.dCSWDataResidue -= cnt * MSC_BLOCK_SIZE;
+    n -= cnt;
+    next = n < MSC_BUFFER_BLOCKS ? n : MSC_BUFFER_BLOCKS;
+    if ((next > 0) &&
+        msc_start_receive(mscp, mscp->buf[i ^ 1], next * MSC_BLOCK_SIZE))
+      return RDY_RESET;
+    if ((mscp->csw.bCSWStatus == MSC_CSW_STATUS_PASSED) &&
+        blkWrite(mscp->config->bbdp, lba, (uint8_t *)mscp->buf[i], cnt))
+      msc_fail(mscp, SCSI_SENSE_MEDIUM_ERROR, SCSI_ASC_WRITE_FAULT);
+    lba += cnt;
+    cnt = next;
+    i ^= 1;
+  }
+  if (mscp->csw.dCSWDataResidue > 0)
+    msc_stall_data(mscp);
+  return RDY_OK;
+}
 
-  switch (CBW.CBWCB[0]) {
+/**
+ * @brief   Decodes and executes the received CBW.
+ *
+ * @param[in] mscp      pointer to the @p USBMassStorageDriver object
+ * @return              The execution result.
+ * @retval RDY_OK       the CSW can be sent.
+ * @retval RDY_RESET    the driver has been reset during the data phase.
+ */
+static msg_t msc_decode(USBMassStorageDriver *mscp) {
+  const uint8_t *cb = mscp->cbw.CBWCB;
+  uint8_t *p = (uint8_t *)mscp->buf[0];
+  BlockDeviceInfo bdi;
+  uint32_t lba, n;
+
+  switch (cb[0]) {
+  case SCSI_TEST_UNIT_READY:
+    if (!msc_media_ready(mscp))
+      msc_fail(mscp, SCSI_SENSE_NOT_READY, SCSI_ASC_MEDIUM_NOT_PRESENT);
+    return RDY_OK;
   case SCSI_REQUEST_SENSE:
-    break;
+    memset(p, 0, 18);
+    p[0]  = 0x70;
+    p[2]  = mscp->sense_key;
+    p[7]  = 18 - 8;
+    p[12] = mscp->sense_asc;
+    mscp->sense_key = SCSI_SENSE_NO_SENSE;
+    mscp->sense_asc = 0;
+    return msc_send(mscp, p, 18);
   case SCSI_INQUIRY:
-    msc_transmit(usbp, (uint8_t *)&scsi_inquiry_data,
-                 sizeof scsi_inquiry_data);
-    CSW.bCSWStatus = MSC_CSW_STATUS_PASSED;
-    break;
+    return msc_send(mscp, scsi_inquiry_data, sizeof scsi_inquiry_data);
   case SCSI_READ_FORMAT_CAPACITIES:
-    buf[8]  = scsi_read_format_capacities(&nblocks, &secsize);
-    buf[0]  = buf[1] = buf[2] = 0;
-    buf[3]  = 8;
-    buf[4]  = (uint8_t)(nblocks >> 24);
-    buf[5]  = (uint8_t)(nblocks >> 16);
-    buf[6]  = (uint8_t)(nblocks >> 8);
-    buf[7]  = (uint8_t)(nblocks >> 0);
-    buf[9]  = (uint8_t)(secsize >> 16);
-    buf[10] = (uint8_t)(secsize >> 8);
-    buf[11] = (uint8_t)(secsize >> 0);
-    msc_transmit(usbp, buf, 12);
-    CSW.bCSWStatus = MSC_CSW_STATUS_PASSED;
-    break;
+    memset(p, 0, 12);
+    p[3]  = 8;
+    if (msc_media_ready(mscp) && !blkGetInfo(mscp->config->bbdp, &bdi)) {
+      p[4]  = (uint8_t)(bdi.blk_num >> 24);
+      p[5]  = (uint8_t)(bdi.blk_num >> 16);
+      p[6]  = (uint8_t)(bdi.blk_num >> 8);
+      p[7]  = (uint8_t)(bdi.blk_num >> 0);
+      p[8]  = 2; /* Formatted media.*/
+    }
+    else
+      p[8]  = 3; /* No media.*/
+    p[10] = (uint8_t)(MSC_BLOCK_SIZE >> 8);
+    p[11] = (uint8_t)(MSC_BLOCK_SIZE >> 0);
+    return msc_send(mscp, p, 12);
+  case SCSI_READ_CAPACITY10:
+    if (msc_get_capacity(mscp, &bdi)) {
+      msc_stall_data(mscp);
+      return RDY_OK;
+    }
+    n = bdi.blk_num - 1;
+    p[0] = (uint8_t)(n >> 24);
+    p[1] = (uint8_t)(n >> 16);
+    p[2] = (uint8_t)(n >> 8);
+    p[3] = (uint8_t)(n >> 0);
+    p[4] = 0;
+    p[5] = 0;
+    p[6] = (uint8_t)(MSC_BLOCK_SIZE >> 8);
+    p[7] = (uint8_t)(MSC_BLOCK_SIZE >> 0);
+    return msc_send(mscp, p, 8);
+  case SCSI_MODE_SENSE6:
+    p[0] = 3;
+    p[1] = 0;
+    p[2] = msc_media_ready(mscp) &&
+           blkIsWriteProtected(mscp->config->bbdp) ? 0x80 : 0x00;
+    p[3] = 0;
+    return msc_send(mscp, p, 4);
+  case SCSI_ALLOW_MEDIUM_REMOVAL:
+  case SCSI_START_STOP_UNIT:
+  case SCSI_VERIFY10:
+    return RDY_OK;
+  case SCSI_SYNCHRONIZE_CACHE10:
+    if (msc_media_ready(mscp) && blkSync(mscp->config->bbdp))
+      msc_fail(mscp, SCSI_SENSE_MEDIUM_ERROR, SCSI_ASC_WRITE_FAULT);
+    return RDY_OK;
+  case SCSI_READ10:
+  case SCSI_WRITE10:
+    lba = ((uint32_t)cb[2] << 24) | ((uint32_t)cb[3] << 16) |
+          ((uint32_t)cb[4] << 8) | (uint32_t)cb[5];
+    n   = ((uint32_t)cb[7] << 8) | (uint32_t)cb[8];
+    if (msc_check_phase(mscp, cb[0] == SCSI_READ10, n * MSC_BLOCK_SIZE))
+      return RDY_OK;
+    if (msc_check_range(mscp, lba, n)) {
+      msc_stall_data(mscp);
+      return RDY_OK;
+    }
+    if (cb[0] == SCSI_READ10)
+      return msc_read10(mscp, lba, n);
+    if (blkIsWriteProtected(mscp->config->bbdp)) {
+      msc_fail(mscp, SCSI_SENSE_DATA_PROTECT, SCSI_ASC_WRITE_PROTECTED);
+      msc_stall_data(mscp);
+      return RDY_OK;
+    }
+    return msc_write10(mscp, lba, n);
   default:
-    return TRUE;
+    msc_fail(mscp, SCSI_SENSE_ILLEGAL_REQUEST, SCSI_ASC_INVALID_COMMAND);
+    msc_stall_data(mscp);
+    return RDY_OK;
   }
-  return FALSE;
+}
+
+/**
+ * @brief   MSC thread.
+ * @details Receives a CBW, executes the command and sends the CSW. An
+ *          invalid CBW stalls both pipes until the host performs the
+ *          reset recovery (6.6.1).
+ */
+static msg_t msc_thread(void *arg) {
+  USBMassStorageDriver *mscp = (USBMassStorageDriver *)arg;
+  USBDriver *usbp;
+  size_t n;
+
+  chRegSetThreadName("usb_msc");
+  while (TRUE) {
+    chSysLock();
+    mscp->reset = FALSE;
+    if ((mscp->state != MSC_READY) ||
+        (usbGetDriverStateI(mscp->config->usbp) != USB_ACTIVE)) {
+      msc_sleep_s(mscp);
+      chSysUnlock();
+      continue;
+    }
+    chSysUnlock();
+    usbp = mscp->config->usbp;
+
+    /* Waiting for a CBW.*/
+    if (msc_start_receive(mscp, &mscp->cbw, sizeof mscp->cbw) ||
+        (msc_wait(mscp, &mscp->outsem) != RDY_OK))
+      continue;
+    chSysLock();
+    n = usbGetReceiveTransactionSizeI(usbp, mscp->config->bulk_out);
+    if ((n != MSC_CBW_SIZE) ||
+        (mscp->cbw.dCBWSignature != MSC_CBW_SIGNATURE) ||
+        (mscp->cbw.bCBWLUN != 0) ||
+        (mscp->cbw.bCBWCBLength == 0) || (mscp->cbw.bCBWCBLength > 16)) {
+      if (!mscp->reset) {
+        usbStallTransmitI(usbp, mscp->config->bulk_in);
+        usbStallReceiveI(usbp, mscp->config->bulk_out);
+      }
+      msc_sleep_s(mscp);
+      chSysUnlock();
+      continue;
+    }
+    chSysUnlock();
+
+    /* Command execution.*/
+    mscp->csw.dCSWSignature   = MSC_CSW_SIGNATURE;
+    mscp->csw.dCSWTag         = mscp->cbw.dCBWTag;
+    mscp->csw.dCSWDataResidue = mscp->cbw.dCBWDataTransferLength;
+    mscp->csw.bCSWStatus      = MSC_CSW_STATUS_PASSED;
+    if (msc_decode(mscp) != RDY_OK)
+      continue;
+
+    /* Status transport.*/
+    if (msc_start_transmit(mscp, &mscp->csw, MSC_CSW_SIZE))
+      continue;
+    msc_wait(mscp, &mscp->insem);
+  }
+  return 0;
 }
 
 /*===========================================================================*/
 /* Driver exported functions.                                                */
 /*===========================================================================*/
 
+/**
+ * @brief   Initializes a USB mass storage driver object.
+ *
+ * @param[out] mscp     pointer to a @p USBMassStorageDriver structure
+ *
+ * @init
+ */
+void mscObjectInit(USBMassStorageDriver *mscp) {
+
+  mscp->state     = MSC_STOP;
+  mscp->config    = NULL;
+  mscp->thd_wait  = NULL;
+  mscp->reset     = FALSE;
+  mscp->started   = FALSE;
+  mscp->sense_key = SCSI_SENSE_NO_SENSE;
+  mscp->sense_asc = 0;
+  chSemInit(&mscp->insem, 0);
+  chSemInit(&mscp->outsem, 0);
+}
+
+/**
+ * @brief   Configures and starts the driver.
+ * @details The MSC thread is created on the first activation, commands
+ *          are served once the USB device has been configured.
+ *
+ * @param[in] mscp      pointer to a @p USBMassStorageDriver object
+ * @param[in] config    the mass storage driver configuration
+ *
+ * @api
+ */
+void mscStart(USBMassStorageDriver *mscp,
+              const USBMassStorageConfig *config) {
+
+  chDbgCheck((mscp != NULL) && (config != NULL) &&
+             (config->usbp != NULL) && (config->bbdp != NULL), "mscStart");
+
+  chSysLock();
+  chDbgAssert((mscp->state == MSC_STOP) || (mscp->state == MSC_READY),
+              "mscStart(), #1",
+              "invalid state");
+  chDbgAssert((usbGetEndpointParamX(config->usbp, config->bulk_in) == NULL) &&
+              (usbGetEndpointParamX(config->usbp, config->bulk_out) == NULL),
+              "mscStart(), #2",
+              "endpoint already in use");
+  mscp->config = config;
+  usbSetEndpointParamI(config->usbp, config->bulk_in, mscp);
+  usbSetEndpointParamI(config->usbp, config->bulk_out, mscp);
+  mscp->state = MSC_READY;
+  if (!mscp->started) {
+    mscp->started = TRUE;
+    chSchWakeupS(chThdCreateI(mscp->wa, sizeof(mscp->wa),
+                              MSC_THREAD_PRIORITY, msc_thread, mscp),
+                 RDY_OK);
+  }
+  else
+    msc_reset_i(mscp);
+  chSchRescheduleS();
+  chSysUnlock();
+}
+
+/**
+ * @brief   Stops the driver.
+ * @details The MSC thread aborts the current command and waits for the
+ *          next @p mscStart().
+ *
+ * @param[in] mscp      pointer to a @p USBMassStorageDriver object
+ *
+ * @api
+ */
+void mscStop(USBMassStorageDriver *mscp) {
+
+  chDbgCheck(mscp != NULL, "mscStop");
+
+  chSysLock();
+  chDbgAssert((mscp->state == MSC_STOP) || (mscp->state == MSC_READY),
+              "mscStop(), #1",
+              "invalid state");
+  if (mscp->state == MSC_READY) {
+    usbSetEndpointParamI(mscp->config->usbp, mscp->config->bulk_in, NULL);
+    usbSetEndpointParamI(mscp->config->usbp, mscp->config->bulk_out, NULL);
+  }
+  mscp->state = MSC_STOP;
+  msc_reset_i(mscp);
+  chSchRescheduleS();
+  chSysUnlock();
+}
+
+/**
+ * @brief   USB device configured handler.
+ * @details All the mass storage drivers started on @p usbp restart from
+ *          the CBW reception. The application must invoke this function
+ *          on the @p USB_EVENT_CONFIGURED and @p USB_EVENT_RESET events.
+ *
+ * @param[in] usbp      pointer to the @p USBDriver object
+ *
+ * @iclass
+ */
+void mscConfigureHookI(USBDriver *usbp) {
+  usbep_t ep;
+
+  for (ep = 1; ep <= USB_MAX_ENDPOINTS; ep++) {
+    USBMassStorageDriver *mscp = usbGetEndpointParamX(usbp, ep);
+
+    if ((mscp == NULL) || (usbp->epc[ep] == NULL) ||
+        (usbp->epc[ep]->out_cb != mscDataReceived) ||
+        (mscp->state != MSC_READY) || (mscp->config->bulk_out != ep))
+      continue;
+
+    msc_reset_i(mscp);
+  }
+}
+
 /**
  * @brief   Default requests hook.
  * @details The application must use this function as callback for the
@@ -195,7 +685,9 @@ bool_t mscRequestsHook(USBDriver *usbp) {
       usbSetupTransfer(usbp, (uint8_t *)zerobuf, 1, NULL);
       return TRUE;
     case MSC_MASS_STORAGE_RESET_COMMAND:
-      msc_reset(usbp);
+      chSysLockFromIsr();
+      mscConfigureHookI(usbp);
+      chSysUnlockFromIsr();
       usbSetupTransfer(usbp, NULL, 0, NULL);
       return TRUE;
     default:
@@ -214,25 +706,14 @@ bool_t mscRequestsHook(USBDriver *usbp) {
  * @param[in] ep        endpoint number
  */
 void mscDataTransmitted(USBDriver *usbp, usbep_t ep) {
+  USBMassStorageDriver *mscp = usbGetEndpointParamX(usbp, ep);
 
-  switch (msc_state) {
-  case MSC_DATA_IN:
-    CSW.dCSWSignature = MSC_CSW_SIGNATURE;
-    CSW.dCSWTag = CBW.dCBWTag;
-    chSysLockFromIsr();
-    usbStartTransmitI(usbp, ep, (uint8_t *)&CSW, sizeof CSW);
-    chSysUnlockFromIsr();
-    msc_state = MSC_SENDING_CSW;
-    break;
-  case MSC_SENDING_CSW:
-    chSysLockFromIsr();
-    usbStartReceiveI(usbp, MSC_DATA_OUT_EP, (uint8_t *)&CBW, sizeof CBW);
-    chSysUnlockFromIsr();
-    msc_state = MSC_IDLE;
-    break;
-  default:
-    ;
-  }
+  if (mscp == NULL)
+    return;
+
+  chSysLockFromIsr();
+  chSemSignalI(&mscp->insem);
+  chSysUnlockFromIsr();
 }
 
 /**
@@ -244,60 +725,14 @@ void mscDataTransmitted(USBDriver *usbp, usbep_t ep) {
  * @param[in] ep        endpoint number
  */
 void mscDataReceived(USBDriver *usbp, usbep_t ep) {
-  size_t n;
-
-  n = usbGetReceiveTransactionSizeI(usbp, ep);
-  switch (msc_state) {
-  case MSC_IDLE:
-    if ((n != sizeof(msccbw_t)) || (CBW.dCBWSignature != MSC_CBW_SIGNATURE))
-      goto stall_out; /* 6.6.1 */
-
-    /* Decoding SCSI command.*/
-    if (msc_decode(usbp)) {
-      if (CBW.dCBWDataTransferLength == 0) {
-        CSW.bCSWStatus = MSC_CSW_STATUS_FAILED;
-        CSW.dCSWDataResidue = 0;
-        msc_sendstatus(usbp);
-        return;
-      }
-      goto stall_both;
-    }
+  USBMassStorageDriver *mscp = usbGetEndpointParamX(usbp, ep);
 
-    /* Commands with zero transfer length, 5.1.*/
-    if (CBW.dCBWDataTransferLength == 0) {
-      msc_sendstatus(usbp);
-      return;
-    }
+  if (mscp == NULL)
+    return;
 
-    /* Transfer direction.*/
-    if (CBW.bmCBWFlags & 0x80) {
-      /* IN, Device to Host.*/
-      msc_state = MSC_DATA_IN;
-    }
-    else {
-      /* OUT, Host to Device.*/
-      msc_state = MSC_DATA_OUT;
-    }
-    break;
-  case MSC_DATA_OUT:
-    break;
-  default:
-    ;
-  }
-  return;
-stall_out:
-  msc_state = MSC_ERROR;
-  chSysLockFromIsr();
-  usbStallReceiveI(usbp, ep);
-  chSysUnlockFromIsr();
-  return;
-stall_both:
-  msc_state = MSC_ERROR;
   chSysLockFromIsr();
-  usbStallTransmitI(usbp, ep);
-  usbStallReceiveI(usbp, ep);
+  chSemSignalI(&mscp->outsem);
   chSysUnlockFromIsr();
-  return;
 }
 
 /** @} */
@@ -71,44 +71,76 @@
 #define SCSI_VERIFY12               0xAF
 #define SCSI_VERIFY16               0x8F
 
+#define SCSI_SYNCHRONIZE_CACHE10    0x35
+
 #define SCSI_SEND_DIAGNOSTIC        0x1D
 #define SCSI_READ_FORMAT_CAPACITIES 0x23
 
+#define SCSI_SENSE_NO_SENSE         0x00
+#define SCSI_SENSE_NOT_READY        0x02
+#define SCSI_SENSE_MEDIUM_ERROR     0x03
+#define SCSI_SENSE_ILLEGAL_REQUEST  0x05
+#define SCSI_SENSE_DATA_PROTECT     0x07
+
+#define SCSI_ASC_INVALID_COMMAND    0x20
+#define SCSI_ASC_LBA_OUT_OF_RANGE   0x21
+#define SCSI_ASC_WRITE_PROTECTED    0x27
+#define SCSI_ASC_MEDIUM_NOT_PRESENT 0x3A
+#define SCSI_ASC_WRITE_FAULT        0x03
+#define SCSI_ASC_READ_ERROR         0x11
+
 /*===========================================================================*/
 /* Driver pre-compile time settings.                                         */
 /*===========================================================================*/
 
 /**
- * @brief   Endpoint number for bulk IN.
+ * @brief   Number of blocks in each of the two transfer buffers.
+ * @details READ(10) and WRITE(10) are served in chunks of this size, the
+ *          media access on a buffer overlaps the USB transfer of the
+ *          other buffer.
  */
-#if !defined(MSC_DATA_IN_EP) || defined(__DOXYGEN__)
-#define MSC_DATA_IN_EP          1
+#if !defined(MSC_BUFFER_BLOCKS) || defined(__DOXYGEN__)
+#define MSC_BUFFER_BLOCKS       4
 #endif
 
 /**
- * @brief   Endpoint number for bulk OUT.
+ * @brief   Stack size of the MSC thread.
  */
-#if !defined(MSC_DATA_OUT_EP) || defined(__DOXYGEN__)
-#define MSC_DATA_OUT_EP         2
+#if !defined(MSC_THREAD_STACK_SIZE) || defined(__DOXYGEN__)
+#define MSC_THREAD_STACK_SIZE   256
+#endif
+
+/**
+ * @brief   Priority of the MSC thread.
+ */
+#if !defined(MSC_THREAD_PRIORITY) || defined(__DOXYGEN__)
+#define MSC_THREAD_PRIORITY     NORMALPRIO
 #endif
 
 /*===========================================================================*/
 /* Derived constants and error checks.                                       */
 /*===========================================================================*/
 
+#if !CH_USE_SEMAPHORES
+#error "USB_MSC requires CH_USE_SEMAPHORES"
+#endif
+
+/**
+ * @brief   Supported block size.
+ */
+#define MSC_BLOCK_SIZE          512
+
 /*===========================================================================*/
 /* Driver data structures and types.                                         */
 /*===========================================================================*/
 
 /**
- * @brief   Type of the MSC possible states.
+ * @brief   Type of the MSC driver possible states.
  */
 typedef enum {
-  MSC_IDLE = 0,
-  MSC_DATA_OUT,
-  MSC_DATA_IN,
-  MSC_SENDING_CSW,
-  MSC_ERROR
+  MSC_UNINIT = 0,                   /**< Not initialized.                   */
+  MSC_STOP = 1,                     /**< Stopped.                           */
+  MSC_READY = 2                     /**< Ready.                             */
 } mscstate_t;
 
 /**
@@ -144,6 +176,64 @@ typedef struct CBW msccbw_t;
  */
 typedef struct CSW msccsw_t;
 
+/**
+ * @brief   USB mass storage driver configuration structure.
+ */
+typedef struct {
+  /**
+   * @brief   USB driver to use.
+   */
+  USBDriver                 *usbp;
+  /**
+   * @brief   Block device exported as the only LUN.
+   * @note    The device must use 512 bytes blocks, the application is
+   *          responsible of connecting it.
+   */
+  BaseBlockDevice           *bbdp;
+  /**
+   * @brief   Bulk IN endpoint.
+   */
+  usbep_t                   bulk_in;
+  /**
+   * @brief   Bulk OUT endpoint.
+   */
+  usbep_t                   bulk_out;
+} USBMassStorageConfig;
+
+/**
+ * @brief   Structure representing an USB mass storage driver.
+ * @details Commands are served by a dedicated thread, the endpoint
+ *          callbacks only signal the transfers completion.
+ */
+typedef struct {
+  /** @brief Driver state.*/
+  mscstate_t                state;
+  /** @brief Current configuration data.*/
+  const USBMassStorageConfig *config;
+  /** @brief Signaled on IN transfers completion.*/
+  Semaphore                 insem;
+  /** @brief Signaled on OUT transfers completion.*/
+  Semaphore                 outsem;
+  /** @brief Idle thread waiting for the USB configuration or a reset.*/
+  Thread                    *thd_wait;
+  /** @brief Bulk-only reset or reconfiguration pending.*/
+  volatile bool_t           reset;
+  /** @brief Thread created flag.*/
+  bool_t                    started;
+  /** @brief Last received CBW.*/
+  msccbw_t                  cbw;
+  /** @brief CSW to be transmitted.*/
+  msccsw_t                  csw;
+  /** @brief Sense key of the last failed command.*/
+  uint8_t                   sense_key;
+  /** @brief Additional sense code of the last failed command.*/
+  uint8_t                   sense_asc;
+  /** @brief Transfer buffers.*/
+  uint32_t                  buf[2][MSC_BUFFER_BLOCKS * MSC_BLOCK_SIZE / 4];
+  /** @brief MSC thread working area.*/
+  WORKING_AREA(wa, MSC_THREAD_STACK_SIZE);
+} USBMassStorageDriver;
+
 /*===========================================================================*/
 /* Driver macros.                                                            */
 /*===========================================================================*/
@@ -155,6 +245,11 @@ typedef struct CSW msccsw_t;
 #ifdef __cplusplus
 extern "C" {
 #endif
+  void mscObjectInit(USBMassStorageDriver *mscp);
+  void mscStart(USBMassStorageDriver *mscp,
+                const USBMassStorageConfig *config);
+  void mscStop(USBMassStorageDriver *mscp);
+  void mscConfigureHookI(USBDriver *usbp);
   bool_t mscRequestsHook(USBDriver *usbp);
   void mscDataTransmitted(USBDriver *usbp, usbep_t ep);
   void mscDataReceived(USBDriver *usbp, usbep_t ep);
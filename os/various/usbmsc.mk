@@ -0,0 +1,4 @@
+# USB mass storage class files.
+USBMSCSRC = ${CHIBIOS}/os/various/usb_msc.c
+
+USBMSCINC = ${CHIBIOS}/os/various
@@ -0,0 +1,301 @@
+/**
+ * @file    test/host/bulk_pkt_test.c
+ * @brief   Host test of the bulk packets over USB driver.
+ * @details Runs application/bulk_pkt_usb.c over the USB device model of
+ *          usb_model.h. The test plays the role of the host: it completes
+ *          the transfers prepared on the endpoints and calls the driver
+ *          callbacks as the USB ISR does. Transfers must use the posted
+ *          buffers directly, one transfer per buffer and in order.
+ *
+ * @{
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ch.h"
+#include "hal.h"
+
+#include "bulk_pkt_usb.h"
+
+#define EP_DATA         3
+#define PKT_SIZE        64
+
+/*===========================================================================*/
+/* USB device model.                                                         */
+/*===========================================================================*/
+
+static USBDriver usbd;
+
+static const USBEndpointConfig epconfig = {
+  bpuDataTransmitted,
+  bpuDataReceived,
+  PKT_SIZE,
+  PKT_SIZE
+};
+
+void usbPrepareReceive(USBDriver *usbp, usbep_t ep, uint8_t *buf, size_t n) {
+
+  usbp->out[ep].buf = buf;
+  usbp->out[ep].n   = n;
+}
+
+void usbPrepareTransmit(USBDriver *usbp, usbep_t ep,
+                        const uint8_t *buf, size_t n) {
+
+  usbp->in[ep].buf = buf;
+  usbp->in[ep].n   = n;
+}
+
+bool_t usbStartReceiveI(USBDriver *usbp, usbep_t ep) {
+
+  assert(!usbGetReceiveStatusI(usbp, ep));
+  usbp->receiving |= 1 << ep;
+  usbp->out[ep].starts++;
+  return FALSE;
+}
+
+bool_t usbStartTransmitI(USBDriver *usbp, usbep_t ep) {
+
+  assert(!usbGetTransmitStatusI(usbp, ep));
+  usbp->transmitting |= 1 << ep;
+  usbp->in[ep].starts++;
+  return FALSE;
+}
+
+/* The host sends n bytes, the receive in progress completes.*/
+static void host_send(usbep_t ep, uint8_t fill, size_t n) {
+
+  assert(usbGetReceiveStatusI(&usbd, ep) && (n <= usbd.out[ep].n));
+  memset((uint8_t *)usbd.out[ep].buf, fill, n);
+  usbd.rxsize[ep] = n;
+  usbd.receiving &= ~(1 << ep);
+  usbd.epc[ep]->out_cb(&usbd, ep);
+}
+
+/* The host takes the transmit in progress.*/
+static void host_take(usbep_t ep) {
+
+  assert(usbGetTransmitStatusI(&usbd, ep));
+  usbd.transmitting &= ~(1 << ep);
+  usbd.epc[ep]->in_cb(&usbd, ep);
+}
+
+static void configure(void) {
+
+  usbd.state = USB_ACTIVE;
+  usbd.transmitting = 0;
+  usbd.receiving = 0;
+  usbd.epc[EP_DATA] = &epconfig;
+  bpuConfigureHookI(&usbd);
+}
+
+/*===========================================================================*/
+/* Test helpers.                                                             */
+/*===========================================================================*/
+
+static unsigned failures;
+
+#define CHECK(c, ...) do {                                                  \
+  if (!(c)) {                                                               \
+    failures++;                                                             \
+    printf("FAIL %s:%d: ", __FILE__, __LINE__);                             \
+    printf(__VA_ARGS__);                                                    \
+    printf("\n");                                                           \
+  }                                                                         \
+} while (0)
+
+static BulkPacketUSBDriver bpu;
+
+static const BulkPacketUSBConfig bpucfg = {
+  &usbd,
+  EP_DATA,
+  EP_DATA
+};
+
+static uint8_t rxbuf[BULK_PKT_USB_RING_SIZE][4 * PKT_SIZE];
+static uint8_t txbuf[BULK_PKT_USB_RING_SIZE + 1][4 * PKT_SIZE];
+
+/*===========================================================================*/
+/* Tests.                                                                    */
+/*===========================================================================*/
+
+/*
+ * Nothing moves before the device is configured, configuration is
+ * reported once.
+ */
+static void test_connect(void) {
+
+  bpuObjectInit(&bpu);
+  bpuStart(&bpu, &bpucfg);
+  CHECK(usbGetEndpointParamX(&usbd, EP_DATA) == &bpu,
+        "connect: endpoint not routed to the driver");
+
+  bpuPostReceive(&bpu, rxbuf[0], sizeof rxbuf[0]);
+  CHECK(usbd.out[EP_DATA].starts == 0,
+        "connect: receive started before configuration");
+
+  configure();
+  CHECK(bpu.event.es_flags == BPU_CONNECTED, "connect: flags %x",
+        (unsigned)bpu.event.es_flags);
+  CHECK((usbd.out[EP_DATA].starts == 1) &&
+        (usbd.out[EP_DATA].buf == rxbuf[0]) &&
+        (usbd.out[EP_DATA].n == sizeof rxbuf[0]),
+        "connect: posted buffer not armed on configuration");
+}
+
+/*
+ * Each transfer fills one posted buffer in place, buffers are returned
+ * in order with the transfer size.
+ */
+static void test_receive(void) {
+  uint8_t *bp;
+  msg_t n;
+  int i;
+
+  for (i = 1; i < BULK_PKT_USB_RING_SIZE; i++)
+    bpuPostReceive(&bpu, rxbuf[i], sizeof rxbuf[i]);
+  CHECK(usbd.out[EP_DATA].starts == 1,
+        "receive: %u receives started", usbd.out[EP_DATA].starts);
+
+  n = bpuReceiveTimeout(&bpu, &bp, TIME_IMMEDIATE);
+  CHECK(n == RDY_TIMEOUT, "receive: %d before any transfer", (int)n);
+
+  bpu.event.es_flags = 0;
+  host_send(EP_DATA, 0xA0, 10);
+  host_send(EP_DATA, 0xA1, 4 * PKT_SIZE);
+  CHECK(bpu.event.es_flags == BPU_RX_DONE, "receive: flags %x",
+        (unsigned)bpu.event.es_flags);
+  CHECK((usbd.out[EP_DATA].starts == 3) &&
+        (usbd.out[EP_DATA].buf == rxbuf[2]),
+        "receive: next posted buffer not armed");
+
+  n = bpuReceiveTimeout(&bpu, &bp, TIME_IMMEDIATE);
+  CHECK((n == 10) && (bp == rxbuf[0]) && (bp[0] == 0xA0) && (bp[9] == 0xA0),
+        "receive: first buffer %d bytes", (int)n);
+  n = bpuReceiveTimeout(&bpu, &bp, TIME_IMMEDIATE);
+  CHECK((n == 4 * PKT_SIZE) && (bp == rxbuf[1]) &&
+        (bp[4 * PKT_SIZE - 1] == 0xA1),
+        "receive: second buffer %d bytes", (int)n);
+  n = bpuReceiveTimeout(&bpu, &bp, TIME_IMMEDIATE);
+  CHECK(n == RDY_TIMEOUT, "receive: %d with no filled buffer", (int)n);
+
+  /* Returned buffers can be posted again behind the pending ones.*/
+  bpuPostReceive(&bpu, rxbuf[0], sizeof rxbuf[0]);
+  bpuPostReceive(&bpu, rxbuf[1], sizeof rxbuf[1]);
+  for (i = 2; i < BULK_PKT_USB_RING_SIZE + 2; i++) {
+    host_send(EP_DATA, (uint8_t)i, 1);
+    n = bpuReceiveTimeout(&bpu, &bp, TIME_IMMEDIATE);
+    CHECK((n == 1) && (bp == rxbuf[i % BULK_PKT_USB_RING_SIZE]) &&
+          (bp[0] == i), "receive: ring wrap, buffer %d", i);
+  }
+  CHECK(!usbGetReceiveStatusI(&usbd, EP_DATA),
+        "receive: armed with no posted buffer");
+}
+
+/*
+ * Packets are sent in order from the caller buffers, a transmission with
+ * a size multiple of the packet size is terminated by a zero length
+ * packet, slots are released only when the host took the data.
+ */
+static void test_transmit(void) {
+  static const size_t sizes[BULK_PKT_USB_RING_SIZE] = {
+    10, PKT_SIZE, 0, 3 * PKT_SIZE
+  };
+  unsigned starts = usbd.in[EP_DATA].starts;
+  msg_t msg;
+  int i;
+
+  for (i = 0; i < BULK_PKT_USB_RING_SIZE; i++) {
+    msg = bpuPostTransmitTimeout(&bpu, txbuf[i], sizes[i], TIME_IMMEDIATE);
+    CHECK(msg == RDY_OK, "transmit: post %d returned %d", i, (int)msg);
+  }
+  msg = bpuPostTransmitTimeout(&bpu, txbuf[i], 1, TIME_IMMEDIATE);
+  CHECK(msg == RDY_TIMEOUT, "transmit: post on a full ring returned %d",
+        (int)msg);
+  CHECK(usbd.in[EP_DATA].starts == starts + 1,
+        "transmit: %u transmits started", usbd.in[EP_DATA].starts - starts);
+
+  bpu.event.es_flags = 0;
+  for (i = 0; i < BULK_PKT_USB_RING_SIZE; i++) {
+    CHECK((usbd.in[EP_DATA].buf == txbuf[i]) &&
+          (usbd.in[EP_DATA].n == sizes[i]),
+          "transmit: packet %d not sent from its buffer", i);
+    host_take(EP_DATA);
+    if ((sizes[i] > 0) && (sizes[i] % PKT_SIZE == 0)) {
+      CHECK(usbGetTransmitStatusI(&usbd, EP_DATA) &&
+            (usbd.in[EP_DATA].n == 0),
+            "transmit: packet %d not terminated", i);
+      CHECK(chSemGetCounterI(&bpu.txsem) == i,
+            "transmit: packet %d released before its zero length packet",
+            i);
+      host_take(EP_DATA);
+    }
+    CHECK(chSemGetCounterI(&bpu.txsem) == i + 1,
+          "transmit: packet %d not released", i);
+  }
+  CHECK(bpu.event.es_flags == BPU_TX_DONE, "transmit: flags %x",
+        (unsigned)bpu.event.es_flags);
+  CHECK(!usbGetTransmitStatusI(&usbd, EP_DATA),
+        "transmit: still transmitting with an empty ring");
+  CHECK(usbd.in[EP_DATA].starts == starts + BULK_PKT_USB_RING_SIZE + 2,
+        "transmit: %u transmits started", usbd.in[EP_DATA].starts - starts);
+}
+
+/*
+ * A reconfiguration drops the pending transmissions and keeps the posted
+ * receive buffers.
+ */
+static void test_reconfigure(void) {
+  uint8_t *bp;
+  msg_t n;
+
+  bpuPostReceive(&bpu, rxbuf[0], sizeof rxbuf[0]);
+  bpuPostTransmitTimeout(&bpu, txbuf[0], 5, TIME_IMMEDIATE);
+  bpuPostTransmitTimeout(&bpu, txbuf[1], 5, TIME_IMMEDIATE);
+
+  /* Bus reset, the transfers in progress are lost.*/
+  configure();
+  CHECK(chSemGetCounterI(&bpu.txsem) == BULK_PKT_USB_RING_SIZE,
+        "reconfigure: transmit slots not released");
+  CHECK(bpu.tx.busy == bpu.tx.wr, "reconfigure: transmissions pending");
+  CHECK(usbGetReceiveStatusI(&usbd, EP_DATA) &&
+        (usbd.out[EP_DATA].buf == rxbuf[0]),
+        "reconfigure: posted buffer not armed");
+  host_send(EP_DATA, 0xB0, 2);
+  n = bpuReceiveTimeout(&bpu, &bp, TIME_IMMEDIATE);
+  CHECK((n == 2) && (bp == rxbuf[0]), "reconfigure: received %d", (int)n);
+}
+
+/*
+ * A stopped driver ignores the endpoint callbacks and releases the
+ * endpoints.
+ */
+static void test_stop(void) {
+  uint8_t *bp;
+  msg_t n;
+
+  bpuPostReceive(&bpu, rxbuf[1], sizeof rxbuf[1]);
+  bpuStop(&bpu);
+  CHECK(usbGetEndpointParamX(&usbd, EP_DATA) == NULL,
+        "stop: endpoint still routed to the driver");
+  host_send(EP_DATA, 0xC0, 1);
+  n = bpuReceiveTimeout(&bpu, &bp, TIME_IMMEDIATE);
+  CHECK(n == RDY_TIMEOUT, "stop: received %d", (int)n);
+  CHECK(chSemGetCounterI(&bpu.txsem) == BULK_PKT_USB_RING_SIZE,
+        "stop: transmit slots not released");
+}
+
+int main(void) {
+
+  test_connect();
+  test_receive();
+  test_transmit();
+  test_reconfigure();
+  test_stop();
+
+  printf("bulk_pkt_test: %u failures\n", failures);
+  return failures != 0;
+}
+
+/** @} */
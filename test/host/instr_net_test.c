@@ -0,0 +1,663 @@
+/**
+ * @file    test/host/instr_net_test.c
+ * @brief   Host test of the instrument protocol network front end.
+ * @details Runs application/instr_net.c over the lwIP 1.4.1 raw API with a
+ *          loopback interface, the test clients and the front end share
+ *          the same stack. The instrument thread is replaced by an echo
+ *          checking the content of every request it receives, it runs
+ *          when the network is quiet so requests complete asynchronously.
+ *
+ *          TCP requests are sent whole, split across several segments one
+ *          byte at a time, and in excess of what the front end can answer
+ *          without waiting for its responses to be acknowledged. The pbufs
+ *          held by the connection and its receive window are checked at
+ *          each step.
+ *
+ * @{
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+/* Responses refused by the send buffer, see test_tcp_refused().*/
+#define tcp_write       net_tcp_write
+
+#include "instr_net.c"
+
+#undef tcp_write
+err_t tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len,
+                u8_t apiflags);
+
+#include "lwip/init.h"
+#include "lwip/ip.h"
+#include "lwip/memp.h"
+#include "lwip/stats.h"
+#include "lwip/tcp_impl.h"
+
+/*===========================================================================*/
+/* Instrument thread stand-in.                                               */
+/*===========================================================================*/
+
+#define TYPE_ECHO       0x10        /* Echoed back, response flag set.      */
+#define TYPE_SILENT     0x11        /* Dispatched, no response.             */
+#define TYPE_RESPONSE   0x80
+
+/* Largest packet, the payload fills the union.*/
+#define PKT_MAX         (USB_PKT_MIN_HEADER_SZ + 250)
+
+static instr_request_t *requests[INSTR_REQUEST_QUEUE_SIZE];
+static unsigned req_head, req_count;
+
+static unsigned dispatched;
+static unsigned dispatch_bad;
+static unsigned dispatch_next;
+static unsigned dispatch_inplace;
+
+static uint8_t value(unsigned id, unsigned k) {
+
+  return (uint8_t)(id * 31 + k * 7 + 1);
+}
+
+msg_t instrPostRequest(instr_request_t *rp) {
+
+  if (req_count >= INSTR_REQUEST_QUEUE_SIZE)
+    return RDY_TIMEOUT;
+  requests[(req_head + req_count++) % INSTR_REQUEST_QUEUE_SIZE] = rp;
+  return RDY_OK;
+}
+
+/*
+ * Requests carry a sequence number in the checksum field and a payload
+ * derived from it, they must be dispatched whole and in order.
+ */
+static bool_t echo(const uint8_t *req, int rval, usb_packet_t *rsp) {
+  unsigned id = req[2] | (req[3] << 8), k;
+
+  dispatched++;
+  if ((const uint8_t *)rsp != req)
+    dispatch_inplace++;
+  if ((rval != req[0]) || (id != dispatch_next))
+    dispatch_bad++;
+  for (k = 0; k < (unsigned)rval - USB_PKT_MIN_HEADER_SZ; k++)
+    if (req[USB_PKT_MIN_HEADER_SZ + k] != value(id, k))
+      dispatch_bad++;
+  dispatch_next = id + 1;
+  if (req[1] == TYPE_SILENT)
+    return FALSE;
+  memmove(rsp, req, rval);
+  rsp->type |= TYPE_RESPONSE;
+  return TRUE;
+}
+
+/*
+ * Serves one queued request, as the instrument thread does.
+ */
+static bool_t instr_serve(void) {
+  instr_request_t *rp;
+
+  if (req_count == 0)
+    return FALSE;
+  rp = requests[req_head];
+  req_head = (req_head + 1) % INSTR_REQUEST_QUEUE_SIZE;
+  req_count--;
+  rp->send = echo(rp->req, rp->rval, &rp->rsp);
+  rp->done(rp);
+  return TRUE;
+}
+
+/* Number of writes to refuse with ERR_MEM.*/
+static unsigned write_refuse;
+
+err_t net_tcp_write(struct tcp_pcb *pcb, const void *dataptr, u16_t len,
+                    u8_t apiflags) {
+
+  if (write_refuse > 0) {
+    write_refuse--;
+    return ERR_MEM;
+  }
+  return tcp_write(pcb, dataptr, len, apiflags);
+}
+
+/*===========================================================================*/
+/* Loopback interface.                                                       */
+/*===========================================================================*/
+
+#define LOOP_MAX        64
+
+static struct netif nif;
+static struct pbuf *loop_queue[LOOP_MAX];
+static unsigned loop_head, loop_count;
+
+/*
+ * Sent packets are copied and queued, the stack does not expect its
+ * output to be received before the function returns.
+ */
+static err_t loop_output(struct netif *netif, struct pbuf *p,
+                         ip_addr_t *ipaddr) {
+  struct pbuf *q;
+
+  (void)netif;
+  (void)ipaddr;
+
+  if (loop_count >= LOOP_MAX)
+    return ERR_MEM;
+  q = pbuf_alloc(PBUF_RAW, p->tot_len, PBUF_RAM);
+  if (q == NULL)
+    return ERR_MEM;
+  pbuf_copy(q, p);
+  loop_queue[(loop_head + loop_count++) % LOOP_MAX] = q;
+  return ERR_OK;
+}
+
+static err_t loop_init(struct netif *netif) {
+
+  netif->output = loop_output;
+  netif->mtu = 1500;
+  netif->flags = NETIF_FLAG_UP;
+  return ERR_OK;
+}
+
+/*===========================================================================*/
+/* Test helpers.                                                             */
+/*===========================================================================*/
+
+static unsigned failures;
+
+#define CHECK(c, ...) do {                                                  \
+  if (!(c)) {                                                               \
+    failures++;                                                             \
+    printf("FAIL %s:%d: ", __FILE__, __LINE__);                             \
+    printf(__VA_ARGS__);                                                    \
+    printf("\n");                                                           \
+  }                                                                         \
+} while (0)
+
+/* Largest amount of undispatched data held by the connection.*/
+static unsigned held_max;
+
+static unsigned conn_pending(void);
+
+static void net_poll(void) {
+  unsigned idle = 0;
+
+  while (idle < 2) {
+    if (loop_count > 0) {
+      struct pbuf *p = loop_queue[loop_head];
+
+      loop_head = (loop_head + 1) % LOOP_MAX;
+      loop_count--;
+      ip_input(p, &nif);
+      if (conn_pending() > held_max)
+        held_max = conn_pending();
+      idle = 0;
+    }
+    else if (instr_serve())
+      idle = 0;
+    else {
+      /* Delayed ACKs and poll callbacks.*/
+      host_now += TCP_SLOW_INTERVAL;
+      tcp_fasttmr();
+      tcp_slowtmr();
+      idle++;
+    }
+  }
+}
+
+/*
+ * Test client, parses the response stream.
+ */
+static struct {
+  struct tcp_pcb        *pcb;
+  bool_t                connected;
+  err_t                 err;
+  uint8_t               rx[sizeof(usb_packet_t)];
+  size_t                rxlen;
+  unsigned              responses;
+  unsigned              bad;
+  unsigned              next;
+  /* Stream still to be sent.*/
+  const uint8_t         *tx;
+  size_t                txlen;
+  size_t                chunk;
+  bool_t                burst;
+  /* Slow reader, the received bytes are not acknowledged to the stack.*/
+  bool_t                hold;
+  u16_t                 held;
+} cl;
+
+static err_t client_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
+                         err_t err) {
+  u16_t off;
+
+  (void)arg;
+  (void)err;
+
+  if (p == NULL)
+    return ERR_OK;
+  for (off = 0; off < p->tot_len; off++) {
+    cl.rx[cl.rxlen++] = pbuf_get_at(p, off);
+    if ((cl.rx[0] < USB_PKT_MIN_HEADER_SZ) || (cl.rxlen < cl.rx[0]))
+      continue;
+    /* Complete response.*/
+    if ((cl.rx[1] != (TYPE_ECHO | TYPE_RESPONSE)) ||
+        ((cl.rx[2] | (cl.rx[3] << 8)) != (int)cl.next))
+      cl.bad++;
+    cl.next = (cl.rx[2] | (cl.rx[3] << 8)) + 1;
+    cl.responses++;
+    cl.rxlen = 0;
+  }
+  if (cl.hold)
+    cl.held += p->tot_len;
+  else
+    tcp_recved(pcb, p->tot_len);
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+/* Sends the next chunk of the stream as a segment of its own.*/
+static bool_t client_push(void) {
+  size_t n = cl.txlen < cl.chunk ? cl.txlen : cl.chunk;
+
+  if ((cl.pcb == NULL) || (n == 0) || (tcp_sndbuf(cl.pcb) < n) ||
+      (tcp_write(cl.pcb, cl.tx, (u16_t)n, TCP_WRITE_FLAG_COPY) != ERR_OK))
+    return FALSE;
+  tcp_output(cl.pcb);
+  cl.tx += n;
+  cl.txlen -= n;
+  return TRUE;
+}
+
+static err_t client_sent(void *arg, struct tcp_pcb *pcb, u16_t len) {
+
+  (void)arg;
+  (void)pcb;
+  (void)len;
+
+  while (client_push() && cl.burst)
+    ;
+  return ERR_OK;
+}
+
+static void client_err(void *arg, err_t err) {
+
+  (void)arg;
+
+  cl.err = err;
+  cl.pcb = NULL;
+}
+
+static err_t client_connected(void *arg, struct tcp_pcb *pcb, err_t err) {
+
+  (void)arg;
+  (void)pcb;
+
+  cl.connected = err == ERR_OK;
+  return ERR_OK;
+}
+
+static void client_open(void) {
+
+  memset(&cl, 0, sizeof(cl));
+  dispatch_next = 0;
+  cl.pcb = tcp_new();
+  tcp_recv(cl.pcb, client_recv);
+  tcp_sent(cl.pcb, client_sent);
+  tcp_err(cl.pcb, client_err);
+  tcp_nagle_disable(cl.pcb);
+  tcp_connect(cl.pcb, &nif.ip_addr, INSTR_NET_PORT, client_connected);
+  net_poll();
+  CHECK(cl.connected && (conns[0].pcb != NULL), "client not connected");
+}
+
+/*
+ * Sends a stream, one chunk per round trip or, in burst mode, as much as
+ * the send buffer takes.
+ */
+static void client_send(const uint8_t *buf, size_t len, size_t chunk,
+                        bool_t burst) {
+  size_t left;
+
+  cl.tx = buf;
+  cl.txlen = len;
+  cl.chunk = chunk;
+  cl.burst = burst;
+  do {
+    left = cl.txlen;
+    while (client_push() && burst)
+      ;
+    net_poll();
+  } while ((cl.txlen > 0) && (cl.txlen < left));
+}
+
+/* Queues a stream without letting the stack run.*/
+static void client_push_all(const uint8_t *buf, size_t len) {
+
+  tcp_write(cl.pcb, buf, (u16_t)len, TCP_WRITE_FLAG_COPY);
+  tcp_output(cl.pcb);
+}
+
+static void client_close(void) {
+
+  if (cl.pcb != NULL)
+    tcp_close(cl.pcb);
+  cl.pcb = NULL;
+  net_poll();
+}
+
+/* Builds request packets, returns the stream length.*/
+static size_t build(uint8_t *buf, unsigned first, unsigned n, uint8_t len,
+                    uint8_t type) {
+  size_t pos = 0;
+  unsigned id, k;
+
+  for (id = first; id < first + n; id++) {
+    buf[pos++] = len;
+    buf[pos++] = type;
+    buf[pos++] = (uint8_t)id;
+    buf[pos++] = (uint8_t)(id >> 8);
+    for (k = 0; k < (unsigned)len - USB_PKT_MIN_HEADER_SZ; k++)
+      buf[pos++] = value(id, k);
+  }
+  return pos;
+}
+
+/* Bytes received by the connection and not yet answered.*/
+static unsigned conn_pending(void) {
+
+  return conns[0].rx == NULL ? 0 : conns[0].rx->tot_len - conns[0].rxoff;
+}
+
+static void check_idle(const char *name) {
+
+  CHECK((conns[0].pcb == NULL) && !conns[0].busy,
+        "%s: connection slot not freed", name);
+  CHECK(req_count == 0, "%s: requests left", name);
+  CHECK(conns[0].rx == NULL, "%s: received data not freed", name);
+  CHECK(lwip_stats.memp[MEMP_PBUF].used == 0,
+        "%s: %u reference pbufs leaked", name,
+        (unsigned)lwip_stats.memp[MEMP_PBUF].used);
+  CHECK(lwip_stats.memp[MEMP_PBUF_POOL].used == 0,
+        "%s: %u pool pbufs leaked", name,
+        (unsigned)lwip_stats.memp[MEMP_PBUF_POOL].used);
+  CHECK(lwip_stats.mem.used == 0, "%s: %u heap bytes leaked", name,
+        (unsigned)lwip_stats.mem.used);
+}
+
+/*===========================================================================*/
+/* Test cases.                                                               */
+/*===========================================================================*/
+
+static uint8_t stream[20 * PKT_MAX];
+
+static void test_setup(void) {
+  ip_addr_t ip, gateway, netmask;
+
+  lwip_init();
+  IP4_ADDR(&ip, 192, 168, 1, 20);
+  IP4_ADDR(&gateway, 192, 168, 1, 1);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  netif_add(&nif, &ip, &netmask, &gateway, NULL, loop_init, ip_input);
+  netif_set_default(&nif);
+  netif_set_up(&nif);
+  instrNetStart();
+}
+
+/*
+ * Several packets in a single segment, answered in order.
+ */
+static void test_tcp_whole(void) {
+  size_t len = build(stream, 0, 5, 40, TYPE_ECHO);
+
+  client_open();
+  dispatched = dispatch_bad = dispatch_inplace = 0;
+  client_send(stream, len, len, FALSE);
+  CHECK((dispatched == 5) && (dispatch_bad == 0),
+        "whole: %u dispatched, %u bad", dispatched, dispatch_bad);
+  CHECK(dispatch_inplace == 5, "whole: %u requests parsed in place",
+        dispatch_inplace);
+  CHECK((cl.responses == 5) && (cl.bad == 0),
+        "whole: %u responses, %u bad", cl.responses, cl.bad);
+  CHECK((conns[0].rx == NULL) && (conns[0].pcb->rcv_wnd == TCP_WND),
+        "whole: data held or window not reopened");
+  client_close();
+  check_idle("whole");
+}
+
+/*
+ * Packets received one byte per segment, every packet spans several
+ * pbufs of the connection chain. The dispatched pbufs must be released
+ * as soon as they are consumed and the window must only be kept closed
+ * for the bytes of the incomplete packet.
+ */
+static void test_tcp_partial(void) {
+  size_t len = build(stream, 0, 3, 10, TYPE_ECHO), partial = len - 4;
+
+  client_open();
+  dispatched = dispatch_bad = dispatch_inplace = 0;
+  client_send(stream, partial, 1, FALSE);
+  CHECK((dispatched == 2) && (dispatch_bad == 0),
+        "partial: %u dispatched, %u bad", dispatched, dispatch_bad);
+  CHECK(dispatch_inplace == 0, "partial: split request parsed in place");
+  CHECK(conn_pending() == 6, "partial: %u bytes pending", conn_pending());
+  CHECK((conns[0].rx != NULL) && (conns[0].rxoff == 0) &&
+        (pbuf_clen(conns[0].rx) == 6),
+        "partial: consumed pbufs not released, %u pbufs at %u",
+        pbuf_clen(conns[0].rx), (unsigned)conns[0].rxoff);
+  CHECK(conns[0].pcb->rcv_wnd == TCP_WND - 6, "partial: window %u",
+        (unsigned)conns[0].pcb->rcv_wnd);
+
+  /* Remaining bytes in a segment followed by the half of another packet,
+     the head pbuf is then only partially consumed.*/
+  len = build(stream + len, 3, 1, 10, TYPE_ECHO);
+  client_send(stream + partial, 4 + 5, 9, FALSE);
+  CHECK((dispatched == 3) && (dispatch_bad == 0),
+        "partial: %u dispatched, %u bad", dispatched, dispatch_bad);
+  CHECK((conn_pending() == 5) && (conns[0].rxoff == 4) &&
+        (pbuf_clen(conns[0].rx) == 1),
+        "partial: %u bytes pending at %u", conn_pending(),
+        (unsigned)conns[0].rxoff);
+  CHECK(conns[0].pcb->rcv_wnd == TCP_WND - 5, "partial: window %u",
+        (unsigned)conns[0].pcb->rcv_wnd);
+
+  client_send(stream + partial + 9, 5, 1, FALSE);
+  CHECK((dispatched == 4) && (dispatch_bad == 0),
+        "partial: %u dispatched, %u bad", dispatched, dispatch_bad);
+  CHECK((cl.responses == 4) && (cl.bad == 0),
+        "partial: %u responses, %u bad", cl.responses, cl.bad);
+  CHECK((conns[0].rx == NULL) && (conns[0].pcb->rcv_wnd == TCP_WND),
+        "partial: data held or window not reopened");
+  client_close();
+  check_idle("partial");
+}
+
+/*
+ * More requests than the send buffer can answer while the client does not
+ * read the responses, dispatching resumes when the responses can be sent
+ * again and the window is reopened.
+ */
+static void test_tcp_backpressure(void) {
+  unsigned n = sizeof(stream) / PKT_MAX;
+  size_t len = build(stream, 0, n, PKT_MAX, TYPE_ECHO);
+
+  client_open();
+  dispatched = dispatch_bad = 0;
+  held_max = 0;
+  cl.hold = TRUE;
+  client_send(stream, len, 300, TRUE);
+  CHECK((held_max >= PKT_MAX) && (dispatched < n),
+        "backpressure: dispatching never deferred");
+  CHECK(conns[0].pcb->rcv_wnd == TCP_WND - conn_pending(),
+        "backpressure: window %u with %u bytes pending",
+        (unsigned)conns[0].pcb->rcv_wnd, conn_pending());
+
+  cl.hold = FALSE;
+  tcp_recved(cl.pcb, cl.held);
+  client_send(cl.tx, cl.txlen, 300, TRUE);
+  CHECK((dispatched == n) && (dispatch_bad == 0),
+        "backpressure: %u dispatched, %u bad", dispatched, dispatch_bad);
+  CHECK((cl.responses == n) && (cl.bad == 0) && (cl.txlen == 0),
+        "backpressure: %u responses, %u bad, %u not sent",
+        cl.responses, cl.bad, (unsigned)cl.txlen);
+  CHECK((conns[0].rx == NULL) && (conns[0].pcb->rcv_wnd == TCP_WND),
+        "backpressure: data held or window not reopened");
+  client_close();
+  check_idle("backpressure");
+}
+
+/*
+ * Requests without response and a malformed packet, the connection is
+ * aborted and its data released.
+ */
+static void test_tcp_malformed(void) {
+  size_t len = build(stream, 0, 2, 8, TYPE_SILENT);
+  unsigned errors = instr_net_stats.errors;
+
+  client_open();
+  dispatched = dispatch_bad = 0;
+  stream[len++] = 2;
+  memset(&stream[len], 0, 10);
+  client_send(stream, len + 10, 3, FALSE);
+  CHECK((dispatched == 2) && (dispatch_bad == 0) && (cl.responses == 0),
+        "malformed: %u dispatched, %u bad, %u responses",
+        dispatched, dispatch_bad, cl.responses);
+  CHECK(instr_net_stats.errors == errors + 1, "malformed: error not counted");
+  CHECK((cl.pcb == NULL) && (cl.err == ERR_RST), "malformed: not aborted");
+  net_poll();
+  check_idle("malformed");
+}
+
+/*
+ * Responses refused by the send buffer with nothing in flight, the
+ * packets are kept and answered from the poll callback.
+ */
+static void test_tcp_refused(void) {
+  size_t len = build(stream, 0, 3, 20, TYPE_ECHO);
+
+  client_open();
+  dispatched = dispatch_bad = 0;
+  write_refuse = 2;
+  client_send(stream, len, len, FALSE);
+  CHECK(write_refuse == 0, "refused: writes not attempted");
+  CHECK((dispatched == 3) && (dispatch_bad == 0),
+        "refused: %u dispatched, %u bad", dispatched, dispatch_bad);
+  CHECK((cl.responses == 3) && (cl.bad == 0),
+        "refused: %u responses, %u bad", cl.responses, cl.bad);
+  CHECK((conns[0].rx == NULL) && (conns[0].pcb->rcv_wnd == TCP_WND),
+        "refused: data held or window not reopened");
+  client_close();
+  check_idle("refused");
+}
+
+/*
+ * Connection closed by the client while its request is served, the
+ * request buffer is released on completion.
+ */
+static void test_tcp_close_busy(void) {
+  size_t len = build(stream, 0, 1, 20, TYPE_ECHO);
+
+  client_open();
+  dispatched = dispatch_bad = 0;
+  client_push_all(stream, len);
+  tcp_close(cl.pcb);
+  cl.pcb = NULL;
+  /* Data and FIN delivered before the instrument thread runs.*/
+  while (loop_count > 0) {
+    struct pbuf *p = loop_queue[loop_head];
+
+    loop_head = (loop_head + 1) % LOOP_MAX;
+    loop_count--;
+    ip_input(p, &nif);
+  }
+  CHECK((conns[0].pcb == NULL) && conns[0].busy && (conns[0].rx != NULL),
+        "close busy: request buffer released while in flight");
+  net_poll();
+  CHECK((dispatched == 1) && (dispatch_bad == 0),
+        "close busy: %u dispatched, %u bad", dispatched, dispatch_bad);
+  check_idle("close busy");
+}
+
+/*
+ * UDP responses gathered in datagrams of up to INSTR_NET_UDP_MAX bytes.
+ */
+static unsigned udp_dgrams, udp_responses, udp_bad;
+
+static void udp_client_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                            ip_addr_t *addr, u16_t port) {
+  u16_t off = 0;
+
+  (void)arg;
+  (void)pcb;
+  (void)addr;
+  (void)port;
+
+  udp_dgrams++;
+  if (p->tot_len > INSTR_NET_UDP_MAX)
+    udp_bad++;
+  while (off + USB_PKT_MIN_HEADER_SZ <= p->tot_len) {
+    u8_t len = pbuf_get_at(p, off);
+
+    if ((len < USB_PKT_MIN_HEADER_SZ) ||
+        (pbuf_get_at(p, off + 1) != (TYPE_ECHO | TYPE_RESPONSE))) {
+      udp_bad++;
+      break;
+    }
+    udp_responses++;
+    off += len;
+  }
+  if (off != p->tot_len)
+    udp_bad++;
+  pbuf_free(p);
+}
+
+static void test_udp(void) {
+  struct udp_pcb *upcb;
+  struct pbuf *p;
+  size_t len = build(stream, 0, 5, 250, TYPE_ECHO);
+
+  upcb = udp_new();
+  udp_bind(upcb, IP_ADDR_ANY, INSTR_NET_PORT + 1);
+  udp_recv(upcb, udp_client_recv, NULL);
+
+  /* Trailing garbage, shorter than a header.*/
+  stream[len++] = 0xFF;
+  stream[len++] = 0xFF;
+  dispatched = dispatch_bad = 0;
+  dispatch_next = 0;
+  p = pbuf_alloc(PBUF_TRANSPORT, (u16_t)len, PBUF_RAM);
+  memcpy(p->payload, stream, len);
+  udp_sendto(upcb, p, &nif.ip_addr, INSTR_NET_PORT);
+  /* Received while the first one is served.*/
+  udp_sendto(upcb, p, &nif.ip_addr, INSTR_NET_PORT);
+  pbuf_free(p);
+  net_poll();
+
+  CHECK((dispatched == 5) && (dispatch_bad == 0),
+        "udp: %u dispatched, %u bad", dispatched, dispatch_bad);
+  CHECK((udp_dgrams == 2) && (udp_responses == 5) && (udp_bad == 0),
+        "udp: %u datagrams, %u responses, %u bad",
+        udp_dgrams, udp_responses, udp_bad);
+  CHECK(instr_net_stats.dropped == 1, "udp: %u datagrams dropped",
+        (unsigned)instr_net_stats.dropped);
+  udp_remove(upcb);
+  check_idle("udp");
+}
+
+int main(void) {
+
+  test_setup();
+  test_tcp_whole();
+  test_tcp_partial();
+  test_tcp_backpressure();
+  test_tcp_malformed();
+  test_tcp_refused();
+  test_tcp_close_busy();
+  test_udp();
+
+  printf("instr_net_test: %u requests, %u accepted, %u errors, "
+         "%u failures\n", (unsigned)instr_net_stats.requests,
+         (unsigned)instr_net_stats.accepted,
+         (unsigned)instr_net_stats.errors, failures);
+  return failures != 0;
+}
+
+/** @} */
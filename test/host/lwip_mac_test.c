@@ -0,0 +1,639 @@
+/**
+ * @file    test/host/lwip_mac_test.c
+ * @brief   Host test of the lwIP bindings zero copy paths.
+ * @details Runs os/various/lwip_bindings/lwipthread.c over a loopback MAC
+ *          model. Every transmitted frame is received back by the same
+ *          interface, so TCP and UDP endpoints of a single lwIP instance
+ *          talk to each other through the driver paths under test.
+ *
+ *          The model records the content of each frame when it is handed
+ *          to the DMA and compares it with what the DMA reads when the
+ *          frame is actually sent, any change of the memory lent to the
+ *          DMA in between is reported.
+ *
+ * @{
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mac_model.h"
+#include "lwipthread.c"
+
+#include "lwip/init.h"
+#include "lwip/memp.h"
+#include "lwip/tcp.h"
+#include "lwip/tcp_impl.h"
+#include "lwip/udp.h"
+
+/*===========================================================================*/
+/* Loopback MAC model.                                                       */
+/*===========================================================================*/
+
+#define NTX             STM32_MAC_TRANSMIT_BUFFERS
+#define NRX             STM32_MAC_RECEIVE_BUFFERS
+#define FRAME_MAX       STM32_MAC_BUFFERS_SIZE
+
+typedef enum {
+  TX_FREE = 0,                      /* Available.                           */
+  TX_FILLING,                       /* Taken by the driver.                 */
+  TX_OWN,                           /* Owned by the DMA.                    */
+  TX_DONE                           /* Sent, waiting to be reclaimed.       */
+} txstate_t;
+
+typedef enum {
+  RX_EMPTY = 0,                     /* Owned by the DMA.                    */
+  RX_FULL,                          /* Frame waiting to be fetched.         */
+  RX_CPU                            /* Fetched, not yet released.           */
+} rxstate_t;
+
+static struct {
+  txstate_t             state;
+  const uint8_t         *buf;
+  size_t                size;
+  bool_t                last;
+  bool_t                chained;
+  void                  *param;
+  uint8_t               own[FRAME_MAX];
+  /* Frame content when handed to the DMA, first descriptor only.*/
+  uint8_t               expect[FRAME_MAX];
+  size_t                expect_len;
+} tx[NTX];
+
+static struct {
+  rxstate_t             state;
+  size_t                size;
+  uint8_t               buf[FRAME_MAX];
+} rx[NRX];
+
+static unsigned tx_next, tx_dma, rx_wr, rx_rd;
+
+static struct {
+  unsigned              tx_chains;
+  unsigned              tx_copies;
+  unsigned              tx_frames;
+  unsigned              tx_corrupted;
+  unsigned              rx_frames;
+  unsigned              rx_lent;
+  unsigned              rx_dropped;
+} mst;
+
+MACDriver ETHD1;
+
+static void mac_snapshot(unsigned first) {
+  unsigned i = first;
+  size_t len = 0;
+
+  while (TRUE) {
+    assert(len + tx[i].size <= FRAME_MAX);
+    memcpy(&tx[first].expect[len], tx[i].buf, tx[i].size);
+    len += tx[i].size;
+    if (tx[i].last)
+      break;
+    i = (i + 1) % NTX;
+  }
+  tx[first].expect_len = len;
+}
+
+static void rx_deliver(const uint8_t *frame, size_t len) {
+
+  if (rx[rx_wr].state != RX_EMPTY) {
+    mst.rx_dropped++;
+    return;
+  }
+  memcpy(rx[rx_wr].buf, frame, len);
+  rx[rx_wr].size  = len;
+  rx[rx_wr].state = RX_FULL;
+  rx_wr = (rx_wr + 1) % NRX;
+  mst.rx_frames++;
+  chEvtBroadcastI(&ETHD1.rdevent);
+}
+
+/*
+ * Sends the frames owned by the DMA, each one is looped back to the
+ * receive ring.
+ */
+static unsigned mac_dma_run(void) {
+  static uint8_t frame[FRAME_MAX];
+  unsigned n = 0;
+
+  while (tx[tx_dma].state == TX_OWN) {
+    unsigned first = tx_dma;
+    size_t len = 0;
+
+    while (TRUE) {
+      unsigned i = tx_dma;
+
+      assert(tx[i].state == TX_OWN);
+      memcpy(&frame[len], tx[i].buf, tx[i].size);
+      len += tx[i].size;
+      tx[i].state = tx[i].chained ? TX_DONE : TX_FREE;
+      tx_dma = (tx_dma + 1) % NTX;
+      if (tx[i].last)
+        break;
+    }
+    if ((len != tx[first].expect_len) ||
+        (memcmp(frame, tx[first].expect, len) != 0))
+      mst.tx_corrupted++;
+    mst.tx_frames++;
+    rx_deliver(frame, len);
+    n++;
+  }
+  return n;
+}
+
+void macStart(MACDriver *macp, const MACConfig *config) {
+
+  macp->config = config;
+}
+
+bool_t macPollLinkStatus(MACDriver *macp) {
+
+  (void)macp;
+  return TRUE;
+}
+
+msg_t macWaitTransmitDescriptor(MACDriver *macp, MACTransmitDescriptor *tdp,
+                                systime_t time) {
+
+  (void)macp;
+
+  /* Waiting is modeled by letting the DMA run.*/
+  while (tx[tx_next].state != TX_FREE) {
+    if ((time == TIME_IMMEDIATE) || (mac_dma_run() == 0))
+      return RDY_TIMEOUT;
+  }
+  tx[tx_next].state = TX_FILLING;
+  tdp->slot   = tx_next;
+  tdp->offset = 0;
+  tx_next = (tx_next + 1) % NTX;
+  return RDY_OK;
+}
+
+size_t mac_lld_write_transmit_descriptor(MACTransmitDescriptor *tdp,
+                                         uint8_t *buf, size_t size) {
+
+  if (size > FRAME_MAX - tdp->offset)
+    size = FRAME_MAX - tdp->offset;
+  memcpy(&tx[tdp->slot].own[tdp->offset], buf, size);
+  tdp->offset += size;
+  return size;
+}
+
+void macReleaseTransmitDescriptor(MACTransmitDescriptor *tdp) {
+  unsigned i = tdp->slot;
+
+  assert(tx[i].state == TX_FILLING);
+  tx[i].buf     = tx[i].own;
+  tx[i].size    = tdp->offset;
+  tx[i].last    = TRUE;
+  tx[i].chained = FALSE;
+  tx[i].param   = NULL;
+  mac_snapshot(i);
+  tx[i].state   = TX_OWN;
+  mst.tx_copies++;
+}
+
+msg_t macWaitTransmitChain(MACDriver *macp, MACTransmitChain *tcp,
+                           unsigned n, mactxreclaimcb_t cb, systime_t time) {
+  unsigned i;
+
+  assert((n > 0) && (n <= MAC_TRANSMIT_CHAIN_MAX));
+
+  while (TRUE) {
+    macReclaimTransmitChains(macp, cb);
+    for (i = 0; i < n; i++)
+      if (tx[(tx_next + i) % NTX].state != TX_FREE)
+        break;
+    if (i == n)
+      break;
+    if ((time == TIME_IMMEDIATE) || (mac_dma_run() == 0))
+      return RDY_TIMEOUT;
+  }
+  for (i = 0; i < n; i++)
+    tx[(tx_next + i) % NTX].state = TX_FILLING;
+  tcp->first = tcp->next = tx_next;
+  tcp->n = n;
+  tx_next = (tx_next + n) % NTX;
+  return RDY_OK;
+}
+
+void macAddTransmitSegment(MACTransmitChain *tcp,
+                           const uint8_t *buf, size_t size) {
+  unsigned i = tcp->next;
+
+  assert((buf != NULL) && (size > 0) && (size <= FRAME_MAX));
+  assert((tcp->n > 0) && (tx[i].state == TX_FILLING));
+  tx[i].buf     = buf;
+  tx[i].size    = size;
+  tx[i].last    = FALSE;
+  tx[i].chained = TRUE;
+  tx[i].param   = NULL;
+  tcp->next = (i + 1) % NTX;
+  tcp->n--;
+}
+
+void macReleaseTransmitChain(MACTransmitChain *tcp, void *param) {
+  unsigned i, last = (tcp->next + NTX - 1) % NTX;
+
+  assert(tcp->n == 0);
+  tx[last].last  = TRUE;
+  tx[last].param = param;
+  mac_snapshot(tcp->first);
+  for (i = tcp->first; ; i = (i + 1) % NTX) {
+    tx[i].state = TX_OWN;
+    if (i == last)
+      break;
+  }
+  mst.tx_chains++;
+}
+
+void macReclaimTransmitChains(MACDriver *macp, mactxreclaimcb_t cb) {
+  unsigned i;
+
+  (void)macp;
+
+  for (i = 0; i < NTX; i++) {
+    if (tx[i].state != TX_DONE)
+      continue;
+    tx[i].state = TX_FREE;
+    if ((tx[i].param != NULL) && (cb != NULL))
+      cb(tx[i].param);
+    tx[i].param = NULL;
+  }
+}
+
+msg_t macWaitReceiveDescriptor(MACDriver *macp, MACReceiveDescriptor *rdp,
+                               systime_t time) {
+
+  (void)macp;
+  (void)time;
+
+  if (rx[rx_rd].state != RX_FULL)
+    return RDY_TIMEOUT;
+  rx[rx_rd].state = RX_CPU;
+  rdp->slot   = rx_rd;
+  rdp->offset = 0;
+  rdp->size   = rx[rx_rd].size;
+  rx_rd = (rx_rd + 1) % NRX;
+  return RDY_OK;
+}
+
+size_t mac_lld_read_receive_descriptor(MACReceiveDescriptor *rdp,
+                                       uint8_t *buf, size_t size) {
+
+  if (size > rdp->size - rdp->offset)
+    size = rdp->size - rdp->offset;
+  memcpy(buf, &rx[rdp->slot].buf[rdp->offset], size);
+  rdp->offset += size;
+  return size;
+}
+
+const uint8_t *mac_lld_get_next_receive_buffer(MACReceiveDescriptor *rdp,
+                                               size_t *sizep) {
+  const uint8_t *p;
+
+  if (rdp->offset >= rdp->size) {
+    *sizep = 0;
+    return NULL;
+  }
+  p = &rx[rdp->slot].buf[rdp->offset];
+  *sizep = rdp->size - rdp->offset;
+  rdp->offset = rdp->size;
+  mst.rx_lent++;
+  return p;
+}
+
+void macReleaseReceiveDescriptor(MACReceiveDescriptor *rdp) {
+
+  assert(rx[rdp->slot].state == RX_CPU);
+  rx[rdp->slot].state = RX_EMPTY;
+}
+
+/*===========================================================================*/
+/* Test helpers.                                                             */
+/*===========================================================================*/
+
+static unsigned failures;
+
+#define CHECK(c, ...) do {                                                  \
+  if (!(c)) {                                                               \
+    failures++;                                                             \
+    printf("FAIL %s:%d: ", __FILE__, __LINE__);                             \
+    printf(__VA_ARGS__);                                                    \
+    printf("\n");                                                           \
+  }                                                                         \
+} while (0)
+
+static struct netif nif;
+
+static uint8_t value(unsigned k) {
+
+  return (uint8_t)(k * 29 + 3);
+}
+
+/*
+ * Moves the frames through the loopback until the network is quiet, as
+ * the lwIP thread does on the receive event and on the periodic timer.
+ */
+static void net_poll(void) {
+  unsigned idle = 0;
+
+  while (idle < 2) {
+    struct pbuf *p;
+    bool_t progress = mac_dma_run() > 0;
+
+    while ((p = low_level_input(&nif)) != NULL) {
+      if (nif.input(p, &nif) != ERR_OK)
+        pbuf_free(p);
+      progress = TRUE;
+    }
+    if (progress)
+      idle = 0;
+    else {
+      /* Delayed ACKs and reclaim of the transmitted frames.*/
+      host_now += TCP_FAST_INTERVAL;
+      tcp_fasttmr();
+      tcpip_callback_with_block(tx_reclaim, NULL, 0);
+      idle++;
+    }
+  }
+}
+
+static unsigned rx_free_count(void) {
+  struct rx_pbuf *rxp;
+  unsigned n = 0;
+
+  for (rxp = rx_free; rxp != NULL; rxp = rxp->next)
+    n++;
+  return n;
+}
+
+/*
+ * TCP endpoints, the server collects the received stream.
+ */
+#define TCP_PORT        7000
+#define STREAM_SIZE     (3 * TCP_MSS + 100)
+
+static struct tcp_pcb *server, *client;
+static uint8_t stream[STREAM_SIZE];
+static uint8_t received[2 * STREAM_SIZE];
+static size_t nreceived;
+static bool_t connected;
+
+static err_t server_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
+                         err_t err) {
+
+  (void)arg;
+  (void)err;
+
+  if (p == NULL) {
+    tcp_close(pcb);
+    server = NULL;
+    return ERR_OK;
+  }
+  if (nreceived + p->tot_len <= sizeof(received))
+    pbuf_copy_partial(p, &received[nreceived], p->tot_len, 0);
+  nreceived += p->tot_len;
+  tcp_recved(pcb, p->tot_len);
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+static err_t server_accept(void *arg, struct tcp_pcb *pcb, err_t err) {
+
+  struct tcp_pcb *lpcb = arg;
+
+  (void)err;
+
+  tcp_accepted(lpcb);
+  server = pcb;
+  tcp_recv(pcb, server_recv);
+  return ERR_OK;
+}
+
+static err_t client_connected(void *arg, struct tcp_pcb *pcb, err_t err) {
+
+  (void)arg;
+  (void)pcb;
+
+  connected = err == ERR_OK;
+  return ERR_OK;
+}
+
+/*
+ * UDP endpoint, collects the received datagram.
+ */
+#define UDP_PORT        7001
+#define DGRAM_SIZE      300
+
+static uint8_t dgram[DGRAM_SIZE];
+static uint8_t dgram_rx[DGRAM_SIZE];
+static size_t dgram_len;
+
+static void udp_server_recv(void *arg, struct udp_pcb *pcb, struct pbuf *p,
+                            ip_addr_t *addr, u16_t port) {
+
+  (void)arg;
+  (void)pcb;
+  (void)addr;
+  (void)port;
+
+  dgram_len = p->tot_len;
+  pbuf_copy_partial(p, dgram_rx, sizeof(dgram_rx), 0);
+  pbuf_free(p);
+}
+
+/*===========================================================================*/
+/* Test cases.                                                               */
+/*===========================================================================*/
+
+static void test_setup(void) {
+  static const MACConfig mac_config = {nif.hwaddr};
+  ip_addr_t ip, gateway, netmask;
+  unsigned i;
+
+  lwip_init();
+
+  rx_free = NULL;
+  for (i = 0; i < LWIP_ZERO_COPY_RX_PBUFS; i++) {
+    rx_pbufs[i].next = rx_free;
+    rx_free = &rx_pbufs[i];
+  }
+
+  nif.hwaddr[0] = LWIP_ETHADDR_0;
+  nif.hwaddr[1] = LWIP_ETHADDR_1;
+  nif.hwaddr[2] = LWIP_ETHADDR_2;
+  nif.hwaddr[3] = LWIP_ETHADDR_3;
+  nif.hwaddr[4] = LWIP_ETHADDR_4;
+  nif.hwaddr[5] = LWIP_ETHADDR_5;
+  LWIP_IPADDR(&ip);
+  LWIP_GATEWAY(&gateway);
+  LWIP_NETMASK(&netmask);
+  macStart(&ETHD1, &mac_config);
+  netif_add(&nif, &ip, &netmask, &gateway, NULL, ethernetif_init,
+            tcpip_input);
+  netif_set_default(&nif);
+  netif_set_up(&nif);
+
+  for (i = 0; i < sizeof(stream); i++)
+    stream[i] = value(i);
+  for (i = 0; i < sizeof(dgram); i++)
+    dgram[i] = value(i + 1000);
+}
+
+/*
+ * A TCP segment is retransmitted while the previous transmission is still
+ * owned by the DMA, the stack rewrites the headers of the segment pbuf in
+ * place. The frame already handed to the DMA must not change.
+ */
+static void test_tcp_retransmit(void) {
+  struct tcp_pcb *lpcb;
+  unsigned chains;
+
+  lpcb = tcp_new();
+  tcp_bind(lpcb, IP_ADDR_ANY, TCP_PORT);
+  lpcb = tcp_listen(lpcb);
+  tcp_arg(lpcb, lpcb);
+  tcp_accept(lpcb, server_accept);
+
+  client = tcp_new();
+  tcp_connect(client, &nif.ip_addr, TCP_PORT, client_connected);
+  net_poll();
+  CHECK(connected && (server != NULL), "tcp: connection not established");
+  if (!connected || (server == NULL))
+    return;
+
+  /* Payload referenced by the segments, the headers are in their own
+     pbufs so the frames take the zero copy path.*/
+  chains = mst.tx_chains;
+  CHECK(tcp_write(client, stream, sizeof(stream), 0) == ERR_OK,
+        "tcp: write failed");
+  tcp_output(client);
+  CHECK(mst.tx_chains > chains, "tcp: zero copy path not taken");
+
+  /* Retransmission before the DMA ran, the retransmitted frames wait for
+     the descriptors of the previous ones.*/
+  tcp_rexmit_rto(client);
+  tcp_output(client);
+  CHECK(mst.tx_corrupted == 0,
+        "tcp: %u frames modified while owned by the DMA", mst.tx_corrupted);
+
+  net_poll();
+  CHECK(mst.tx_corrupted == 0,
+        "tcp: %u frames modified while owned by the DMA", mst.tx_corrupted);
+  CHECK((nreceived == sizeof(stream)) &&
+        (memcmp(received, stream, sizeof(stream)) == 0),
+        "tcp: %u bytes received, expected %u",
+        (unsigned)nreceived, (unsigned)sizeof(stream));
+  CHECK(client->unacked == NULL, "tcp: data not acknowledged");
+
+  tcp_close(client);
+  client = NULL;
+  net_poll();
+  tcp_close(lpcb);
+}
+
+/*
+ * A datagram referencing the application buffer, the UDP header is
+ * prepended in its own pbuf.
+ */
+static void test_udp(void) {
+  struct udp_pcb *upcb, *spcb;
+  struct pbuf *p;
+  unsigned chains = mst.tx_chains;
+
+  spcb = udp_new();
+  udp_bind(spcb, IP_ADDR_ANY, UDP_PORT);
+  udp_recv(spcb, udp_server_recv, NULL);
+
+  upcb = udp_new();
+  p = pbuf_alloc(PBUF_TRANSPORT, sizeof(dgram), PBUF_REF);
+  p->payload = dgram;
+  CHECK(udp_sendto(upcb, p, &nif.ip_addr, UDP_PORT) == ERR_OK,
+        "udp: send failed");
+  pbuf_free(p);
+  CHECK(mst.tx_chains > chains, "udp: zero copy path not taken");
+  net_poll();
+
+  CHECK(mst.tx_corrupted == 0,
+        "udp: %u frames modified while owned by the DMA", mst.tx_corrupted);
+  CHECK((dgram_len == sizeof(dgram)) &&
+        (memcmp(dgram_rx, dgram, sizeof(dgram)) == 0),
+        "udp: %u bytes received", (unsigned)dgram_len);
+  udp_remove(upcb);
+  udp_remove(spcb);
+}
+
+/*
+ * A frame referenced by another owner is copied, the driver must not keep
+ * it after returning.
+ */
+static void test_shared_frame(void) {
+  struct pbuf *hdr, *data;
+  unsigned chains = mst.tx_chains, copies = mst.tx_copies;
+  struct eth_hdr *eh;
+
+  hdr = pbuf_alloc(PBUF_RAW, SIZEOF_ETH_HDR, PBUF_RAM);
+  data = pbuf_alloc(PBUF_RAW, 64, PBUF_RAM);
+  eh = hdr->payload;
+  memcpy(&eh->dest, nif.hwaddr, ETHARP_HWADDR_LEN);
+  memcpy(&eh->src, nif.hwaddr, ETHARP_HWADDR_LEN);
+  eh->type = PP_HTONS(0x88B5);
+  memset(data->payload, 0xA5, data->len);
+  pbuf_cat(hdr, data);
+
+  pbuf_ref(hdr);
+  CHECK(low_level_output(&nif, hdr) == ERR_OK, "shared: output failed");
+  CHECK((mst.tx_chains == chains) && (mst.tx_copies == copies + 1),
+        "shared: frame not copied");
+  CHECK(hdr->ref == 2, "shared: reference kept by the driver");
+  memset(data->payload, 0x5A, data->len);
+  pbuf_free(hdr);
+  pbuf_free(hdr);
+  net_poll();
+  CHECK(mst.tx_corrupted == 0, "shared: frame modified");
+}
+
+/*
+ * Everything lent to the DMA or by the DMA must be back.
+ */
+static void test_release(void) {
+  unsigned i;
+
+  net_poll();
+  for (i = 0; i < NTX; i++)
+    CHECK(tx[i].state == TX_FREE, "release: tx descriptor %u state %d",
+          i, tx[i].state);
+  for (i = 0; i < NRX; i++)
+    CHECK(rx[i].state == RX_EMPTY, "release: rx buffer %u state %d",
+          i, rx[i].state);
+  CHECK(rx_free_count() == LWIP_ZERO_COPY_RX_PBUFS,
+        "release: %u receive pbufs free", rx_free_count());
+  CHECK(mst.rx_lent > 0, "release: zero copy receive path not taken");
+  CHECK(lwip_stats.memp[MEMP_PBUF].used == 0,
+        "release: %u reference pbufs leaked",
+        (unsigned)lwip_stats.memp[MEMP_PBUF].used);
+  CHECK(lwip_stats.memp[MEMP_PBUF_POOL].used == 0,
+        "release: %u pool pbufs leaked",
+        (unsigned)lwip_stats.memp[MEMP_PBUF_POOL].used);
+  CHECK(lwip_stats.mem.used == 0, "release: %u heap bytes leaked",
+        (unsigned)lwip_stats.mem.used);
+}
+
+int main(void) {
+
+  test_setup();
+  test_tcp_retransmit();
+  test_udp();
+  test_shared_frame();
+  test_release();
+
+  printf("lwip_mac_test: %u frames sent (%u zero copy, %u copied), "
+         "%u received (%u lent, %u dropped), %u failures\n",
+         mst.tx_frames, mst.tx_chains, mst.tx_copies, mst.rx_frames,
+         mst.rx_lent, mst.rx_dropped, failures);
+  return failures != 0;
+}
+
+/** @} */
@@ -0,0 +1,49 @@
+/**
+ * @file    test/host/lwip_port/arch/cc.h
+ * @brief   lwIP compiler and platform definitions of the host tests.
+ *
+ * @{
+ */
+
+#ifndef __CC_H__
+#define __CC_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef uint8_t         u8_t;
+typedef int8_t          s8_t;
+typedef uint16_t        u16_t;
+typedef int16_t         s16_t;
+typedef uint32_t        u32_t;
+typedef int32_t         s32_t;
+typedef uintptr_t       mem_ptr_t;
+
+#define U16_F           "u"
+#define S16_F           "d"
+#define X16_F           "x"
+#define U32_F           "u"
+#define S32_F           "d"
+#define X32_F           "x"
+#define SZT_F           "zu"
+
+#define LWIP_PLATFORM_DIAG(x)   do {printf x;} while (0)
+#define LWIP_PLATFORM_ASSERT(x) do {                                        \
+  printf("lwIP assertion \"%s\" failed at %s:%d\n", x, __FILE__, __LINE__); \
+  abort();                                                                  \
+} while (0)
+
+#ifndef BYTE_ORDER
+#define BYTE_ORDER      LITTLE_ENDIAN
+#endif
+#define LWIP_PROVIDE_ERRNO
+
+#define PACK_STRUCT_STRUCT      __attribute__((packed))
+#define PACK_STRUCT_BEGIN
+#define PACK_STRUCT_END
+#define PACK_STRUCT_FIELD(x)    x
+
+#endif /* __CC_H__ */
+
+/** @} */
@@ -0,0 +1,16 @@
+/**
+ * @file    test/host/lwip_port/arch/perf.h
+ * @brief   lwIP performance measurement hooks, unused on the host.
+ *
+ * @{
+ */
+
+#ifndef __PERF_H__
+#define __PERF_H__
+
+#define PERF_START
+#define PERF_STOP(x)
+
+#endif /* __PERF_H__ */
+
+/** @} */
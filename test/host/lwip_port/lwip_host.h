@@ -0,0 +1,42 @@
+/**
+ * @file    test/host/lwip_port/lwip_host.h
+ * @brief   Stand-ins for the lwIP OS glue, forced into the builds using
+ *          lwIP.
+ * @details With @p NO_SYS the tcpip thread API is not declared by lwIP,
+ *          the tests provide it running the callbacks synchronously.
+ *
+ * @{
+ */
+
+#ifndef _LWIP_HOST_H_
+#define _LWIP_HOST_H_
+
+#include "lwip/opt.h"
+#include "lwip/err.h"
+#include "lwip/pbuf.h"
+#include "lwip/netif.h"
+
+typedef void (*tcpip_init_done_fn)(void *arg);
+typedef void (*tcpip_callback_fn)(void *ctx);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+  void tcpip_init(tcpip_init_done_fn tcpip_init_done, void *arg);
+  err_t tcpip_input(struct pbuf *p, struct netif *inp);
+  err_t tcpip_callback_with_block(tcpip_callback_fn function, void *ctx,
+                                  u8_t block);
+#ifdef __cplusplus
+}
+#endif
+
+#define tcpip_callback(f, ctx)          tcpip_callback_with_block(f, ctx, 1)
+
+/**
+ * @brief   Current time in milliseconds, advanced by the tests.
+ */
+extern u32_t host_now;
+
+#endif /* _LWIP_HOST_H_ */
+
+/** @} */
@@ -0,0 +1,49 @@
+/**
+ * @file    test/host/lwip_port/lwipopts.h
+ * @brief   lwIP options of the host tests.
+ * @details Raw API only, no OS, no timers. The memory statistics are kept
+ *          so the tests can check that every pbuf has been released.
+ *
+ * @{
+ */
+
+#ifndef __LWIPOPTS_H__
+#define __LWIPOPTS_H__
+
+#define NO_SYS                          1
+#define NO_SYS_NO_TIMERS                1
+#define LWIP_NETCONN                    0
+#define LWIP_SOCKET                     0
+
+#define MEM_ALIGNMENT                   4
+#define MEM_SIZE                        (32 * 1024)
+#define MEMP_NUM_PBUF                   32
+#define MEMP_NUM_TCP_PCB                8
+#define MEMP_NUM_TCP_SEG                32
+#define PBUF_POOL_SIZE                  16
+
+#define TCP_MSS                         536
+#define TCP_SND_BUF                     (4 * TCP_MSS)
+#define TCP_SND_QUEUELEN                16
+#define TCP_WND                         (4 * TCP_MSS)
+#define TCP_LISTEN_BACKLOG              1
+
+#define LWIP_DHCP                       0
+#define LWIP_AUTOIP                     0
+#define LWIP_IGMP                       0
+#define LWIP_DNS                        0
+#define LWIP_RAW                        0
+#define IP_REASSEMBLY                   0
+/* Custom pbufs, used by the zero copy receive path, depend on these.*/
+#define IP_FRAG                         1
+#define IP_FRAG_USES_STATIC_BUF         0
+
+#define LWIP_STATS                      1
+#define LWIP_STATS_DISPLAY              0
+#define LINK_STATS                      1
+#define MEM_STATS                       1
+#define MEMP_STATS                      1
+
+#endif /* __LWIPOPTS_H__ */
+
+/** @} */
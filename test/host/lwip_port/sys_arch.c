@@ -0,0 +1,49 @@
+/**
+ * @file    test/host/lwip_port/sys_arch.c
+ * @brief   lwIP OS glue of the host tests.
+ *
+ * @{
+ */
+
+#include "lwip/opt.h"
+#include "lwip/sys.h"
+
+#include "netif/etharp.h"
+
+#include "lwip_host.h"
+
+u32_t host_now;
+
+void sys_init(void) {
+}
+
+u32_t sys_now(void) {
+
+  return host_now;
+}
+
+/* No timers, the tests call the TCP timer functions.*/
+void tcp_timer_needed(void) {
+}
+
+void tcpip_init(tcpip_init_done_fn tcpip_init_done, void *arg) {
+
+  if (tcpip_init_done != NULL)
+    tcpip_init_done(arg);
+}
+
+err_t tcpip_input(struct pbuf *p, struct netif *inp) {
+
+  return ethernet_input(p, inp);
+}
+
+err_t tcpip_callback_with_block(tcpip_callback_fn function, void *ctx,
+                                u8_t block) {
+
+  (void)block;
+
+  function(ctx);
+  return ERR_OK;
+}
+
+/** @} */
@@ -0,0 +1,260 @@
+/**
+ * @file    test/host/lwip_tcp_bench.c
+ * @brief   Host TCP throughput benchmark of the lwIP checksum settings.
+ * @details A bulk TCP transfer between two connections of the same stack
+ *          over a loopback interface. The program is linked once against
+ *          the software checksum build of lwIP and once against the build
+ *          configured as os/various/lwip_bindings/arch/cc.h does with
+ *          @p STM32_MAC_IP_CHECKSUM_OFFLOAD 3, the difference is the CPU
+ *          time the MAC offload saves the stack. The loopback copies every
+ *          packet, as the MAC DMA would, in both builds.
+ *
+ *          The received stream is checked so the benchmark also fails if
+ *          the transfer is corrupted or stalls.
+ *
+ * @{
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "lwip/init.h"
+#include "lwip/ip.h"
+#include "lwip/tcp.h"
+#include "lwip/tcp_impl.h"
+
+#ifndef BENCH_MODE
+#define BENCH_MODE      "software checksums"
+#endif
+
+/* Bytes transferred in each run.*/
+#define BENCH_BYTES     (64u * 1024u * 1024u)
+#define BENCH_RUNS      3
+#define BENCH_PORT      5001
+
+/*===========================================================================*/
+/* Loopback interface.                                                       */
+/*===========================================================================*/
+
+#define LOOP_MAX        64
+
+static struct netif nif;
+static struct pbuf *loop_queue[LOOP_MAX];
+static unsigned loop_head, loop_count;
+
+static err_t loop_output(struct netif *netif, struct pbuf *p,
+                         ip_addr_t *ipaddr) {
+  struct pbuf *q;
+
+  (void)netif;
+  (void)ipaddr;
+
+  if (loop_count >= LOOP_MAX)
+    return ERR_MEM;
+  q = pbuf_alloc(PBUF_RAW, p->tot_len, PBUF_RAM);
+  if (q == NULL)
+    return ERR_MEM;
+  pbuf_copy(q, p);
+  loop_queue[(loop_head + loop_count++) % LOOP_MAX] = q;
+  return ERR_OK;
+}
+
+static err_t loop_init(struct netif *netif) {
+
+  netif->output = loop_output;
+  netif->mtu = 1500;
+  netif->flags = NETIF_FLAG_UP;
+  return ERR_OK;
+}
+
+/*===========================================================================*/
+/* Transfer.                                                                 */
+/*===========================================================================*/
+
+static uint8_t pattern[TCP_SND_BUF + 256];
+
+static struct {
+  struct tcp_pcb        *pcb;
+  size_t                sent;
+} tx;
+
+static struct {
+  struct tcp_pcb        *pcb;
+  size_t                received;
+  unsigned              bad;
+} rx;
+
+static uint8_t value(size_t k) {
+
+  return (uint8_t)(k % 251);
+}
+
+static void sender_fill(void) {
+  u16_t len;
+
+  while (tx.sent < BENCH_BYTES) {
+    len = tcp_sndbuf(tx.pcb);
+    if (len > BENCH_BYTES - tx.sent)
+      len = (u16_t)(BENCH_BYTES - tx.sent);
+    if ((len == 0) || (tcp_sndqueuelen(tx.pcb) >= TCP_SND_QUEUELEN))
+      break;
+    if (tcp_write(tx.pcb, &pattern[tx.sent % 251], len, 0) != ERR_OK)
+      break;
+    tx.sent += len;
+  }
+  tcp_output(tx.pcb);
+}
+
+static err_t sender_sent(void *arg, struct tcp_pcb *pcb, u16_t len) {
+
+  (void)arg;
+  (void)pcb;
+  (void)len;
+
+  sender_fill();
+  return ERR_OK;
+}
+
+static err_t sender_connected(void *arg, struct tcp_pcb *pcb, err_t err) {
+
+  (void)arg;
+  (void)pcb;
+  (void)err;
+
+  sender_fill();
+  return ERR_OK;
+}
+
+static err_t receiver_recv(void *arg, struct tcp_pcb *pcb, struct pbuf *p,
+                           err_t err) {
+  struct pbuf *q;
+  u16_t k;
+
+  (void)arg;
+  (void)err;
+
+  if (p == NULL)
+    return ERR_OK;
+  /* First and last byte of each pbuf, a full compare would dominate.*/
+  for (q = p; q != NULL; q = q->next) {
+    const uint8_t *b = q->payload;
+
+    k = q->len - 1;
+    if ((b[0] != value(rx.received)) || (b[k] != value(rx.received + k)))
+      rx.bad++;
+    rx.received += q->len;
+  }
+  tcp_recved(pcb, p->tot_len);
+  pbuf_free(p);
+  return ERR_OK;
+}
+
+static err_t receiver_accept(void *arg, struct tcp_pcb *pcb, err_t err) {
+
+  (void)arg;
+  (void)err;
+
+  rx.pcb = pcb;
+  tcp_recv(pcb, receiver_recv);
+  return ERR_OK;
+}
+
+/*
+ * Delivers the queued packets until the transfer completes or stalls.
+ */
+static void net_poll(void) {
+  unsigned idle = 0;
+
+  while ((rx.received < BENCH_BYTES) && (idle < 100)) {
+    if (loop_count > 0) {
+      struct pbuf *p = loop_queue[loop_head];
+
+      loop_head = (loop_head + 1) % LOOP_MAX;
+      loop_count--;
+      ip_input(p, &nif);
+      idle = 0;
+    }
+    else {
+      /* Delayed ACKs.*/
+      tcp_fasttmr();
+      idle++;
+    }
+  }
+}
+
+static double cpu_seconds(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/*
+ * One transfer, returns the throughput in MB/s or zero on failure.
+ */
+static double run(void) {
+  struct tcp_pcb *lpcb;
+  double t;
+
+  memset(&tx, 0, sizeof tx);
+  memset(&rx, 0, sizeof rx);
+  lpcb = tcp_new();
+  tcp_bind(lpcb, IP_ADDR_ANY, BENCH_PORT);
+  lpcb = tcp_listen(lpcb);
+  tcp_accept(lpcb, receiver_accept);
+  tx.pcb = tcp_new();
+  tcp_sent(tx.pcb, sender_sent);
+
+  t = cpu_seconds();
+  tcp_connect(tx.pcb, &nif.ip_addr, BENCH_PORT, sender_connected);
+  net_poll();
+  t = cpu_seconds() - t;
+
+  tcp_close(lpcb);
+  if (rx.pcb != NULL)
+    tcp_abort(rx.pcb);
+  tcp_abort(tx.pcb);
+  while (loop_count > 0) {
+    pbuf_free(loop_queue[loop_head]);
+    loop_head = (loop_head + 1) % LOOP_MAX;
+    loop_count--;
+  }
+  if ((rx.received != BENCH_BYTES) || (rx.bad != 0)) {
+    printf("FAIL %s:%d: %zu of %u bytes received, %u bad\n",
+           __FILE__, __LINE__, rx.received, BENCH_BYTES, rx.bad);
+    return 0;
+  }
+  return BENCH_BYTES / t / (1024 * 1024);
+}
+
+int main(void) {
+  ip_addr_t ip, gateway, netmask;
+  double best = 0, mbs;
+  size_t k;
+  int i;
+
+  for (k = 0; k < sizeof pattern; k++)
+    pattern[k] = value(k);
+  lwip_init();
+  IP4_ADDR(&ip, 192, 168, 1, 20);
+  IP4_ADDR(&gateway, 192, 168, 1, 1);
+  IP4_ADDR(&netmask, 255, 255, 255, 0);
+  netif_add(&nif, &ip, &netmask, &gateway, NULL, loop_init, ip_input);
+  netif_set_default(&nif);
+  netif_set_up(&nif);
+
+  /* Best of several runs, the least disturbed by the host.*/
+  for (i = 0; i < BENCH_RUNS; i++) {
+    mbs = run();
+    if (mbs == 0)
+      return 1;
+    if (mbs > best)
+      best = mbs;
+  }
+  printf("lwip_tcp_bench: %-22s %7.1f MB/s, MSS %u\n",
+         BENCH_MODE ",", best, TCP_MSS);
+  return 0;
+}
+
+/** @} */
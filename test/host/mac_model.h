@@ -0,0 +1,83 @@
+/**
+ * @file    test/host/mac_model.h
+ * @brief   Loopback MAC model, stands in for the MAC driver API.
+ * @details Declares the subset of the zero copy MAC API used by the lwIP
+ *          bindings, the implementation lives in the test.
+ *
+ * @{
+ */
+
+#ifndef _MAC_MODEL_H_
+#define _MAC_MODEL_H_
+
+#include "ch.h"
+
+#define HAL_USE_MAC                 TRUE
+#define MAC_USE_ZERO_COPY           TRUE
+
+#define STM32_MAC_TRANSMIT_BUFFERS  4
+#define STM32_MAC_RECEIVE_BUFFERS   4
+#define STM32_MAC_BUFFERS_SIZE      1524
+
+#define MAC_TRANSMIT_CHAIN_MAX      STM32_MAC_TRANSMIT_BUFFERS
+
+typedef struct {
+  const uint8_t         *mac_address;
+} MACConfig;
+
+typedef struct {
+  const MACConfig       *config;
+  EventSource           rdevent;
+} MACDriver;
+
+typedef struct {
+  unsigned              slot;
+  size_t                offset;
+} MACTransmitDescriptor;
+
+typedef struct {
+  unsigned              slot;
+  size_t                offset;
+  size_t                size;
+} MACReceiveDescriptor;
+
+typedef struct {
+  unsigned              first;
+  unsigned              next;
+  unsigned              n;
+} MACTransmitChain;
+
+typedef void (*mactxreclaimcb_t)(void *param);
+
+extern MACDriver ETHD1;
+
+#define macGetReceiveEventSource(macp)  (&(macp)->rdevent)
+#define macWriteTransmitDescriptor(tdp, buf, size)                          \
+  mac_lld_write_transmit_descriptor(tdp, buf, size)
+#define macReadReceiveDescriptor(rdp, buf, size)                            \
+  mac_lld_read_receive_descriptor(rdp, buf, size)
+
+void macStart(MACDriver *macp, const MACConfig *config);
+bool_t macPollLinkStatus(MACDriver *macp);
+msg_t macWaitTransmitDescriptor(MACDriver *macp, MACTransmitDescriptor *tdp,
+                                systime_t time);
+void macReleaseTransmitDescriptor(MACTransmitDescriptor *tdp);
+msg_t macWaitReceiveDescriptor(MACDriver *macp, MACReceiveDescriptor *rdp,
+                               systime_t time);
+void macReleaseReceiveDescriptor(MACReceiveDescriptor *rdp);
+size_t mac_lld_write_transmit_descriptor(MACTransmitDescriptor *tdp,
+                                         uint8_t *buf, size_t size);
+size_t mac_lld_read_receive_descriptor(MACReceiveDescriptor *rdp,
+                                       uint8_t *buf, size_t size);
+const uint8_t *mac_lld_get_next_receive_buffer(MACReceiveDescriptor *rdp,
+                                               size_t *sizep);
+msg_t macWaitTransmitChain(MACDriver *macp, MACTransmitChain *tcp,
+                           unsigned n, mactxreclaimcb_t cb, systime_t time);
+void macAddTransmitSegment(MACTransmitChain *tcp,
+                           const uint8_t *buf, size_t size);
+void macReleaseTransmitChain(MACTransmitChain *tcp, void *param);
+void macReclaimTransmitChains(MACDriver *macp, mactxreclaimcb_t cb);
+
+#endif /* _MAC_MODEL_H_ */
+
+/** @} */
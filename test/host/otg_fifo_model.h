@@ -0,0 +1,21 @@
+/**
+ * @file    test/host/otg_fifo_model.h
+ * @brief   OTG FIFO register model, forced into the driver build.
+ *
+ * @{
+ */
+
+#ifndef _OTG_FIFO_MODEL_H_
+#define _OTG_FIFO_MODEL_H_
+
+#include <stdint.h>
+
+void fifo_push(volatile uint32_t *fifop, uint32_t w);
+uint32_t fifo_pop(volatile uint32_t *fifop);
+
+#define OTG_FIFO_PUSH(fifop, w)     fifo_push(fifop, w)
+#define OTG_FIFO_POP(fifop)         fifo_pop(fifop)
+
+#endif /* _OTG_FIFO_MODEL_H_ */
+
+/** @} */
@@ -0,0 +1,260 @@
+/**
+ * @file    test/host/otg_fifo_test.c
+ * @brief   Host register model test of the STM32 OTG FIFO helpers.
+ * @details Drives os/hal/platforms/STM32/OTGv1/stm32_otg_fifo.c against a
+ *          fake FIFO register recording every word pushed and serving a
+ *          preloaded sequence of words on pops. Every queue read/write
+ *          offset is covered, so the word straddling the circular buffer
+ *          boundary is exercised at each position modulo 4, with all the
+ *          transfer lengths up to the queue size.
+ *
+ * @{
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "ch.h"
+#include "hal.h"
+#include "stm32_otg_fifo.h"
+
+/*===========================================================================*/
+/* Register model.                                                           */
+/*===========================================================================*/
+
+#define MAX_WORDS       64
+
+static volatile uint32_t fifo_reg;
+static uint32_t fifo_words[MAX_WORDS];
+static unsigned fifo_nwords;
+static unsigned fifo_pos;
+static unsigned fifo_bad_access;
+
+void fifo_push(volatile uint32_t *fifop, uint32_t w) {
+
+  if (fifop != &fifo_reg)
+    fifo_bad_access++;
+  if (fifo_nwords < MAX_WORDS)
+    fifo_words[fifo_nwords] = w;
+  fifo_nwords++;
+}
+
+uint32_t fifo_pop(volatile uint32_t *fifop) {
+
+  if (fifop != &fifo_reg)
+    fifo_bad_access++;
+  return fifo_pos < MAX_WORDS ? fifo_words[fifo_pos++] : 0xDEADBEEF;
+}
+
+static void fifo_reset(void) {
+
+  memset(fifo_words, 0, sizeof(fifo_words));
+  fifo_nwords = 0;
+  fifo_pos = 0;
+  fifo_bad_access = 0;
+}
+
+/* Byte k of the words stream, LSB-first as in the OTG FIFO.*/
+static uint8_t fifo_byte(unsigned k) {
+
+  return (uint8_t)(fifo_words[k / 4] >> ((k % 4) * 8));
+}
+
+/*===========================================================================*/
+/* Test helpers.                                                             */
+/*===========================================================================*/
+
+static unsigned failures;
+static unsigned cases;
+
+#define CHECK(c, ...) do {                                                  \
+  if (!(c)) {                                                               \
+    if (failures++ < 20) {                                                  \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);                           \
+      printf(__VA_ARGS__);                                                  \
+      printf("\n");                                                         \
+    }                                                                       \
+  }                                                                         \
+} while (0)
+
+static uint8_t value(unsigned k) {
+
+  return (uint8_t)(k * 37 + 1);
+}
+
+#define GUARD           8
+#define SENTINEL        0x5A
+
+/* Ring storage, with guard bytes around the ring and room to misalign it.*/
+static uint8_t storage[GUARD + 3 + MAX_WORDS * 4 + GUARD];
+
+static GenericQueue *queue_setup(GenericQueue *qp, unsigned misalign,
+                                 unsigned size, unsigned off) {
+  uint8_t *ring = &storage[GUARD + misalign];
+
+  memset(qp, 0, sizeof(*qp));
+  queue_init(&qp->q_waiting);
+  qp->q_buffer = ring;
+  qp->q_top = ring + size;
+  qp->q_rdptr = qp->q_wrptr = ring + off;
+  return qp;
+}
+
+/*===========================================================================*/
+/* Test cases.                                                               */
+/*===========================================================================*/
+
+static void test_write_from_queue(unsigned misalign, unsigned size,
+                                  unsigned off, unsigned n) {
+  static uint8_t snapshot[sizeof(storage)];
+  GenericQueue q;
+  Thread waiter;
+  unsigned k;
+
+  queue_setup(&q, misalign, size, off);
+  memset(storage, SENTINEL, sizeof(storage));
+  for (k = 0; k < n; k++)
+    q.q_buffer[(off + k) % size] = value(k);
+  q.q_counter = size - n;
+  memset(&waiter, 0, sizeof(waiter));
+  queue_insert(&waiter, &q.q_waiting);
+  memcpy(snapshot, storage, sizeof(storage));
+  fifo_reset();
+
+  otg_fifo_write_from_queue(&fifo_reg, &q, n);
+  cases++;
+
+  CHECK(fifo_bad_access == 0, "tx size %u off %u n %u: wrong register",
+        size, off, n);
+  CHECK(fifo_nwords == (n + 3) / 4,
+        "tx size %u off %u n %u: %u words pushed", size, off, n, fifo_nwords);
+  for (k = 0; k < n; k++) {
+    if (fifo_byte(k) != value(k)) {
+      CHECK(0, "tx size %u off %u n %u: byte %u is %02x, expected %02x",
+            size, off, n, k, fifo_byte(k), value(k));
+      break;
+    }
+  }
+  CHECK(q.q_rdptr == q.q_buffer + (off + n) % size,
+        "tx size %u off %u n %u: rdptr at %d", size, off, n,
+        (int)(q.q_rdptr - q.q_buffer));
+  CHECK(q.q_counter == size, "tx size %u off %u n %u: counter %u",
+        size, off, n, (unsigned)q.q_counter);
+  CHECK(memcmp(snapshot, storage, sizeof(storage)) == 0,
+        "tx size %u off %u n %u: queue memory modified", size, off, n);
+  CHECK((waiter.p_readied == 1) && (waiter.p_u.rdymsg == Q_OK) &&
+        !notempty(&q.q_waiting),
+        "tx size %u off %u n %u: writer not woken", size, off, n);
+}
+
+static void test_read_to_queue(unsigned misalign, unsigned size,
+                               unsigned off, unsigned n) {
+  GenericQueue q;
+  unsigned k, nw = (n + 3) / 4;
+
+  queue_setup(&q, misalign, size, off);
+  memset(storage, SENTINEL, sizeof(storage));
+  fifo_reset();
+  /* Packet bytes, the padding of the last word is junk.*/
+  for (k = 0; k < nw * 4; k++)
+    fifo_words[k / 4] |= (uint32_t)(k < n ? value(k) : 0xCC) << ((k % 4) * 8);
+
+  otg_fifo_read_to_queue(&fifo_reg, &q, n);
+  cases++;
+
+  CHECK(fifo_bad_access == 0, "rx size %u off %u n %u: wrong register",
+        size, off, n);
+  CHECK(fifo_pos == nw, "rx size %u off %u n %u: %u words popped",
+        size, off, n, fifo_pos);
+  for (k = 0; k < n; k++) {
+    if (q.q_buffer[(off + k) % size] != value(k)) {
+      CHECK(0, "rx size %u off %u n %u: byte %u is %02x, expected %02x",
+            size, off, n, k, q.q_buffer[(off + k) % size], value(k));
+      break;
+    }
+  }
+  /* Nothing written outside the packet bytes, guards included.*/
+  for (k = 0; k < sizeof(storage); k++) {
+    uint8_t *bp = &storage[k];
+    int inring = (bp >= q.q_buffer) && (bp < q.q_top);
+    unsigned pos = (unsigned)(bp - q.q_buffer);
+
+    if (inring && (((pos + size - off) % size) < n))
+      continue;
+    if (*bp != SENTINEL) {
+      CHECK(0, "rx size %u off %u n %u: stray write at %d",
+            size, off, n, (int)(bp - q.q_buffer));
+      break;
+    }
+  }
+  CHECK(q.q_wrptr == q.q_buffer + (off + n) % size,
+        "rx size %u off %u n %u: wrptr at %d", size, off, n,
+        (int)(q.q_wrptr - q.q_buffer));
+  CHECK(q.q_counter == n, "rx size %u off %u n %u: counter %u",
+        size, off, n, (unsigned)q.q_counter);
+}
+
+static void test_buffers(unsigned misalign, unsigned n) {
+  uint8_t *buf = &storage[GUARD + misalign];
+  unsigned k, nw = (n + 3) / 4;
+
+  /* Linear buffer to FIFO.*/
+  for (k = 0; k < n; k++)
+    buf[k] = value(k);
+  fifo_reset();
+  otg_fifo_write_from_buffer(&fifo_reg, buf, n);
+  cases++;
+  CHECK(fifo_nwords == nw, "tx buf %u: %u words", n, fifo_nwords);
+  for (k = 0; k < n; k++) {
+    if (fifo_byte(k) != value(k)) {
+      CHECK(0, "tx buf %u: byte %u", n, k);
+      break;
+    }
+  }
+
+  /* FIFO to linear buffer, the excess of a long packet is discarded.*/
+  memset(storage, SENTINEL, sizeof(storage));
+  fifo_reset();
+  for (k = 0; k < nw * 4; k++)
+    fifo_words[k / 4] |= (uint32_t)value(k) << ((k % 4) * 8);
+  otg_fifo_read_to_buffer(&fifo_reg, buf, n, n / 2);
+  cases++;
+  CHECK(fifo_pos == nw, "rx buf %u: %u words popped", n, fifo_pos);
+  for (k = 0; k < n / 2; k++) {
+    if (buf[k] != value(k)) {
+      CHECK(0, "rx buf %u: byte %u", n, k);
+      break;
+    }
+  }
+  /* Whole words are stored, nothing past the last word of the limit.*/
+  for (k = ((n / 2 + 3) / 4) * 4; k < n; k++) {
+    if (buf[k] != SENTINEL) {
+      CHECK(0, "rx buf %u: stray write at %u", n, k);
+      break;
+    }
+  }
+}
+
+int main(void) {
+  static const unsigned sizes[] = {64, 66, 67};
+  unsigned i, misalign, off, n;
+
+  for (i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    for (misalign = 0; misalign < 4; misalign++) {
+      for (off = 0; off < sizes[i]; off++) {
+        for (n = 1; n <= sizes[i]; n++) {
+          test_write_from_queue(misalign, sizes[i], off, n);
+          test_read_to_queue(misalign, sizes[i], off, n);
+        }
+      }
+    }
+  }
+  for (misalign = 0; misalign < 4; misalign++)
+    for (n = 0; n <= 64; n++)
+      test_buffers(misalign, n);
+
+  printf("otg_fifo_test: %u cases, %u failures\n", cases, failures);
+  return failures != 0;
+}
+
+/** @} */
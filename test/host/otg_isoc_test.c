@@ -0,0 +1,330 @@
+/**
+ * @file    test/host/otg_isoc_test.c
+ * @brief   Host register model test of the isochronous IN abort.
+ * @details Builds os/hal/platforms/STM32/OTGv1/usb_lld.c against a plain
+ *          memory OTG registers block. The test plays the role of the core:
+ *          it raises the interrupts, applies the effect of the write-only
+ *          control bits and a background thread completes the FIFO flushes
+ *          as the hardware does. The ISR must never wait for the core, a
+ *          spinning handler is caught by the alarm.
+ *
+ * @{
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include "ch.h"
+#include "hal.h"
+
+/*===========================================================================*/
+/* Platform stand-ins.                                                       */
+/*===========================================================================*/
+
+#define STM32F4XX
+#define STM32_HAS_OTG1                      TRUE
+#define STM32_HAS_OTG2                      FALSE
+#define STM32_USB_USE_OTG1                  TRUE
+#define STM32_PLL48CLK                      48000000
+#define STM32_OTG1_NUMBER                   67
+#define STM32_OTG1_HANDLER                  Vector14C
+#define CORTEX_IS_VALID_KERNEL_PRIORITY(n)  TRUE
+#define CORTEX_PRIORITY_MASK(n)             (n)
+
+#define CH_IRQ_HANDLER(id)                  void id(void)
+#define CH_IRQ_PROLOGUE()
+#define CH_IRQ_EPILOGUE()
+
+#define nvicEnableVector(n, prio)
+#define nvicDisableVector(n)
+#define rccEnableOTG_FS(lp)
+#define rccDisableOTG_FS(lp)
+#define rccResetOTG_FS()
+#define halPolledDelay(n)
+
+#define THD_STATE_SUSPENDED                 0
+#define chThdSelf()                         ((Thread *)NULL)
+#define chThdResumeI(tp)                    chSchReadyI(tp)
+#define chSchGoSleepS(newstate)             ((void)(newstate))
+#define chThdCreateI(wsp, size, prio, pf, arg)                              \
+  ((void)(pf), (void)(arg), (Thread *)(wsp))
+
+#include "usb.h"
+
+void usbObjectInit(USBDriver *usbp) { (void)usbp; }
+void _usb_reset(USBDriver *usbp) { (void)usbp; }
+void _usb_ep0setup(USBDriver *usbp, usbep_t ep) { (void)usbp; (void)ep; }
+void _usb_ep0in(USBDriver *usbp, usbep_t ep) { (void)usbp; (void)ep; }
+void _usb_ep0out(USBDriver *usbp, usbep_t ep) { (void)usbp; (void)ep; }
+
+#include "usb_lld.c"
+
+/*===========================================================================*/
+/* Register model.                                                           */
+/*===========================================================================*/
+
+static stm32_otg_t otg;
+static volatile unsigned flushes[USB_MAX_ENDPOINTS + 1];
+static volatile int hw_stop;
+
+/* The core completes the FIFO flushes, the driver waits for them.*/
+static void *hw_thread(void *arg) {
+
+  (void)arg;
+  while (!hw_stop) {
+    uint32_t rst = otg.GRSTCTL;
+
+    if (rst & GRSTCTL_TXFFLSH) {
+      flushes[(rst & GRSTCTL_TXFNUM_MASK) >> 6]++;
+      __sync_synchronize();
+      otg.GRSTCTL = rst & ~GRSTCTL_TXFFLSH;
+    }
+    if (rst & GRSTCTL_RXFFLSH)
+      otg.GRSTCTL = rst & ~GRSTCTL_RXFFLSH;
+  }
+  return NULL;
+}
+
+/* Write-only control bits, they read as zero.*/
+#define DIEPCTL_WO  (DIEPCTL_CNAK | DIEPCTL_SNAK | DIEPCTL_SD0PID |         \
+                     DIEPCTL_SODDFRM)
+
+/* The core latches the control bits written by the driver.*/
+static void hw_latch(usbep_t ep, int *snak, int *epdis) {
+  uint32_t ctl = otg.ie[ep].DIEPCTL;
+
+  *snak = (ctl & DIEPCTL_SNAK) != 0;
+  *epdis = (ctl & DIEPCTL_EPDIS) != 0;
+  if ((ctl & DIEPCTL_EPTYP_MASK) == DIEPCTL_EPTYP_ISO) {
+    if (ctl & DIEPCTL_SODDFRM)
+      ctl |= DIEPCTL_EONUM;
+    else if (ctl & DIEPCTL_SEVNFRM)
+      ctl &= ~DIEPCTL_EONUM;
+  }
+  otg.ie[ep].DIEPCTL = ctl & ~DIEPCTL_WO;
+}
+
+/* Raises the given interrupt sources and runs the ISR.*/
+static void hw_irq(uint32_t gintsts, usbep_t ep, uint32_t diepint) {
+  unsigned i;
+
+  for (i = 0; i <= USB_MAX_ENDPOINTS; i++)
+    otg.ie[i].DIEPINT = 0;
+  otg.DAINT = 0;
+  if (diepint != 0) {
+    otg.ie[ep].DIEPINT = diepint;
+    otg.DAINT = 1 << ep;
+    gintsts |= GINTSTS_IEPINT;
+  }
+  otg.GINTSTS = gintsts;
+  usb_lld_serve_interrupt(&USBD1);
+  otg.GINTSTS = 0;
+}
+
+/*===========================================================================*/
+/* Test helpers.                                                             */
+/*===========================================================================*/
+
+static unsigned failures;
+static unsigned cases;
+
+#define CHECK(c, ...) do {                                                  \
+  if (!(c)) {                                                               \
+    if (failures++ < 20) {                                                  \
+      printf("FAIL %s:%d: ", __FILE__, __LINE__);                           \
+      printf(__VA_ARGS__);                                                  \
+      printf("\n");                                                         \
+    }                                                                       \
+  }                                                                         \
+} while (0)
+
+static unsigned in_done[USB_MAX_ENDPOINTS + 1];
+
+static void in_cb(USBDriver *usbp, usbep_t ep) {
+
+  (void)usbp;
+  in_done[ep]++;
+}
+
+static USBInEndpointState in_state[USB_MAX_ENDPOINTS + 1];
+
+static const USBEndpointConfig iso_cfg = {
+  USB_EP_MODE_TYPE_ISOC, NULL, in_cb, NULL, 64, 0,
+  &in_state[1], NULL, 1, NULL
+};
+
+static const USBEndpointConfig bulk_cfg = {
+  USB_EP_MODE_TYPE_BULK, NULL, in_cb, NULL, 64, 0,
+  &in_state[3], NULL, 1, NULL
+};
+
+static void flushes_reset(void) {
+  unsigned i;
+
+  for (i = 0; i <= USB_MAX_ENDPOINTS; i++)
+    flushes[i] = 0;
+}
+
+/* Driver and core after the reset, endpoints 1 and 2 isochronous IN and
+   endpoint 3 bulk IN, all with a transfer in progress started during
+   the frame before @p frame.*/
+static void setup(uint32_t frame) {
+  int snak, epdis;
+  usbep_t ep;
+
+  memset(&otg, 0, sizeof(otg));
+  memset(in_done, 0, sizeof(in_done));
+  USBD1.otg = &otg;
+  USBD1.state = USB_ACTIVE;
+  USBD1.txpending = 0;
+  USBD1.isoabort = 0;
+  usb_lld_reset(&USBD1);
+  USBD1.epc[1] = &iso_cfg;
+  USBD1.epc[2] = &iso_cfg;
+  USBD1.epc[3] = &bulk_cfg;
+  for (ep = 1; ep <= 3; ep++) {
+    usb_lld_init_endpoint(&USBD1, ep);
+    hw_latch(ep, &snak, &epdis);
+  }
+  otg.DSTS = DSTS_FNSOF(frame - 1);
+  for (ep = 1; ep <= 3; ep++) {
+    usb_lld_start_in(&USBD1, ep);
+    hw_latch(ep, &snak, &epdis);
+  }
+  otg.DSTS = DSTS_FNSOF(frame);
+  flushes_reset();
+}
+
+/*===========================================================================*/
+/* Test cases.                                                               */
+/*===========================================================================*/
+
+/* Endpoint 1 missed frame @p frame, endpoint 2 is rescheduled for the
+   next one and must be left alone, the bulk endpoint too.*/
+static void test_abort(uint32_t frame) {
+  int snak, epdis;
+
+  setup(frame);
+  usb_lld_start_in(&USBD1, 2);
+  hw_latch(2, &snak, &epdis);
+
+  hw_irq(GINTSTS_IISOIXFR, 0, 0);
+  hw_latch(1, &snak, &epdis);
+  CHECK(snak && !epdis, "frame %u: stale EP1 NAK %d disable %d",
+        frame, snak, epdis);
+  CHECK(USBD1.isoabort == (1 << 1), "frame %u: aborts %x",
+        frame, USBD1.isoabort);
+  CHECK((otg.DIEPMSK & (DIEPMSK_INEPNEM | DIEPMSK_EPDM)) ==
+        (DIEPMSK_INEPNEM | DIEPMSK_EPDM), "frame %u: masks %x",
+        frame, otg.DIEPMSK);
+  CHECK((otg.DIEPEMPMSK & DIEPEMPMSK_INEPTXFEM(1)) == 0,
+        "frame %u: EP1 still filled", frame);
+  hw_latch(2, &snak, &epdis);
+  CHECK(!snak && !epdis, "frame %u: EP2 in time was touched", frame);
+  hw_latch(3, &snak, &epdis);
+  CHECK(!snak && !epdis, "frame %u: bulk EP3 was touched", frame);
+  CHECK(in_done[1] == 0 && flushes[1] == 0,
+        "frame %u: EP1 terminated before being disabled", frame);
+
+  /* A second incomplete frame does not restart the abort.*/
+  hw_irq(GINTSTS_IISOIXFR, 0, 0);
+  hw_latch(1, &snak, &epdis);
+  CHECK(!snak && !epdis, "frame %u: EP1 abort restarted", frame);
+
+  /* NAK effective, the endpoint is disabled.*/
+  hw_irq(0, 1, DIEPINT_INEPNE);
+  hw_latch(1, &snak, &epdis);
+  CHECK(epdis, "frame %u: EP1 not disabled on NAK effective", frame);
+  CHECK(in_done[1] == 0 && flushes[1] == 0,
+        "frame %u: EP1 terminated before being disabled", frame);
+
+  /* Endpoint disabled, FIFO flushed and transfer terminated.*/
+  otg.ie[1].DIEPCTL &= ~DIEPCTL_EPENA;
+  hw_irq(0, 1, DIEPINT_EPDISD);
+  CHECK(flushes[1] == 1, "frame %u: EP1 flushed %u times", frame,
+        flushes[1]);
+  CHECK(in_done[1] == 1, "frame %u: EP1 completed %u times", frame,
+        in_done[1]);
+  CHECK(USBD1.isoabort == 0, "frame %u: aborts %x", frame,
+        USBD1.isoabort);
+  CHECK((otg.DIEPMSK & (DIEPMSK_INEPNEM | DIEPMSK_EPDM)) == 0,
+        "frame %u: masks %x left enabled", frame, otg.DIEPMSK);
+  CHECK(in_done[2] == 0 && in_done[3] == 0 && flushes[2] == 0 &&
+        flushes[3] == 0, "frame %u: other endpoints terminated", frame);
+  cases++;
+}
+
+/* The EP1 transfer completes before the NAK becomes effective, EP2 also
+   missed the frame and its abort goes on.*/
+static void test_late_complete(uint32_t frame) {
+  int snak, epdis;
+
+  setup(frame);
+  hw_irq(GINTSTS_IISOIXFR, 0, 0);
+  hw_latch(1, &snak, &epdis);
+  CHECK(snak, "frame %u: stale EP1 not NAKed", frame);
+
+  otg.ie[1].DIEPCTL &= ~DIEPCTL_EPENA;
+  hw_irq(0, 1, DIEPINT_XFRC | DIEPINT_INEPNE);
+  hw_latch(1, &snak, &epdis);
+  CHECK(!epdis, "frame %u: completed EP1 disabled", frame);
+  CHECK(in_done[1] == 1, "frame %u: EP1 completed %u times", frame,
+        in_done[1]);
+  CHECK(flushes[1] == 0, "frame %u: completed EP1 flushed", frame);
+  CHECK(USBD1.isoabort == (1 << 2), "frame %u: aborts %x", frame,
+        USBD1.isoabort);
+  cases++;
+}
+
+/* Endpoints disabled while an abort is in progress.*/
+static void test_disable(uint32_t frame) {
+
+  setup(frame);
+  hw_irq(GINTSTS_IISOIXFR, 0, 0);
+  CHECK(USBD1.isoabort != 0, "frame %u: no abort", frame);
+  otg.ie[1].DIEPCTL &= ~DIEPCTL_EPENA;
+  otg.ie[2].DIEPCTL &= ~DIEPCTL_EPENA;
+  otg.ie[3].DIEPCTL &= ~DIEPCTL_EPENA;
+  usb_lld_disable_endpoints(&USBD1);
+  CHECK(USBD1.isoabort == 0, "frame %u: aborts %x", frame,
+        USBD1.isoabort);
+  CHECK((otg.DIEPMSK & (DIEPMSK_INEPNEM | DIEPMSK_EPDM)) == 0,
+        "frame %u: masks %x left enabled", frame, otg.DIEPMSK);
+  cases++;
+}
+
+static void on_alarm(int sig) {
+  static const char msg[] = "FAIL otg_isoc_test: the ISR waits for the core\n";
+
+  (void)sig;
+  fflush(stdout);
+  (void)write(1, msg, sizeof(msg) - 1);
+  _exit(1);
+}
+
+int main(void) {
+  static const stm32_otg_params_t params = {128, 320, 3};
+  pthread_t hw;
+  uint32_t frame;
+
+  signal(SIGALRM, on_alarm);
+  alarm(5);
+  USBD1.otgparams = &params;
+  pthread_create(&hw, NULL, hw_thread, NULL);
+
+  for (frame = 1; frame <= 4; frame++) {
+    test_abort(frame);
+    test_late_complete(frame);
+    test_disable(frame);
+  }
+
+  hw_stop = 1;
+  pthread_join(hw, NULL);
+  printf("otg_isoc_test: %u cases, %u failures\n", cases, failures);
+  return failures != 0;
+}
+
+/** @} */
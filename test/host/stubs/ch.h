@@ -0,0 +1,174 @@
+/**
+ * @file    test/host/stubs/ch.h
+ * @brief   Host stand-in for the kernel header.
+ * @details Provides the subset of the kernel API used by the modules
+ *          built on the host by the tests in this directory. Structures
+ *          only carry the fields those modules access, locking is a no-op
+ *          because the tests are single threaded.
+ *
+ * @{
+ */
+
+#ifndef _CH_H_
+#define _CH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <assert.h>
+
+typedef int32_t         bool_t;
+typedef int32_t         msg_t;
+typedef uint32_t        systime_t;
+typedef uint32_t        eventmask_t;
+typedef uint32_t        eventflags_t;
+typedef uint8_t         tprio_t;
+
+#define FALSE           0
+#define TRUE            (!FALSE)
+
+#define RDY_OK          0
+#define RDY_TIMEOUT     -1
+#define RDY_RESET       -2
+#define Q_OK            RDY_OK
+
+#define LOWPRIO         ((tprio_t)1)
+#define NORMALPRIO      ((tprio_t)64)
+
+#define ALL_EVENTS      ((eventmask_t)-1)
+
+#define TIME_IMMEDIATE  ((systime_t)0)
+#define TIME_INFINITE   ((systime_t)-1)
+#define MS2ST(msec)     ((systime_t)(msec))
+#define S2ST(sec)       ((systime_t)(sec) * 1000)
+
+/*
+ * Threads and threads queues, readying a thread only records the message.
+ */
+typedef struct Thread Thread;
+
+typedef struct {
+  Thread                *p_next;
+  Thread                *p_prev;
+} ThreadsQueue;
+
+struct Thread {
+  Thread                *p_next;
+  Thread                *p_prev;
+  union {
+    msg_t               rdymsg;
+  } p_u;
+  int                   p_readied;
+};
+
+#define queue_init(tqp) ((tqp)->p_next = (tqp)->p_prev = (Thread *)(tqp))
+#define notempty(tqp)   ((tqp)->p_next != (Thread *)(tqp))
+
+static inline void queue_insert(Thread *tp, ThreadsQueue *tqp) {
+
+  tp->p_next = (Thread *)tqp;
+  tp->p_prev = tqp->p_prev;
+  tp->p_prev->p_next = tp;
+  tqp->p_prev = tp;
+}
+
+static inline Thread *fifo_remove(ThreadsQueue *tqp) {
+  Thread *tp = tqp->p_next;
+
+  (tqp->p_next = tp->p_next)->p_prev = (Thread *)tqp;
+  return tp;
+}
+
+static inline Thread *chSchReadyI(Thread *tp) {
+
+  tp->p_readied++;
+  return tp;
+}
+
+#define WORKING_AREA(s, n)              uint8_t s[n]
+
+#define chRegSetThreadName(p)
+#define chThdSetPriority(newprio)       ((void)(newprio))
+#define chThdSleepMilliseconds(msec)    ((void)(msec))
+#define chSysHalt()                     assert(0)
+
+#define chSysLock()
+#define chSysUnlock()
+#define chSysLockFromIsr()
+#define chSysUnlockFromIsr()
+#define chSchRescheduleS()
+
+#define CH_USE_SEMAPHORES               TRUE
+#define CH_USE_EVENTS                   TRUE
+
+#define chDbgCheck(c, func)             assert(c)
+#define chDbgAssert(c, m, r)            assert(c)
+#define chDbgCheckClassI()
+
+/*
+ * Counting semaphores, nobody else can signal while the caller waits so
+ * a wait on a zero counter times out immediately.
+ */
+typedef struct {
+  int32_t               s_cnt;
+} Semaphore;
+
+#define chSemInit(sp, n)                ((sp)->s_cnt = (n))
+#define chSemResetI(sp, n)              ((sp)->s_cnt = (n))
+#define chSemSignalI(sp)                ((sp)->s_cnt++)
+#define chSemGetCounterI(sp)            ((sp)->s_cnt)
+
+static inline msg_t chSemWaitTimeoutS(Semaphore *sp, systime_t time) {
+
+  (void)time;
+  if (sp->s_cnt <= 0)
+    return RDY_TIMEOUT;
+  sp->s_cnt--;
+  return RDY_OK;
+}
+
+/*
+ * Event sources, broadcasting only counts the events and accumulates the
+ * flags.
+ */
+typedef struct {
+  int                   es_broadcasts;
+  eventflags_t          es_flags;
+} EventSource;
+
+typedef struct {
+  EventSource           *el_source;
+} EventListener;
+
+#define chEvtInit(esp)                                                      \
+  ((esp)->es_broadcasts = 0, (esp)->es_flags = 0)
+#define chEvtBroadcastI(esp)            ((esp)->es_broadcasts++)
+#define chEvtBroadcastFlagsI(esp, flags)                                    \
+  ((esp)->es_broadcasts++, (esp)->es_flags |= (flags))
+#define chEvtRegisterMask(esp, elp, mask)                                   \
+  ((elp)->el_source = (esp), (void)(mask))
+#define chEvtAddEvents(mask)            ((void)(mask))
+#define chEvtWaitAny(mask)              ((eventmask_t)(mask))
+
+/*
+ * I/O queues, see chqueues.h.
+ */
+typedef struct GenericQueue GenericQueue;
+typedef void (*qnotify_t)(GenericQueue *qp);
+
+struct GenericQueue {
+  ThreadsQueue          q_waiting;
+  size_t                q_counter;
+  uint8_t               *q_buffer;
+  uint8_t               *q_top;
+  uint8_t               *q_wrptr;
+  uint8_t               *q_rdptr;
+  qnotify_t             q_notify;
+  void                  *q_link;
+};
+
+typedef GenericQueue InputQueue;
+typedef GenericQueue OutputQueue;
+
+#endif /* _CH_H_ */
+
+/** @} */
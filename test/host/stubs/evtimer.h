@@ -0,0 +1,22 @@
+/**
+ * @file    test/host/stubs/evtimer.h
+ * @brief   Host stand-in for the events generator timer.
+ *
+ * @{
+ */
+
+#ifndef _EVTIMER_H_
+#define _EVTIMER_H_
+
+typedef struct {
+  systime_t             et_interval;
+  EventSource           et_es;
+} EvTimer;
+
+#define evtInit(etp, time)  ((etp)->et_interval = (time),                   \
+                             (etp)->et_es.es_broadcasts = 0)
+#define evtStart(etp)       ((void)(etp))
+
+#endif /* _EVTIMER_H_ */
+
+/** @} */
@@ -0,0 +1,15 @@
+/**
+ * @file    test/host/stubs/hal.h
+ * @brief   Host stand-in for the HAL header.
+ *
+ * @{
+ */
+
+#ifndef _HAL_H_
+#define _HAL_H_
+
+#define HAL_USE_USB     TRUE
+
+#endif /* _HAL_H_ */
+
+/** @} */
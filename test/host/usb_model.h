@@ -0,0 +1,77 @@
+/**
+ * @file    test/host/usb_model.h
+ * @brief   USB device model, stands in for the USB driver API.
+ * @details Declares the subset of the USB API used by the bulk drivers of
+ *          the application, the implementation lives in the test. A
+ *          prepared transfer is recorded per endpoint and completed by the
+ *          test playing the role of the host.
+ *
+ * @{
+ */
+
+#ifndef _USB_MODEL_H_
+#define _USB_MODEL_H_
+
+#include "ch.h"
+
+#define USB_MAX_ENDPOINTS           3
+
+typedef uint8_t usbep_t;
+
+typedef enum {
+  USB_UNINIT   = 0,
+  USB_STOP     = 1,
+  USB_READY    = 2,
+  USB_SELECTED = 3,
+  USB_ACTIVE   = 4
+} usbstate_t;
+
+typedef struct USBDriver USBDriver;
+
+typedef void (*usbepcallback_t)(USBDriver *usbp, usbep_t ep);
+
+typedef struct {
+  usbepcallback_t       in_cb;
+  usbepcallback_t       out_cb;
+  uint16_t              in_maxsize;
+  uint16_t              out_maxsize;
+} USBEndpointConfig;
+
+/**
+ * @brief   Transfer prepared on an endpoint direction.
+ */
+typedef struct {
+  const uint8_t         *buf;
+  size_t                n;
+  /* Number of usbStartXxxI() calls on this direction.*/
+  unsigned              starts;
+} usb_model_xfer_t;
+
+struct USBDriver {
+  usbstate_t            state;
+  uint16_t              transmitting;
+  uint16_t              receiving;
+  const USBEndpointConfig *epc[USB_MAX_ENDPOINTS + 1];
+  void                  *epparam[USB_MAX_ENDPOINTS + 1];
+  usb_model_xfer_t      in[USB_MAX_ENDPOINTS + 1];
+  usb_model_xfer_t      out[USB_MAX_ENDPOINTS + 1];
+  /* Size of the last completed receive transaction.*/
+  size_t                rxsize[USB_MAX_ENDPOINTS + 1];
+};
+
+#define usbGetDriverStateI(usbp)        ((usbp)->state)
+#define usbSetEndpointParamI(usbp, ep, p) ((usbp)->epparam[ep] = (p))
+#define usbGetEndpointParamX(usbp, ep)  ((usbp)->epparam[ep])
+#define usbGetTransmitStatusI(usbp, ep) ((usbp)->transmitting & (1 << (ep)))
+#define usbGetReceiveStatusI(usbp, ep)  ((usbp)->receiving & (1 << (ep)))
+#define usbGetReceiveTransactionSizeI(usbp, ep) ((usbp)->rxsize[ep])
+
+void usbPrepareReceive(USBDriver *usbp, usbep_t ep, uint8_t *buf, size_t n);
+void usbPrepareTransmit(USBDriver *usbp, usbep_t ep,
+                        const uint8_t *buf, size_t n);
+bool_t usbStartReceiveI(USBDriver *usbp, usbep_t ep);
+bool_t usbStartTransmitI(USBDriver *usbp, usbep_t ep);
+
+#endif /* _USB_MODEL_H_ */
+
+/** @} */
@@ -26,6 +26,7 @@
 #include "chprintf.h"
 
 #include "ff.h"
+#include "blk_cache.h"
 
 #define SDC_DATA_DESTRUCTIVE_TEST   FALSE
 
@@ -36,6 +37,10 @@ static uint8_t  inbuf[MMCSD_BLOCK_SIZE * SDC_BURST_SIZE + 1];
 /* FS object.*/
 static FATFS SDC_FS;
 
+/* FatFs accesses the card through a block cache.*/
+static BlockCacheDriver BCD1;
+extern BaseBlockDevice *fatfsBlockDevice;
+
 /* FS mounted and ready.*/
 static bool_t fs_ready = FALSE;
 
@@ -129,7 +134,8 @@ void cmd_sdiotest(BaseSequentialStream *chp, int argc, char *argv[]){
   chprintf(chp, "Trying to connect SDIO... ");
   chThdSleepMilliseconds(100);
 
-  if (!sdcConnect(&SDCD1)) {
+  /* Connecting the cache also connects the card.*/
+  if (!blkConnect(&BCD1)) {
 
     chprintf(chp, "OK\r\n");
     chprintf(chp, "*** Card CSD content is: ");
@@ -335,7 +341,8 @@ void cmd_sdiotest(BaseSequentialStream *chp, int argc, char *argv[]){
 
     chprintf(chp, "Disconnecting from SDIO...");
     chThdSleepMilliseconds(100);
-    if (sdcDisconnect(&SDCD1))
+    /* Writes back the cached blocks before disconnecting the card.*/
+    if (blkDisconnect(&BCD1))
       chSysHalt();
     chprintf(chp, " OK\r\n");
     chprintf(chp, "------------------------------------------------------\r\n");
@@ -390,6 +397,8 @@ int main(void) {
    * Initializes the SDIO drivers.
    */
   sdcStart(&SDCD1, &sdccfg);
+  bcObjectInit(&BCD1, (BaseBlockDevice *)&SDCD1);
+  fatfsBlockDevice = (BaseBlockDevice *)&BCD1;
 
   /*
    * Normal main() thread activity.
@@ -0,0 +1,380 @@
+/*
+    ChibiOS/RT - Copyright (C) 2006,2007,2008,2009,2010,
+                 2011,2012 Giovanni Di Sirio.
+
+    This file is part of ChibiOS/RT.
+
+    ChibiOS/RT is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 3 of the License, or
+    (at your option) any later version.
+
+    ChibiOS/RT is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ch.h"
+#include "hal.h"
+
+#include "usb_msc.h"
+
+/*===========================================================================*/
+/* USB related stuff.                                                        */
+/*===========================================================================*/
+
+/*
+ * Endpoint used by the mass storage driver, both directions.
+ */
+#define MSC_DATA_EP             1
+
+/*
+ * Mass storage driver structure.
+ */
+static USBMassStorageDriver MSD1;
+
+/*
+ * USB Device Descriptor.
+ */
+static const uint8_t msc_device_descriptor_data[18] = {
+  USB_DESC_DEVICE       (0x0200,        /* bcdUSB (2.0).                    */
+                         0x00,          /* bDeviceClass (in interface).     */
+                         0x00,          /* bDeviceSubClass.                 */
+                         0x00,          /* bDeviceProtocol.                 */
+                         0x40,          /* bMaxPacketSize.                  */
+                         0x0483,        /* idVendor (ST).                   */
+                         0x5720,        /* idProduct.                       */
+                         0x0200,        /* bcdDevice.                       */
+                         1,             /* iManufacturer.                   */
+                         2,             /* iProduct.                        */
+                         3,             /* iSerialNumber.                   */
+                         1)             /* bNumConfigurations.              */
+};
+
+/*
+ * Device Descriptor wrapper.
+ */
+static const USBDescriptor msc_device_descriptor = {
+  sizeof msc_device_descriptor_data,
+  msc_device_descriptor_data
+};
+
+/* Configuration Descriptor tree for a bulk-only mass storage device.*/
+static const uint8_t msc_configuration_descriptor_data[32] = {
+  /* Configuration Descriptor.*/
+  USB_DESC_CONFIGURATION(32,            /* wTotalLength.                    */
+                         0x01,          /* bNumInterfaces.                  */
+                         0x01,          /* bConfigurationValue.             */
+                         0,             /* iConfiguration.                  */
+                         0xC0,          /* bmAttributes (self powered).     */
+                         50),           /* bMaxPower (100mA).               */
+  /* Interface Descriptor.*/
+  USB_DESC_INTERFACE    (0x00,          /* bInterfaceNumber.                */
+                         0x00,          /* bAlternateSetting.               */
+                         0x02,          /* bNumEndpoints.                   */
+                         0x08,          /* bInterfaceClass (Mass Storage).  */
+                         0x06,          /* bInterfaceSubClass (SCSI
+                                           transparent command set).        */
+                         0x50,          /* bInterfaceProtocol (Bulk-Only
+                                           Transport).                      */
+                         0),            /* iInterface.                      */
+  /* Endpoint 1 IN Descriptor.*/
+  USB_DESC_ENDPOINT     (MSC_DATA_EP|0x80,              /* bEndpointAddress.*/
+                         0x02,          /* bmAttributes (Bulk).             */
+                         0x0040,        /* wMaxPacketSize.                  */
+                         0x00),         /* bInterval.                       */
+  /* Endpoint 1 OUT Descriptor.*/
+  USB_DESC_ENDPOINT     (MSC_DATA_EP,                   /* bEndpointAddress.*/
+                         0x02,          /* bmAttributes (Bulk).             */
+                         0x0040,        /* wMaxPacketSize.                  */
+                         0x00)          /* bInterval.                       */
+};
+
+/*
+ * Configuration Descriptor wrapper.
+ */
+static const USBDescriptor msc_configuration_descriptor = {
+  sizeof msc_configuration_descriptor_data,
+  msc_configuration_descriptor_data
+};
+
+/*
+ * U.S. English language identifier.
+ */
+static const uint8_t msc_string0[] = {
+  USB_DESC_BYTE(4),                     /* bLength.                         */
+  USB_DESC_BYTE(USB_DESCRIPTOR_STRING), /* bDescriptorType.                 */
+  USB_DESC_WORD(0x0409)                 /* wLANGID (U.S. English).          */
+};
+
+/*
+ * Vendor string.
+ */
+static const uint8_t msc_string1[] = {
+  USB_DESC_BYTE(38),                    /* bLength.                         */
+  USB_DESC_BYTE(USB_DESCRIPTOR_STRING), /* bDescriptorType.                 */
+  'S', 0, 'T', 0, 'M', 0, 'i', 0, 'c', 0, 'r', 0, 'o', 0, 'e', 0,
+  'l', 0, 'e', 0, 'c', 0, 't', 0, 'r', 0, 'o', 0, 'n', 0, 'i', 0,
+  'c', 0, 's', 0
+};
+
+/*
+ * Device Description string.
+ */
+static const uint8_t msc_string2[] = {
+  USB_DESC_BYTE(38),                    /* bLength.                         */
+  USB_DESC_BYTE(USB_DESCRIPTOR_STRING), /* bDescriptorType.                 */
+  'C', 0, 'h', 0, 'i', 0, 'b', 0, 'i', 0, 'O', 0, 'S', 0, '/', 0,
+  'R', 0, 'T', 0, ' ', 0, 'S', 0, 'D', 0, ' ', 0, 'C', 0, 'a', 0,
+  'r', 0, 'd', 0
+};
+
+/*
+ * Serial Number string, the host identifies the media by it.
+ */
+static const uint8_t msc_string3[] = {
+  USB_DESC_BYTE(26),                    /* bLength.                         */
+  USB_DESC_BYTE(USB_DESCRIPTOR_STRING), /* bDescriptorType.                 */
+  '0', 0, '0', 0, '0', 0, '0', 0, '0', 0, '0', 0,
+  '0', 0, '0', 0, '0', 0,
+  '0' + CH_KERNEL_MAJOR, 0,
+  '0' + CH_KERNEL_MINOR, 0,
+  '0' + CH_KERNEL_PATCH, 0
+};
+
+/*
+ * Strings wrappers array.
+ */
+static const USBDescriptor msc_strings[] = {
+  {sizeof msc_string0, msc_string0},
+  {sizeof msc_string1, msc_string1},
+  {sizeof msc_string2, msc_string2},
+  {sizeof msc_string3, msc_string3}
+};
+
+/*
+ * Handles the GET_DESCRIPTOR callback. All required descriptors must be
+ * handled here.
+ */
+static const USBDescriptor *get_descriptor(USBDriver *usbp,
+                                           uint8_t dtype,
+                                           uint8_t dindex,
+                                           uint16_t lang) {
+
+  (void)usbp;
+  (void)lang;
+  switch (dtype) {
+  case USB_DESCRIPTOR_DEVICE:
+    return &msc_device_descriptor;
+  case USB_DESCRIPTOR_CONFIGURATION:
+    return &msc_configuration_descriptor;
+  case USB_DESCRIPTOR_STRING:
+    if (dindex < 4)
+      return &msc_strings[dindex];
+  }
+  return NULL;
+}
+
+/**
+ * @brief   IN EP1 state.
+ */
+static USBInEndpointState ep1instate;
+
+/**
+ * @brief   OUT EP1 state.
+ */
+static USBOutEndpointState ep1outstate;
+
+/**
+ * @brief   EP1 initialization structure (both IN and OUT).
+ */
+static const USBEndpointConfig ep1config = {
+  USB_EP_MODE_TYPE_BULK,
+  NULL,
+  mscDataTransmitted,
+  mscDataReceived,
+  0x0040,
+  0x0040,
+  &ep1instate,
+  &ep1outstate,
+  2,
+  NULL
+};
+
+/*
+ * Handles the USB driver global events.
+ */
+static void usb_event(USBDriver *usbp, usbevent_t event) {
+
+  switch (event) {
+  case USB_EVENT_RESET:
+    chSysLockFromIsr();
+    mscConfigureHookI(usbp);
+    chSysUnlockFromIsr();
+    return;
+  case USB_EVENT_ADDRESS:
+    return;
+  case USB_EVENT_CONFIGURED:
+    chSysLockFromIsr();
+
+    /* Enables the endpoints specified into the configuration.
+       Note, this callback is invoked from an ISR so I-Class functions
+       must be used.*/
+    usbInitEndpointI(usbp, MSC_DATA_EP, &ep1config);
+
+    /* Restarting the mass storage driver from the CBW reception.*/
+    mscConfigureHookI(usbp);
+
+    chSysUnlockFromIsr();
+    return;
+  case USB_EVENT_SUSPEND:
+    return;
+  case USB_EVENT_WAKEUP:
+    return;
+  case USB_EVENT_STALLED:
+    return;
+  }
+  return;
+}
+
+/*
+ * USB driver configuration.
+ */
+static const USBConfig usbcfg = {
+  usb_event,
+  get_descriptor,
+  mscRequestsHook,
+  NULL
+};
+
+/*
+ * Mass storage driver configuration, the SD card is the only LUN.
+ */
+static const USBMassStorageConfig msccfg = {
+  &USBD1,
+  (BaseBlockDevice *)&SDCD1,
+  MSC_DATA_EP,
+  MSC_DATA_EP
+};
+
+/*===========================================================================*/
+/* SD card related.                                                          */
+/*===========================================================================*/
+
+/*
+ * SDIO configuration.
+ */
+static const SDCConfig sdccfg = {
+  0
+};
+
+/*
+ * The card is wired to the SDIO pins without detect and write protect
+ * switches.
+ */
+bool_t sdc_lld_is_card_inserted(SDCDriver *sdcp) {
+
+  (void)sdcp;
+  return TRUE;
+}
+
+bool_t sdc_lld_is_write_protected(SDCDriver *sdcp) {
+
+  (void)sdcp;
+  return FALSE;
+}
+
+/*===========================================================================*/
+/* Generic code.                                                             */
+/*===========================================================================*/
+
+/*
+ * Green LED blinker thread, times are in milliseconds. The LED blinks
+ * faster once the card is connected.
+ */
+static WORKING_AREA(waThread1, 128);
+static msg_t Thread1(void *arg) {
+
+  (void)arg;
+  chRegSetThreadName("blinker");
+  while (TRUE) {
+    systime_t time;
+
+    time = blkGetDriverState(&SDCD1) != BLK_ACTIVE ? 250 : 500;
+    palClearPad(GPIOD, GPIOD_LED4);
+    chThdSleepMilliseconds(time);
+    palSetPad(GPIOD, GPIOD_LED4);
+    chThdSleepMilliseconds(time);
+  }
+}
+
+/*
+ * Application entry point.
+ */
+int main(void) {
+
+  /*
+   * System initializations.
+   * - HAL initialization, this also initializes the configured device drivers
+   *   and performs the board-specific initializations.
+   * - Kernel initialization, the main() function becomes a thread and the
+   *   RTOS is active.
+   */
+  halInit();
+  chSysInit();
+
+  /*
+   * SDIO pins, PC8-PC11 data, PC12 clock and PD2 command. PC10 and PC12
+   * are shared with the audio DAC I2S lines, the DAC is kept in reset.
+   */
+  palSetGroupMode(GPIOC, 0x0F, 8,
+                  PAL_MODE_ALTERNATE(12) | PAL_STM32_OSPEED_HIGHEST |
+                  PAL_STM32_PUDR_PULLUP);
+  palSetPadMode(GPIOC, 12,
+                PAL_MODE_ALTERNATE(12) | PAL_STM32_OSPEED_HIGHEST);
+  palSetPadMode(GPIOD, GPIOD_PIN2,
+                PAL_MODE_ALTERNATE(12) | PAL_STM32_OSPEED_HIGHEST |
+                PAL_STM32_PUDR_PULLUP);
+
+  /*
+   * Activates the card, the mass storage driver reports the media as not
+   * present until the connection succeeds.
+   */
+  sdcStart(&SDCD1, &sdccfg);
+  sdcConnect(&SDCD1);
+
+  /*
+   * Initializes the mass storage driver.
+   */
+  mscObjectInit(&MSD1);
+  mscStart(&MSD1, &msccfg);
+
+  /*
+   * Activates the USB driver and then the USB bus pull-up on D+.
+   * Note, a delay is inserted in order to not have to disconnect the cable
+   * after a reset.
+   */
+  usbDisconnectBus(msccfg.usbp);
+  chThdSleepMilliseconds(1000);
+  usbStart(msccfg.usbp, &usbcfg);
+  usbConnectBus(msccfg.usbp);
+
+  /*
+   * Creates the blinker thread.
+   */
+  chThdCreateStatic(waThread1, sizeof(waThread1), NORMALPRIO, Thread1, NULL);
+
+  /*
+   * Normal main() thread activity, a card inserted after the start is
+   * connected here.
+   */
+  while (TRUE) {
+    if (blkGetDriverState(&SDCD1) == BLK_ACTIVE)
+      sdcConnect(&SDCD1);
+    chThdSleepMilliseconds(1000);
+  }
+}